@@ -0,0 +1,383 @@
+// appulses.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for searching for asteroids which pass close to (or in front of) any of a list of stars.
+// The stars are sorted into cells on the sky. Each asteroid's track is then followed in steps, and for each step
+// only the stars in the cells near the track are considered. The time and separation of closest approach are only
+// refined for those candidate stars.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/orbitalElements.h"
+#include "ephemCalc/orbitalElementsIndex.h"
+#include "ephemCalc/starIndex.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/brent.h"
+#include "mathsTools/julianDate.h"
+#include "mathsTools/sphericalAst.h"
+
+// The maximum number of candidate stars considered near any one step of an asteroid's track
+#define MAX_STAR_CANDIDATES 4096
+
+// Asteroids' tracks are not straight lines, so the circle searched around each step of a track is made this much
+// larger than the track's half-length
+#define APPULSE_TRACK_SAFETY 1.5
+
+// Precision with which times of closest approach are refined; days
+#define APPULSE_TIME_TOLERANCE 1e-7
+
+static const char *const usage[] = {
+        "appulses.bin [options] [[--] args]",
+        "appulses.bin [options]",
+        NULL,
+};
+
+//! appulse_settings - The settings which describe the search we are to perform
+typedef struct {
+    double jd_min, jd_max, jd_step;  // TT; days
+    double threshold;  // arcseconds
+    const char *star_list;
+    double star_epoch;  // TT
+    double cell_size;  // degrees
+    double mag_max;
+    orbitalElementsFilter filter;
+} appulse_settings;
+
+// Parameters passed to the function which Brent's method minimises when refining appulses
+typedef struct {
+    int body_id;
+    const starIndex *stars;
+    int star;
+} appulse_params;
+
+//! appulse_separation - Compute the angular separation between an asteroid and a star at a particular time
+//! \param [in] jd - Julian date; TT
+//! \param [in] params - An appulse_params structure describing the asteroid and star
+//! \return - The angular separation; radians
+
+static double appulse_separation(const double jd, void *params) {
+    const appulse_params *p = (const appulse_params *) params;
+    double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+    double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+    double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+    double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+    double star_ra, star_dec;
+
+    orbitalElements_computeEphemeris(p->body_id, jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size, &phy_size,
+                                     &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                     &ecliptic_longitude, &ecliptic_latitude, &ecliptic_distance, 2451545.0,
+                                     0, 0, 0);
+    starIndex_position(p->stars, p->star, jd, &star_ra, &star_dec);
+    return angDist_RADec(ra, dec, star_ra, star_dec);
+}
+
+//! appulse_report - Write an appulse to stdout, in the same format as the events reported by asteroids.bin
+//! \param [in] slot - The slot occupied by the asteroid
+//! \param [in] stars - The star index
+//! \param [in] star - The number of the star
+//! \param [in] jd - The time of closest approach; TT
+//! \param [in] separation - The separation at closest approach; radians
+
+static void appulse_report(const int slot, const starIndex *stars, const int star, const double jd,
+                           const double separation) {
+    int year, month, day, hour, min, status, j;
+    double sec;
+    double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+    double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+    double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+    double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+    const orbitalElementsMetadata *metadata = orbitalElements_asteroids_fetchMetadata(slot);
+    orbitalElements_computeEphemeris(10000000 + metadata->number, jd, &x, &y, &z, &ra, &dec, &mag, &phase,
+                                     &ang_size, &phy_size, &albedo, &sun_dist, &earth_dist, &sun_ang_dist,
+                                     &theta_eso, &ecliptic_longitude, &ecliptic_latitude, &ecliptic_distance,
+                                     2451545.0, 0, 0, 0);
+
+    // The asteroid passes in front of the star, as seen from the geocentre, if the separation is less than its radius
+    const double separation_arcsec = separation * 180 / M_PI * 3600;
+    const char *type = (separation_arcsec < ang_size / 2) ? "Occultation" : "Appulse    ";
+
+    char name_no_spaces[1024];
+    for (j = 0; metadata->name[j] != '\0'; j++) {
+        name_no_spaces[j] = metadata->name[j];
+        if (metadata->name[j] == ' ') name_no_spaces[j] = '@';
+    }
+    name_no_spaces[j] = '\0';
+
+#pragma omp critical (file_appulse)
+    {
+        inv_julian_day(jd, &year, &month, &day, &hour, &min, &sec, &status, temp_err_string);
+        fprintf(stdout, "%14.6f %04d %02d %02d %02d %02d %02d %s   %9.4f %6.1f %8.3f   %10.6f %10.6f %s   %07d %s %s\n",
+                jd, year, month, day, hour, min, (int) sec, type, separation_arcsec, mag, earth_dist, ra, dec,
+                constellations_fetch(ra, dec), metadata->number, name_no_spaces, stars->name[star]);
+        fflush(stdout);
+    }
+}
+
+//! appulse_run - Search the selected asteroids for appulses with the stars in the star list
+//! \param [in] s - The settings for the search
+
+void appulse_run(appulse_settings *s) {
+    int i;
+    const double threshold = s->threshold / 3600 * M_PI / 180;
+
+    const starIndex *stars = starIndex_load(s->star_list, s->star_epoch, s->cell_size * M_PI / 180);
+
+    // Select asteroids by their orbital elements
+    orbitalElements_asteroids_init();
+    int *slots = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+    if (slots == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Inclinations are specified in degrees on the command line
+    s->filter.inc_min *= M_PI / 180;
+    s->filter.inc_max *= M_PI / 180;
+    const int candidate_count = orbitalElementsIndex_asteroids_query(&s->filter, slots);
+
+    // Look up the bodyId of each asteroid once, so that the cold table of metadata is not touched within the loop
+    int *body_ids = (int *) lt_malloc((candidate_count + 1) * sizeof(int));
+    if (body_ids == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    for (i = 0; i < candidate_count; i++) {
+        body_ids[i] = 10000000 + orbitalElements_asteroids_fetchMetadata(slots[i])->number;
+    }
+
+    // Positions and magnitudes of each asteroid at the start and end of each step
+    double *ra_0 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    double *dec_0 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    double *mag_0 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    double *ra_1 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    double *dec_1 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    double *mag_1 = (double *) lt_malloc((candidate_count + 1) * sizeof(double));
+    if ((ra_0 == NULL) || (dec_0 == NULL) || (mag_0 == NULL) || (ra_1 == NULL) || (dec_1 == NULL) ||
+        (mag_1 == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Searching %d asteroids for appulses with %d stars.",
+                 candidate_count, stars->star_count);
+        ephem_log(temp_err_string);
+    }
+
+    double jd_0 = s->jd_min;
+    int first_step = 1;
+    while (jd_0 < s->jd_max) {
+        const double jd_1 = first_step ? jd_0 : GSL_MIN(jd_0 + s->jd_step, s->jd_max);
+
+        // The positions of the Earth and Sun are the same for every object, so only look them up once
+        orbitalElementsEpochState epoch_state;
+        orbitalElements_computeEpochState(jd_1, &epoch_state);
+
+#pragma omp parallel for shared(epoch_state, slots, body_ids, ra_0, dec_0, mag_0, ra_1, dec_1, mag_1) private(i) \
+    schedule(dynamic, 64)
+        for (i = 0; i < candidate_count; i++) {
+            int j;
+            double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+            double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+            double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+            double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+            int star_candidates[MAX_STAR_CANDIDATES];
+
+            const int body_id = body_ids[i];
+            orbitalElements_computeEphemerisAtEpoch(body_id, &epoch_state, &x, &y, &z, &ra, &dec, &mag,
+                                                    &phase, &ang_size, &phy_size,
+                                                    &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                                    &ecliptic_longitude, &ecliptic_latitude,
+                                                    &ecliptic_distance, 2451545.0,
+                                                    0, 0, 0);
+            ra_1[i] = ra;
+            dec_1[i] = dec;
+            mag_1[i] = mag;
+
+            if (first_step) continue;
+            if ((!gsl_finite(ra_0[i])) || (!gsl_finite(ra_1[i]))) continue;
+            if (GSL_MIN(mag_0[i], mag_1[i]) > s->mag_max) continue;
+
+            // Find the stars near to this step of the asteroid's track. We search a circle centred on the midpoint
+            // of the track.
+            const double x_mid = cos(ra_0[i]) * cos(dec_0[i]) + cos(ra_1[i]) * cos(dec_1[i]);
+            const double y_mid = sin(ra_0[i]) * cos(dec_0[i]) + sin(ra_1[i]) * cos(dec_1[i]);
+            const double z_mid = sin(dec_0[i]) + sin(dec_1[i]);
+            const double ra_mid = atan2(y_mid, x_mid);
+            const double dec_mid = atan2(z_mid, gsl_hypot(x_mid, y_mid));
+            const double track_length = angDist_RADec(ra_0[i], dec_0[i], ra_1[i], dec_1[i]);
+            const double radius = APPULSE_TRACK_SAFETY * track_length / 2 + threshold;
+
+            const int star_count = starIndex_query(stars, ra_mid, dec_mid, radius, jd_0, jd_1,
+                                                   star_candidates, MAX_STAR_CANDIDATES);
+            if (star_count > MAX_STAR_CANDIDATES) {
+                // <ephem_warning> uses global buffers, so only one thread may call it at a time
+                char warning_string[FNAME_LENGTH];
+                snprintf(warning_string, FNAME_LENGTH,
+                         "Asteroid %d passes %d stars at JD %.1f; only considering the first %d.",
+                         body_id - 10000000, star_count, jd_0, MAX_STAR_CANDIDATES);
+#pragma omp critical (appulse_warning)
+                ephem_warning(warning_string);
+            }
+
+            // Refine the closest approach to each candidate star. We search half a step either side, but only
+            // report minima which fall within this step, so that no minimum is reported twice.
+            for (j = 0; j < GSL_MIN(star_count, MAX_STAR_CANDIDATES); j++) {
+                double jd_closest;
+                appulse_params params;
+                params.body_id = body_id;
+                params.stars = stars;
+                params.star = star_candidates[j];
+
+                const double separation = brent_minimise(appulse_separation, &params,
+                                                         jd_0 - s->jd_step / 2, (jd_0 + jd_1) / 2,
+                                                         jd_1 + s->jd_step / 2,
+                                                         APPULSE_TIME_TOLERANCE, &jd_closest);
+
+                if (separation > threshold) continue;
+                if ((jd_closest < jd_0) || (jd_closest > jd_1)) continue;
+                if ((jd_closest == jd_1) && (jd_1 < s->jd_max)) continue;
+                appulse_report(slots[i], stars, star_candidates[j], jd_closest, separation);
+            }
+        }
+
+        // Move on to the next step
+        {
+            double *swap;
+            swap = ra_0;
+            ra_0 = ra_1;
+            ra_1 = swap;
+            swap = dec_0;
+            dec_0 = dec_1;
+            dec_1 = swap;
+            swap = mag_0;
+            mag_0 = mag_1;
+            mag_1 = swap;
+        }
+        jd_0 = jd_1;
+        first_step = 0;
+    }
+}
+
+int main(int argc, const char **argv) {
+    appulse_settings s;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising appulse search.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default appulse search parameters.");
+    s.jd_min = 2451545.0;
+    s.jd_max = 2451545.0 + 365.25;
+    s.jd_step = 1;
+    s.threshold = 10;
+    s.star_list = NULL;
+    s.star_epoch = 2451545.0;
+    s.cell_size = 0.5;
+    s.mag_max = 99;
+    orbitalElementsIndex_defaultFilter(&s.filter);
+    s.filter.secure_only = 0;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_STRING('s', "stars", &s.star_list,
+                       "Text file listing stars: name, RA and Dec (J2000; degrees), and optionally proper motion "
+                       "in RA*cos(Dec) and Dec (mas/yr)"),
+            OPT_FLOAT('E', "star_epoch", &s.star_epoch, "The epoch of the star positions; TT"),
+            OPT_FLOAT('a', "jd_min", &s.jd_min, "The Julian day number at which to start searching; TT"),
+            OPT_FLOAT('b', "jd_max", &s.jd_max, "The Julian day number at which to stop searching; TT"),
+            OPT_FLOAT('j', "jd_step", &s.jd_step, "The length of each step of the asteroids' tracks; days"),
+            OPT_FLOAT('t', "threshold", &s.threshold, "The largest separation to report; arcseconds"),
+            OPT_FLOAT('g', "cell_size", &s.cell_size, "The size of the cells the stars are sorted into; degrees"),
+            OPT_FLOAT('m', "mag_max", &s.mag_max, "The faintest magnitude of asteroids to consider"),
+            OPT_GROUP("Selection of asteroids"),
+            OPT_FLOAT(0, "a_min", &s.filter.a_min, "Minimum semi-major axis (AU)"),
+            OPT_FLOAT(0, "a_max", &s.filter.a_max, "Maximum semi-major axis (AU)"),
+            OPT_FLOAT(0, "e_min", &s.filter.e_min, "Minimum eccentricity"),
+            OPT_FLOAT(0, "e_max", &s.filter.e_max, "Maximum eccentricity"),
+            OPT_FLOAT(0, "i_min", &s.filter.inc_min, "Minimum inclination (deg)"),
+            OPT_FLOAT(0, "i_max", &s.filter.inc_max, "Maximum inclination (deg)"),
+            OPT_FLOAT(0, "q_min", &s.filter.q_min, "Minimum perihelion distance (AU)"),
+            OPT_FLOAT(0, "q_max", &s.filter.q_max, "Maximum perihelion distance (AU)"),
+            OPT_FLOAT(0, "H_min", &s.filter.H_min, "Minimum absolute magnitude"),
+            OPT_FLOAT(0, "H_max", &s.filter.H_max, "Maximum absolute magnitude"),
+            OPT_INTEGER(0, "secure_only", &s.filter.secure_only,
+                        "Set to 1 to include only asteroids with secure orbits"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nSearch for asteroids passing close to any of a list of stars",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    if (s.star_list == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "A list of stars must be supplied with the --stars option.");
+        exit(1);
+    }
+
+    if ((s.jd_step <= 0) || (s.cell_size <= 0)) {
+        ephem_fatal(__FILE__, __LINE__, "The time step and cell size must be positive.");
+        exit(1);
+    }
+
+    // Perform search
+    appulse_run(&s);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
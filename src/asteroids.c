@@ -27,6 +27,8 @@
 // * The ending JD
 // * The magnitude limit (i.e. the faintest magnitude an asteroid may have at opposition to be listed)
 
+// Optionally, the search may be restricted to asteroids with orbital elements in specified ranges, e.g. to NEOs
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,6 +47,7 @@
 #include "ephemCalc/jpl.h"
 #include "ephemCalc/magnitudeEstimate.h"
 #include "ephemCalc/orbitalElements.h"
+#include "ephemCalc/orbitalElementsIndex.h"
 
 #include "listTools/ltMemory.h"
 
@@ -54,11 +57,16 @@
 
 #define N_INPUTS 7
 
-void file_event(int report, int i, const char *name, char *type, double JD, double mag, double earth_dist,
+void file_event(int report, int i, char *type, double JD, double mag, double earth_dist,
                 double ra, double dec) {
     int year, month, day, hour, min, j;
     double sec;
 
+    // The asteroid's name is only needed when we report an event, so it's kept out of the orbital elements we scan
+    const orbitalElementsMetadata *metadata = orbitalElements_asteroids_fetchMetadata(i);
+    const char *name = metadata->name;
+    const orbitalElements *elements = orbitalElements_asteroids_fetch(i);
+
     char name_no_spaces[1024];
     for (j = 0; name[j] != '\0'; j++) {
         name_no_spaces[j] = name[j];
@@ -73,11 +81,11 @@ void file_event(int report, int i, const char *name, char *type, double JD, doub
                  "%10.1f %04d %02d %02d %02d %02d %s   %6.1f %8.3f   %10.6f %10.6f %s   "
                  "%07d %s %.16e %.16e %.16e %.16e %.16e %.16e %.16e",
                  JD, year, month, day, hour, min, type, mag, earth_dist, ra, dec,
-                 constellations_fetch(ra, dec), i, name_no_spaces,
-                 asteroid_database[i].semiMajorAxis, asteroid_database[i].eccentricity,
-                 asteroid_database[i].longAscNode, asteroid_database[i].inclination,
-                 asteroid_database[i].argumentPerihelion, asteroid_database[i].meanAnomaly,
-                 asteroid_database[i].epochOsculation);
+                 constellations_fetch(ra, dec), metadata->number, name_no_spaces,
+                 elements->semiMajorAxis, elements->eccentricity,
+                 elements->longAscNode, elements->inclination,
+                 elements->argumentPerihelion, elements->meanAnomaly,
+                 elements->epochOsculation);
         if (report) {
             fprintf(stdout, "%s\n", temp_err_string);
             fflush(stdout);
@@ -94,73 +102,91 @@ void scan_for_oppositions(settings *s, double jd_min, double jd_max, double jd_s
     double jd;
     int max_iters;
 
+    // If we have not been given a list of asteroids to scan, then scan all of those with secure orbits
     if (selected_in == NULL) {
-        max_iters = asteroid_count - 1;
-    } else {
-        for (j = 0; 1; j++) {
-            int i = selected_in[j];
-            if (i < 0) {
-                max_iters = j;
-                break;
-            }
+        orbitalElementsFilter filter;
+        int *secure = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+        if (secure == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail");
+            exit(1);
         }
+        orbitalElementsIndex_defaultFilter(&filter);
+        orbitalElementsIndex_asteroids_query(&filter, secure);
+        selected_in = secure;
+    }
+
+    for (j = 0; 1; j++) {
+        int i = selected_in[j];
+        if (i < 0) {
+            max_iters = j;
+            break;
+        }
+    }
+
+    // Look up the bodyId of each asteroid once, so that the cold table of metadata is not touched within the loop
+    int *body_id = (int *) lt_malloc((max_iters + 1) * sizeof(int));
+    if (body_id == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail");
+        exit(1);
+    }
+    for (j = 0; j < max_iters; j++) {
+        body_id[j] = 10000000 + orbitalElements_asteroids_fetchMetadata(selected_in[j])->number;
     }
 
     // Loop, day by day, over search period
     for (jd = jd_min, loop_iter = 0; jd <= jd_max; jd += jd_step, loop_iter++) {
         //if (DEBUG) {
         // snprintf(temp_err_string, FNAME_LENGTH, "Starting work on day %.1f",jd); ephem_log(temp_err_string); }
-#pragma omp parallel for shared(jd, loop_iter, max_iters, so_count) private(j)
+
+        // The positions of the Earth and Sun are the same for every asteroid, so only look them up once per time step
+        orbitalElementsEpochState epoch_state;
+        orbitalElements_computeEpochState(jd, &epoch_state);
+
+#pragma omp parallel for shared(jd, loop_iter, max_iters, so_count, epoch_state, body_id) private(j)
         for (j = 0; j < max_iters; j++) {
-            int i;
-            if (selected_in == NULL) { i = j + 1; }
-            else { i = selected_in[j]; }
-
-            if (asteroid_database[i].secureOrbit) {
-                double ra = 0, dec = 0, x = 0, y = 0, z = 0;
-                double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
-                double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
-                double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
-
-                orbitalElements_computeEphemeris(10000000 + i, jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size,
-                                                 &phy_size,
-                                                 &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
-                                                 &ecliptic_longitude, &ecliptic_latitude,
-                                                 &ecliptic_distance, s->ra_dec_epoch,
-                                                 0, 0, 0);
-
-                // Check if asteroid is both bright, also at opposition
-                if ((mag < mag_limit) && (loop_iter > 2)) {
-                    if (selected_out != NULL) {
-                        int got = 0, c = 0;
+            // Each asteroid is identified by the slot it occupies in the densely packed table of orbital elements
+            const int i = selected_in[j];
+
+            double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+            double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+            double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+            double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+            orbitalElements_computeEphemerisAtEpoch(body_id[j], &epoch_state, &x, &y, &z, &ra, &dec, &mag,
+                                                    &phase, &ang_size, &phy_size,
+                                                    &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                                    &ecliptic_longitude, &ecliptic_latitude,
+                                                    &ecliptic_distance, s->ra_dec_epoch,
+                                                    0, 0, 0);
+
+            // Check if asteroid is both bright, also at opposition
+            if ((mag < mag_limit) && (loop_iter > 2)) {
+                if (selected_out != NULL) {
+                    int got = 0, c = 0;
 #pragma omp critical (select_asteroid)
-                        {
-                            for (c = 0; c < so_count; c++)
-                                if (selected_out[c] == i) {
-                                    got = 1;
-                                    break;
-                                }
-                            if (!got) selected_out[so_count++] = i;
-                        }
+                    {
+                        for (c = 0; c < so_count; c++)
+                            if (selected_out[c] == i) {
+                                got = 1;
+                                break;
+                            }
+                        if (!got) selected_out[so_count++] = i;
                     }
-                    if ((sun_ang_dist_1[i] > sun_ang_dist) && (sun_ang_dist_1[i] > sun_ang_dist_2[i]))
-                        file_event(report, i, asteroid_database[i].name, "Opposition", jd - jd_step, mag, earth_dist,
-                                   ra, dec);
-                    if ((earth_dist_1[i] < earth_dist) && (earth_dist_1[i] < earth_dist_2[i]))
-                        file_event(report, i, asteroid_database[i].name, "Apogee    ", jd - jd_step, mag, earth_dist,
-                                   ra, dec);
-                    if ((mag1[i] < mag) && (mag1[i] < mag2[i]))
-                        file_event(report, i, asteroid_database[i].name, "PeakMag   ", jd - jd_step, mag, earth_dist,
-                                   ra, dec);
                 }
-
-                sun_ang_dist_2[i] = sun_ang_dist_1[i];
-                sun_ang_dist_1[i] = sun_ang_dist;
-                earth_dist_2[i] = earth_dist_1[i];
-                earth_dist_1[i] = earth_dist;
-                mag2[i] = mag1[i];
-                mag1[i] = mag;
+                if ((sun_ang_dist_1[i] > sun_ang_dist) && (sun_ang_dist_1[i] > sun_ang_dist_2[i]))
+                    file_event(report, i, "Opposition", jd - jd_step, mag, earth_dist, ra, dec);
+                if ((earth_dist_1[i] < earth_dist) && (earth_dist_1[i] < earth_dist_2[i]))
+                    file_event(report, i, "Apogee    ", jd - jd_step, mag, earth_dist, ra, dec);
+                if ((mag1[i] < mag) && (mag1[i] < mag2[i]))
+                    file_event(report, i, "PeakMag   ", jd - jd_step, mag, earth_dist, ra, dec);
             }
+
+            sun_ang_dist_2[i] = sun_ang_dist_1[i];
+            sun_ang_dist_1[i] = sun_ang_dist;
+            earth_dist_2[i] = earth_dist_1[i];
+            earth_dist_1[i] = earth_dist;
+            mag2[i] = mag1[i];
+            mag1[i] = mag;
         }
     }
     if (selected_out != NULL) {
@@ -172,6 +198,25 @@ void scan_for_oppositions(settings *s, double jd_min, double jd_max, double jd_s
     }
 }
 
+//! filter_switch - Look up which field of an orbitalElementsFilter structure is set by a command-line switch
+//! \param [in] arg - The command-line switch
+//! \param [in] filter - The filter structure
+//! \return - Pointer to the field to set, or NULL if the switch is not recognised
+
+double *filter_switch(const char *arg, orbitalElementsFilter *filter) {
+    if (strcmp(arg, "--a_min") == 0) return &filter->a_min;
+    if (strcmp(arg, "--a_max") == 0) return &filter->a_max;
+    if (strcmp(arg, "--e_min") == 0) return &filter->e_min;
+    if (strcmp(arg, "--e_max") == 0) return &filter->e_max;
+    if (strcmp(arg, "--i_min") == 0) return &filter->inc_min;
+    if (strcmp(arg, "--i_max") == 0) return &filter->inc_max;
+    if (strcmp(arg, "--q_min") == 0) return &filter->q_min;
+    if (strcmp(arg, "--q_max") == 0) return &filter->q_max;
+    if (strcmp(arg, "--H_min") == 0) return &filter->H_min;
+    if (strcmp(arg, "--H_max") == 0) return &filter->H_max;
+    return NULL;
+}
+
 int main(int argc, char **argv) {
     char help_string[LSTR_LENGTH], version_string[FNAME_LENGTH], version_string_underline[FNAME_LENGTH];
     int i, inputs_read = 0;
@@ -181,7 +226,8 @@ int main(int argc, char **argv) {
     double *sun_ang_dist_1, *sun_ang_dist_2;
     double *earth_dist_1, *earth_dist_2;
     double *mag1, *mag2;
-    int *selected;
+    int *selected, *candidates;
+    orbitalElementsFilter filter;
 
     // Step through 4 days at a time looking for oppositions
     const double jd_step_pass_1 = 4;
@@ -200,14 +246,23 @@ int main(int argc, char **argv) {
     // Make help and version strings
     snprintf(version_string, FNAME_LENGTH, "Asteroid Opposition Search %s", DCFVERSION);
 
-    snprintf(help_string, FNAME_LENGTH,
+    snprintf(help_string, LSTR_LENGTH,
              "Asteroid Opposition Search %s\n"
              "%s\n\n"
              "Usage: asteroids.bin <YearMin> <MonthMin> <DayMin>  <YearMax> <MonthMax> <DayMax>  <LimitingMagnitude>\n"
              "-h, --help:       Display this help.\n"
-             "-v, --version:    Display version number.",
+             "-v, --version:    Display version number.\n"
+             "--a_min <x>, --a_max <x>:  Only search asteroids with semi-major axes in this range (AU).\n"
+             "--e_min <x>, --e_max <x>:  Only search asteroids with eccentricities in this range.\n"
+             "--i_min <x>, --i_max <x>:  Only search asteroids with inclinations in this range (deg).\n"
+             "--q_min <x>, --q_max <x>:  Only search asteroids with perihelion distances in this range (AU).\n"
+             "--H_min <x>, --H_max <x>:  Only search asteroids with absolute magnitudes in this range.\n"
+             "--secure_only <0|1>:       Only search asteroids with secure orbits (default 1).",
              DCFVERSION, str_underline(version_string, version_string_underline));
 
+    // By default, search all asteroids with secure orbits
+    orbitalElementsIndex_defaultFilter(&filter);
+
     // Scan command line options for any switches
     for (i = 1; i < argc; i++) {
         if (strlen(argv[i]) == 0) continue;
@@ -238,6 +293,20 @@ int main(int argc, char **argv) {
                    (strcmp(argv[i], "--help") == 0)) {
             ephem_report(help_string);
             return 0;
+        } else if ((filter_switch(argv[i], &filter) != NULL) || (strcmp(argv[i], "--secure_only") == 0)) {
+            // Switches which restrict the search to a range of orbital elements take a numeric value
+            if ((i + 1 >= argc) || !valid_float(argv[i + 1], NULL)) {
+                snprintf(temp_err_string, FNAME_LENGTH,
+                         "Switch '%s' should be followed by a numeric value.\n"
+                         "Type 'asteroids.bin -help' for a list of available command-line options.",
+                         argv[i]);
+                ephem_error(temp_err_string);
+                return 1;
+            }
+            const double value = get_float(argv[i + 1], NULL);
+            if (strcmp(argv[i], "--secure_only") == 0) filter.secure_only = (value != 0);
+            else *filter_switch(argv[i], &filter) = value;
+            i++;
         } else {
             snprintf(temp_err_string, FNAME_LENGTH,
                      "Received switch '%s' which was not recognised.\n"
@@ -268,6 +337,10 @@ int main(int argc, char **argv) {
     jd_max = julian_day((int) input[3], (int) input[4], (int) input[5], 12, 0, 0, &i, temp_err_string);
     mag_limit = input[6];
 
+    // Inclinations are specified in degrees on the command line
+    filter.inc_min *= M_PI / 180;
+    filter.inc_max *= M_PI / 180;
+
     // Open asteroid database
     orbitalElements_asteroids_init();
 
@@ -276,11 +349,8 @@ int main(int argc, char **argv) {
         ephem_log(temp_err_string);
     }
 
-    // Read contents of the asteroid database
-    fseek(asteroid_database_file, asteroid_database_offset, SEEK_SET);
-    dcf_fread((void *) asteroid_database, sizeof(orbitalElements), asteroid_count, asteroid_database_file,
-              asteroid_database_filename, __FILE__, __LINE__);
-    memset(asteroid_database_items_loaded, 1, asteroid_count);
+    // Read the orbital elements of every asteroid. Their names and flags are read separately, when needed.
+    orbitalElements_asteroids_loadAll();
 
     // Malloc arrays for keeping track of solar distance of asteroids
     sun_ang_dist_1 = (double *) lt_malloc(asteroid_count * sizeof(double));
@@ -289,9 +359,10 @@ int main(int argc, char **argv) {
     earth_dist_2 = (double *) lt_malloc(asteroid_count * sizeof(double));
     mag1 = (double *) lt_malloc(asteroid_count * sizeof(double));
     mag2 = (double *) lt_malloc(asteroid_count * sizeof(double));
-    selected = (int *) lt_malloc(asteroid_count * sizeof(int));
+    selected = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+    candidates = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
     if ((sun_ang_dist_1 == NULL) || (sun_ang_dist_2 == NULL) || (earth_dist_1 == NULL) || (earth_dist_2 == NULL) ||
-        (mag1 == NULL) || (mag2 == NULL) || (selected == NULL)) {
+        (mag1 == NULL) || (mag2 == NULL) || (selected == NULL) || (candidates == NULL)) {
         ephem_fatal(__FILE__, __LINE__, "Malloc fail");
         exit(1);
     }
@@ -304,13 +375,16 @@ int main(int argc, char **argv) {
     for (i = 0; i < asteroid_count; i++) mag1[i] = 900.;
     for (i = 0; i < asteroid_count; i++) mag2[i] = 800.;
 
+    // Select the asteroids whose orbital elements lie within the requested ranges
+    orbitalElementsIndex_asteroids_query(&filter, candidates);
+
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "Starting pass 1.");
         ephem_log(temp_err_string);
     }
     scan_for_oppositions(&s_model, jd_min, jd_max, jd_step_pass_1, mag_limit, 0, sun_ang_dist_1, sun_ang_dist_2,
                          earth_dist_1,
-                         earth_dist_2, mag1, mag2, NULL, selected);
+                         earth_dist_2, mag1, mag2, candidates, selected);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "Starting pass 2.");
         ephem_log(temp_err_string);
@@ -0,0 +1,268 @@
+// closeApproaches.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for searching the asteroid catalogue for close approaches to the Earth and other planets.
+// Each asteroid's minimum orbit intersection distance (MOID) with each planet's orbit is computed first, and only
+// asteroids whose orbits pass within the distance threshold of the planet's orbit are searched in detail.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/closeApproach.h"
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/orbitalElements.h"
+#include "ephemCalc/orbitalElementsIndex.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+// The maximum number of planets which may be searched
+#define MAX_PLANETS_SEARCHED 16
+
+// The maximum number of close approaches reported for each asteroid and planet
+#define MAX_APPROACHES 1024
+
+static const char *const usage[] = {
+        "closeApproaches.bin [options] [[--] args]",
+        "closeApproaches.bin [options]",
+        NULL,
+};
+
+//! close_approach_settings - The settings which describe the search we are to perform
+typedef struct {
+    double jd_min, jd_max;  // TT
+    double threshold;  // AU
+    const char *planets;
+    orbitalElementsFilter filter;
+} close_approach_settings;
+
+//! close_approach_report - Write a close approach to stdout
+//! \param [in] slot - The slot occupied by the asteroid
+//! \param [in] event - The close approach
+
+void close_approach_report(const int slot, const closeApproachEvent *event) {
+    int year, month, day, hour, min, status, j;
+    double sec;
+
+    const orbitalElementsMetadata *metadata = orbitalElements_asteroids_fetchMetadata(slot);
+    char name_no_spaces[1024];
+    for (j = 0; metadata->name[j] != '\0'; j++) {
+        name_no_spaces[j] = metadata->name[j];
+        if (metadata->name[j] == ' ') name_no_spaces[j] = '@';
+    }
+    name_no_spaces[j] = '\0';
+
+#pragma omp critical (file_close_approach)
+    {
+        inv_julian_day(event->jd, &year, &month, &day, &hour, &min, &sec, &status, temp_err_string);
+        fprintf(stdout, "%14.6f %04d %02d %02d %02d %02d %02d   %2d   %12.9f %9.4f   %07d %s\n",
+                event->jd, year, month, day, hour, min, (int) sec, event->planet_id,
+                event->distance, event->speed, metadata->number, name_no_spaces);
+        fflush(stdout);
+    }
+}
+
+//! close_approach_run - Search the selected asteroids for close approaches to each of the selected planets
+//! \param [in] s - The settings for the search
+
+void close_approach_run(close_approach_settings *s) {
+    int i, p, planet_count = 0;
+    int planet_ids[MAX_PLANETS_SEARCHED];
+
+    orbitalElements_planets_init();
+    orbitalElements_asteroids_init();
+
+    // Read the list of planets to search
+    {
+        const char *scan = s->planets;
+        while ((*scan != '\0') && (planet_count < MAX_PLANETS_SEARCHED)) {
+            char planet_string[FNAME_LENGTH];
+            str_comma_separated_list_scan(&scan, planet_string);
+            planet_ids[planet_count] = (int) get_float(planet_string, NULL);
+            if (orbitalElements_planets_slot(planet_ids[planet_count]) < 0) {
+                snprintf(temp_err_string, FNAME_LENGTH, "No orbital elements for planet <%s>.", planet_string);
+                ephem_fatal(__FILE__, __LINE__, temp_err_string);
+                exit(1);
+            }
+            planet_count++;
+        }
+    }
+
+    // Select asteroids by their orbital elements
+    int *slots = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+    int *survivors = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+    if ((slots == NULL) || (survivors == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Inclinations are specified in degrees on the command line
+    s->filter.inc_min *= M_PI / 180;
+    s->filter.inc_max *= M_PI / 180;
+    const int candidate_count = orbitalElementsIndex_asteroids_query(&s->filter, slots);
+
+    // Look up the bodyId of each asteroid once, so that the cold table of metadata is not touched within the loops
+    // below. Survivors of pass 1 are recorded by their position in <slots>.
+    int *body_ids = (int *) lt_malloc((candidate_count + 1) * sizeof(int));
+    if (body_ids == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    for (i = 0; i < candidate_count; i++) {
+        body_ids[i] = 10000000 + orbitalElements_asteroids_fetchMetadata(slots[i])->number;
+    }
+
+    // Evaluate MOIDs half-way through the search, since the planets' orbital elements slowly drift
+    const double jd_moid = (s->jd_min + s->jd_max) / 2;
+
+    for (p = 0; p < planet_count; p++) {
+        int survivor_count = 0;
+        const orbitalElements *planet = orbitalElements_planets_fetch(orbitalElements_planets_slot(planet_ids[p]));
+        const double moid_limit = s->threshold + closeApproach_moidMargin(planet_ids[p]);
+
+        // The range of distances from the Sun which the planet spans
+        const double planet_r_min = planet->semiMajorAxis * (1 - planet->eccentricity);
+        const double planet_r_max = planet->semiMajorAxis * (1 + planet->eccentricity);
+
+        // Pass 1: discard asteroids whose orbits never come within the threshold of the planet's orbit
+#pragma omp parallel for shared(slots, survivors, survivor_count) private(i) schedule(dynamic, 256)
+        for (i = 0; i < candidate_count; i++) {
+            const orbitalElements *elements = orbitalElements_asteroids_fetch(slots[i]);
+            const double a = elements->semiMajorAxis, e = elements->eccentricity;
+            int keep = 1;
+
+            // Cheap test: the asteroid's range of distances from the Sun must overlap that of the planet
+            if ((e >= 0) && (e < 1) && (a > 0)) {
+                if ((a * (1 - e) > planet_r_max + moid_limit) || (a * (1 + e) < planet_r_min - moid_limit)) {
+                    keep = 0;
+                } else {
+                    keep = closeApproach_moid(elements, planet, jd_moid) <= moid_limit;
+                }
+            }
+
+            if (keep) {
+#pragma omp critical (close_approach_survivors)
+                {
+                    survivors[survivor_count++] = i;
+                }
+            }
+        }
+
+        if (DEBUG) {
+            snprintf(temp_err_string, FNAME_LENGTH, "Planet %d: %d of %d asteroids pass within %.4f AU of its orbit.",
+                     planet_ids[p], survivor_count, candidate_count, moid_limit);
+            ephem_log(temp_err_string);
+        }
+
+        // Pass 2: search each remaining asteroid for close approaches
+#pragma omp parallel for shared(slots, body_ids, survivors, survivor_count) private(i) schedule(dynamic, 1)
+        for (i = 0; i < survivor_count; i++) {
+            int j;
+            closeApproachEvent events[MAX_APPROACHES];
+            const int candidate = survivors[i];
+            const int event_count = closeApproach_search(body_ids[candidate], planet_ids[p], s->jd_min, s->jd_max,
+                                                         s->threshold, events, MAX_APPROACHES);
+            for (j = 0; j < event_count; j++) close_approach_report(slots[candidate], &events[j]);
+        }
+    }
+}
+
+int main(int argc, const char **argv) {
+    close_approach_settings s;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising close approach search.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default close approach search parameters.");
+    s.jd_min = 2451545.0;
+    s.jd_max = 2451545.0 + 3652.5;
+    s.threshold = 0.05;
+    s.planets = "19";
+    orbitalElementsIndex_defaultFilter(&s.filter);
+    s.filter.secure_only = 0;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &s.jd_min, "The Julian day number at which to start searching; TT"),
+            OPT_FLOAT('b', "jd_max", &s.jd_max, "The Julian day number at which to stop searching; TT"),
+            OPT_FLOAT('t', "threshold", &s.threshold, "The largest distance of closest approach to report; AU"),
+            OPT_STRING('p', "planets", &s.planets,
+                       "Comma-separated list of the bodyIds of the planets to search, e.g. 19 for the Earth"),
+            OPT_GROUP("Selection of asteroids"),
+            OPT_FLOAT(0, "a_min", &s.filter.a_min, "Minimum semi-major axis (AU)"),
+            OPT_FLOAT(0, "a_max", &s.filter.a_max, "Maximum semi-major axis (AU)"),
+            OPT_FLOAT(0, "e_min", &s.filter.e_min, "Minimum eccentricity"),
+            OPT_FLOAT(0, "e_max", &s.filter.e_max, "Maximum eccentricity"),
+            OPT_FLOAT(0, "i_min", &s.filter.inc_min, "Minimum inclination (deg)"),
+            OPT_FLOAT(0, "i_max", &s.filter.inc_max, "Maximum inclination (deg)"),
+            OPT_FLOAT(0, "q_min", &s.filter.q_min, "Minimum perihelion distance (AU)"),
+            OPT_FLOAT(0, "q_max", &s.filter.q_max, "Maximum perihelion distance (AU)"),
+            OPT_FLOAT(0, "H_min", &s.filter.H_min, "Minimum absolute magnitude"),
+            OPT_FLOAT(0, "H_max", &s.filter.H_max, "Maximum absolute magnitude"),
+            OPT_INTEGER(0, "secure_only", &s.filter.secure_only,
+                        "Set to 1 to include only asteroids with secure orbits"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nSearch the asteroid catalogue for close approaches to the planets",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    // Perform search
+    close_approach_run(&s);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
@@ -0,0 +1,150 @@
+// compactEphemeris.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+
+// This is a tool for writing compact ephemerides, which cover a limited time span and a subset of the bodies in
+// DE430, with Chebyshev series truncated to meet a given tolerance. They can be used in place of DE430 by passing
+// them to the <--ephemeris_file> option of ephem.bin.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <gsl/gsl_errno.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/jplCompact.h"
+
+#include "listTools/ltMemory.h"
+
+static const char *const usage[] = {
+        "compactEphemeris.bin [options] [[--] args]",
+        "compactEphemeris.bin [options]",
+        NULL,
+};
+
+//! The names of the bodies in DE430, in the order they are stored
+static const char *const body_names[13] = {
+        "mercury", "venus", "emb", "mars", "jupiter", "saturn", "uranus", "neptune", "pluto", "moon", "sun",
+        "nutations", "librations"
+};
+
+int main(int argc, const char **argv) {
+    const char *objects = "sun,mercury,venus,earth,moon,mars,jupiter,saturn,uranus,neptune,pluto";
+    const char *output_filename = "compact.430";
+    double jd_min = 2415020.5;  // 1900 January 1
+    double jd_max = 2488069.5;  // 2100 January 1
+    double tolerance = 1;  // km
+    int include_body[13];
+    jplCompactSummary summary;
+    int i;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising compact ephemeris writer.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &jd_min, "The Julian day number at which the compact ephemeris should start; TT"),
+            OPT_FLOAT('b', "jd_max", &jd_max, "The Julian day number at which the compact ephemeris should end; TT"),
+            OPT_STRING('o', "objects", &objects,
+                       "Comma-separated list of the bodies to include. The Earth and the Moon each need both emb "
+                       "and moon."),
+            OPT_FLOAT('t', "tolerance", &tolerance,
+                      "The largest acceptable difference between the positions of bodies and DE430; km"),
+            OPT_STRING('f', "output", &output_filename, "The filename to write the compact ephemeris to"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nWrite a compact version of DE430, covering a limited time span and selected bodies",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    if (!(tolerance > 0)) {
+        ephem_fatal(__FILE__, __LINE__, "The tolerance must be greater than zero.");
+        exit(1);
+    }
+
+    // Read the list of bodies to include. The Earth and Moon are computed from the Earth-Moon barycentre and the
+    // geocentric position of the Moon, so need both.
+    for (i = 0; i < 13; i++) include_body[i] = 0;
+    {
+        const char *scan = objects;
+        while (*scan != '\0') {
+            char name[FNAME_LENGTH];
+            str_comma_separated_list_scan(&scan, name);
+            if ((str_cmp_no_case(name, "earth") == 0) || (str_cmp_no_case(name, "moon") == 0)) {
+                include_body[2] = include_body[9] = 1;
+                continue;
+            }
+            for (i = 0; i < 13; i++) if (str_cmp_no_case(name, body_names[i]) == 0) break;
+            if (i >= 13) {
+                snprintf(temp_err_string, FNAME_LENGTH, "Unrecognised body <%s>.", name);
+                ephem_fatal(__FILE__, __LINE__, temp_err_string);
+                exit(1);
+            }
+            include_body[i] = 1;
+        }
+    }
+
+    // Write the compact ephemeris
+    if (jplCompact_write(output_filename, jd_min, jd_max, include_body, tolerance, &summary) != 0) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Could not write compact ephemeris to file <%s>.", output_filename);
+        ephem_fatal(__FILE__, __LINE__, temp_err_string);
+        exit(1);
+    }
+
+    // Report how each body is represented
+    fprintf(stdout, "# Compact ephemeris <%s>: JD %.1f to %.1f, %d records\n", output_filename,
+            summary.jd_start, summary.jd_end, summary.record_count);
+    fprintf(stdout, "# %-10s %12s %12s %22s\n", "Body", "Coefficients", "Subintervals", "Max sampled error / km");
+    for (i = 0; i < 13; i++) {
+        if (summary.coefficients[i] < 1) continue;
+        fprintf(stdout, "  %-10s %12d %12d %22.6f\n", body_names[i], summary.coefficients[i],
+                summary.subintervals[i], summary.max_error[i]);
+    }
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
@@ -0,0 +1,217 @@
+// eclipses.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for searching for solar and lunar eclipses using the DE430 ephemeris. For each solar eclipse it can
+// list Besselian elements, and the local circumstances of the eclipse at any number of places.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/eclipses.h"
+#include "ephemCalc/siteList.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+// Sites where the Sun is lower than this at maximum eclipse are not listed; degrees
+#define SUN_RISE_ALTITUDE (-50. / 60.)
+
+static const char *const usage[] = {
+        "eclipses.bin [options] [[--] args]",
+        "eclipses.bin [options]",
+        NULL,
+};
+
+//! eclipse_settings - The settings which describe the search we are to perform
+typedef struct {
+    double jd_min, jd_max;  // TT
+    const char *kinds;  // Comma-separated list of the kinds of eclipse to search for
+    const char *site_list;  // Filename of the list of sites at which to compute local circumstances
+    int output_besselian;  // Boolean
+} eclipse_settings;
+
+//! eclipse_context - Information passed to <eclipse_report>
+typedef struct {
+    const eclipse_settings *settings;
+    const siteList *sites;  // NULL if no list of sites was supplied
+} eclipse_context;
+
+//! eclipse_write_time - Write a Julian date to stdout, or a dash if the time is undefined
+
+static void eclipse_write_time(const double jd) {
+    if (gsl_isnan(jd)) fprintf(stdout, " %14s", "-");
+    else fprintf(stdout, " %14.6f", jd);
+}
+
+//! eclipse_write_polynomial - Write the coefficients of one of the polynomials in a set of Besselian elements
+
+static void eclipse_write_polynomial(const char *name, const double *c, const double scale) {
+    int i;
+    fprintf(stdout, "    %-6s", name);
+    for (i = 0; i < ECLIPSE_POLYNOMIAL_TERMS; i++) fprintf(stdout, " %+16.9e", c[i] * scale);
+    fprintf(stdout, "\n");
+}
+
+//! eclipse_report - Write an eclipse to stdout, followed by its Besselian elements and local circumstances if
+//! requested
+//! \param [in] eclipse - The eclipse
+//! \param [in] context - The settings and list of sites
+
+void eclipse_report(const eclipseFound *eclipse, void *context) {
+    const eclipse_context *c = (const eclipse_context *) context;
+    int year, month, day, hour, min, status, i;
+    double sec;
+
+    inv_julian_day(eclipse->jd_greatest, &year, &month, &day, &hour, &min, &sec, &status, temp_err_string);
+    fprintf(stdout, "%14.6f %04d %02d %02d %02d %02d %02d   %-5s %-9s %9.6f",
+            eclipse->jd_greatest, year, month, day, hour, min, (int) sec,
+            (eclipse->kind == ECLIPSE_SOLAR) ? "solar" : "lunar", eclipses_typeName(eclipse->type),
+            eclipse->magnitude);
+    if (gsl_isnan(eclipse->penumbral_magnitude)) fprintf(stdout, " %9s", "-");
+    else fprintf(stdout, " %9.6f", eclipse->penumbral_magnitude);
+    fprintf(stdout, " %+9.6f", eclipse->gamma);
+    for (i = 0; i < ECLIPSE_CONTACT_COUNT; i++) eclipse_write_time(eclipse->jd_contact[i]);
+    fprintf(stdout, "\n");
+
+    if (eclipse->kind != ECLIPSE_SOLAR) return;
+
+    // Besselian elements, with angles in degrees
+    if (c->settings->output_besselian) {
+        const eclipseBesselianElements *b = &eclipse->besselian;
+        fprintf(stdout, "    t0     %14.6f\n", b->t0);
+        eclipse_write_polynomial("x", b->x, 1);
+        eclipse_write_polynomial("y", b->y, 1);
+        eclipse_write_polynomial("d", b->d, 180 / M_PI);
+        eclipse_write_polynomial("mu", b->mu, 180 / M_PI);
+        eclipse_write_polynomial("l1", b->l1, 1);
+        eclipse_write_polynomial("l2", b->l2, 1);
+        fprintf(stdout, "    tan_f1 %+16.9e\n    tan_f2 %+16.9e\n", b->tan_f1, b->tan_f2);
+    }
+
+    // Local circumstances at each site, computed from the Besselian elements alone
+    if (c->sites == NULL) return;
+    for (i = 0; i < c->sites->site_count; i++) {
+        eclipseLocalCircumstances local;
+        int j;
+        if (!eclipses_localCircumstances(&eclipse->besselian, c->sites->latitude[i], c->sites->longitude[i], &local)) {
+            continue;
+        }
+        if (local.sun_altitude * 180 / M_PI < SUN_RISE_ALTITUDE) continue;
+        fprintf(stdout, "    %-20s %-9s %9.6f %+8.3f", c->sites->name[i], eclipses_typeName(local.type),
+                local.magnitude, local.sun_altitude * 180 / M_PI);
+        eclipse_write_time(local.jd_maximum);
+        for (j = 0; j < ECLIPSE_LOCAL_CONTACT_COUNT; j++) eclipse_write_time(local.jd_contact[j]);
+        fprintf(stdout, "\n");
+    }
+}
+
+int main(int argc, const char **argv) {
+    eclipse_settings s;
+    eclipse_context context;
+    int do_solar = 0, do_lunar = 0;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising eclipse search.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default eclipse search parameters.");
+    s.jd_min = 2451545.0;
+    s.jd_max = 2451545.0 + 365.25;
+    s.kinds = "solar,lunar";
+    s.site_list = NULL;
+    s.output_besselian = 0;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &s.jd_min, "The Julian day number at which to start searching; TT"),
+            OPT_FLOAT('b', "jd_max", &s.jd_max, "The Julian day number at which to stop searching; TT"),
+            OPT_STRING('k', "kinds", &s.kinds,
+                       "Comma-separated list of the kinds of eclipse to search for: solar and/or lunar"),
+            OPT_STRING('l', "sites", &s.site_list,
+                       "Text file listing sites at which to compute the local circumstances of solar eclipses: "
+                       "name, latitude and longitude (east of Greenwich; degrees)"),
+            OPT_INTEGER('e', "besselian", &s.output_besselian,
+                        "Set to 1 to output the Besselian elements of each solar eclipse"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nSearch for solar and lunar eclipses",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    // Read the kinds of eclipse to search for
+    {
+        const char *scan = s.kinds;
+        while (*scan != '\0') {
+            char kind[FNAME_LENGTH];
+            str_comma_separated_list_scan(&scan, kind);
+            if (str_cmp_no_case(kind, "solar") == 0) do_solar = 1;
+            else if (str_cmp_no_case(kind, "lunar") == 0) do_lunar = 1;
+            else {
+                snprintf(temp_err_string, FNAME_LENGTH, "Unrecognised kind of eclipse <%s>.", kind);
+                ephem_fatal(__FILE__, __LINE__, temp_err_string);
+                exit(1);
+            }
+        }
+    }
+
+    // Perform search
+    context.settings = &s;
+    context.sites = (s.site_list != NULL) ? siteList_load(s.site_list) : NULL;
+    eclipses_search(s.jd_min, s.jd_max, do_solar, do_lunar, eclipse_report, &context);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
@@ -0,0 +1,595 @@
+// apparentCache.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+
+// This module caches the apparent places of objects -- their RA and Dec, and optionally their positions, magnitudes,
+// distances and the other quantities computed by <magnitudeEstimate_atObserver> -- as Chebyshev series fitted over
+// fixed windows of time, so that repeated queries for the same objects over the same span of time need only evaluate
+// polynomials, rather than correcting for light travel time, aberration and precession at every time point. The
+// cache is kept in a file, so that it can be shared between runs.
+//
+// Time is divided into windows of APPARENT_CACHE_WINDOW days. The apparent place of an object is fitted over a whole
+// window, and the fit is checked against the full calculation at a set of test points. If it misses the tolerance,
+// the window is halved, and each half is fitted in turn, down to APPARENT_CACHE_MAX_LEVEL halvings. Objects which
+// cannot be fitted even then are computed in full.
+
+#define APPARENTCACHE_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+#include "apparentCache.h"
+#include "jpl.h"
+#include "magnitudeEstimate.h"
+#include "orbitalElements.h"
+
+// Identifies the format of cache files
+#define APPARENT_CACHE_FORMAT 4
+
+// The length of the windows which time is divided into; days. Windows start at JDs which are multiples of this.
+#define APPARENT_CACHE_WINDOW 16.0
+
+// The largest number of times a window may be halved to meet the tolerance
+#define APPARENT_CACHE_MAX_LEVEL 9
+
+// The accuracy required of cached magnitudes
+#define APPARENT_CACHE_MAG_TOLERANCE 1e-3
+
+// The largest number of fitted windows to keep. When the cache is full, the least recently used window is evicted.
+#define APPARENT_CACHE_MAX_ENTRIES 16384
+
+// The size of the hash table used to look up cache entries; must be a power of two
+#define APPARENT_CACHE_BUCKETS 32768
+
+// The status of a cache entry
+#define APPARENT_CACHE_FITTED 0  // The entry holds a fit which meets the tolerance
+#define APPARENT_CACHE_SPLIT  1  // The window could not be fitted, and must be halved
+#define APPARENT_CACHE_FAILED 2  // The window could not be fitted at the finest level, and must be computed in full
+
+// A fit to the apparent place of one object over one window of time
+typedef struct {
+    apparentCacheKey key;
+    double tolerance;  // The tolerance the fit was checked against; arcsec
+    long window;  // The number of the window; it starts at JD <window> * <length of window>
+    int level;  // The number of times the window has been halved
+    int status;  // One of the APPARENT_CACHE_* statuses above
+    long last_used;  // The value of <apparentCache_clock> when the entry was last used
+    double coefficients[APPARENT_CACHE_QUANTITIES * APPARENT_CACHE_TERMS];  // Chebyshev coefficients, if fitted
+} apparentCacheEntry;
+
+//! The filename of the cache, and the accuracy required of RA and Dec; arcsec. Other angles are held to the same
+//! accuracy, and distances and sizes to the same fraction of their values.
+static char apparentCache_filename[FNAME_LENGTH] = "";
+static double apparentCache_tolerance = 0;
+
+//! The cache entries, with a hash table of chains of entries. <apparentCache_next> gives the next entry in each chain.
+static apparentCacheEntry *apparentCache_entries = NULL;
+static int *apparentCache_next = NULL;
+static int apparentCache_buckets[APPARENT_CACHE_BUCKETS];
+static int apparentCache_count = 0;
+
+//! A counter which is incremented every time an entry is used, so that we can find the least recently used entry
+static long apparentCache_clock = 0;
+
+//! Boolean flag indicating whether entries have been added since the cache was loaded
+static int apparentCache_modified = 0;
+
+//! Statistics on how the cache has been used
+static long apparentCache_hits = 0, apparentCache_fits = 0, apparentCache_failures = 0, apparentCache_evictions = 0;
+
+//! apparentCache_keysMatch - Test whether two cache keys are the same
+//! \param [in] a - The first key
+//! \param [in] b - The second key
+//! \return - Boolean
+
+static int apparentCache_keysMatch(const apparentCacheKey *a, const apparentCacheKey *b) {
+    if ((a->body_id != b->body_id) || (a->use_orbital_elements != b->use_orbital_elements) ||
+        (a->topocentric != b->topocentric) || (a->ra_dec_epoch != b->ra_dec_epoch) ||
+        (a->ephemeris_tolerance != b->ephemeris_tolerance) || (a->elements_checksum != b->elements_checksum) ||
+        (a->physical != b->physical)) {
+        return 0;
+    }
+    return (!a->topocentric) || ((a->latitude == b->latitude) && (a->longitude == b->longitude));
+}
+
+//! apparentCache_hash - Work out which hash table bucket a window of time for a particular key belongs in
+//! \param [in] key - The key of the cache entry
+//! \param [in] level - The number of times the window has been halved
+//! \param [in] window - The number of the window
+//! \return - The bucket number
+
+static int apparentCache_hash(const apparentCacheKey *key, const int level, const long window) {
+    uint64_t h = (uint64_t) key->body_id * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t) window * 0xC2B2AE3D27D4EB4FULL + (uint64_t) level * 0x165667B19E3779F9ULL;
+    if (key->topocentric) {
+        uint64_t bits;
+        memcpy(&bits, &key->latitude, sizeof(bits));
+        h ^= bits * 0x27D4EB2F165667C5ULL;
+        memcpy(&bits, &key->longitude, sizeof(bits));
+        h ^= bits * 0x94D049BB133111EBULL;
+    }
+    h ^= h >> 29;
+    return (int) (h & (APPARENT_CACHE_BUCKETS - 1));
+}
+
+//! apparentCache_find - Look up the cache entry for a window of time for a particular key
+//! \param [in] key - The key of the cache entry
+//! \param [in] level - The number of times the window has been halved
+//! \param [in] window - The number of the window
+//! \return - The index of the entry, or -1 if there is no entry which is usable with the current tolerance
+
+static int apparentCache_find(const apparentCacheKey *key, const int level, const long window) {
+    int i = apparentCache_buckets[apparentCache_hash(key, level, window)];
+    while (i >= 0) {
+        const apparentCacheEntry *e = &apparentCache_entries[i];
+
+        // Fits checked against a looser tolerance than we need are no use. Conversely, if a window could not be
+        // fitted to a tighter tolerance than we need, we may still be able to fit it.
+        const int usable = (e->status == APPARENT_CACHE_FITTED) ? (e->tolerance <= apparentCache_tolerance) :
+                           (e->tolerance >= apparentCache_tolerance);
+        if ((e->level == level) && (e->window == window) && usable && apparentCache_keysMatch(&e->key, key)) {
+            return i;
+        }
+        i = apparentCache_next[i];
+    }
+    return -1;
+}
+
+//! apparentCache_link - Add a cache entry to the chain for its hash table bucket
+//! \param [in] i - The index of the entry
+
+static void apparentCache_link(const int i) {
+    const apparentCacheEntry *e = &apparentCache_entries[i];
+    const int bucket = apparentCache_hash(&e->key, e->level, e->window);
+    apparentCache_next[i] = apparentCache_buckets[bucket];
+    apparentCache_buckets[bucket] = i;
+}
+
+//! apparentCache_unlink - Remove a cache entry from the chain for its hash table bucket
+//! \param [in] i - The index of the entry
+
+static void apparentCache_unlink(const int i) {
+    const apparentCacheEntry *e = &apparentCache_entries[i];
+    int *scan = &apparentCache_buckets[apparentCache_hash(&e->key, e->level, e->window)];
+    while (*scan >= 0) {
+        if (*scan == i) {
+            *scan = apparentCache_next[i];
+            return;
+        }
+        scan = &apparentCache_next[*scan];
+    }
+}
+
+//! apparentCache_insert - Add a new entry to the cache, evicting the least recently used entry if the cache is full
+//! \param [in] entry - The new entry
+
+static void apparentCache_insert(const apparentCacheEntry *entry) {
+    int i;
+
+    // Another thread may already have fitted the same window
+    if (apparentCache_find(&entry->key, entry->level, entry->window) >= 0) return;
+
+    if (apparentCache_count < APPARENT_CACHE_MAX_ENTRIES) {
+        i = apparentCache_count++;
+    } else {
+        int j;
+        i = 0;
+        for (j = 1; j < apparentCache_count; j++) {
+            if (apparentCache_entries[j].last_used < apparentCache_entries[i].last_used) i = j;
+        }
+        apparentCache_unlink(i);
+        apparentCache_evictions++;
+    }
+
+    apparentCache_entries[i] = *entry;
+    apparentCache_entries[i].last_used = ++apparentCache_clock;
+    apparentCache_link(i);
+    apparentCache_modified = 1;
+}
+
+//! apparentCache_open - Open a cache of apparent places. Any entries already in the file are loaded, and new entries
+//! are written back to it by <apparentCache_close>.
+//! \param [in] filename - The filename of the cache. It is created if it does not exist.
+//! \param [in] tolerance - The accuracy required of cached RA and Dec; arcsec. Other quantities are held to the
+//! accuracies described in <apparentCache_error>.
+
+void apparentCache_open(const char *filename, const double tolerance) {
+    int i;
+
+    snprintf(apparentCache_filename, FNAME_LENGTH, "%s", filename);
+    apparentCache_tolerance = tolerance;
+
+    apparentCache_entries = (apparentCacheEntry *) lt_malloc(APPARENT_CACHE_MAX_ENTRIES * sizeof(apparentCacheEntry));
+    apparentCache_next = (int *) lt_malloc(APPARENT_CACHE_MAX_ENTRIES * sizeof(int));
+    if ((apparentCache_entries == NULL) || (apparentCache_next == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    for (i = 0; i < APPARENT_CACHE_BUCKETS; i++) apparentCache_buckets[i] = -1;
+    apparentCache_count = 0;
+    apparentCache_clock = 0;
+    apparentCache_modified = 0;
+
+    // Load existing entries. A file which is missing, or was written in a different format, is treated as empty.
+    FILE *input = fopen(filename, "rb");
+    if (input == NULL) return;
+
+    int header[3] = {0, 0, 0};  // format, terms, entry count
+    if ((fread(header, sizeof(int), 3, input) != 3) || (header[0] != APPARENT_CACHE_FORMAT) ||
+        (header[1] != APPARENT_CACHE_TERMS) || (header[2] < 0) || (header[2] > APPARENT_CACHE_MAX_ENTRIES)) {
+        if (DEBUG) {
+            snprintf(temp_err_string, FNAME_LENGTH, "Ignoring apparent place cache <%s> in unknown format.",
+                     filename);
+            ephem_log(temp_err_string);
+        }
+        fclose(input);
+        return;
+    }
+
+    apparentCache_count = (int) fread(apparentCache_entries, sizeof(apparentCacheEntry), header[2], input);
+    fclose(input);
+
+    for (i = 0; i < apparentCache_count; i++) {
+        apparentCache_link(i);
+        if (apparentCache_entries[i].last_used > apparentCache_clock) {
+            apparentCache_clock = apparentCache_entries[i].last_used;
+        }
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Loaded %d windows from apparent place cache <%s>.",
+                 apparentCache_count, filename);
+        ephem_log(temp_err_string);
+    }
+}
+
+//! apparentCache_close - Write any new entries in the cache of apparent places back to its file. The file is written
+//! under a temporary name and then renamed, so that other processes never see it half-written.
+
+void apparentCache_close() {
+    if ((apparentCache_entries == NULL) || (!apparentCache_modified)) return;
+
+    char fname_temp[FNAME_LENGTH + 16];
+    snprintf(fname_temp, FNAME_LENGTH + 16, "%s.%d", apparentCache_filename, (int) getpid());
+
+    FILE *output = fopen(fname_temp, "wb");
+    if (output == NULL) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Could not write apparent place cache <%s>.", apparentCache_filename);
+        ephem_warning(temp_err_string);
+        return;
+    }
+
+    const int header[3] = {APPARENT_CACHE_FORMAT, APPARENT_CACHE_TERMS, apparentCache_count};
+    int failed = (fwrite(header, sizeof(int), 3, output) != 3);
+    if (!failed) {
+        failed = (fwrite(apparentCache_entries, sizeof(apparentCacheEntry), apparentCache_count, output) !=
+                  (size_t) apparentCache_count);
+    }
+    failed = (fclose(output) != 0) || failed;
+
+    if (failed || (rename(fname_temp, apparentCache_filename) != 0)) {
+        remove(fname_temp);
+        snprintf(temp_err_string, FNAME_LENGTH, "Could not write apparent place cache <%s>.", apparentCache_filename);
+        ephem_warning(temp_err_string);
+        return;
+    }
+    apparentCache_modified = 0;
+}
+
+//! apparentCache_quantityCount - The number of quantities which are fitted for a key
+//! \param [in] key - The object, and the settings for its apparent place
+//! \return - The number of quantities, which are the first of those listed in apparentCache.h
+
+static int apparentCache_quantityCount(const apparentCacheKey *key) {
+    return key->physical ? APPARENT_CACHE_QUANTITIES : 2;
+}
+
+//! apparentCache_wraps - Test whether a quantity is an angle which wraps around, and must be unwrapped to vary
+//! smoothly
+//! \param [in] q - The quantity, one of the APPARENT_CACHE_* quantities
+//! \return - Boolean
+
+static int apparentCache_wraps(const int q) {
+    return (q == APPARENT_CACHE_RA) || (q == APPARENT_CACHE_THETA_ESO) || (q == APPARENT_CACHE_ECL_LONGITUDE) ||
+           (q == APPARENT_CACHE_ECL_DISTANCE);
+}
+
+//! apparentCache_compute - Compute the apparent place of an object in full
+//! \param [in] key - The object, and the settings for its apparent place
+//! \param [in] jd - The Julian date; TT
+//! \param [out] out - The value of each quantity which is fitted for this key
+
+static void apparentCache_compute(const apparentCacheKey *key, const double jd, double *out) {
+    orbitalElementsEpochState state;
+    double topocentric_offset[3] = {0, 0, 0};
+    double x, y, z;
+
+    orbitalElements_computeEpochState(jd, &state);
+    if (key->topocentric) {
+        const double st = sidereal_time(unix_from_jd(jd)) * 180 / 12; // degrees
+        const double pos_earth[3] = {0, 0, 0};
+        earthTopocentricPositionICRF(topocentric_offset, key->latitude, key->longitude, 1, pos_earth, jd, st);
+    }
+
+    if (key->use_orbital_elements == 0) jpl_computePositionAtEpoch(key->body_id, &state, &x, &y, &z);
+    else orbitalElements_computePositionAtEpoch(key->body_id, &state, &x, &y, &z);
+
+    // The Earth's magnitude is computed for the Earth/Moon barycentre's ID number, as in <ephemeris_store_at_observer>
+    if (key->physical) {
+        out[APPARENT_CACHE_X] = x;
+        out[APPARENT_CACHE_Y] = y;
+        out[APPARENT_CACHE_Z] = z;
+        magnitudeEstimate_atObserver((key->body_id == 19) ? 2 : key->body_id, x, y, z,
+                                     state.earth_pos[0], state.earth_pos[1], state.earth_pos[2],
+                                     state.sun_pos[0], state.sun_pos[1], state.sun_pos[2],
+                                     &out[APPARENT_CACHE_RA], &out[APPARENT_CACHE_DEC], &out[APPARENT_CACHE_MAG],
+                                     &out[APPARENT_CACHE_PHASE], &out[APPARENT_CACHE_ANG_SIZE],
+                                     &out[APPARENT_CACHE_PHY_SIZE], &out[APPARENT_CACHE_ALBEDO],
+                                     &out[APPARENT_CACHE_SUN_DIST], &out[APPARENT_CACHE_EARTH_DIST],
+                                     &out[APPARENT_CACHE_SUN_ANG_DIST], &out[APPARENT_CACHE_THETA_ESO],
+                                     &out[APPARENT_CACHE_ECL_LONGITUDE], &out[APPARENT_CACHE_ECL_LATITUDE],
+                                     &out[APPARENT_CACHE_ECL_DISTANCE], key->ra_dec_epoch, topocentric_offset);
+    } else {
+        magnitudeEstimate_raDec(x, y, z, state.earth_pos[0], state.earth_pos[1], state.earth_pos[2],
+                                &out[APPARENT_CACHE_RA], &out[APPARENT_CACHE_DEC], key->ra_dec_epoch,
+                                topocentric_offset);
+    }
+}
+
+//! apparentCache_error - Compute the error of a fitted quantity, as a multiple of the accuracy required of it
+//! \param [in] q - The quantity, one of the APPARENT_CACHE_* quantities
+//! \param [in] fit - The value of each quantity from the fit
+//! \param [in] exact - The value of each quantity from the full calculation
+//! \return - The error; the fit meets the tolerance if this is no more than one
+
+static double apparentCache_error(const int q, const double *fit, const double *exact) {
+    const double tolerance = apparentCache_tolerance / 3600 * M_PI / 180;  // radians
+    const double diff = apparentCache_wraps(q) ? fabs(remainder(fit[q] - exact[q], 2 * M_PI)) :
+                        fabs(fit[q] - exact[q]);
+
+    switch (q) {
+        // Longitudes are checked as distances on the sky
+        case APPARENT_CACHE_RA:
+            return diff * cos(exact[APPARENT_CACHE_DEC]) / tolerance;
+        case APPARENT_CACHE_ECL_LONGITUDE:
+            return diff * cos(exact[APPARENT_CACHE_ECL_LATITUDE]) / tolerance;
+
+        // Distances and sizes are checked as a fraction of their values. The geocentre's distance from the Earth is
+        // exactly zero.
+        case APPARENT_CACHE_ANG_SIZE:
+        case APPARENT_CACHE_PHY_SIZE:
+        case APPARENT_CACHE_SUN_DIST:
+        case APPARENT_CACHE_EARTH_DIST:
+            return (diff == 0) ? 0 : diff / fabs(exact[q]) / tolerance;
+
+        // Positions are checked as a fraction of the distance from the origin
+        case APPARENT_CACHE_X:
+        case APPARENT_CACHE_Y:
+        case APPARENT_CACHE_Z:
+            return diff / gsl_hypot3(exact[APPARENT_CACHE_X], exact[APPARENT_CACHE_Y], exact[APPARENT_CACHE_Z]) /
+                   tolerance;
+
+        case APPARENT_CACHE_MAG:
+            return diff / APPARENT_CACHE_MAG_TOLERANCE;
+
+        // Other angles, and phases and albedos
+        default:
+            return diff / tolerance;
+    }
+}
+
+//! apparentCache_fit - Fit Chebyshev series to the apparent place of an object over a window of time, and check
+//! them against the full calculation. The series are interpolated through the apparent place at Chebyshev nodes,
+//! and checked at the extrema of the first omitted polynomial, including both ends of the window.
+//! \param [in] key - The object, and the settings for its apparent place
+//! \param [in] jd_start - The start of the window; TT
+//! \param [in] length - The length of the window; days
+//! \param [in] can_split - Boolean indicating whether the window may be halved if the fit misses the tolerance
+//! \param [out] coefficients - The Chebyshev coefficients for each quantity in turn
+//! \return - The status of the fit: APPARENT_CACHE_FITTED, APPARENT_CACHE_SPLIT or APPARENT_CACHE_FAILED
+
+static int apparentCache_fit(const apparentCacheKey *key, const double jd_start, const double length,
+                             const int can_split, double *coefficients) {
+    const int N = APPARENT_CACHE_TERMS;
+    const int count = apparentCache_quantityCount(key);
+    double samples[APPARENT_CACHE_QUANTITIES][APPARENT_CACHE_TERMS];
+    int nan_count[APPARENT_CACHE_QUANTITIES];
+    int j, l, m, q;
+
+    for (q = 0; q < count; q++) nan_count[q] = 0;
+
+    // Sample the apparent place at the Chebyshev nodes, unwrapping angles so that they vary smoothly
+    for (m = 0; m < N; m++) {
+        double value[APPARENT_CACHE_QUANTITIES];
+        const double x = cos(M_PI * (m + 0.5) / N);
+        apparentCache_compute(key, jd_start + (x + 1) / 2 * length, value);
+        for (q = 0; q < count; q++) {
+            if ((m > 0) && apparentCache_wraps(q)) {
+                value[q] = samples[q][m - 1] + remainder(value[q] - samples[q][m - 1], 2 * M_PI);
+            }
+            samples[q][m] = value[q];
+            if (gsl_isnan(value[q])) nan_count[q]++;
+        }
+    }
+
+    // Compute the Chebyshev coefficients with a discrete cosine transform
+    for (q = 0; q < count; q++) {
+        for (l = 0; l < N; l++) {
+            double sum = 0;
+            for (m = 0; m < N; m++) sum += samples[q][m] * cos(M_PI * l * (m + 0.5) / N);
+            coefficients[q * N + l] = sum * ((l == 0) ? 1. : 2.) / N;
+        }
+    }
+
+    // Check the fit against the full calculation. Positions which are undefined throughout the window, such as those
+    // of objects outside the span of the ephemeris, are accepted as undefined.
+    for (j = 0; j <= N; j++) {
+        double exact[APPARENT_CACHE_QUANTITIES], fit[APPARENT_CACHE_QUANTITIES];
+        const double x = cos(M_PI * j / N);
+        apparentCache_compute(key, jd_start + (x + 1) / 2 * length, exact);
+        for (q = 0; q < count; q++) {
+            fit[q] = chebyshev(coefficients + q * N, N, x);
+            if (gsl_isnan(exact[q])) nan_count[q]++;
+        }
+
+        for (q = 0; q < count; q++) {
+            if ((nan_count[q] == 0) && !(apparentCache_error(q, fit, exact) <= 1)) {
+                return can_split ? APPARENT_CACHE_SPLIT : APPARENT_CACHE_FAILED;
+            }
+        }
+    }
+
+    for (q = 0; q < count; q++) {
+        if ((nan_count[q] > 0) && (nan_count[q] < 2 * N + 1)) {
+            return can_split ? APPARENT_CACHE_SPLIT : APPARENT_CACHE_FAILED;
+        }
+    }
+    return APPARENT_CACHE_FITTED;
+}
+
+//! apparentCache_evaluate - Evaluate the Chebyshev series for all of the quantities in a cache entry together
+//! \param [in] coefficients - The Chebyshev coefficients for each quantity in turn
+//! \param [in] count - The number of quantities
+//! \param [in] x - The point at which to evaluate the series (-1 to 1)
+//! \param [out] out - The value of each quantity
+
+static void apparentCache_evaluate(const double *coefficients, const int count, const double x, double *out) {
+    const double x2 = 2 * x;
+    double d[APPARENT_CACHE_QUANTITIES], dd[APPARENT_CACHE_QUANTITIES];
+    int k, q;
+
+    for (q = 0; q < count; q++) d[q] = dd[q] = 0;
+
+    // Clenshaw's recurrence, as in <chebyshev>
+    for (k = APPARENT_CACHE_TERMS - 1; k > 0; k--) {
+        for (q = 0; q < count; q++) {
+            const double d_new = x2 * d[q] - dd[q] + coefficients[q * APPARENT_CACHE_TERMS + k];
+            dd[q] = d[q];
+            d[q] = d_new;
+        }
+    }
+    for (q = 0; q < count; q++) out[q] = x * d[q] - dd[q] + coefficients[q * APPARENT_CACHE_TERMS];
+}
+
+//! apparentCache_fetch - Look up the apparent place of an object from the cache, fitting the window of time which
+//! contains <jd> if it is not already in the cache.
+//! \param [in] key - The object, and the settings for its apparent place
+//! \param [in] jd - The Julian date; TT
+//! \param [out] values - The value of each of the APPARENT_CACHE_QUANTITIES quantities, in the order listed in
+//! apparentCache.h. Quantities which are not fitted for this key are set to zero.
+//! \return - Boolean indicating whether the apparent place was found. If zero, it must be computed in full.
+
+int apparentCache_fetch(const apparentCacheKey *key, const double jd, double *values) {
+    const int count = apparentCache_quantityCount(key);
+    double coefficients[APPARENT_CACHE_QUANTITIES * APPARENT_CACHE_TERMS];
+    int level, q;
+
+    if ((apparentCache_entries == NULL) || !gsl_finite(jd)) return 0;
+
+    // Descend through the levels of halving until we find the window which was fitted
+    for (level = 0; level <= APPARENT_CACHE_MAX_LEVEL; level++) {
+        const double length = APPARENT_CACHE_WINDOW / (1 << level);
+        const long window = (long) floor(jd / length);
+        int status = -1;
+
+#pragma omp critical (apparent_cache)
+        {
+            const int i = apparentCache_find(key, level, window);
+            if (i >= 0) {
+                apparentCacheEntry *e = &apparentCache_entries[i];
+                e->last_used = ++apparentCache_clock;
+                status = e->status;
+                if (status == APPARENT_CACHE_FITTED) {
+                    memcpy(coefficients, e->coefficients, sizeof(coefficients));
+                    apparentCache_hits++;
+                }
+            }
+        }
+
+        // Fit this window if it is not in the cache
+        if (status < 0) {
+            apparentCacheEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.key = *key;
+            entry.tolerance = apparentCache_tolerance;
+            entry.window = window;
+            entry.level = level;
+            entry.status = status = apparentCache_fit(key, window * length, length,
+                                                      level < APPARENT_CACHE_MAX_LEVEL, entry.coefficients);
+            memcpy(coefficients, entry.coefficients, sizeof(coefficients));
+#pragma omp critical (apparent_cache)
+            {
+                apparentCache_insert(&entry);
+                if (status == APPARENT_CACHE_FAILED) apparentCache_failures++;
+                else if (status == APPARENT_CACHE_FITTED) apparentCache_fits++;
+            }
+        }
+
+        if (status == APPARENT_CACHE_SPLIT) continue;
+        if (status == APPARENT_CACHE_FAILED) return 0;
+
+        // Evaluate the fitted series
+        double tc = 2 * (jd - window * length) / length - 1;
+        if (tc < -1) tc = -1;
+        if (tc > 1) tc = 1;
+        for (q = 0; q < APPARENT_CACHE_QUANTITIES; q++) values[q] = 0;
+        apparentCache_evaluate(coefficients, count, tc, values);
+
+        // Wrap angles back into the ranges returned by <magnitudeEstimate_atObserver>
+        for (q = 0; q < count; q++) {
+            if (!apparentCache_wraps(q)) continue;
+            if (q == APPARENT_CACHE_RA) {
+                values[q] = fmod(values[q], 2 * M_PI);
+                if (values[q] < 0) values[q] += 2 * M_PI;
+            } else {
+                values[q] = remainder(values[q], 2 * M_PI);
+            }
+        }
+        return 1;
+    }
+    return 0;
+}
+
+//! apparentCache_statistics - Report how the cache of apparent places has been used
+//! \param [out] hits - The number of apparent places which were evaluated from windows already in the cache
+//! \param [out] fits - The number of windows which were fitted
+//! \param [out] failures - The number of windows which could not be fitted to the tolerance
+//! \param [out] evictions - The number of windows which were evicted to make space for new ones
+
+void apparentCache_statistics(long *hits, long *fits, long *failures, long *evictions) {
+    *hits = apparentCache_hits;
+    *fits = apparentCache_fits;
+    *failures = apparentCache_failures;
+    *evictions = apparentCache_evictions;
+}
@@ -0,0 +1,70 @@
+// apparentCache.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef APPARENTCACHE_H
+#define APPARENTCACHE_H 1
+
+// The number of Chebyshev coefficients fitted to each quantity over each window of time
+#define APPARENT_CACHE_TERMS 16
+
+// The quantities which are fitted, in the order they are returned by <apparentCache_fetch>: those computed by
+// <magnitudeEstimate_atObserver>, and the apparent position of the object. For keys which do not ask for physical
+// quantities, only RA and Dec are fitted.
+#define APPARENT_CACHE_RA             0  // Right ascension; radians
+#define APPARENT_CACHE_DEC            1  // Declination; radians
+#define APPARENT_CACHE_MAG            2  // Magnitude
+#define APPARENT_CACHE_PHASE          3  // Phase (0-1)
+#define APPARENT_CACHE_ANG_SIZE       4  // Angular diameter; arcsec
+#define APPARENT_CACHE_PHY_SIZE       5  // Physical diameter; metres
+#define APPARENT_CACHE_ALBEDO         6  // Albedo (0-1)
+#define APPARENT_CACHE_SUN_DIST       7  // Distance from the Sun; AU
+#define APPARENT_CACHE_EARTH_DIST     8  // Distance from the observer; AU
+#define APPARENT_CACHE_SUN_ANG_DIST   9  // Angular distance from the Sun; radians
+#define APPARENT_CACHE_THETA_ESO     10  // Angle Earth-Sun-object, signed; radians
+#define APPARENT_CACHE_ECL_LONGITUDE 11  // Ecliptic longitude, J2000.0; radians
+#define APPARENT_CACHE_ECL_LATITUDE  12  // Ecliptic latitude, J2000.0; radians
+#define APPARENT_CACHE_ECL_DISTANCE  13  // Separation from the Sun in ecliptic longitude; radians
+#define APPARENT_CACHE_X             14  // Apparent position, relative to the solar system barycentre; AU, ICRF
+#define APPARENT_CACHE_Y             15
+#define APPARENT_CACHE_Z             16
+#define APPARENT_CACHE_QUANTITIES    17
+
+// The settings which an apparent place depends upon. Cache entries are only shared between queries whose keys match.
+typedef struct {
+    int body_id;  // The object ID number
+    int use_orbital_elements;  // 0 if positions come from DE430; 1 if they come from orbital elements
+    int topocentric;  // Boolean; if zero, <latitude> and <longitude> are ignored
+    double ra_dec_epoch;  // The epoch of the RA/Dec coordinate system
+    double latitude, longitude;  // The position of the observer; degrees
+    double ephemeris_tolerance;  // The accuracy of positions from DE430; km, or 0 for full precision
+    unsigned long elements_checksum;  // Checksum of the object's orbital elements, from <orbitalElements_checksum>
+    int physical;  // Boolean; whether positions, magnitudes, distances and so on are fitted, or only RA and Dec
+} apparentCacheKey;
+
+void apparentCache_open(const char *filename, double tolerance);
+
+void apparentCache_close();
+
+int apparentCache_fetch(const apparentCacheKey *key, double jd, double *values);
+
+void apparentCache_statistics(long *hits, long *fits, long *failures, long *evictions);
+
+#endif
@@ -0,0 +1,402 @@
+// calendarEvents.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// Lunar phases, lunar apsides and nodes, and equinoxes and solstices recur at well-known mean intervals. Rather than
+// stepping through time to bracket each event, we predict the time of each event from its mean interval, and then
+// iterate directly on the Sun-Moon elongation, the Earth-Moon distance, the Moon's ecliptic latitude, or the Sun's
+// ecliptic longitude. The rates of change of these quantities are computed alongside them, from velocities which
+// are already available from the finite differences used to correct for aberration, so that each event typically
+// converges within three or four evaluations of the positions of the Sun and Moon.
+
+#define CALENDAREVENTS_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "mathsTools/precess_equinoxes.h"
+
+#include "calendarEvents.h"
+#include "eventSearch.h"
+#include "jpl.h"
+#include "orbitalElements.h"
+
+// Precision with which the times of events are determined; days
+#define CALENDAR_TIME_TOLERANCE 1e-7
+
+// Maximum number of iterations used to refine the time of each event
+#define CALENDAR_MAX_ITERATIONS 30
+
+// The number of series of events (phases, apsides, nodes and seasons)
+#define CALENDAR_SERIES_COUNT 4
+
+// Mean obliquity of the ecliptic at J2000.0, as used by magnitudeEstimate. Meeus (22.2)
+#define CALENDAR_OBLIQUITY_J2000 ((23. + 26. / 60. + 21.448 / 3600.) / 180. * M_PI)
+
+// A series of events which recur at a mean interval, e.g. the four phases of the Moon
+typedef struct {
+    int first_type;  // The EVENT_* type of the first event in each cycle
+    int events_per_cycle;  // The number of events in each cycle, whose types follow on from <first_type>
+    double epoch;  // Mean time of an event of type <first_type>; TT
+    double interval;  // Mean interval between successive events in the series; days
+    double rate;  // Typical rate of change of the function whose roots are the events; per day
+    double max_step;  // Largest step to take in a single iteration; days
+} calendar_series_definition;
+
+// Mean epochs and intervals from Meeus, Astronomical Algorithms, (49.1), (50.1), (51.1) and table 27.A
+static const calendar_series_definition calendar_series[CALENDAR_SERIES_COUNT] = {
+        {EVENT_NEW_MOON,        4, 2451550.09766, 29.530588861 / 4,  2 * M_PI / 29.530588861,  2},
+        {EVENT_PERIGEE,         2, 2451534.6698,  27.55454989 / 2,   7e-6,                     2},
+        {EVENT_ASCENDING_NODE,  2, 2451565.1619,  27.212220817 / 2,  0.02,                     2},
+        {EVENT_MARCH_EQUINOX,   4, 2451623.80984, 365.242189623 / 4, 2 * M_PI / 365.242189623, 10}
+};
+
+// The progress made through a series of events
+typedef struct {
+    long k;  // The number of the most recent event considered, counting from <epoch>
+    int done;  // Boolean flag indicating that there are no more events in the time span
+    eventFound next;  // The next event to report
+} calendar_series_state;
+
+// The positions of the Sun and Moon at a particular time, in the ecliptic and mean equinox of date
+typedef struct {
+    double moon[3], moon_velocity[3];  // Apparent geocentric position of the Moon; AU and AU per day
+    double sun[3], sun_velocity[3];  // Apparent geocentric position of the Sun; AU and AU per day
+    double moon_dist, moon_dist_dot;  // Geometric distance of the Moon from the Earth; AU and AU per day
+    double nutation;  // Nutation in longitude; radians
+} calendar_frame;
+
+//! calendar_wrap - Wrap an angle into the range -pi to pi
+//! \param [in] angle - The angle to wrap; radians
+//! \return - The wrapped angle; radians
+
+static double calendar_wrap(double angle) {
+    angle = fmod(angle, 2 * M_PI);
+    if (angle > M_PI) angle -= 2 * M_PI;
+    if (angle <= -M_PI) angle += 2 * M_PI;
+    return angle;
+}
+
+//! calendar_rotation_matrix - Compute the matrix which rotates vectors from J2000.0 equatorial coordinates (ICRF) into
+//! the ecliptic and mean equinox of date.
+//! \param [in] jd - The Julian date; TT
+//! \param [out] matrix - The 3x3 rotation matrix, stored row by row
+
+static void calendar_rotation_matrix(const double jd, double *matrix) {
+    int i, j;
+    double precession[9];
+    const double ce = cos(CALENDAR_OBLIQUITY_J2000), se = sin(CALENDAR_OBLIQUITY_J2000);
+
+    // Equatorial J2000.0 -> ecliptic J2000.0 -> ecliptic of date
+    const double to_ecliptic[9] = {1, 0, 0, 0, ce, se, 0, -se, ce};
+    precess_matrix(2451545.0, jd, precession);
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++) {
+            matrix[i * 3 + j] = precession[i * 3] * to_ecliptic[j] + precession[i * 3 + 1] * to_ecliptic[3 + j] +
+                                precession[i * 3 + 2] * to_ecliptic[6 + j];
+        }
+}
+
+//! calendar_rotate - Multiply a vector by a rotation matrix
+//! \param [in] matrix - The 3x3 rotation matrix, stored row by row
+//! \param [in] in - The vector to rotate
+//! \param [out] out - The rotated vector
+
+static void calendar_rotate(const double *matrix, const double *in, double *out) {
+    int i;
+    for (i = 0; i < 3; i++) out[i] = matrix[i * 3] * in[0] + matrix[i * 3 + 1] * in[1] + matrix[i * 3 + 2] * in[2];
+}
+
+//! calendar_frame_compute - Compute the positions and velocities of the Sun and Moon at a particular time
+//! \param [in] jd - The Julian date; TT
+//! \param [out] frame - The positions of the Sun and Moon
+
+static void calendar_frame_compute(const double jd, calendar_frame *frame) {
+    orbitalElementsEpochState state;
+    double matrix[9], moon[3], sun[3], moon_velocity[3], sun_velocity[3];
+    int i;
+
+    orbitalElements_computeEpochState(jd, &state);
+    calendar_rotation_matrix(jd, matrix);
+
+    // Apparent positions of the Moon and Sun, relative to the solar system barycentre
+    for (i = 0; i < 3; i++) {
+        moon[i] = state.earth_pos[i] + state.moon_pos[i];
+        sun[i] = state.sun_pos[i];
+    }
+    jpl_correctAberration(&state, &moon[0], &moon[1], &moon[2]);
+    jpl_correctAberration(&state, &sun[0], &sun[1], &sun[2]);
+
+    // Geocentric positions and velocities. We neglect the Sun's motion relative to the solar system barycentre, which
+    // is only used to estimate rates of change.
+    for (i = 0; i < 3; i++) {
+        moon[i] -= state.earth_pos[i];
+        sun[i] -= state.earth_pos[i];
+        moon_velocity[i] = (state.moon_pos_future[i] - state.moon_pos[i]) / ORBIT_EARTH_VELOCITY_TIMESTEP;
+        sun_velocity[i] = -(state.earth_pos_future[i] - state.earth_pos[i]) / ORBIT_EARTH_VELOCITY_TIMESTEP;
+    }
+
+    calendar_rotate(matrix, moon, frame->moon);
+    calendar_rotate(matrix, moon_velocity, frame->moon_velocity);
+    calendar_rotate(matrix, sun, frame->sun);
+    calendar_rotate(matrix, sun_velocity, frame->sun_velocity);
+
+    frame->moon_dist = gsl_hypot3(state.moon_pos[0], state.moon_pos[1], state.moon_pos[2]);
+    frame->moon_dist_dot = (state.moon_pos[0] * moon_velocity[0] + state.moon_pos[1] * moon_velocity[1] +
+                            state.moon_pos[2] * moon_velocity[2]) / frame->moon_dist;
+
+    // Nutation in longitude
+    frame->nutation = nutation_longitude(jd);
+}
+
+//! calendar_longitude - Compute the ecliptic longitude of a position vector, and its rate of change
+//! \param [in] pos - The position vector, in ecliptic coordinates
+//! \param [in] velocity - The velocity vector, in ecliptic coordinates
+//! \param [out] longitude_dot - The rate of change of the longitude; radians per day
+//! \return - The ecliptic longitude; radians
+
+static double calendar_longitude(const double *pos, const double *velocity, double *longitude_dot) {
+    *longitude_dot = (pos[0] * velocity[1] - pos[1] * velocity[0]) / (gsl_pow_2(pos[0]) + gsl_pow_2(pos[1]));
+    return atan2(pos[1], pos[0]);
+}
+
+//! calendar_latitude - Compute the ecliptic latitude of a position vector, and its rate of change
+//! \param [in] pos - The position vector, in ecliptic coordinates
+//! \param [in] velocity - The velocity vector, in ecliptic coordinates
+//! \param [out] latitude_dot - The rate of change of the latitude; radians per day
+//! \return - The ecliptic latitude; radians
+
+static double calendar_latitude(const double *pos, const double *velocity, double *latitude_dot) {
+    const double rho_2 = gsl_pow_2(pos[0]) + gsl_pow_2(pos[1]);
+    const double r_2 = rho_2 + gsl_pow_2(pos[2]);
+    *latitude_dot = (velocity[2] * rho_2 - pos[2] * (pos[0] * velocity[0] + pos[1] * velocity[1])) /
+                    (r_2 * sqrt(rho_2));
+    return atan2(pos[2], sqrt(rho_2));
+}
+
+//! calendar_quantity - Evaluate the function whose roots are a particular type of event. The function always
+//! increases through zero at the event.
+//! \param [in] type - One of the EVENT_* calendar types
+//! \param [in] frame - The positions of the Sun and Moon
+//! \param [out] g_dot - The rate of change of the function, or NaN if this is not known; per day
+//! \return - The value of the function
+
+static double calendar_quantity(const int type, const calendar_frame *frame, double *g_dot) {
+    double moon_lng_dot, sun_lng_dot, moon_lat_dot;
+
+    switch (type) {
+        case EVENT_NEW_MOON:
+        case EVENT_FIRST_QUARTER:
+        case EVENT_FULL_MOON:
+        case EVENT_LAST_QUARTER: {
+            const double moon_lng = calendar_longitude(frame->moon, frame->moon_velocity, &moon_lng_dot);
+            const double sun_lng = calendar_longitude(frame->sun, frame->sun_velocity, &sun_lng_dot);
+            *g_dot = moon_lng_dot - sun_lng_dot;
+            return calendar_wrap(moon_lng - sun_lng - (type - EVENT_NEW_MOON) * M_PI / 2);
+        }
+        case EVENT_PERIGEE:
+        case EVENT_APOGEE:
+            *g_dot = GSL_NAN;
+            return (type == EVENT_PERIGEE) ? frame->moon_dist_dot : -frame->moon_dist_dot;
+        case EVENT_ASCENDING_NODE:
+        case EVENT_DESCENDING_NODE: {
+            const double moon_lat = calendar_latitude(frame->moon, frame->moon_velocity, &moon_lat_dot);
+            *g_dot = (type == EVENT_ASCENDING_NODE) ? moon_lat_dot : -moon_lat_dot;
+            return (type == EVENT_ASCENDING_NODE) ? moon_lat : -moon_lat;
+        }
+        default: {
+            const double sun_lng = calendar_longitude(frame->sun, frame->sun_velocity, &sun_lng_dot);
+            *g_dot = sun_lng_dot;
+            return calendar_wrap(sun_lng + frame->nutation - (type - EVENT_MARCH_EQUINOX) * M_PI / 2);
+        }
+    }
+}
+
+//! calendar_solve - Find the time of an event, starting from a prediction of when it occurs. We take Newton-Raphson
+//! steps where the rate of change of the function is known, and secant steps otherwise. Once the event has been
+//! bracketed, steps which would leave the bracket are replaced by bisection.
+//! \param [in] series - The series of events
+//! \param [in] type - One of the EVENT_* calendar types
+//! \param [in] jd - The predicted time of the event; TT
+//! \param [out] frame - The positions of the Sun and Moon at the time of the event
+//! \return - The time of the event; TT
+
+static double calendar_solve(const calendar_series_definition *series, const int type, double jd,
+                             calendar_frame *frame) {
+    double jd_previous = GSL_NAN, g_previous = GSL_NAN;
+    double jd_low = GSL_NAN, jd_high = GSL_NAN;
+    int iteration;
+
+    for (iteration = 0; iteration < CALENDAR_MAX_ITERATIONS; iteration++) {
+        double g_dot;
+        calendar_frame_compute(jd, frame);
+        const double g = calendar_quantity(type, frame, &g_dot);
+
+        // The function increases through zero, so the event lies after any point where it is negative
+        if (g < 0) jd_low = gsl_isnan(jd_low) ? jd : GSL_MAX(jd_low, jd);
+        else jd_high = gsl_isnan(jd_high) ? jd : GSL_MIN(jd_high, jd);
+
+        if (!gsl_finite(g_dot)) {
+            if (gsl_finite(g_previous) && (g != g_previous)) g_dot = (g - g_previous) / (jd - jd_previous);
+            else g_dot = series->rate;
+        }
+        if (g_dot <= 0) g_dot = series->rate;
+
+        double step = -g / g_dot;
+        if (fabs(step) < CALENDAR_TIME_TOLERANCE) return jd + step;
+        if (step > series->max_step) step = series->max_step;
+        if (step < -series->max_step) step = -series->max_step;
+        double jd_new = jd + step;
+
+        if (gsl_finite(jd_low) && gsl_finite(jd_high) && ((jd_new <= jd_low) || (jd_new >= jd_high))) {
+            jd_new = (jd_low + jd_high) / 2;
+        }
+
+        jd_previous = jd;
+        g_previous = g;
+        jd = jd_new;
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Event of type %d near JD %.3f did not converge.", type, jd);
+        ephem_log(temp_err_string);
+    }
+    return jd;
+}
+
+//! calendar_series_next - Find the next event in a series which is of one of the types we are searching for
+//! \param [in] series - The series of events
+//! \param [in|out] state - The progress made through the series
+//! \param [in] enabled - Boolean flags indicating which EVENT_* types we are searching for
+//! \param [in] jd_min - The start of the time span to search; TT
+//! \param [in] jd_max - The end of the time span to search; TT
+
+static void calendar_series_next(const calendar_series_definition *series, calendar_series_state *state,
+                                 const int *enabled, const double jd_min, const double jd_max) {
+    while (!state->done) {
+        calendar_frame frame;
+        state->k++;
+        const int phase = (int) (((state->k % series->events_per_cycle) + series->events_per_cycle) %
+                                 series->events_per_cycle);
+        const int type = series->first_type + phase;
+        const double jd_estimate = series->epoch + state->k * series->interval;
+
+        // Events never stray from their predicted times by more than a few days
+        if (jd_estimate > jd_max + series->interval) {
+            state->done = 1;
+            return;
+        }
+        if (!enabled[type]) continue;
+
+        const double jd = calendar_solve(series, type, jd_estimate, &frame);
+        if (jd < jd_min) continue;
+        if (jd >= jd_max) {
+            state->done = 1;
+            return;
+        }
+
+        eventFound *event = &state->next;
+        event->type = type;
+        event->jd = jd;
+        event->body_a = 9;
+        event->body_b = -1;
+        event->sense = 1;
+
+        switch (series->first_type) {
+            case EVENT_NEW_MOON: {
+                // Record the angular separation of the Sun and Moon
+                const double cross[3] = {
+                        frame.moon[1] * frame.sun[2] - frame.moon[2] * frame.sun[1],
+                        frame.moon[2] * frame.sun[0] - frame.moon[0] * frame.sun[2],
+                        frame.moon[0] * frame.sun[1] - frame.moon[1] * frame.sun[0]
+                };
+                const double dot = frame.moon[0] * frame.sun[0] + frame.moon[1] * frame.sun[1] +
+                                   frame.moon[2] * frame.sun[2];
+                event->body_b = 10;
+                event->value = atan2(gsl_hypot3(cross[0], cross[1], cross[2]), dot);
+                break;
+            }
+            case EVENT_PERIGEE:
+                // Record the Earth-Moon distance
+                event->sense = (type == EVENT_PERIGEE) ? 1 : -1;
+                event->value = frame.moon_dist;
+                break;
+            case EVENT_ASCENDING_NODE:
+                // Record the ecliptic longitude of the node, in the range 0 to 2 pi
+                event->sense = (type == EVENT_ASCENDING_NODE) ? 1 : -1;
+                event->value = calendar_wrap(atan2(frame.moon[1], frame.moon[0]) + frame.nutation - M_PI) + M_PI;
+                break;
+            default:
+                // Record the Sun's apparent ecliptic longitude, in the range 0 to 2 pi
+                event->body_a = 10;
+                event->value = calendar_wrap(atan2(frame.sun[1], frame.sun[0]) + frame.nutation - M_PI) + M_PI;
+                break;
+        }
+        return;
+    }
+}
+
+//! calendarEvents_run - Produce a calendar of lunar phases, lunar perigees and apogees, lunar node crossings, and
+//! equinoxes and solstices between two times. Longitudes are apparent geocentric longitudes, measured in the
+//! ecliptic and equinox of date. Events are passed to the callback function <report> in time order.
+//! \param [in] enabled - Boolean flags, indexed by EVENT_* type, indicating which types of event to report
+//! \param [in] jd_min - The start of the time span to search; TT
+//! \param [in] jd_max - The end of the time span to search; TT
+//! \param [in] report - Callback function to call with each event found
+//! \param [in] context - Pointer which is passed to <report>
+
+void calendarEvents_run(const int *enabled, const double jd_min, const double jd_max,
+                        void (*report)(const eventFound *, void *), void *context) {
+    calendar_series_state states[CALENDAR_SERIES_COUNT];
+    int i;
+
+    // Start each series a couple of events before the start of the time span, to allow for the differences between
+    // the true and predicted times of events
+    for (i = 0; i < CALENDAR_SERIES_COUNT; i++) {
+        const calendar_series_definition *series = &calendar_series[i];
+        int type, any_enabled = 0;
+        for (type = series->first_type; type < series->first_type + series->events_per_cycle; type++) {
+            if (enabled[type]) any_enabled = 1;
+        }
+        states[i].k = (long) floor((jd_min - series->epoch) / series->interval) - 2;
+        states[i].done = !any_enabled;
+        calendar_series_next(series, &states[i], enabled, jd_min, jd_max);
+    }
+
+    // Merge the series, reporting the earliest outstanding event each time
+    while (1) {
+        int earliest = -1;
+        for (i = 0; i < CALENDAR_SERIES_COUNT; i++) {
+            if (states[i].done) continue;
+            if ((earliest < 0) || (states[i].next.jd < states[earliest].next.jd)) earliest = i;
+        }
+        if (earliest < 0) break;
+
+        report(&states[earliest].next, context);
+        calendar_series_next(&calendar_series[earliest], &states[earliest], enabled, jd_min, jd_max);
+    }
+}
@@ -0,0 +1,30 @@
+// calendarEvents.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef CALENDAREVENTS_H
+#define CALENDAREVENTS_H 1
+
+#include "eventSearch.h"
+
+void calendarEvents_run(const int *enabled, double jd_min, double jd_max,
+                        void (*report)(const eventFound *, void *), void *context);
+
+#endif
@@ -0,0 +1,370 @@
+// closeApproach.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#define CLOSEAPPROACH_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "mathsTools/brent.h"
+
+#include "closeApproach.h"
+#include "jpl.h"
+#include "orbitalElements.h"
+
+// Numerical constants
+const static double CLOSE_APPROACH_ASTRONOMICAL_UNIT = 149597870700.; // m
+
+// Number of points around each orbit at which distances are sampled, before refining the minima we find
+#define MOID_GRID 64
+
+// Maximum number of local minima on the grid which we refine
+#define MOID_MAX_MINIMA 8
+
+// Precision with which eccentric anomalies are refined when computing MOIDs; radians
+#define MOID_TOLERANCE 1e-8
+
+// The planets' orbital elements are only a first-order model, so they can stray from the orbits used to compute
+// MOIDs. Candidates are kept if their MOID is within this margin of the threshold: a fixed amount, in AU, plus a
+// fraction of the planet's distance from the Sun.
+#define MOID_MARGIN_FIXED 0.002
+#define MOID_MARGIN_FRACTION 0.005
+
+// An upper limit on the speed of any asteroid relative to any planet; AU per day (about 170 km/s)
+#define CLOSE_APPROACH_MAX_SPEED 0.1
+
+// Limits on the time steps taken when searching for close approaches; days
+#define CLOSE_APPROACH_STEP_MIN 1e-4
+#define CLOSE_APPROACH_STEP_MAX 10.
+
+// Within the distance threshold, the step is chosen so that the distance cannot change by more than this fraction
+#define CLOSE_APPROACH_STEP_FRACTION 0.2
+
+// Precision with which times of closest approach are refined; days
+#define CLOSE_APPROACH_TIME_TOLERANCE 1e-6
+
+// Time step used to estimate relative velocities at closest approach; days
+#define CLOSE_APPROACH_VELOCITY_TIMESTEP 1e-3
+
+// The shape and orientation of an elliptical orbit, in the J2000.0 ecliptic frame
+typedef struct {
+    double a, b, e;  // Semi-major axis, semi-minor axis (AU), and eccentricity
+    double P[3], Q[3];  // Unit vectors pointing towards perihelion, and 90 degrees ahead of it
+} close_approach_orbit;
+
+//! close_approach_orbit_setup - Compute the shape and orientation of an orbit at a particular time
+//! \param [in] in - The orbital elements of the object
+//! \param [in] jd - The time at which to evaluate the orbital elements; TT
+//! \param [out] out - The shape and orientation of the orbit
+//! \return - Zero if the orbit is not a closed ellipse
+
+static int close_approach_orbit_setup(const orbitalElements *in, const double jd, close_approach_orbit *out) {
+    const double offset_from_epoch = jd - in->epochOsculation;
+    const double a = in->semiMajorAxis + in->semiMajorAxis_dot * offset_from_epoch;
+    const double e = in->eccentricity + in->eccentricity_dot * offset_from_epoch;
+    const double N = in->longAscNode + in->longAscNode_dot * offset_from_epoch;
+    const double inc = in->inclination + in->inclination_dot * offset_from_epoch;
+    const double w = in->argumentPerihelion + in->argumentPerihelion_dot * offset_from_epoch;
+
+    if ((!gsl_finite(a)) || (!gsl_finite(e)) || (a <= 0) || (e < 0) || (e >= 1)) return 0;
+
+    out->a = a;
+    out->b = a * sqrt(1 - e * e);
+    out->e = e;
+
+    out->P[0] = cos(N) * cos(w) - sin(N) * sin(w) * cos(inc);
+    out->P[1] = sin(N) * cos(w) + cos(N) * sin(w) * cos(inc);
+    out->P[2] = sin(w) * sin(inc);
+
+    out->Q[0] = -cos(N) * sin(w) - sin(N) * cos(w) * cos(inc);
+    out->Q[1] = -sin(N) * sin(w) + cos(N) * cos(w) * cos(inc);
+    out->Q[2] = cos(w) * sin(inc);
+    return 1;
+}
+
+//! close_approach_orbit_point - Compute the position of a point on an orbit, relative to the Sun
+//! \param [in] o - The orbit
+//! \param [in] E - The eccentric anomaly of the point; radians
+//! \param [out] out - The position of the point; AU
+
+static void close_approach_orbit_point(const close_approach_orbit *o, const double E, double *out) {
+    const double x = o->a * (cos(E) - o->e);
+    const double y = o->b * sin(E);
+    out[0] = x * o->P[0] + y * o->Q[0];
+    out[1] = x * o->P[1] + y * o->Q[1];
+    out[2] = x * o->P[2] + y * o->Q[2];
+}
+
+// Parameters passed to the functions which Brent's method minimises when computing MOIDs
+typedef struct {
+    const close_approach_orbit *orbit_a, *orbit_b;
+    double point_a[3];  // The point on orbit A from which we measure distances to orbit B
+    double guess_b;  // The eccentric anomaly on orbit B around which to search
+} moid_params;
+
+//! moid_distance_to_b - Squared distance from a fixed point on orbit A to the point on orbit B at eccentric anomaly E
+
+static double moid_distance_to_b(const double E, void *params) {
+    const moid_params *p = (const moid_params *) params;
+    double point_b[3];
+    close_approach_orbit_point(p->orbit_b, E, point_b);
+    return gsl_pow_2(p->point_a[0] - point_b[0]) + gsl_pow_2(p->point_a[1] - point_b[1]) +
+           gsl_pow_2(p->point_a[2] - point_b[2]);
+}
+
+//! moid_closest_to_a - Squared distance from the point on orbit A at eccentric anomaly E to the nearest point on
+//! orbit B, searching within one grid cell either side of <guess_b>
+
+static double moid_closest_to_a(const double E, void *params) {
+    moid_params *p = (moid_params *) params;
+    const double h = 2 * M_PI / MOID_GRID;
+    double E_b;
+    close_approach_orbit_point(p->orbit_a, E, p->point_a);
+    return brent_minimise(moid_distance_to_b, params, p->guess_b - 2 * h, p->guess_b, p->guess_b + 2 * h,
+                          MOID_TOLERANCE, &E_b);
+}
+
+//! closeApproach_moid - Compute the minimum orbit intersection distance (MOID) between two elliptical orbits: the
+//! closest that any point on one orbit comes to any point on the other. Distances are first sampled on a grid of
+//! eccentric anomalies, and then the deepest local minima are refined using Brent's method.
+//! \param [in] a - The orbital elements of the first object
+//! \param [in] b - The orbital elements of the second object
+//! \param [in] jd - The time at which to evaluate the orbital elements; TT
+//! \return - The MOID (AU), or zero if either orbit is not a closed ellipse, since then no objects can be excluded
+
+double closeApproach_moid(const orbitalElements *a, const orbitalElements *b, const double jd) {
+    int i, j, k, minima_count = 0;
+    close_approach_orbit orbit_a, orbit_b;
+    double points_a[MOID_GRID][3], points_b[MOID_GRID][3];
+    double distance[MOID_GRID][MOID_GRID];
+    int minima_i[MOID_MAX_MINIMA], minima_j[MOID_MAX_MINIMA];
+
+    if ((!close_approach_orbit_setup(a, jd, &orbit_a)) || (!close_approach_orbit_setup(b, jd, &orbit_b))) return 0;
+
+    const double h = 2 * M_PI / MOID_GRID;
+    for (i = 0; i < MOID_GRID; i++) {
+        close_approach_orbit_point(&orbit_a, i * h, points_a[i]);
+        close_approach_orbit_point(&orbit_b, i * h, points_b[i]);
+    }
+
+    // Sample squared distances on a grid
+    for (i = 0; i < MOID_GRID; i++)
+        for (j = 0; j < MOID_GRID; j++) {
+            distance[i][j] = gsl_pow_2(points_a[i][0] - points_b[j][0]) +
+                             gsl_pow_2(points_a[i][1] - points_b[j][1]) +
+                             gsl_pow_2(points_a[i][2] - points_b[j][2]);
+        }
+
+    // Find the deepest local minima on the grid, which wraps around in both directions
+    for (i = 0; i < MOID_GRID; i++)
+        for (j = 0; j < MOID_GRID; j++) {
+            int di, dj, is_minimum = 1;
+            for (di = -1; (di <= 1) && is_minimum; di++)
+                for (dj = -1; (dj <= 1) && is_minimum; dj++) {
+                    if ((di == 0) && (dj == 0)) continue;
+                    const double neighbour = distance[(i + di + MOID_GRID) % MOID_GRID][(j + dj + MOID_GRID) %
+                                                                                          MOID_GRID];
+                    if (neighbour < distance[i][j]) is_minimum = 0;
+                }
+            if (!is_minimum) continue;
+
+            // Insert into list of minima, which is kept in order of depth
+            for (k = minima_count; k > 0; k--) {
+                if (distance[minima_i[k - 1]][minima_j[k - 1]] <= distance[i][j]) break;
+                if (k < MOID_MAX_MINIMA) {
+                    minima_i[k] = minima_i[k - 1];
+                    minima_j[k] = minima_j[k - 1];
+                }
+            }
+            if (k < MOID_MAX_MINIMA) {
+                minima_i[k] = i;
+                minima_j[k] = j;
+                if (minima_count < MOID_MAX_MINIMA) minima_count++;
+            }
+        }
+
+    // Refine each minimum. For each point on orbit A, the nearest point on orbit B is found by an inner search.
+    double best = GSL_POSINF;
+    for (k = 0; k < minima_count; k++) {
+        moid_params params;
+        double E_a;
+        params.orbit_a = &orbit_a;
+        params.orbit_b = &orbit_b;
+        params.guess_b = minima_j[k] * h;
+        const double refined = brent_minimise(moid_closest_to_a, &params, (minima_i[k] - 1) * h, minima_i[k] * h,
+                                              (minima_i[k] + 1) * h, MOID_TOLERANCE, &E_a);
+        best = GSL_MIN(best, GSL_MIN(refined, distance[minima_i[k]][minima_j[k]]));
+    }
+
+    return sqrt(best);
+}
+
+//! closeApproach_moidMargin - Return the margin which should be added to a distance threshold before using MOIDs
+//! against a planet's orbit to exclude objects, allowing for the difference between the planet's orbital elements
+//! and its true position in DE430.
+//! \param [in] planet_id - The bodyId of the planet
+//! \return - The margin; AU
+
+double closeApproach_moidMargin(const int planet_id) {
+    orbitalElements_planets_init();
+    const int slot = orbitalElements_planets_slot(planet_id);
+    if (slot < 0) return GSL_POSINF;
+    return MOID_MARGIN_FIXED + MOID_MARGIN_FRACTION * orbitalElements_planets_fetch(slot)->semiMajorAxis;
+}
+
+//! close_approach_planet_xyz - Compute the position of a planet relative to the solar system barycentre, from DE430
+//! \param [in] planet_id - The bodyId of the planet; 19 for the Earth
+//! \param [in] jd - Julian date; TT
+//! \param [out] out - The position of the planet (AU) in ICRF
+
+static void close_approach_planet_xyz(const int planet_id, const double jd, double *out) {
+    if (planet_id == 19) {
+        // DE430 gives us the Earth/Moon barycentre (body 2), from which we subtract a small fraction of the Moon's
+        // offset (body 9) to get the Earth's centre of mass
+        const double earth_mass = 0.8887692390113509e-9;
+        const double moon_mass = 0.1093189565989898e-10;
+        const double moon_earth_mass_ratio = moon_mass / (moon_mass + earth_mass);
+        double moon_pos[3];
+        jpl_computeXYZ(2, jd, &out[0], &out[1], &out[2]);
+        jpl_computeXYZ(9, jd, &moon_pos[0], &moon_pos[1], &moon_pos[2]);
+        out[0] -= moon_earth_mass_ratio * moon_pos[0];
+        out[1] -= moon_earth_mass_ratio * moon_pos[1];
+        out[2] -= moon_earth_mass_ratio * moon_pos[2];
+    } else if ((planet_id >= 0) && (planet_id <= 8)) {
+        jpl_computeXYZ(planet_id, jd, &out[0], &out[1], &out[2]);
+    } else {
+        out[0] = out[1] = out[2] = GSL_NAN;
+    }
+}
+
+//! close_approach_offset - Compute the position of an object relative to a planet
+//! \param [in] body_id - The bodyId of the object
+//! \param [in] planet_id - The bodyId of the planet
+//! \param [in] jd - Julian date; TT
+//! \param [out] out - The position of the object relative to the planet (AU) in ICRF
+
+static void close_approach_offset(const int body_id, const int planet_id, const double jd, double *out) {
+    double object_pos[3], sun_pos[3], planet_pos[3];
+
+    // Orbital elements give positions relative to the Sun
+    orbitalElements_computeXYZ(body_id, jd, &object_pos[0], &object_pos[1], &object_pos[2]);
+    jpl_computeXYZ(10, jd, &sun_pos[0], &sun_pos[1], &sun_pos[2]);
+    close_approach_planet_xyz(planet_id, jd, planet_pos);
+
+    out[0] = object_pos[0] + sun_pos[0] - planet_pos[0];
+    out[1] = object_pos[1] + sun_pos[1] - planet_pos[1];
+    out[2] = object_pos[2] + sun_pos[2] - planet_pos[2];
+}
+
+//! closeApproach_distance - Compute the distance between an object and a planet at a particular time
+//! \param [in] body_id - The bodyId of the object
+//! \param [in] planet_id - The bodyId of the planet; 19 for the Earth
+//! \param [in] jd - Julian date; TT
+//! \return - The distance between the object and the planet; AU
+
+double closeApproach_distance(const int body_id, const int planet_id, const double jd) {
+    double offset[3];
+    close_approach_offset(body_id, planet_id, jd, offset);
+    return gsl_hypot3(offset[0], offset[1], offset[2]);
+}
+
+// Parameters passed to the function which Brent's method minimises when refining close approaches
+typedef struct {
+    int body_id, planet_id;
+} close_approach_params;
+
+//! close_approach_distance_at - Wrapper around closeApproach_distance in the form expected by brent_minimise
+
+static double close_approach_distance_at(const double jd, void *params) {
+    const close_approach_params *p = (const close_approach_params *) params;
+    return closeApproach_distance(p->body_id, p->planet_id, jd);
+}
+
+//! closeApproach_search - Search for times when an object passes within <threshold> of a planet. The time step is
+//! chosen adaptively: while the object is far from the threshold, we take the largest step in which it could not
+//! possibly reach it. Each local minimum of distance is then refined using Brent's method.
+//! \param [in] body_id - The bodyId of the object
+//! \param [in] planet_id - The bodyId of the planet; 19 for the Earth
+//! \param [in] jd_min - The start of the time span to search; TT
+//! \param [in] jd_max - The end of the time span to search; TT
+//! \param [in] threshold - The largest distance of closest approach to report; AU
+//! \param [out] events_out - Array to populate with the close approaches found
+//! \param [in] max_events - The number of entries there is room for in <events_out>
+//! \return - The number of close approaches found
+
+int closeApproach_search(const int body_id, const int planet_id, const double jd_min, const double jd_max,
+                         const double threshold, closeApproachEvent *events_out, const int max_events) {
+    int count = 0;
+    close_approach_params params;
+    params.body_id = body_id;
+    params.planet_id = planet_id;
+
+    // Keep track of the last three distances we have sampled, to spot local minima
+    double t0 = jd_min, d0 = closeApproach_distance(body_id, planet_id, t0);
+    double t1 = t0, d1 = d0;
+
+    while ((t1 < jd_max) && gsl_finite(d1)) {
+        double step = GSL_MAX(d1 - threshold, CLOSE_APPROACH_STEP_FRACTION * d1) / CLOSE_APPROACH_MAX_SPEED;
+        step = GSL_MIN(GSL_MAX(step, CLOSE_APPROACH_STEP_MIN), CLOSE_APPROACH_STEP_MAX);
+
+        const double t2 = GSL_MIN(t1 + step, jd_max);
+        const double d2 = closeApproach_distance(body_id, planet_id, t2);
+
+        // Refine local minima which could lie within the threshold
+        if ((t1 > t0) && (d1 <= d0) && (d1 < d2) && (d1 - CLOSE_APPROACH_MAX_SPEED * (t2 - t0) < threshold)) {
+            double jd_closest;
+            const double distance = brent_minimise(close_approach_distance_at, &params, t0, t1, t2,
+                                                   CLOSE_APPROACH_TIME_TOLERANCE, &jd_closest);
+
+            if ((distance <= threshold) && (count < max_events)) {
+                double offset_before[3], offset_after[3];
+                close_approach_offset(body_id, planet_id, jd_closest - CLOSE_APPROACH_VELOCITY_TIMESTEP,
+                                      offset_before);
+                close_approach_offset(body_id, planet_id, jd_closest + CLOSE_APPROACH_VELOCITY_TIMESTEP,
+                                      offset_after);
+                const double speed = gsl_hypot3(offset_after[0] - offset_before[0],
+                                                offset_after[1] - offset_before[1],
+                                                offset_after[2] - offset_before[2]) /
+                                     (2 * CLOSE_APPROACH_VELOCITY_TIMESTEP);  // AU per day
+
+                events_out[count].body_id = body_id;
+                events_out[count].planet_id = planet_id;
+                events_out[count].jd = jd_closest;
+                events_out[count].distance = distance;
+                events_out[count].speed = speed * CLOSE_APPROACH_ASTRONOMICAL_UNIT / 1e3 / 86400;
+                count++;
+            }
+        }
+
+        t0 = t1;
+        d0 = d1;
+        t1 = t2;
+        d1 = d2;
+    }
+
+    return count;
+}
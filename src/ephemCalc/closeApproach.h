@@ -0,0 +1,45 @@
+// closeApproach.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef CLOSEAPPROACH_H
+#define CLOSEAPPROACH_H 1
+
+#include "orbitalElements.h"
+
+// A close approach between a solar system object and a planet
+typedef struct {
+    int body_id;  // The bodyId of the object
+    int planet_id;  // The bodyId of the planet, e.g. 19 for the Earth
+    double jd;  // The time of closest approach; TT
+    double distance;  // The distance of closest approach; AU
+    double speed;  // The speed of the object relative to the planet at closest approach; km/s
+} closeApproachEvent;
+
+double closeApproach_moid(const orbitalElements *a, const orbitalElements *b, double jd);
+
+double closeApproach_moidMargin(int planet_id);
+
+double closeApproach_distance(int body_id, int planet_id, double jd);
+
+int closeApproach_search(int body_id, int planet_id, double jd_min, double jd_max, double threshold,
+                         closeApproachEvent *events_out, int max_events);
+
+#endif
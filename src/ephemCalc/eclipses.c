@@ -0,0 +1,805 @@
+// eclipses.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// Eclipses can only occur at new and full moons which fall close to one of the Moon's nodes. We find the times of
+// new and full moons using <calendarEvents_run>, and discard those where the Moon's mean argument of latitude rules
+// out an eclipse. For each remaining candidate, we sample the geometry of the Sun, Moon and Earth at intervals of
+// half an hour, and fit polynomials to it. For solar eclipses these polynomials are the Besselian elements, following
+// chapter 8 of the Explanatory Supplement to the Astronomical Almanac (1992). The times of greatest eclipse and of
+// the contacts, and the local circumstances of solar eclipses at any number of places, are then found by evaluating
+// these polynomials, without any further use of the ephemeris.
+
+#define ECLIPSES_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <gsl/gsl_const_mksa.h>
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+#include "calendarEvents.h"
+#include "eclipses.h"
+#include "eventSearch.h"
+#include "jpl.h"
+#include "orbitalElements.h"
+
+// Equatorial radius of the Earth, and the square of the eccentricity of its meridian (WGS84)
+#define ECLIPSE_EARTH_RADIUS     6378137.0  /* metres */
+#define ECLIPSE_EARTH_E2         0.00669437999014
+
+// Radius of the Sun
+#define ECLIPSE_SUN_RADIUS       696000e3  /* metres */
+
+// Radius of the Moon, in units of the Earth's equatorial radius (IAU 1982)
+#define ECLIPSE_MOON_RADIUS      0.2725076
+
+// Factor by which the Earth's shadow is enlarged to allow for its atmosphere (Chauvenet)
+#define ECLIPSE_SHADOW_ENLARGEMENT 1.02
+
+// No eclipse is possible when the sine of the Moon's mean argument of latitude exceeds this. Meeus, chapter 54
+#define ECLIPSE_NODE_LIMIT       0.36
+
+// The polynomials fitted to each eclipse are fitted to samples spanning this many hours either side of their
+// reference time, at intervals of half an hour
+#define ECLIPSE_FIT_HALF_WIDTH   4.0
+#define ECLIPSE_FIT_SAMPLES      17
+
+// Precision with which times are determined; hours
+#define ECLIPSE_TIME_TOLERANCE   1e-6
+
+// Step size used to bracket contact times; hours
+#define ECLIPSE_CONTACT_STEP     0.25
+
+// Maximum number of iterations used to refine any time
+#define ECLIPSE_MAX_ITERATIONS   30
+
+// The number of quantities sampled for each solar eclipse: x, y, d, mu, l1, l2, tan f1, tan f2
+#define ECLIPSE_SOLAR_QUANTITIES 8
+
+// The number of quantities sampled for each lunar eclipse: x, y, penumbral radius, umbral radius, lunar radius,
+// and the sine of the Moon's horizontal parallax
+#define ECLIPSE_LUNAR_QUANTITIES 6
+
+// The geometry of a lunar eclipse, as polynomials in the time <t> since <t0>, measured in hours. The Moon's position
+// is measured in the plane of the sky, relative to the centre of the Earth's shadow, in radians.
+typedef struct {
+    double t0;  // TT
+    double x[ECLIPSE_POLYNOMIAL_TERMS], y[ECLIPSE_POLYNOMIAL_TERMS];  // Towards the east and north; radians
+    double penumbra[ECLIPSE_POLYNOMIAL_TERMS];  // Angular radius of the Earth's penumbra; radians
+    double umbra[ECLIPSE_POLYNOMIAL_TERMS];  // Angular radius of the Earth's umbra; radians
+    double moon_radius[ECLIPSE_POLYNOMIAL_TERMS];  // Angular radius of the Moon; radians
+    double sin_parallax;  // Sine of the Moon's horizontal parallax
+} eclipse_lunar_elements;
+
+// The position of an observer on the Earth's surface
+typedef struct {
+    double rho_sin_phi, rho_cos_phi;  // Geocentric position, in units of the Earth's equatorial radius
+    double longitude;  // East of Greenwich; radians
+} eclipse_observer;
+
+// The circumstances of a solar eclipse seen by an observer at a particular time
+typedef struct {
+    double u, v;  // Position of the observer relative to the shadow axis, in the fundamental plane
+    double a, b;  // Rates of change of u and v; per hour
+    double zeta;  // Height of the observer above the fundamental plane
+    double L1, L2;  // Radii of the penumbra and umbra in the observer's plane
+} eclipse_local_state;
+
+// The new and full moons which have been found, to be screened for eclipses
+typedef struct {
+    eventFound *items;
+    int count, capacity;
+} eclipse_syzygy_list;
+
+//! eclipses_typeName - Return the name of a type of eclipse
+//! \param [in] type - One of the ECLIPSE_* types
+//! \return - The name of the type of eclipse
+
+const char *eclipses_typeName(const int type) {
+    switch (type) {
+        case ECLIPSE_PARTIAL:
+            return "partial";
+        case ECLIPSE_ANNULAR:
+            return "annular";
+        case ECLIPSE_TOTAL:
+            return "total";
+        case ECLIPSE_HYBRID:
+            return "hybrid";
+        case ECLIPSE_PENUMBRAL:
+            return "penumbral";
+        default:
+            return "unknown";
+    }
+}
+
+//! eclipse_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *eclipse_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! eclipse_polynomial - Evaluate one of the polynomials fitted to an eclipse
+//! \param [in] c - The coefficients of the polynomial
+//! \param [in] t - The time since the polynomial's reference time; hours
+//! \return - The value of the polynomial
+
+static double eclipse_polynomial(const double *c, const double t) {
+    int i;
+    double output = 0;
+    for (i = ECLIPSE_POLYNOMIAL_TERMS - 1; i >= 0; i--) output = output * t + c[i];
+    return output;
+}
+
+//! eclipse_polynomial_dot - Evaluate the rate of change of one of the polynomials fitted to an eclipse
+//! \param [in] c - The coefficients of the polynomial
+//! \param [in] t - The time since the polynomial's reference time; hours
+//! \return - The rate of change of the polynomial; per hour
+
+static double eclipse_polynomial_dot(const double *c, const double t) {
+    int i;
+    double output = 0;
+    for (i = ECLIPSE_POLYNOMIAL_TERMS - 1; i >= 1; i--) output = output * t + i * c[i];
+    return output;
+}
+
+//! eclipse_polynomial_fit - Fit a polynomial to samples of a quantity by least squares, by solving the normal
+//! equations by Gaussian elimination with partial pivoting.
+//! \param [in] t - The times of the samples; hours
+//! \param [in] values - The values of the samples
+//! \param [in] stride - The separation of successive samples within <values>
+//! \param [out] c - The coefficients of the fitted polynomial
+
+static void eclipse_polynomial_fit(const double *t, const double *values, const int stride, double *c) {
+    const int n = ECLIPSE_POLYNOMIAL_TERMS;
+    double matrix[ECLIPSE_POLYNOMIAL_TERMS][ECLIPSE_POLYNOMIAL_TERMS + 1];
+    int i, j, k;
+
+    for (i = 0; i < n; i++) for (j = 0; j <= n; j++) matrix[i][j] = 0;
+    for (k = 0; k < ECLIPSE_FIT_SAMPLES; k++) {
+        double powers[2 * ECLIPSE_POLYNOMIAL_TERMS];
+        powers[0] = 1;
+        for (i = 1; i < 2 * n; i++) powers[i] = powers[i - 1] * t[k];
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) matrix[i][j] += powers[i + j];
+            matrix[i][n] += powers[i] * values[k * stride];
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        int pivot = i;
+        for (j = i + 1; j < n; j++) if (fabs(matrix[j][i]) > fabs(matrix[pivot][i])) pivot = j;
+        for (k = 0; k <= n; k++) {
+            const double tmp = matrix[i][k];
+            matrix[i][k] = matrix[pivot][k];
+            matrix[pivot][k] = tmp;
+        }
+        for (j = i + 1; j < n; j++) {
+            const double factor = matrix[j][i] / matrix[i][i];
+            for (k = i; k <= n; k++) matrix[j][k] -= factor * matrix[i][k];
+        }
+    }
+
+    for (i = n - 1; i >= 0; i--) {
+        double sum = matrix[i][n];
+        for (j = i + 1; j < n; j++) sum -= matrix[i][j] * c[j];
+        c[i] = sum / matrix[i][i];
+    }
+}
+
+//! eclipse_positions - Compute the apparent geocentric positions of the Sun and Moon, allowing for light travel time
+//! and annual aberration
+//! \param [in] jd - The Julian date; TT
+//! \param [out] sun - The position of the Sun, in J2000.0 equatorial coordinates; Earth radii
+//! \param [out] moon - The position of the Moon, in J2000.0 equatorial coordinates; Earth radii
+
+static void eclipse_positions(const double jd, double *sun, double *moon) {
+    orbitalElementsEpochState state;
+    const double scale = GSL_CONST_MKSA_ASTRONOMICAL_UNIT / ECLIPSE_EARTH_RADIUS;
+    int i;
+
+    orbitalElements_computeEpochState(jd, &state);
+
+    // The Moon's position at the time the light left it, relative to the solar system barycentre. The Sun's position
+    // in <state> already allows for light travel time.
+    const double moon_dist = gsl_hypot3(state.moon_pos[0], state.moon_pos[1], state.moon_pos[2]);  // AU
+    const double light_travel_time = moon_dist * GSL_CONST_MKSA_ASTRONOMICAL_UNIT / GSL_CONST_MKSA_SPEED_OF_LIGHT /
+                                     86400;  // days
+    for (i = 0; i < 3; i++) {
+        const double velocity = (state.earth_pos_future[i] + state.moon_pos_future[i] -
+                                 state.earth_pos[i] - state.moon_pos[i]) / ORBIT_EARTH_VELOCITY_TIMESTEP;
+        moon[i] = state.earth_pos[i] + state.moon_pos[i] - velocity * light_travel_time;
+        sun[i] = state.sun_pos[i];
+    }
+    jpl_correctAberration(&state, &moon[0], &moon[1], &moon[2]);
+    jpl_correctAberration(&state, &sun[0], &sun[1], &sun[2]);
+
+    for (i = 0; i < 3; i++) {
+        moon[i] = (moon[i] - state.earth_pos[i]) * scale;
+        sun[i] = (sun[i] - state.earth_pos[i]) * scale;
+    }
+}
+
+//! eclipse_to_date - Convert a position in J2000.0 equatorial coordinates into RA and Dec for the equinox of date
+//! \param [in] pos - The position, in J2000.0 equatorial coordinates
+//! \param [in] jd - The Julian date of the equinox to use; TT
+//! \param [out] ra - The RA of the position, equinox of date; radians
+//! \param [out] dec - The declination of the position, equinox of date; radians
+//! \return - The length of the vector <pos>
+
+static double eclipse_to_date(const double *pos, const double jd, double *ra, double *dec) {
+    const double r = gsl_hypot3(pos[0], pos[1], pos[2]);
+    ra_dec_from_j2000(atan2(pos[1], pos[0]), asin(pos[2] / r), jd, ra, dec);
+    return r;
+}
+
+//! eclipse_solar_sample - Compute the Besselian elements of a solar eclipse at a single time
+//! \param [in] jd - The Julian date; TT
+//! \param [out] out - The values of x, y, d, mu, l1, l2, tan f1 and tan f2
+
+static void eclipse_solar_sample(const double jd, double *out) {
+    double sun[3], moon[3], sun_ra, sun_dec, moon_ra, moon_dec;
+    const double sun_radius = ECLIPSE_SUN_RADIUS / ECLIPSE_EARTH_RADIUS;
+    const double k = ECLIPSE_MOON_RADIUS;
+
+    eclipse_positions(jd, sun, moon);
+
+    // Positions of the Sun and Moon relative to the equator and equinox of date, with which the Earth rotates
+    const double sun_r = eclipse_to_date(sun, jd, &sun_ra, &sun_dec);
+    const double moon_r = eclipse_to_date(moon, jd, &moon_ra, &moon_dec);
+
+    // The shadow axis runs from the Moon to the Sun
+    const double g[3] = {
+            sun_r * cos(sun_dec) * cos(sun_ra) - moon_r * cos(moon_dec) * cos(moon_ra),
+            sun_r * cos(sun_dec) * sin(sun_ra) - moon_r * cos(moon_dec) * sin(moon_ra),
+            sun_r * sin(sun_dec) - moon_r * sin(moon_dec)
+    };
+    const double g_mag = gsl_hypot3(g[0], g[1], g[2]);
+    const double a = atan2(g[1], g[0]);
+    const double d = asin(g[2] / g_mag);
+
+    // Position of the Moon in the fundamental plane. Explanatory Supplement (8.341-1)
+    const double x = moon_r * cos(moon_dec) * sin(moon_ra - a);
+    const double y = moon_r * (sin(moon_dec) * cos(d) - cos(moon_dec) * sin(d) * cos(moon_ra - a));
+    const double z = moon_r * (sin(moon_dec) * sin(d) + cos(moon_dec) * cos(d) * cos(moon_ra - a));
+
+    // Half-angles of the penumbral and umbral cones, and their radii in the fundamental plane
+    const double sin_f1 = (sun_radius + k) / g_mag;
+    const double sin_f2 = (sun_radius - k) / g_mag;
+    const double tan_f1 = sin_f1 / sqrt(1 - sin_f1 * sin_f1);
+    const double tan_f2 = sin_f2 / sqrt(1 - sin_f2 * sin_f2);
+
+    // Greenwich hour angle of the shadow axis
+    const double sidereal = sidereal_time(unix_from_jd(jd)) * M_PI / 12;  // radians
+
+    out[0] = x;
+    out[1] = y;
+    out[2] = d;
+    out[3] = sidereal - a;
+    out[4] = (z + k / sin_f1) * tan_f1;
+    out[5] = (z - k / sin_f2) * tan_f2;
+    out[6] = tan_f1;
+    out[7] = tan_f2;
+}
+
+//! eclipse_lunar_sample - Compute the geometry of a lunar eclipse at a single time
+//! \param [in] jd - The Julian date; TT
+//! \param [out] out - The position of the Moon relative to the centre of the Earth's shadow (x and y), the radii
+//! of the penumbra, umbra and Moon, and the sine of the Moon's horizontal parallax
+
+static void eclipse_lunar_sample(const double jd, double *out) {
+    double sun[3], moon[3];
+    const double sun_radius = ECLIPSE_SUN_RADIUS / ECLIPSE_EARTH_RADIUS;
+
+    eclipse_positions(jd, sun, moon);
+
+    const double sun_r = gsl_hypot3(sun[0], sun[1], sun[2]);
+    const double moon_r = gsl_hypot3(moon[0], moon[1], moon[2]);
+
+    // The centre of the Earth's shadow lies opposite the Sun
+    const double a = atan2(-sun[1], -sun[0]);
+    const double d = asin(-sun[2] / sun_r);
+    const double axis[3] = {cos(d) * cos(a), cos(d) * sin(a), sin(d)};
+    const double east[3] = {-sin(a), cos(a), 0};
+    const double north[3] = {-sin(d) * cos(a), -sin(d) * sin(a), cos(d)};
+
+    // Gnomonic projection of the Moon's position onto the plane of the sky around the centre of the shadow
+    const double m_axis = moon[0] * axis[0] + moon[1] * axis[1] + moon[2] * axis[2];
+    const double m_east = moon[0] * east[0] + moon[1] * east[1] + moon[2] * east[2];
+    const double m_north = moon[0] * north[0] + moon[1] * north[1] + moon[2] * north[2];
+
+    // Radii of the Earth's shadow. Explanatory Supplement (8.421)
+    const double moon_parallax = asin(1 / moon_r);
+    const double sun_parallax = asin(1 / sun_r);
+    const double sun_semi_diameter = asin(sun_radius / sun_r);
+
+    out[0] = m_east / m_axis;
+    out[1] = m_north / m_axis;
+    out[2] = ECLIPSE_SHADOW_ENLARGEMENT * (0.998340 * moon_parallax + sun_semi_diameter + sun_parallax);
+    out[3] = ECLIPSE_SHADOW_ENLARGEMENT * (0.998340 * moon_parallax - sun_semi_diameter + sun_parallax);
+    out[4] = asin(ECLIPSE_MOON_RADIUS / moon_r);
+    out[5] = 1 / moon_r;
+}
+
+//! eclipse_sample - Sample a quantity at regular intervals about a reference time
+//! \param [in] t0 - The reference time; TT
+//! \param [in] sampler - The function which computes the quantities at each time
+//! \param [in] quantities - The number of quantities returned by <sampler>
+//! \param [out] t - The times of the samples, relative to <t0>; hours
+//! \param [out] samples - The sampled quantities, stored sample by sample
+
+static void eclipse_sample(const double t0, void (*sampler)(double, double *), const int quantities, double *t,
+                           double *samples) {
+    int i;
+    for (i = 0; i < ECLIPSE_FIT_SAMPLES; i++) {
+        t[i] = -ECLIPSE_FIT_HALF_WIDTH + i * 2 * ECLIPSE_FIT_HALF_WIDTH / (ECLIPSE_FIT_SAMPLES - 1);
+        sampler(t0 + t[i] / 24, samples + i * quantities);
+    }
+}
+
+//! eclipse_solar_fit - Compute the Besselian elements of a solar eclipse, as polynomials about a reference time
+//! \param [in] t0 - The reference time; TT
+//! \param [out] elements - The Besselian elements
+
+static void eclipse_solar_fit(const double t0, eclipseBesselianElements *elements) {
+    double t[ECLIPSE_FIT_SAMPLES], samples[ECLIPSE_FIT_SAMPLES * ECLIPSE_SOLAR_QUANTITIES];
+    int i;
+
+    eclipse_sample(t0, eclipse_solar_sample, ECLIPSE_SOLAR_QUANTITIES, t, samples);
+
+    // Make the hour angle of the shadow axis continuous, rather than wrapping it at 2pi
+    samples[3] = fmod(samples[3], 2 * M_PI);
+    if (samples[3] < 0) samples[3] += 2 * M_PI;
+    for (i = 1; i < ECLIPSE_FIT_SAMPLES; i++) {
+        double *mu = samples + i * ECLIPSE_SOLAR_QUANTITIES + 3;
+        const double mu_previous = *(mu - ECLIPSE_SOLAR_QUANTITIES);
+        *mu = mu_previous + fmod(*mu - mu_previous, 2 * M_PI);
+        while (*mu < mu_previous) *mu += 2 * M_PI;
+    }
+
+    elements->t0 = t0;
+    eclipse_polynomial_fit(t, samples + 0, ECLIPSE_SOLAR_QUANTITIES, elements->x);
+    eclipse_polynomial_fit(t, samples + 1, ECLIPSE_SOLAR_QUANTITIES, elements->y);
+    eclipse_polynomial_fit(t, samples + 2, ECLIPSE_SOLAR_QUANTITIES, elements->d);
+    eclipse_polynomial_fit(t, samples + 3, ECLIPSE_SOLAR_QUANTITIES, elements->mu);
+    elements->mu[0] -= 2 * M_PI * floor(elements->mu[0] / (2 * M_PI));
+    eclipse_polynomial_fit(t, samples + 4, ECLIPSE_SOLAR_QUANTITIES, elements->l1);
+    eclipse_polynomial_fit(t, samples + 5, ECLIPSE_SOLAR_QUANTITIES, elements->l2);
+
+    // The angles of the shadow cones are almost constant through each eclipse
+    elements->tan_f1 = elements->tan_f2 = 0;
+    for (i = 0; i < ECLIPSE_FIT_SAMPLES; i++) {
+        elements->tan_f1 += samples[i * ECLIPSE_SOLAR_QUANTITIES + 6] / ECLIPSE_FIT_SAMPLES;
+        elements->tan_f2 += samples[i * ECLIPSE_SOLAR_QUANTITIES + 7] / ECLIPSE_FIT_SAMPLES;
+    }
+}
+
+//! eclipse_lunar_fit - Compute the geometry of a lunar eclipse, as polynomials about a reference time
+//! \param [in] t0 - The reference time; TT
+//! \param [out] elements - The polynomials describing the eclipse
+
+static void eclipse_lunar_fit(const double t0, eclipse_lunar_elements *elements) {
+    double t[ECLIPSE_FIT_SAMPLES], samples[ECLIPSE_FIT_SAMPLES * ECLIPSE_LUNAR_QUANTITIES];
+    int i;
+
+    eclipse_sample(t0, eclipse_lunar_sample, ECLIPSE_LUNAR_QUANTITIES, t, samples);
+
+    elements->t0 = t0;
+    eclipse_polynomial_fit(t, samples + 0, ECLIPSE_LUNAR_QUANTITIES, elements->x);
+    eclipse_polynomial_fit(t, samples + 1, ECLIPSE_LUNAR_QUANTITIES, elements->y);
+    eclipse_polynomial_fit(t, samples + 2, ECLIPSE_LUNAR_QUANTITIES, elements->penumbra);
+    eclipse_polynomial_fit(t, samples + 3, ECLIPSE_LUNAR_QUANTITIES, elements->umbra);
+    eclipse_polynomial_fit(t, samples + 4, ECLIPSE_LUNAR_QUANTITIES, elements->moon_radius);
+
+    elements->sin_parallax = 0;
+    for (i = 0; i < ECLIPSE_FIT_SAMPLES; i++) {
+        elements->sin_parallax += samples[i * ECLIPSE_LUNAR_QUANTITIES + 5] / ECLIPSE_FIT_SAMPLES;
+    }
+}
+
+//! eclipse_closest_approach - Find the time when a point moving in a plane passes closest to the origin, by
+//! Newton-Raphson iteration on the dot product of its position and velocity
+//! \param [in] x - Polynomial for the x position of the point
+//! \param [in] y - Polynomial for the y position of the point
+//! \return - The time of closest approach, relative to the polynomials' reference time; hours
+
+static double eclipse_closest_approach(const double *x, const double *y) {
+    double t = 0;
+    int iteration;
+
+    for (iteration = 0; iteration < ECLIPSE_MAX_ITERATIONS; iteration++) {
+        const double x0 = eclipse_polynomial(x, t), y0 = eclipse_polynomial(y, t);
+        const double x1 = eclipse_polynomial_dot(x, t), y1 = eclipse_polynomial_dot(y, t);
+        const double step = -(x0 * x1 + y0 * y1) / (x1 * x1 + y1 * y1);
+        t += step;
+        if (fabs(t) > ECLIPSE_FIT_HALF_WIDTH) return GSL_MAX(-ECLIPSE_FIT_HALF_WIDTH, GSL_MIN(t, ECLIPSE_FIT_HALF_WIDTH));
+        if (fabs(step) < ECLIPSE_TIME_TOLERANCE) break;
+    }
+    return t;
+}
+
+//! eclipse_solar_gap - The distance of the Moon's shadow from the Earth's limb, in the fundamental plane, with the
+//! Earth's oblateness allowed for by stretching the y axis
+//! \param [in] elements - The Besselian elements of the eclipse
+//! \param [in] contact - 0 for the outer edge of the penumbra; 1 for the outer edge of the umbra; 2 for the inner
+//! edge of the umbra
+//! \param [in] t - The time; hours
+//! \return - The distance of the shadow's edge outside the Earth's limb; negative if it overlaps the Earth
+
+static double eclipse_solar_gap(const void *elements, const int contact, const double t) {
+    const eclipseBesselianElements *b = (const eclipseBesselianElements *) elements;
+    const double d = eclipse_polynomial(b->d, t);
+    const double rho1 = sqrt(1 - ECLIPSE_EARTH_E2 * gsl_pow_2(cos(d)));
+    const double distance = gsl_hypot(eclipse_polynomial(b->x, t), eclipse_polynomial(b->y, t) / rho1);
+    const double l2 = fabs(eclipse_polynomial(b->l2, t));
+    if (contact == 0) return distance - (1 + eclipse_polynomial(b->l1, t));
+    if (contact == 1) return distance - (1 + l2);
+    return distance - (1 - l2);
+}
+
+//! eclipse_lunar_gap - The distance of the Moon's limb outside the edge of the Earth's shadow
+//! \param [in] elements - The polynomials describing the eclipse
+//! \param [in] contact - 0 for the Moon's outer limb and the penumbra; 1 for the outer limb and the umbra; 2 for the
+//! inner limb and the umbra
+//! \param [in] t - The time; hours
+//! \return - The distance of the Moon's limb outside the edge of the shadow; negative if it overlaps; radians
+
+static double eclipse_lunar_gap(const void *elements, const int contact, const double t) {
+    const eclipse_lunar_elements *e = (const eclipse_lunar_elements *) elements;
+    const double distance = gsl_hypot(eclipse_polynomial(e->x, t), eclipse_polynomial(e->y, t));
+    const double moon_radius = eclipse_polynomial(e->moon_radius, t);
+    if (contact == 0) return distance - (eclipse_polynomial(e->penumbra, t) + moon_radius);
+    if (contact == 1) return distance - (eclipse_polynomial(e->umbra, t) + moon_radius);
+    return distance - (eclipse_polynomial(e->umbra, t) - moon_radius);
+}
+
+//! eclipse_contacts - Find the pairs of contact times P1/P4, U1/U4 and U2/U3 at which the function <gap> passes
+//! through zero, either side of greatest eclipse. The roots are bracketed by stepping away from greatest eclipse,
+//! and then refined by bisection.
+//! \param [in] gap - The function whose roots are the contacts
+//! \param [in] elements - The polynomials describing the eclipse, passed to <gap>
+//! \param [in] t0 - The reference time of the polynomials; TT
+//! \param [in] t_greatest - The time of greatest eclipse, relative to <t0>; hours
+//! \param [out] jd_contact - The contact times; TT. NaN for contacts which do not occur.
+
+static void eclipse_contacts(double (*gap)(const void *, int, double), const void *elements, const double t0,
+                             const double t_greatest, double *jd_contact) {
+    const int index[3][2] = {{ECLIPSE_P1, ECLIPSE_P4},
+                             {ECLIPSE_U1, ECLIPSE_U4},
+                             {ECLIPSE_U2, ECLIPSE_U3}};
+    int contact, side;
+
+    for (contact = 0; contact < 3; contact++) {
+        jd_contact[index[contact][0]] = jd_contact[index[contact][1]] = GSL_NAN;
+        if (gap(elements, contact, t_greatest) >= 0) continue;
+
+        for (side = 0; side < 2; side++) {
+            const double direction = side ? 1 : -1;
+            double t_inside = t_greatest, t_outside = GSL_NAN;
+            double t;
+
+            for (t = t_greatest + direction * ECLIPSE_CONTACT_STEP;
+                 fabs(t) <= ECLIPSE_FIT_HALF_WIDTH + ECLIPSE_CONTACT_STEP;
+                 t += direction * ECLIPSE_CONTACT_STEP) {
+                if (gap(elements, contact, t) >= 0) {
+                    t_outside = t;
+                    break;
+                }
+                t_inside = t;
+            }
+            if (gsl_isnan(t_outside)) continue;
+
+            while (fabs(t_outside - t_inside) > ECLIPSE_TIME_TOLERANCE) {
+                const double t_mid = (t_inside + t_outside) / 2;
+                if (gap(elements, contact, t_mid) >= 0) t_outside = t_mid;
+                else t_inside = t_mid;
+            }
+            jd_contact[index[contact][side]] = t0 + (t_inside + t_outside) / 2 / 24;
+        }
+    }
+}
+
+//! eclipse_nearest_hour - Round a Julian date to the nearest whole hour, which is used as the reference time of the
+//! polynomials describing an eclipse
+
+static double eclipse_nearest_hour(const double jd) {
+    return floor(jd * 24 + 0.5) / 24;
+}
+
+//! eclipse_solar - Determine whether a solar eclipse occurs near a new moon, and if so, compute its circumstances
+//! \param [in] jd_new_moon - The time of new moon; TT
+//! \param [out] out - The eclipse
+//! \return - Boolean indicating whether an eclipse occurs
+
+static int eclipse_solar(const double jd_new_moon, eclipseFound *out) {
+    eclipseBesselianElements *b = &out->besselian;
+
+    // Fit polynomials about new moon, and then refit them about greatest eclipse if that is more than half an hour
+    // later or earlier
+    eclipse_solar_fit(eclipse_nearest_hour(jd_new_moon), b);
+    double t = eclipse_closest_approach(b->x, b->y);
+    if (fabs(t) > 0.5) {
+        eclipse_solar_fit(eclipse_nearest_hour(b->t0 + t / 24), b);
+        t = eclipse_closest_approach(b->x, b->y);
+    }
+
+    const double x = eclipse_polynomial(b->x, t);
+    const double y = eclipse_polynomial(b->y, t);
+    const double d = eclipse_polynomial(b->d, t);
+    const double l1 = eclipse_polynomial(b->l1, t);
+    const double l2 = eclipse_polynomial(b->l2, t);
+    const double rho1 = sqrt(1 - ECLIPSE_EARTH_E2 * gsl_pow_2(cos(d)));
+    const double distance = gsl_hypot(x, y / rho1);
+
+    // The Moon's penumbra misses the Earth
+    if (distance >= 1 + l1) return 0;
+
+    out->kind = ECLIPSE_SOLAR;
+    out->jd_greatest = b->t0 + t / 24;
+    out->gamma = (y < 0) ? -gsl_hypot(x, y) : gsl_hypot(x, y);
+
+    if (distance < 1) {
+        // Central eclipse: the shadow axis meets the Earth. The umbra is smallest where the axis meets the Earth
+        // closest to the Moon, and largest where the axis grazes the Earth's limb.
+        const double zeta = sqrt(1 - distance * distance);
+        const double L1 = l1 - zeta * b->tan_f1;
+        const double L2 = l2 - zeta * b->tan_f2;
+        out->magnitude = (L1 - L2) / (L1 + L2);
+        if (L2 >= 0) out->type = ECLIPSE_ANNULAR;
+        else if (l2 > 0) out->type = ECLIPSE_HYBRID;
+        else out->type = ECLIPSE_TOTAL;
+    } else {
+        // Non-central eclipse: the greatest eclipse is seen on the Earth's limb
+        out->magnitude = (1 + l1 - distance) / (l1 + l2);
+        if (distance < 1 + fabs(l2)) out->type = (l2 < 0) ? ECLIPSE_TOTAL : ECLIPSE_ANNULAR;
+        else out->type = ECLIPSE_PARTIAL;
+    }
+    out->penumbral_magnitude = GSL_NAN;
+
+    eclipse_contacts(eclipse_solar_gap, b, b->t0, t, out->jd_contact);
+    return 1;
+}
+
+//! eclipse_lunar - Determine whether a lunar eclipse occurs near a full moon, and if so, compute its circumstances
+//! \param [in] jd_full_moon - The time of full moon; TT
+//! \param [out] out - The eclipse
+//! \return - Boolean indicating whether an eclipse occurs
+
+static int eclipse_lunar(const double jd_full_moon, eclipseFound *out) {
+    eclipse_lunar_elements e;
+
+    eclipse_lunar_fit(eclipse_nearest_hour(jd_full_moon), &e);
+    double t = eclipse_closest_approach(e.x, e.y);
+    if (fabs(t) > 0.5) {
+        eclipse_lunar_fit(eclipse_nearest_hour(e.t0 + t / 24), &e);
+        t = eclipse_closest_approach(e.x, e.y);
+    }
+
+    const double y = eclipse_polynomial(e.y, t);
+    const double distance = gsl_hypot(eclipse_polynomial(e.x, t), y);
+    const double moon_radius = eclipse_polynomial(e.moon_radius, t);
+    const double penumbra = eclipse_polynomial(e.penumbra, t);
+    const double umbra = eclipse_polynomial(e.umbra, t);
+
+    // Magnitudes are the fraction of the Moon's diameter covered by the penumbra and umbra. Explanatory Supplement
+    // (8.422)
+    out->penumbral_magnitude = (penumbra + moon_radius - distance) / (2 * moon_radius);
+    out->magnitude = (umbra + moon_radius - distance) / (2 * moon_radius);
+
+    // The Moon misses the Earth's penumbra
+    if (out->penumbral_magnitude <= 0) return 0;
+
+    out->kind = ECLIPSE_LUNAR;
+    out->jd_greatest = e.t0 + t / 24;
+    out->gamma = distance / e.sin_parallax * ((y < 0) ? -1 : 1);
+    if (out->magnitude >= 1) out->type = ECLIPSE_TOTAL;
+    else if (out->magnitude > 0) out->type = ECLIPSE_PARTIAL;
+    else out->type = ECLIPSE_PENUMBRAL;
+
+    memset(&out->besselian, 0, sizeof(eclipseBesselianElements));
+    eclipse_contacts(eclipse_lunar_gap, &e, e.t0, t, out->jd_contact);
+    return 1;
+}
+
+//! eclipse_collect_syzygy - Callback used to collect new and full moons from <calendarEvents_run>
+
+static void eclipse_collect_syzygy(const eventFound *event, void *context) {
+    eclipse_syzygy_list *list = (eclipse_syzygy_list *) context;
+    if (list->count >= list->capacity) return;
+    list->items[list->count++] = *event;
+}
+
+//! eclipses_search - Search for solar and lunar eclipses between two times. Eclipses are passed to the callback
+//! function <report> in time order.
+//! \param [in] jd_min - The start of the time span to search; TT
+//! \param [in] jd_max - The end of the time span to search; TT
+//! \param [in] do_solar - Boolean indicating whether to search for solar eclipses
+//! \param [in] do_lunar - Boolean indicating whether to search for lunar eclipses
+//! \param [in] report - Callback function which is passed each eclipse
+//! \param [in] context - Pointer passed to the callback function
+
+void eclipses_search(const double jd_min, const double jd_max, const int do_solar, const int do_lunar,
+                     void (*report)(const eclipseFound *, void *), void *context) {
+    int i, enabled[EVENT_TYPE_COUNT];
+    eclipse_syzygy_list syzygies;
+
+    // Greatest eclipse can fall a few hours either side of new or full moon
+    const double margin = 0.5;
+
+    for (i = 0; i < EVENT_TYPE_COUNT; i++) enabled[i] = 0;
+    enabled[EVENT_NEW_MOON] = do_solar;
+    enabled[EVENT_FULL_MOON] = do_lunar;
+
+    syzygies.count = 0;
+    syzygies.capacity = (int) (2 * (jd_max - jd_min + 2 * margin) / 29.530588861) + 8;
+    syzygies.items = (eventFound *) eclipse_malloc(syzygies.capacity * sizeof(eventFound));
+    calendarEvents_run(enabled, jd_min - margin, jd_max + margin, eclipse_collect_syzygy, &syzygies);
+
+    for (i = 0; i < syzygies.count; i++) {
+        const eventFound *syzygy = &syzygies.items[i];
+        eclipseFound eclipse;
+        int found;
+
+        // Screen out new and full moons which are far from the Moon's nodes. Meeus (47.5)
+        const double t = (syzygy->jd - 2451545.0) / 36525;
+        const double f = (93.2720950 + 483202.0175233 * t - 0.0036539 * t * t - t * t * t / 3526000 +
+                          t * t * t * t / 863310000) * M_PI / 180;
+        if (fabs(sin(f)) > ECLIPSE_NODE_LIMIT) continue;
+
+        if (syzygy->type == EVENT_NEW_MOON) found = eclipse_solar(syzygy->jd, &eclipse);
+        else found = eclipse_lunar(syzygy->jd, &eclipse);
+
+        if (!found) continue;
+        if ((eclipse.jd_greatest < jd_min) || (eclipse.jd_greatest > jd_max)) continue;
+
+        if (DEBUG) {
+            snprintf(temp_err_string, FNAME_LENGTH, "Found %s %s eclipse at JD %.6f.",
+                     eclipses_typeName(eclipse.type), (eclipse.kind == ECLIPSE_SOLAR) ? "solar" : "lunar",
+                     eclipse.jd_greatest);
+            ephem_log(temp_err_string);
+        }
+        report(&eclipse, context);
+    }
+}
+
+//! eclipse_local_compute - Compute the position of an observer relative to the Moon's shadow. Explanatory Supplement
+//! (8.351) and (8.352)
+//! \param [in] b - The Besselian elements of the eclipse
+//! \param [in] observer - The position of the observer
+//! \param [in] t - The time; hours after the reference time of <b>
+//! \param [out] s - The circumstances of the eclipse seen by the observer
+
+static void eclipse_local_compute(const eclipseBesselianElements *b, const eclipse_observer *observer, const double t,
+                                eclipse_local_state *s) {
+    const double d = eclipse_polynomial(b->d, t);
+    const double d_dot = eclipse_polynomial_dot(b->d, t);
+    const double mu_dot = eclipse_polynomial_dot(b->mu, t);
+    const double h = eclipse_polynomial(b->mu, t) + observer->longitude;
+
+    const double xi = observer->rho_cos_phi * sin(h);
+    const double eta = observer->rho_sin_phi * cos(d) - observer->rho_cos_phi * cos(h) * sin(d);
+    const double zeta = observer->rho_sin_phi * sin(d) + observer->rho_cos_phi * cos(h) * cos(d);
+    const double xi_dot = mu_dot * observer->rho_cos_phi * cos(h);
+    const double eta_dot = mu_dot * xi * sin(d) - zeta * d_dot;
+
+    s->u = eclipse_polynomial(b->x, t) - xi;
+    s->v = eclipse_polynomial(b->y, t) - eta;
+    s->a = eclipse_polynomial_dot(b->x, t) - xi_dot;
+    s->b = eclipse_polynomial_dot(b->y, t) - eta_dot;
+    s->zeta = zeta;
+    s->L1 = eclipse_polynomial(b->l1, t) - zeta * b->tan_f1;
+    s->L2 = eclipse_polynomial(b->l2, t) - zeta * b->tan_f2;
+}
+
+//! eclipse_local_contact - Find the time when the edge of the Moon's penumbra or umbra passes an observer, by
+//! iterating equation (8.355) of the Explanatory Supplement
+//! \param [in] b - The Besselian elements of the eclipse
+//! \param [in] observer - The position of the observer
+//! \param [in] t - The time of maximum eclipse; hours after the reference time of <b>
+//! \param [in] umbral - Boolean indicating whether to use the edge of the umbra, rather than the penumbra
+//! \param [in] direction - -1 for the contact before maximum eclipse; +1 for the contact after it
+//! \return - The contact time; TT. NaN if the contact does not occur.
+
+static double eclipse_local_contact(const eclipseBesselianElements *b, const eclipse_observer *observer, double t,
+                                    const int umbral, const double direction) {
+    int iteration;
+
+    for (iteration = 0; iteration < ECLIPSE_MAX_ITERATIONS; iteration++) {
+        eclipse_local_state s;
+        eclipse_local_compute(b, observer, t, &s);
+
+        const double radius = umbral ? fabs(s.L2) : s.L1;
+        const double n = gsl_hypot(s.a, s.b);
+        const double sin_psi = (s.a * s.v - s.u * s.b) / (n * radius);
+        if (fabs(sin_psi) > 1) return GSL_NAN;
+
+        const double step = -(s.u * s.a + s.v * s.b) / (n * n) + direction * radius / n * sqrt(1 - sin_psi * sin_psi);
+        t += step;
+        if (fabs(step) < ECLIPSE_TIME_TOLERANCE) return b->t0 + t / 24;
+    }
+    return GSL_NAN;
+}
+
+//! eclipses_localCircumstances - Compute the circumstances of a solar eclipse seen from a particular place, using
+//! only its Besselian elements. The observer is assumed to be at sea level.
+//! \param [in] elements - The Besselian elements of the eclipse
+//! \param [in] latitude - The geodetic latitude of the observer; degrees
+//! \param [in] longitude - The longitude of the observer, east of Greenwich; degrees
+//! \param [out] out - The local circumstances of the eclipse
+//! \return - Boolean indicating whether any part of the eclipse is seen from this place, disregarding whether the
+//! Sun is above the horizon
+
+int eclipses_localCircumstances(const eclipseBesselianElements *elements, const double latitude,
+                                const double longitude, eclipseLocalCircumstances *out) {
+    eclipse_observer observer;
+    eclipse_local_state s;
+    double t = 0;
+    int i, iteration;
+
+    // Geocentric position of the observer. Explanatory Supplement (8.331)
+    const double axis_ratio = sqrt(1 - ECLIPSE_EARTH_E2);
+    const double phi = latitude * M_PI / 180;
+    const double u = atan(axis_ratio * tan(phi));
+    observer.rho_sin_phi = axis_ratio * sin(u);
+    observer.rho_cos_phi = cos(u);
+    observer.longitude = longitude * M_PI / 180;
+
+    // Find the time of maximum eclipse, when the observer is closest to the shadow axis
+    for (iteration = 0; iteration < ECLIPSE_MAX_ITERATIONS; iteration++) {
+        eclipse_local_compute(elements, &observer, t, &s);
+        const double step = -(s.u * s.a + s.v * s.b) / (s.a * s.a + s.b * s.b);
+        t += step;
+        if (fabs(step) < ECLIPSE_TIME_TOLERANCE) break;
+    }
+    eclipse_local_compute(elements, &observer, t, &s);
+
+    const double m = gsl_hypot(s.u, s.v);
+    out->jd_maximum = elements->t0 + t / 24;
+    out->magnitude = (s.L1 - m) / (s.L1 + s.L2);
+    out->sun_altitude = asin(GSL_MAX(-1, GSL_MIN(1, s.zeta)));
+    for (i = 0; i < ECLIPSE_LOCAL_CONTACT_COUNT; i++) out->jd_contact[i] = GSL_NAN;
+
+    if (m < fabs(s.L2)) out->type = (s.L2 < 0) ? ECLIPSE_TOTAL : ECLIPSE_ANNULAR;
+    else out->type = ECLIPSE_PARTIAL;
+
+    if (out->magnitude <= 0) return 0;
+
+    out->jd_contact[ECLIPSE_C1] = eclipse_local_contact(elements, &observer, t, 0, -1);
+    out->jd_contact[ECLIPSE_C4] = eclipse_local_contact(elements, &observer, t, 0, 1);
+    if (out->type != ECLIPSE_PARTIAL) {
+        out->jd_contact[ECLIPSE_C2] = eclipse_local_contact(elements, &observer, t, 1, -1);
+        out->jd_contact[ECLIPSE_C3] = eclipse_local_contact(elements, &observer, t, 1, 1);
+    }
+    return 1;
+}
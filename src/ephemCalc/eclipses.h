@@ -0,0 +1,100 @@
+// eclipses.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef ECLIPSES_H
+#define ECLIPSES_H 1
+
+// Kinds of eclipse
+#define ECLIPSE_SOLAR 0
+#define ECLIPSE_LUNAR 1
+
+// Types of eclipse
+#define ECLIPSE_PARTIAL    0
+#define ECLIPSE_ANNULAR    1
+#define ECLIPSE_TOTAL      2
+#define ECLIPSE_HYBRID     3  // Solar eclipses which are annular along part of their path, and total elsewhere
+#define ECLIPSE_PENUMBRAL  4  // Lunar eclipses where the Moon does not enter the Earth's umbra
+
+// The number of terms in the polynomials fitted to each eclipse; a value of 4 gives cubic polynomials
+#define ECLIPSE_POLYNOMIAL_TERMS 4
+
+// Indices of the contact times within <eclipseFound.jd_contact>. For lunar eclipses, these are the times when the
+// Moon's limb touches the Earth's penumbra (P) and umbra (U). For solar eclipses, they are the times when the Moon's
+// penumbra (P) and umbra (U) touch the Earth's limb.
+#define ECLIPSE_P1             0
+#define ECLIPSE_U1             1
+#define ECLIPSE_U2             2
+#define ECLIPSE_U3             3
+#define ECLIPSE_U4             4
+#define ECLIPSE_P4             5
+#define ECLIPSE_CONTACT_COUNT  6
+
+// Indices of the contact times within <eclipseLocalCircumstances.jd_contact>
+#define ECLIPSE_C1             0
+#define ECLIPSE_C2             1
+#define ECLIPSE_C3             2
+#define ECLIPSE_C4             3
+#define ECLIPSE_LOCAL_CONTACT_COUNT 4
+
+// The Besselian elements of a solar eclipse, as polynomials in the time <t> since <t0>, measured in hours. The
+// fundamental plane passes through the centre of the Earth, perpendicular to the axis of the Moon's shadow, and all
+// distances are in units of the Earth's equatorial radius.
+typedef struct {
+    double t0;  // The reference time of the polynomials; TT
+    double x[ECLIPSE_POLYNOMIAL_TERMS];  // Position of the shadow axis in the fundamental plane, towards the east
+    double y[ECLIPSE_POLYNOMIAL_TERMS];  // Position of the shadow axis in the fundamental plane, towards the north
+    double d[ECLIPSE_POLYNOMIAL_TERMS];  // Declination of the shadow axis, equinox of date; radians
+    double mu[ECLIPSE_POLYNOMIAL_TERMS];  // Greenwich hour angle of the shadow axis; radians
+    double l1[ECLIPSE_POLYNOMIAL_TERMS];  // Radius of the penumbra in the fundamental plane
+    double l2[ECLIPSE_POLYNOMIAL_TERMS];  // Radius of the umbra in the fundamental plane; negative if total
+    double tan_f1, tan_f2;  // Tangents of the half-angles of the penumbral and umbral cones
+} eclipseBesselianElements;
+
+// An eclipse which has been found
+typedef struct {
+    int kind;  // ECLIPSE_SOLAR or ECLIPSE_LUNAR
+    int type;  // One of the types of eclipse above
+    double jd_greatest;  // The time of greatest eclipse; TT
+    double magnitude;  // The magnitude of the eclipse at greatest eclipse. For lunar eclipses, the umbral magnitude.
+    double penumbral_magnitude;  // For lunar eclipses, the penumbral magnitude at greatest eclipse
+    double gamma;  // Least distance of the shadow axis from the centre of the Earth; Earth radii
+    double jd_contact[ECLIPSE_CONTACT_COUNT];  // Contact times; TT. NaN for contacts which do not occur.
+    eclipseBesselianElements besselian;  // For solar eclipses, the Besselian elements
+} eclipseFound;
+
+// The circumstances of a solar eclipse seen from a particular place
+typedef struct {
+    int type;  // ECLIPSE_PARTIAL, ECLIPSE_ANNULAR or ECLIPSE_TOTAL
+    double jd_maximum;  // Time of maximum eclipse; TT
+    double magnitude;  // Fraction of the Sun's diameter covered by the Moon at maximum eclipse
+    double sun_altitude;  // Altitude of the Sun at maximum eclipse; radians
+    double jd_contact[ECLIPSE_LOCAL_CONTACT_COUNT];  // Contact times; TT. NaN for contacts which do not occur.
+} eclipseLocalCircumstances;
+
+const char *eclipses_typeName(int type);
+
+void eclipses_search(double jd_min, double jd_max, int do_solar, int do_lunar,
+                     void (*report)(const eclipseFound *, void *), void *context);
+
+int eclipses_localCircumstances(const eclipseBesselianElements *elements, double latitude, double longitude,
+                                eclipseLocalCircumstances *out);
+
+#endif
@@ -0,0 +1,418 @@
+// eventSearch.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// Each type of event is described as a root of some function g(t) of time. Conjunctions and oppositions are roots of
+// a difference in ecliptic longitude, while greatest elongations, stationary points and apsides are roots of the time
+// derivative of the elongation, RA, longitude or heliocentric distance. The time span is stepped through at a coarse
+// step to bracket sign changes in g(t), and each bracket is then refined by Newton-Raphson iteration, safeguarded by
+// bisection, using the derivative of g(t) which is estimated alongside g(t) itself from the same three ephemeris
+// evaluations.
+
+#define EVENTSEARCH_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/sphericalAst.h"
+
+#include "eventSearch.h"
+#include "jpl.h"
+#include "orbitalElements.h"
+
+// Time step used to estimate time derivatives by finite differencing; days
+#define EVENT_DERIVATIVE_STEP 1e-3
+
+// Precision with which the times of events are determined; days
+#define EVENT_TIME_TOLERANCE 1e-7
+
+// Maximum number of iterations used to refine the time of each event
+#define EVENT_MAX_ITERATIONS 40
+
+// Names of each type of event, indexed by EVENT_* type
+static const char *const event_names[EVENT_TYPE_COUNT] = {
+        "conjunction", "opposition", "greatest_elongation", "stationary_ra", "stationary_longitude",
+        "perihelion", "aphelion", "new_moon", "first_quarter", "full_moon", "last_quarter", "perigee", "apogee",
+        "ascending_node", "descending_node", "march_equinox", "june_solstice", "september_equinox",
+        "december_solstice"
+};
+
+// The quantities we need to know about each body, at each time step
+typedef struct {
+    double ra, dec;  // J2000.0; radians
+    double longitude;  // J2000.0 ecliptic longitude; radians
+    double elongation;  // Angular distance from the Sun; radians
+    double longitude_from_sun;  // Ecliptic longitude relative to the Sun, in the range -pi to pi; radians
+    double sun_dist;  // AU
+} event_body_sample;
+
+//! eventSearch_name - Return the name of a type of event
+//! \param [in] type - One of the EVENT_* types
+//! \return - The name of the event type
+
+const char *eventSearch_name(const int type) {
+    if ((type < 0) || (type >= EVENT_TYPE_COUNT)) return "unknown";
+    return event_names[type];
+}
+
+//! eventSearch_type - Look up a type of event by name
+//! \param [in] name - The name of the event type, as returned by <eventSearch_name>
+//! \return - One of the EVENT_* types, or -1 if the name is not recognised
+
+int eventSearch_type(const char *name) {
+    int i;
+    for (i = 0; i < EVENT_TYPE_COUNT; i++) if (strcmp(name, event_names[i]) == 0) return i;
+    return -1;
+}
+
+//! event_wrap - Wrap an angle into the range -pi to pi
+//! \param [in] angle - The angle to wrap; radians
+//! \return - The wrapped angle; radians
+
+static double event_wrap(double angle) {
+    angle = fmod(angle, 2 * M_PI);
+    if (angle > M_PI) angle -= 2 * M_PI;
+    if (angle <= -M_PI) angle += 2 * M_PI;
+    return angle;
+}
+
+//! event_sample - Compute the quantities we need to know about a body at a particular time
+//! \param [in] body_id - The bodyId of the body
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [out] sample - The quantities computed
+
+static void event_sample(const int body_id, const orbitalElementsEpochState *state, event_body_sample *sample) {
+    double x, y, z, mag, phase, ang_size, phy_size, albedo, earth_dist, theta_eso, latitude;
+    jpl_computeEphemerisAtEpoch(body_id, state, &x, &y, &z, &sample->ra, &sample->dec, &mag, &phase, &ang_size,
+                                &phy_size, &albedo, &sample->sun_dist, &earth_dist, &sample->elongation, &theta_eso,
+                                &sample->longitude, &latitude, &sample->longitude_from_sun, 2451545.0,
+                                0, 0, 0);
+}
+
+//! event_needs_derivative - Return whether a type of event is a root of the time derivative of some quantity, in
+//! which case we need to sample each body either side of each time step
+//! \param [in] type - One of the EVENT_* types
+//! \return - Boolean flag
+
+static int event_needs_derivative(const int type) {
+    return (type != EVENT_CONJUNCTION) && (type != EVENT_OPPOSITION);
+}
+
+//! event_quantity - Evaluate the function whose roots are the events we are looking for, together with its time
+//! derivative, from samples of the bodies involved at times (t - h, t, t + h), where h is EVENT_DERIVATIVE_STEP.
+//! \param [in] type - One of the EVENT_* types
+//! \param [in] a - Samples of the first body at times (t - h, t, t + h)
+//! \param [in] b - Samples of the second body at times (t - h, t, t + h); only used for conjunctions
+//! \param [out] g - The value of the function at time t
+//! \param [out] g_dot - The time derivative of the function at time t; per day
+
+static void event_quantity(const int type, const event_body_sample *a, const event_body_sample *b,
+                           double *g, double *g_dot) {
+    const double h = EVENT_DERIVATIVE_STEP;
+    double q[3];
+    int k;
+
+    switch (type) {
+        case EVENT_CONJUNCTION:
+        case EVENT_OPPOSITION: {
+            for (k = 0; k < 3; k++) {
+                if (type == EVENT_CONJUNCTION) q[k] = event_wrap(a[k].longitude - b[k].longitude);
+                else q[k] = event_wrap(a[k].longitude_from_sun - M_PI);
+            }
+            *g = q[1];
+            *g_dot = event_wrap(q[2] - q[0]) / (2 * h);
+            return;
+        }
+
+        case EVENT_STATIONARY_RA:
+        case EVENT_STATIONARY_LONGITUDE: {
+            // These angles wrap around, so difference them before they are combined
+            for (k = 0; k < 3; k++) q[k] = (type == EVENT_STATIONARY_RA) ? a[k].ra : a[k].longitude;
+            const double step_after = event_wrap(q[2] - q[1]);
+            const double step_before = event_wrap(q[1] - q[0]);
+            *g = (step_after + step_before) / (2 * h);
+            *g_dot = (step_after - step_before) / (h * h);
+            return;
+        }
+
+        default: {
+            for (k = 0; k < 3; k++) q[k] = (type == EVENT_GREATEST_ELONGATION) ? a[k].elongation : a[k].sun_dist;
+            *g = (q[2] - q[0]) / (2 * h);
+            *g_dot = (q[2] - 2 * q[1] + q[0]) / (h * h);
+            return;
+        }
+    }
+}
+
+//! event_bracket_valid - Decide whether a sign change in the function g(t) between two time steps is a genuine
+//! event, rather than a jump where an angle wraps around, or a turning point of the wrong kind
+//! \param [in] type - One of the EVENT_* types
+//! \param [in] g_0 - The value of g(t) at the start of the time step
+//! \param [in] g_1 - The value of g(t) at the end of the time step
+//! \return - Boolean flag
+
+static int event_bracket_valid(const int type, const double g_0, const double g_1) {
+    if (!(((g_0 < 0) && (g_1 >= 0)) || ((g_0 > 0) && (g_1 <= 0)))) return 0;
+
+    switch (type) {
+        case EVENT_CONJUNCTION:
+        case EVENT_OPPOSITION:
+            return (fabs(g_0) < M_PI / 2) && (fabs(g_1) < M_PI / 2);
+        case EVENT_PERIHELION:
+            return g_1 > g_0;
+        case EVENT_GREATEST_ELONGATION:
+        case EVENT_APHELION:
+            return g_1 < g_0;
+        default:
+            return 1;
+    }
+}
+
+//! event_evaluate - Compute samples of the bodies involved in an event at times (t - h, t, t + h), and evaluate the
+//! function whose roots are the event
+//! \param [in] search - The event being searched for
+//! \param [in] jd - The time t; TT
+//! \param [out] a - Samples of the first body
+//! \param [out] b - Samples of the second body
+//! \param [out] g - The value of the function at time t
+//! \param [out] g_dot - The time derivative of the function at time t; per day
+
+static void event_evaluate(const eventSearch *search, const double jd, event_body_sample *a, event_body_sample *b,
+                           double *g, double *g_dot) {
+    int k;
+    for (k = 0; k < 3; k++) {
+        orbitalElementsEpochState state;
+        orbitalElements_computeEpochState(jd + (k - 1) * EVENT_DERIVATIVE_STEP, &state);
+        event_sample(search->body_a, &state, &a[k]);
+        if (search->type == EVENT_CONJUNCTION) event_sample(search->body_b, &state, &b[k]);
+    }
+    event_quantity(search->type, a, b, g, g_dot);
+}
+
+//! event_refine - Refine the time of an event which has been bracketed within a time step, using Newton-Raphson
+//! iteration, falling back to bisection whenever a Newton step would leave the bracket
+//! \param [in] search - The event being searched for
+//! \param [in] jd_0 - The start of the bracket; TT
+//! \param [in] g_0 - The value of g(t) at the start of the bracket
+//! \param [in] jd_1 - The end of the bracket; TT
+//! \param [in] g_1 - The value of g(t) at the end of the bracket
+//! \param [out] event - The event found
+
+static void event_refine(const eventSearch *search, double jd_0, double g_0, double jd_1, double g_1,
+                         eventFound *event) {
+    event_body_sample a[3], b[3];
+    double g, g_dot;
+    int iteration;
+
+    event->type = search->type;
+    event->body_a = search->body_a;
+    event->body_b = search->body_b;
+    event->sense = (g_1 > g_0) ? 1 : -1;
+
+    // Start from linear interpolation between the ends of the bracket
+    double jd = (g_1 != g_0) ? (jd_0 - g_0 * (jd_1 - jd_0) / (g_1 - g_0)) : ((jd_0 + jd_1) / 2);
+
+    for (iteration = 0; iteration < EVENT_MAX_ITERATIONS; iteration++) {
+        event_evaluate(search, jd, a, b, &g, &g_dot);
+        if (g == 0) break;
+
+        // Shrink the bracket
+        if ((g < 0) == (g_0 < 0)) {
+            jd_0 = jd;
+            g_0 = g;
+        } else {
+            jd_1 = jd;
+            g_1 = g;
+        }
+
+        // Take a Newton step, unless it would leave the bracket
+        double jd_new = (g_dot != 0) ? (jd - g / g_dot) : jd_0;
+        if ((jd_new <= GSL_MIN(jd_0, jd_1)) || (jd_new >= GSL_MAX(jd_0, jd_1))) jd_new = (jd_0 + jd_1) / 2;
+
+        const int converged = (fabs(jd_new - jd) < EVENT_TIME_TOLERANCE);
+        jd = jd_new;
+        if (converged) {
+            event_evaluate(search, jd, a, b, &g, &g_dot);
+            break;
+        }
+    }
+
+    event->jd = jd;
+
+    // Record the value of the quantity of interest at the time of the event
+    switch (search->type) {
+        case EVENT_CONJUNCTION:
+            event->value = angDist_RADec(a[1].ra, a[1].dec, b[1].ra, b[1].dec);
+            break;
+        case EVENT_OPPOSITION:
+            event->value = a[1].elongation;
+            break;
+        case EVENT_GREATEST_ELONGATION:
+            // Positive elongations are east of the Sun
+            event->value = (a[1].longitude_from_sun >= 0) ? a[1].elongation : -a[1].elongation;
+            break;
+        case EVENT_STATIONARY_RA:
+            // Angles are returned in the range 0 to 2 pi
+            event->value = event_wrap(a[1].ra - M_PI) + M_PI;
+            break;
+        case EVENT_STATIONARY_LONGITUDE:
+            event->value = event_wrap(a[1].longitude - M_PI) + M_PI;
+            break;
+        default:
+            event->value = a[1].sun_dist;
+            break;
+    }
+}
+
+//! event_compare - Comparison function used to sort events into time order
+//! \param [in] a - First event
+//! \param [in] b - Second event
+//! \return - Sort order
+
+static int event_compare(const void *a, const void *b) {
+    const double jd_a = ((const eventFound *) a)->jd;
+    const double jd_b = ((const eventFound *) b)->jd;
+    if (jd_a < jd_b) return -1;
+    if (jd_a > jd_b) return 1;
+    return 0;
+}
+
+//! event_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *event_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! eventSearch_run - Search for a list of events between two times. The positions of the Earth and Sun are computed
+//! only once per time step, and each body is evaluated only once per time step, however many searches it is involved
+//! in. Events are passed to the callback function <report> in time order.
+//! \param [in] searches - The list of events to search for
+//! \param [in] search_count - The number of entries in <searches>
+//! \param [in] jd_min - The start of the time span to search; TT
+//! \param [in] jd_max - The end of the time span to search; TT
+//! \param [in] jd_step - The coarse time step used to bracket events. This must be shorter than the shortest interval
+//! between successive events of the same kind; days
+//! \param [in] report - Callback function to call with each event found
+//! \param [in] context - Pointer which is passed to <report>
+
+void eventSearch_run(const eventSearch *searches, const int search_count, const double jd_min, const double jd_max,
+                     const double jd_step, void (*report)(const eventFound *, void *), void *context) {
+    int i, j, k, body_count = 0, needs_derivative = 0;
+
+    if (search_count > EVENT_MAX_SEARCHES) {
+        ephem_fatal(__FILE__, __LINE__, "Too many event searches.");
+        exit(1);
+    }
+
+    for (i = 0; i < search_count; i++) {
+        if ((searches[i].type < 0) || (searches[i].type >= EVENT_CALENDAR_FIRST)) {
+            ephem_fatal(__FILE__, __LINE__, "Event type cannot be searched for by eventSearch_run.");
+            exit(1);
+        }
+    }
+
+    if (!(jd_step > 0)) {
+        ephem_fatal(__FILE__, __LINE__, "Time step must be positive.");
+        exit(1);
+    }
+
+    // Make a list of all the distinct bodies involved in the searches, so that each is only evaluated once
+    int *body_ids = (int *) event_malloc((2 * search_count + 1) * sizeof(int));
+    int *body_a_index = (int *) event_malloc((search_count + 1) * sizeof(int));
+    int *body_b_index = (int *) event_malloc((search_count + 1) * sizeof(int));
+    for (i = 0; i < search_count; i++) {
+        int *index[2] = {&body_a_index[i], &body_b_index[i]};
+        const int ids[2] = {searches[i].body_a, searches[i].body_b};
+        for (k = 0; k < 2; k++) {
+            *index[k] = -1;
+            if ((k == 1) && (searches[i].type != EVENT_CONJUNCTION)) continue;
+            for (j = 0; j < body_count; j++) if (body_ids[j] == ids[k]) break;
+            if (j == body_count) body_ids[body_count++] = ids[k];
+            *index[k] = j;
+        }
+        if (event_needs_derivative(searches[i].type)) needs_derivative = 1;
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Searching for %d events involving %d bodies.", search_count,
+                 body_count);
+        ephem_log(temp_err_string);
+    }
+
+    event_body_sample *samples = (event_body_sample *) event_malloc((3 * body_count + 1) * sizeof(event_body_sample));
+    double *g_previous = (double *) event_malloc((search_count + 1) * sizeof(double));
+    eventFound *events = (eventFound *) event_malloc((search_count + 1) * sizeof(eventFound));
+
+    const long step_count = (long) ceil((jd_max - jd_min) / jd_step);
+    double jd_previous = jd_min;
+    long step;
+
+    for (step = 0; step <= step_count; step++) {
+        const double jd = GSL_MIN(jd_max, jd_min + step * jd_step);
+        int event_count = 0;
+
+        // Compute the observer's frame once per time step, and sample each body within it
+        for (k = 0; k < 3; k++) {
+            orbitalElementsEpochState state;
+            if ((k != 1) && !needs_derivative) continue;
+            orbitalElements_computeEpochState(jd + (k - 1) * EVENT_DERIVATIVE_STEP, &state);
+            for (j = 0; j < body_count; j++) event_sample(body_ids[j], &state, &samples[3 * j + k]);
+        }
+
+        // Derivatives are only needed while refining conjunctions and oppositions, so skip the extra samples
+        if (!needs_derivative) {
+            for (j = 0; j < body_count; j++) samples[3 * j] = samples[3 * j + 2] = samples[3 * j + 1];
+        }
+
+        // Look for sign changes in each search function since the previous time step
+        for (i = 0; i < search_count; i++) {
+            double g, g_dot;
+            const event_body_sample *a = &samples[3 * body_a_index[i]];
+            const event_body_sample *b = (body_b_index[i] >= 0) ? &samples[3 * body_b_index[i]] : NULL;
+            event_quantity(searches[i].type, a, b, &g, &g_dot);
+
+            if ((step > 0) && event_bracket_valid(searches[i].type, g_previous[i], g)) {
+                event_refine(&searches[i], jd_previous, g_previous[i], jd, g, &events[event_count]);
+                if ((events[event_count].jd >= jd_min) && (events[event_count].jd < jd_max)) event_count++;
+            }
+            g_previous[i] = g;
+        }
+
+        // Report events in time order
+        qsort(events, event_count, sizeof(eventFound), event_compare);
+        for (i = 0; i < event_count; i++) report(&events[i], context);
+
+        jd_previous = jd;
+    }
+}
@@ -0,0 +1,76 @@
+// eventSearch.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef EVENTSEARCH_H
+#define EVENTSEARCH_H 1
+
+// Types of event which are found by <eventSearch_run>
+#define EVENT_CONJUNCTION            0  // Two bodies have the same ecliptic longitude
+#define EVENT_OPPOSITION             1  // A body is 180 degrees from the Sun in ecliptic longitude
+#define EVENT_GREATEST_ELONGATION    2  // A body's angular distance from the Sun reaches a maximum
+#define EVENT_STATIONARY_RA          3  // A body's motion in RA changes direction
+#define EVENT_STATIONARY_LONGITUDE   4  // A body's motion in ecliptic longitude changes direction
+#define EVENT_PERIHELION             5  // A body's distance from the Sun reaches a minimum
+#define EVENT_APHELION               6  // A body's distance from the Sun reaches a maximum
+
+// Types of event which are found by <calendarEvents_run>, rather than <eventSearch_run>
+#define EVENT_CALENDAR_FIRST         7
+#define EVENT_NEW_MOON               7
+#define EVENT_FIRST_QUARTER          8
+#define EVENT_FULL_MOON              9
+#define EVENT_LAST_QUARTER          10
+#define EVENT_PERIGEE               11  // The Moon's distance from the Earth reaches a minimum
+#define EVENT_APOGEE                12  // The Moon's distance from the Earth reaches a maximum
+#define EVENT_ASCENDING_NODE        13  // The Moon crosses the ecliptic northwards
+#define EVENT_DESCENDING_NODE       14  // The Moon crosses the ecliptic southwards
+#define EVENT_MARCH_EQUINOX         15
+#define EVENT_JUNE_SOLSTICE         16
+#define EVENT_SEPTEMBER_EQUINOX     17
+#define EVENT_DECEMBER_SOLSTICE     18
+#define EVENT_TYPE_COUNT            19
+
+// The maximum number of searches which may be performed at once
+#define EVENT_MAX_SEARCHES 1024
+
+// An event to search for
+typedef struct {
+    int type;  // One of the EVENT_* types above
+    int body_a;  // The bodyId of the body whose event we are looking for
+    int body_b;  // For conjunctions, the bodyId of the second body; otherwise ignored
+} eventSearch;
+
+// An event which has been found
+typedef struct {
+    int type;
+    int body_a, body_b;
+    double jd;  // The time of the event; TT
+    int sense;  // +1 if the quantity being searched for a root increases through zero; -1 if it decreases
+    double value;  // Separation of bodies, elongation, RA, ecliptic longitude or distance at the event; radians or AU
+} eventFound;
+
+const char *eventSearch_name(int type);
+
+int eventSearch_type(const char *name);
+
+void eventSearch_run(const eventSearch *searches, int search_count, double jd_min, double jd_max, double jd_step,
+                     void (*report)(const eventFound *, void *), void *context);
+
+#endif
@@ -0,0 +1,182 @@
+// horizon.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// Convert RA/Dec positions into hour angles, altitudes and azimuths. The horizon of each observer is described by a
+// set of unit vectors, which need only be computed once per time step, after which each object costs a handful of
+// dot products.
+
+#define HORIZON_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+
+#include "mathsTools/julianDate.h"
+
+#include "horizon.h"
+
+//! horizon_unitVector - Compute the unit vector pointing towards a point given in equatorial coordinates of date,
+//! expressed in the reference frame of a different epoch
+//! \param [out] out - The three-component unit vector
+//! \param [in] ra - Right ascension, equinox of date; radians
+//! \param [in] dec - Declination, equinox of date; radians
+//! \param [in] jd - The Julian date; TT
+//! \param [in] ra_dec_epoch - The epoch of the output reference frame
+
+static void horizon_unitVector(double *out, const double ra, const double dec, const double jd,
+                               const double ra_dec_epoch) {
+    double ra_out = ra, dec_out = dec;
+    if (ra_dec_epoch != jd) ra_dec_switch_epoch(ra, dec, jd, ra_dec_epoch, &ra_out, &dec_out);
+    out[0] = cos(dec_out) * cos(ra_out);
+    out[1] = cos(dec_out) * sin(ra_out);
+    out[2] = sin(dec_out);
+}
+
+//! horizon_unitVectorRotated - Compute the unit vector pointing towards a point given in equatorial coordinates of
+//! date, expressed in the reference frame of a different epoch by a precomputed rotation
+//! \param [out] out - The three-component unit vector
+//! \param [in] ra - Right ascension, equinox of date; radians
+//! \param [in] dec - Declination, equinox of date; radians
+//! \param [in] rotation - The matrix which rotates the equatorial frame of date into the output reference frame, or
+//! NULL if they are the same
+
+static void horizon_unitVectorRotated(double *out, const double ra, const double dec, const double *rotation) {
+    const double v[3] = {cos(dec) * cos(ra), cos(dec) * sin(ra), sin(dec)};
+    int i;
+    for (i = 0; i < 3; i++) {
+        out[i] = (rotation == NULL) ? v[i] :
+                 (rotation[3 * i] * v[0] + rotation[3 * i + 1] * v[1] + rotation[3 * i + 2] * v[2]);
+    }
+}
+
+//! horizon_rotation - Compute the matrix which rotates the equatorial frame of date into the reference frame of the
+//! RA/Dec coordinates which will be passed to <horizon_convert>, for use with <horizon_framePrecessed>
+//! \param [out] out - The 3x3 rotation matrix, in row-major order
+//! \param [in] jd - The Julian date; TT
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates which will be passed to <horizon_convert>
+
+void horizon_rotation(double *out, const double jd, const double ra_dec_epoch) {
+    double from_date[9], to_epoch[9];
+    int i, j;
+
+    // Rotate from the equinox of date into J2000.0 (the transpose of its precession matrix), then into <ra_dec_epoch>
+    precession_matrix(jd, from_date);
+    precession_matrix(ra_dec_epoch, to_epoch);
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++) {
+            out[3 * i + j] = to_epoch[3 * i] * from_date[3 * j] + to_epoch[3 * i + 1] * from_date[3 * j + 1] +
+                             to_epoch[3 * i + 2] * from_date[3 * j + 2];
+        }
+}
+
+//! horizon_framePrecessed - Compute the unit vectors describing the local horizon of an observer, given the rotation
+//! from the equatorial frame of date into the output reference frame. Used when the horizons of many observers are
+//! needed at the same time. The frame is rotated with the IAU 1976 precession matrices, where <horizon_frame> uses
+//! Green's approximate formulae, so the two may differ by a few hundredths of an arcsecond near J2000.0.
+//! \param [out] out - The horizon frame
+//! \param [in] sidereal_time - The Greenwich sidereal time; degrees
+//! \param [in] latitude - The geodetic latitude of the observer; degrees
+//! \param [in] longitude - The longitude of the observer, east of Greenwich; degrees
+//! \param [in] rotation - The matrix from <horizon_rotation>, or NULL if the RA/Dec coordinates which will be passed
+//! to <horizon_convert> are for the equinox of date
+
+void horizon_framePrecessed(horizonFrame *out, const double sidereal_time, const double latitude,
+                            const double longitude, const double *rotation) {
+    // The local sidereal time is the right ascension of the meridian
+    const double lst = (sidereal_time + longitude) * M_PI / 180;
+    const double lat = latitude * M_PI / 180;
+
+    horizon_unitVectorRotated(out->zenith, lst, lat, rotation);
+    horizon_unitVectorRotated(out->meridian, lst, 0, rotation);
+    horizon_unitVectorRotated(out->east, lst + M_PI / 2, 0, rotation);
+
+    // north = zenith x east. Precession is an exact rotation, so this is already a unit vector.
+    out->north[0] = out->zenith[1] * out->east[2] - out->zenith[2] * out->east[1];
+    out->north[1] = out->zenith[2] * out->east[0] - out->zenith[0] * out->east[2];
+    out->north[2] = out->zenith[0] * out->east[1] - out->zenith[1] * out->east[0];
+}
+
+//! horizon_frame - Compute the unit vectors describing the local horizon of an observer
+//! \param [out] out - The horizon frame
+//! \param [in] jd - The Julian date; TT
+//! \param [in] sidereal_time - The Greenwich sidereal time; degrees
+//! \param [in] latitude - The geodetic latitude of the observer; degrees
+//! \param [in] longitude - The longitude of the observer, east of Greenwich; degrees
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates which will be passed to <horizon_convert>
+
+void horizon_frame(horizonFrame *out, const double jd, const double sidereal_time, const double latitude,
+                   const double longitude, const double ra_dec_epoch) {
+    // The local sidereal time is the right ascension of the meridian
+    const double lst = (sidereal_time + longitude) * M_PI / 180;
+    const double lat = latitude * M_PI / 180;
+
+    horizon_unitVector(out->zenith, lst, lat, jd, ra_dec_epoch);
+    horizon_unitVector(out->meridian, lst, 0, jd, ra_dec_epoch);
+    horizon_unitVector(out->east, lst + M_PI / 2, 0, jd, ra_dec_epoch);
+
+    // north = zenith x east
+    out->north[0] = out->zenith[1] * out->east[2] - out->zenith[2] * out->east[1];
+    out->north[1] = out->zenith[2] * out->east[0] - out->zenith[0] * out->east[2];
+    out->north[2] = out->zenith[0] * out->east[1] - out->zenith[1] * out->east[0];
+
+    // Precession of the equinoxes is not applied as an exact rotation, so renormalise
+    const double norm = gsl_hypot3(out->north[0], out->north[1], out->north[2]);
+    out->north[0] /= norm;
+    out->north[1] /= norm;
+    out->north[2] /= norm;
+}
+
+//! horizon_convert - Convert the RA/Dec positions of a list of objects into hour angles, altitudes and azimuths
+//! \param [in] frame - The horizon frame of the observer, for the RA/Dec reference frame of the input
+//! \param [in] count - The number of objects
+//! \param [in] stride - The separation of the values for consecutive objects in each input and output array
+//! \param [in] ra - The right ascension of each object; radians
+//! \param [in] dec - The declination of each object; radians
+//! \param [out] hour_angle - The hour angle of each object, in the range -pi to pi, positive to the west; radians
+//! \param [out] altitude - The altitude of each object; radians. No correction is made for refraction.
+//! \param [out] azimuth - The azimuth of each object, measured eastwards from north, in the range 0 to 2pi; radians
+
+void horizon_convert(const horizonFrame *frame, const int count, const int stride, const double *ra,
+                     const double *dec, double *hour_angle, double *altitude, double *azimuth) {
+    const double *z = frame->zenith, *n = frame->north, *e = frame->east, *m = frame->meridian;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        const int o = i * stride;
+        const double cos_dec = cos(dec[o]);
+        const double v[3] = {cos_dec * cos(ra[o]), cos_dec * sin(ra[o]), sin(dec[o])};
+
+        // Components of the object's direction along each axis of the horizon frame
+        const double v_zenith = v[0] * z[0] + v[1] * z[1] + v[2] * z[2];
+        const double v_north = v[0] * n[0] + v[1] * n[1] + v[2] * n[2];
+        const double v_east = v[0] * e[0] + v[1] * e[1] + v[2] * e[2];
+        const double v_meridian = v[0] * m[0] + v[1] * m[1] + v[2] * m[2];
+
+        double az = atan2(v_east, v_north);
+        if (az < 0) az += 2 * M_PI;
+
+        hour_angle[o] = atan2(-v_east, v_meridian);
+        altitude[o] = atan2(v_zenith, hypot(v_east, v_north));
+        azimuth[o] = az;
+    }
+}
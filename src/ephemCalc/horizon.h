@@ -0,0 +1,45 @@
+// horizon.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef HORIZON_H
+#define HORIZON_H 1
+
+// The local horizon of an observer at a particular time, described by unit vectors in the reference frame of the
+// RA/Dec coordinates it is to be used with
+typedef struct {
+    double zenith[3];  // The direction normal to the WGS84 ellipsoid at the observer
+    double north[3];  // The north point on the horizon
+    double east[3];  // The east point on the horizon, which is also where the celestial equator meets the horizon
+    double meridian[3];  // The point where the celestial equator crosses the meridian
+} horizonFrame;
+
+void horizon_frame(horizonFrame *out, double jd, double sidereal_time, double latitude, double longitude,
+                   double ra_dec_epoch);
+
+void horizon_rotation(double *out, double jd, double ra_dec_epoch);
+
+void horizon_framePrecessed(horizonFrame *out, double sidereal_time, double latitude, double longitude,
+                            const double *rotation);
+
+void horizon_convert(const horizonFrame *frame, int count, int stride, const double *ra, const double *dec,
+                     double *hour_angle, double *altitude, double *azimuth);
+
+#endif
@@ -23,7 +23,10 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <gsl/gsl_cblas.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_const_mksa.h>
 
@@ -33,6 +36,7 @@
 
 #include "listTools/ltDict.h"
 #include "listTools/ltMemory.h"
+#include "mathsTools/julianDate.h"
 
 #include "jpl.h"
 #include "orbitalElements.h"
@@ -59,88 +63,379 @@ static int *JPL_ShapeData = NULL; // The 13x3 shape array defined in GROUP 1050
 static dict *JPL_EphemVars = NULL; // The metadata variables about the ephemeris, defined in GROUP 1040/1041
 static int JPL_EphemArrayRecords = 0; // The number of blocks needed to go from EphemStart to EphemEnd at step size EphemStep
 
-static int JPL_EphemData_offset = -1; // The offset of the start of the ephmeris binary data from the start of the binary file
 static FILE *JPL_EphemFile = NULL; // File pointer used to read binary data from DE430 (we don't read whole binary ephemeris into memory)
 static char jpl_ephem_filename[FNAME_LENGTH];  // File name of binary ephemeris file
 
 static double *JPL_EphemData = NULL; // Buffer to hold the ephemeris data, as we load it
-static unsigned char *JPL_EphemData_items_loaded = NULL; // Record of which ephemeris data records we have loaded
+static unsigned char *JPL_EphemData_items_loaded = NULL; // Record of which units of ephemeris data we have loaded
+
+// The binary dump of DE430 in <data/dcfbinary.430> stores the coefficients for all 13 bodies for each time step
+// together in one record. We also write a copy in <data/dcfbinary_bodies.430> in which the coefficients for each body
+// are stored contiguously across time, so that queries about a few bodies don't need to read the coefficients for
+// the others. Data is loaded from disk, and cached, in units: each unit is one record of the first file, or the
+// coefficients for one body within one record of the second. Unit number <body * JPL_EphemArrayRecords + record>
+// holds the coefficients for <body>; in the first file, <body> is always zero.
+#define JPL_BODY_COUNT 13
+
+// Version number of the layout of <data/dcfbinary_bodies.430>. Files with any other version number are regenerated.
+#define JPL_BODIES_FORMAT 1
+
+static int JPL_BodyMajor = 0; // Boolean flag indicating whether we are reading <data/dcfbinary_bodies.430>
+static int JPL_UnitCount = 0; // The number of units of data in the binary file
+static int JPL_UnitLength = 0; // The length of the longest unit, in doubles
+static long JPL_BodyFileOffset[JPL_BODY_COUNT]; // The offset of the first unit for each body from the start of file
+static int JPL_BodyLength[JPL_BODY_COUNT]; // The length of each body's units, in doubles
+static long JPL_BodyDataOffset[JPL_BODY_COUNT]; // Position of each body's first unit in <JPL_EphemData>, if uncached
+static int JPL_BodyFirstCoefficient[JPL_BODY_COUNT]; // FORTRAN index of the first coefficient stored in each unit
+static double *JPL_RecordStart = NULL; // The first JD of each record; only needed in <data/dcfbinary_bodies.430>
+
+// A compact ephemeris, written by <jpl_writeCompactEphemeris>, to use instead of DE430; empty to use DE430
+static char JPL_CompactFilename[FNAME_LENGTH] = "";
+
+// Values in <JPL_EphemData_items_loaded>
+#define JPL_RECORD_ABSENT     0
+#define JPL_RECORD_LOADED     1
+#define JPL_RECORD_READAHEAD  2  // Loaded by readahead, and not yet used
+
+// When units are requested in sequence, as in a time-ordered scan, each unit we have to load from disk is read
+// together with the following JPL_READAHEAD_RECORDS units, and the operating system is asked to start fetching the
+// units after those. This means that threads rarely stall on disk reads at record boundaries.
+#define JPL_READAHEAD_RECORDS 4
+
+static int JPL_LastLoaded[JPL_BODY_COUNT]; // The last record loaded from disk for each body, to detect sequential scans
+static long JPL_Readahead_hits = 0; // Number of units used which were loaded by readahead
+static long JPL_Readahead_misses = 0; // Number of times a query had to wait for a unit to be loaded from disk
+static long JPL_Readahead_loaded = 0; // Number of units loaded by readahead
+static long JPL_BytesRead = 0; // Number of bytes of ephemeris data read from disk
+
+// Units are held in <JPL_EphemData> in a cache of <JPL_CacheSlots> slots. By default there is a slot for every
+// unit in the ephemeris, but a memory budget can be set with <jpl_setCacheSize>, in which case units are evicted
+// using the CLOCK algorithm. Queries take no lock when the unit they need is in the cache: each slot has a version
+// number, which is odd while the slot is being overwritten, and queries copy the coefficients they need and then
+// check that the version number has not changed.
+#define JPL_CACHE_MIN_SLOTS (4 * (JPL_READAHEAD_RECORDS + 1))
+
+// The largest number of Chebyshev coefficients for any body in each coordinate
+#define JPL_MAX_COEFFICIENTS 32
+
+// The maximum number of time points evaluated together by <jpl_computeXYZGrid> in a single matrix product
+#define JPL_GRID_CHUNK 256
+
+static long JPL_CacheBudget = 0; // Memory budget for cached units, in bytes; zero for no limit
+static int JPL_CacheSlots = 0; // Number of slots in the cache
+static int JPL_CacheSlotsUsed = 0; // Number of slots which have been filled; empty slots are used before evicting
+static int JPL_CacheClockHand = 0; // The next slot to consider for eviction
+static int *JPL_RecordSlot = NULL; // The slot holding each unit, or -1
+static int *JPL_SlotRecord = NULL; // The unit held in each slot, or -1
+static unsigned int *JPL_SlotVersion = NULL; // Incremented before and after each slot is overwritten
+static unsigned char *JPL_SlotReferenced = NULL; // CLOCK reference bit for each slot
+static long JPL_Cache_evictions = 0; // Number of units evicted from the cache
+
+// Callers which need less than full precision can set a tolerance with <jpl_setTolerance>. When each unit is loaded,
+// we work out how many terms of each body's Chebyshev series are needed to stay within it, taking the sum of the
+// magnitudes of the discarded terms as an upper limit on the error. Queries then only evaluate those terms.
+static double JPL_Tolerance = 0; // Largest acceptable error in positions, in km; zero for full precision
+static unsigned char *JPL_TermCount = NULL; // Number of terms needed for each record and body, [record * 13 + body]
 
 static double JPL_AU = 0.0; // astronomical unit, measured in km
 
 
-//! JPL_ReadBinaryData - restore DE430 from a binary dump of the data in <data/dcfbinary.430>, to save parsing
-//! original files every time we are run.
+//! jpl_readBinaryHeader - Read the metadata at the start of the binary dumps of DE430, which is the same in
+//! <data/dcfbinary.430> and <data/dcfbinary_bodies.430>
+//! \param [in] input - The binary file, positioned at the start of the metadata
+//! \param [in] fname - The filename of the binary file, for error messages
 
-int JPL_ReadBinaryData() {
-    char fname[FNAME_LENGTH];
-
-    // Work out the filename of the binary file that we are to open
-    snprintf(fname, FNAME_LENGTH, "%s/../data/dcfbinary.%d", SRCDIR, JPL_EphemNumber);
-    snprintf(jpl_ephem_filename, FNAME_LENGTH, "%s", fname);
-    if (DEBUG) {
-        snprintf(temp_err_string, FNAME_LENGTH, "Trying to fetch binary data from file <%s>.", fname);
-        ephem_log(temp_err_string);
-    }
-
-    // Open binary data
-    JPL_EphemFile = fopen(fname, "rb");
-    if (JPL_EphemFile == NULL) return 1; // Failed to open binary file
-
-    // Read headers to binary file
-    dcf_fread((void *) &JPL_EphemStart, sizeof(double), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+static void jpl_readBinaryHeader(FILE *input, const char *fname) {
+    dcf_fread((void *) &JPL_EphemStart, sizeof(double), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_EphemStart        = %10f", JPL_EphemStart);
         ephem_log(temp_err_string);
     }
-    dcf_fread((void *) &JPL_EphemEnd, sizeof(double), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) &JPL_EphemEnd, sizeof(double), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_EphemEnd          = %10f", JPL_EphemEnd);
         ephem_log(temp_err_string);
     }
-    dcf_fread((void *) &JPL_EphemStep, sizeof(double), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) &JPL_EphemStep, sizeof(double), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_EphemStep         = %10f", JPL_EphemStep);
         ephem_log(temp_err_string);
     }
-    dcf_fread((void *) &JPL_AU, sizeof(double), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) &JPL_AU, sizeof(double), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_AU                = %10f", JPL_AU);
         ephem_log(temp_err_string);
     }
-    dcf_fread((void *) &JPL_EphemArrayLen, sizeof(int), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) &JPL_EphemArrayLen, sizeof(int), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_EphemArrayLen     = %10d", JPL_EphemArrayLen);
         ephem_log(temp_err_string);
     }
-    dcf_fread((void *) &JPL_EphemArrayRecords, sizeof(int), 1, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) &JPL_EphemArrayRecords, sizeof(int), 1, input, fname, __FILE__, __LINE__);
     if (DEBUG) {
         snprintf(temp_err_string, FNAME_LENGTH, "JPL_EphemArrayRecords = %10d", JPL_EphemArrayRecords);
         ephem_log(temp_err_string);
     }
 
-    JPL_ShapeData = (int *) lt_malloc(13 * 3 * sizeof(int));
+    if (JPL_ShapeData == NULL) JPL_ShapeData = (int *) lt_malloc(13 * 3 * sizeof(int));
     if (JPL_ShapeData == NULL) {
         ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
         exit(1);
     }
 
     // Read shape data array
-    dcf_fread((void *) JPL_ShapeData, sizeof(int), 13 * 3, JPL_EphemFile, fname, __FILE__, __LINE__);
+    dcf_fread((void *) JPL_ShapeData, sizeof(int), 13 * 3, input, fname, __FILE__, __LINE__);
+}
 
-    // We have now reached the actual ephemeris data. We don't load this into RAM since it is large and this would
-    // take time. Instead, store a pointer to the offset of the start of the ephemeris from the beginning of file.
-    JPL_EphemData_offset = (int) ftell(JPL_EphemFile);
+//! jpl_openBodyMajorData - Open the copy of DE430 in <data/dcfbinary_bodies.430>, in which the coefficients for each
+//! body are stored contiguously across time. After the metadata, the file contains an index of the offset of each
+//! body's data from the start of the file, and the length of each body's coefficients within each record. This is
+//! followed by the first JD of each record, and then the coefficients themselves.
+//! \param [in] fname - The filename of the binary file
+//! \return - Zero on success
 
-    // Allocate memory to use to store ephemeris, as we load it
-    JPL_EphemData = (double *) lt_malloc(JPL_EphemArrayLen * JPL_EphemArrayRecords * sizeof(double));
+static int jpl_openBodyMajorData(const char *fname) {
+    int format = -1;
 
-    // Allocate array to record which blocks we have already loaded from disk
-    JPL_EphemData_items_loaded = (unsigned char *) lt_malloc(JPL_EphemArrayRecords * sizeof(unsigned char));
-    memset(JPL_EphemData_items_loaded, 0, JPL_EphemArrayRecords);
+    FILE *input = fopen(fname, "rb");
+    if (input == NULL) return 1;
+
+    // Reject files written in any other layout
+    if ((fread((void *) &format, sizeof(int), 1, input) != 1) || (format != JPL_BODIES_FORMAT)) {
+        fclose(input);
+        return 1;
+    }
+
+    jpl_readBinaryHeader(input, fname);
+    dcf_fread((void *) JPL_BodyFileOffset, sizeof(long), JPL_BODY_COUNT, input, fname, __FILE__, __LINE__);
+    dcf_fread((void *) JPL_BodyLength, sizeof(int), JPL_BODY_COUNT, input, fname, __FILE__, __LINE__);
+
+    JPL_RecordStart = (double *) lt_malloc(JPL_EphemArrayRecords * sizeof(double));
+    if (JPL_RecordStart == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    dcf_fread((void *) JPL_RecordStart, sizeof(double), JPL_EphemArrayRecords, input, fname, __FILE__, __LINE__);
+
+    for (int i = 0; i < JPL_BODY_COUNT; i++) JPL_BodyFirstCoefficient[i] = JPL_ShapeData[i * 3 + 0];
+
+    JPL_EphemFile = input;
+    JPL_BodyMajor = 1;
+    JPL_UnitCount = JPL_BODY_COUNT * JPL_EphemArrayRecords;
+    snprintf(jpl_ephem_filename, FNAME_LENGTH, "%s", fname);
+    return 0;
+}
+
+//! jpl_writeBodyMajorHeader - Write the metadata and index at the start of a file in the layout of
+//! <data/dcfbinary_bodies.430>, leaving the file positioned where the table of the first JD of each record goes. The
+//! coefficients for each body follow that table, in the order of the bodies. The record length given in the metadata
+//! is the total length of the coefficients stored for all bodies, plus two for the JD limits of each record.
+//! \param [in] output - The file to write to
+//! \param [in] jd_start - The Julian day number of the start of the ephemeris
+//! \param [in] jd_end - The Julian day number of the end of the ephemeris
+//! \param [in] record_count - The number of records in the ephemeris
+//! \param [in] shape - The 13x3 shape array, giving the number of coefficients and subintervals for each body
+//! \param [out] body_offset - The offset of each body's coefficients from the start of the file
+//! \param [out] body_length - The number of coefficients stored for each body for each record
+
+static void jpl_writeBodyMajorHeader(FILE *output, const double jd_start, const double jd_end, const int record_count,
+                                     const int *shape, long *body_offset, int *body_length) {
+    const int format = JPL_BODIES_FORMAT;
+    int i, array_length = 2;
+
+    // Work out where each body's data will go
+    long position = (long) (sizeof(int) + 4 * sizeof(double) + (2 + 13 * 3) * sizeof(int) +
+                            JPL_BODY_COUNT * (sizeof(long) + sizeof(int)) +
+                            record_count * sizeof(double));
+    for (i = 0; i < JPL_BODY_COUNT; i++) {
+        body_offset[i] = position;
+        body_length[i] = 3 * shape[i * 3 + 1] * shape[i * 3 + 2];
+        position += (long) record_count * body_length[i] * sizeof(double);
+        array_length += body_length[i];
+    }
+
+    fwrite((void *) &format, sizeof(int), 1, output);
+    fwrite((void *) &jd_start, sizeof(double), 1, output);
+    fwrite((void *) &jd_end, sizeof(double), 1, output);
+    fwrite((void *) &JPL_EphemStep, sizeof(double), 1, output);
+    fwrite((void *) &JPL_AU, sizeof(double), 1, output);
+    fwrite((void *) &array_length, sizeof(int), 1, output);
+    fwrite((void *) &record_count, sizeof(int), 1, output);
+    fwrite((void *) shape, sizeof(int), 13 * 3, output);
+    fwrite((void *) body_offset, sizeof(long), JPL_BODY_COUNT, output);
+    fwrite((void *) body_length, sizeof(int), JPL_BODY_COUNT, output);
+}
 
+//! JPL_DumpBodyMajorData - Write a copy of the binary dump of DE430 in <data/dcfbinary.430>, which must be open, to
+//! <data/dcfbinary_bodies.430>, with the coefficients for each body stored contiguously across time. The file is
+//! written under a temporary name and then renamed, so that other processes never see it half-written.
+//! \param [in] fname - The filename of the body-major binary file
+
+static void JPL_DumpBodyMajorData(const char *fname) {
+    char fname_temp[FNAME_LENGTH + 16];
+    long body_offset[JPL_BODY_COUNT];
+    int body_length[JPL_BODY_COUNT];
+    const double zero = 0;
+    int i, j;
+
+    snprintf(fname_temp, FNAME_LENGTH + 16, "%s.%d", fname, (int) getpid());
     if (DEBUG) {
-        snprintf(temp_err_string, FNAME_LENGTH, "Data file successfully opened.");
+        snprintf(temp_err_string, FNAME_LENGTH, "Dumping body-major binary data to file <%s>.", fname);
+        ephem_log(temp_err_string);
+    }
+    FILE *output = fopen(fname_temp, "wb");
+    if (output == NULL) return; // FAIL
+
+    double *record = (double *) lt_malloc(JPL_EphemArrayLen * sizeof(double));
+    if (record == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    jpl_writeBodyMajorHeader(output, JPL_EphemStart, JPL_EphemEnd, JPL_EphemArrayRecords, JPL_ShapeData,
+                             body_offset, body_length);
+    const long record_start_offset = ftell(output);
+
+    // Read each record in turn, and scatter its contents to each body's data
+    fseek(JPL_EphemFile, JPL_BodyFileOffset[0], SEEK_SET);
+    for (j = 0; j < JPL_EphemArrayRecords; j++) {
+        dcf_fread((void *) record, sizeof(double), JPL_EphemArrayLen, JPL_EphemFile, jpl_ephem_filename,
+                  __FILE__, __LINE__);
+
+        fseek(output, record_start_offset + j * (long) sizeof(double), SEEK_SET);
+        fwrite((void *) &record[0], sizeof(double), 1, output);
+
+        for (i = 0; i < JPL_BODY_COUNT; i++) {
+            const int c0 = JPL_ShapeData[i * 3 + 0];
+            int count = body_length[i];
+
+            // The coefficients of bodies which are not in the ephemeris may run past the end of the record
+            if (c0 - 1 + count > JPL_EphemArrayLen) count = JPL_EphemArrayLen - (c0 - 1);
+            if ((count < 0) || (c0 < 1)) count = 0;
+
+            fseek(output, body_offset[i] + j * (long) body_length[i] * sizeof(double), SEEK_SET);
+            if (count > 0) fwrite((void *) &record[c0 - 1], sizeof(double), count, output);
+            for (; count < body_length[i]; count++) fwrite((void *) &zero, sizeof(double), 1, output);
+        }
+    }
+
+    const int failed = ferror(output);
+    fclose(output);
+    if (failed || (rename(fname_temp, fname) != 0)) {
+        remove(fname_temp);
+        return;
+    }
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Body-major data successfully dumped.");
+        ephem_log(temp_err_string);
+    }
+}
+
+//! JPL_ReadBinaryData - restore DE430 from a binary dump of the data in <data/dcfbinary.430>, to save parsing
+//! original files every time we are run. If the body-major copy in <data/dcfbinary_bodies.430> exists, we read that
+//! instead, and if it doesn't, we try to create it.
+
+int JPL_ReadBinaryData() {
+    char fname[FNAME_LENGTH], fname_bodies[FNAME_LENGTH];
+    int i;
+
+    // Work out the filenames of the binary files that we are to open
+    snprintf(fname, FNAME_LENGTH, "%s/../data/dcfbinary.%d", SRCDIR, JPL_EphemNumber);
+    snprintf(fname_bodies, FNAME_LENGTH, "%s/../data/dcfbinary_bodies.%d", SRCDIR, JPL_EphemNumber);
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Trying to fetch binary data from file <%s>.", fname_bodies);
+        ephem_log(temp_err_string);
+    }
+
+    if (JPL_CompactFilename[0] != '\0') {
+        // Use a compact ephemeris in place of DE430
+        if (jpl_openBodyMajorData(JPL_CompactFilename) != 0) {
+            snprintf(temp_err_string, FNAME_LENGTH, "Could not read compact ephemeris from file <%s>.",
+                     JPL_CompactFilename);
+            ephem_fatal(__FILE__, __LINE__, temp_err_string);
+            exit(1);
+        }
+    } else if (jpl_openBodyMajorData(fname_bodies) != 0) {
+        if (DEBUG) {
+            snprintf(temp_err_string, FNAME_LENGTH, "Trying to fetch binary data from file <%s>.", fname);
+            ephem_log(temp_err_string);
+        }
+
+        // Open binary data
+        snprintf(jpl_ephem_filename, FNAME_LENGTH, "%s", fname);
+        JPL_EphemFile = fopen(fname, "rb");
+        if (JPL_EphemFile == NULL) return 1; // Failed to open binary file
+
+        // Read headers to binary file
+        jpl_readBinaryHeader(JPL_EphemFile, fname);
+
+        // We have now reached the actual ephemeris data. We don't load this into RAM since it is large and this would
+        // take time. Instead, store a pointer to the offset of the start of the ephemeris from the beginning of file.
+        JPL_BodyMajor = 0;
+        JPL_UnitCount = JPL_EphemArrayRecords;
+        JPL_BodyFileOffset[0] = ftell(JPL_EphemFile);
+        JPL_BodyLength[0] = JPL_EphemArrayLen;
+        JPL_BodyFirstCoefficient[0] = 1;
+
+        // Write the body-major copy for next time, and use it straight away if we succeeded
+        FILE *record_major_file = JPL_EphemFile;
+        JPL_DumpBodyMajorData(fname_bodies);
+        if (jpl_openBodyMajorData(fname_bodies) == 0) fclose(record_major_file);
+    }
+
+    // Work out where each body's units go in <JPL_EphemData> when the whole ephemeris is cached
+    const int unit_bodies = JPL_BodyMajor ? JPL_BODY_COUNT : 1;
+    long data_length = 0;
+    JPL_UnitLength = 0;
+    for (i = 0; i < unit_bodies; i++) {
+        JPL_BodyDataOffset[i] = data_length;
+        data_length += (long) JPL_EphemArrayRecords * JPL_BodyLength[i];
+        if (JPL_BodyLength[i] > JPL_UnitLength) JPL_UnitLength = JPL_BodyLength[i];
+        JPL_LastLoaded[i] = -2;
+    }
+
+    // Work out how many units we can cache within our memory budget
+    const long unit_bytes = JPL_UnitLength * sizeof(double);
+    JPL_CacheSlots = JPL_UnitCount;
+    if ((JPL_CacheBudget > 0) && (JPL_CacheBudget / unit_bytes < JPL_CacheSlots)) {
+        JPL_CacheSlots = (int) (JPL_CacheBudget / unit_bytes);
+        if (JPL_CacheSlots < JPL_CACHE_MIN_SLOTS) JPL_CacheSlots = JPL_CACHE_MIN_SLOTS;
+        data_length = JPL_CacheSlots * (long) JPL_UnitLength;
+    }
+
+    // Allocate memory to use to store ephemeris, as we load it
+    JPL_EphemData = (double *) lt_malloc(data_length * sizeof(double));
+
+    // Allocate array to record which units we have already loaded from disk, and where they are
+    JPL_EphemData_items_loaded = (unsigned char *) lt_malloc(JPL_UnitCount * sizeof(unsigned char));
+    JPL_RecordSlot = (int *) lt_malloc(JPL_UnitCount * sizeof(int));
+    JPL_SlotRecord = (int *) lt_malloc(JPL_CacheSlots * sizeof(int));
+    JPL_SlotVersion = (unsigned int *) lt_malloc(JPL_CacheSlots * sizeof(unsigned int));
+    JPL_SlotReferenced = (unsigned char *) lt_malloc(JPL_CacheSlots * sizeof(unsigned char));
+    if (JPL_Tolerance > 0) {
+        JPL_TermCount = (unsigned char *) lt_malloc((size_t) JPL_EphemArrayRecords * JPL_BODY_COUNT);
+        if (JPL_TermCount == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+    }
+    if ((JPL_EphemData == NULL) || (JPL_EphemData_items_loaded == NULL) || (JPL_RecordSlot == NULL) ||
+        (JPL_SlotRecord == NULL) || (JPL_SlotVersion == NULL) || (JPL_SlotReferenced == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    memset(JPL_EphemData_items_loaded, JPL_RECORD_ABSENT, JPL_UnitCount);
+    for (i = 0; i < JPL_UnitCount; i++) JPL_RecordSlot[i] = -1;
+    for (i = 0; i < JPL_CacheSlots; i++) {
+        JPL_SlotRecord[i] = -1;
+        JPL_SlotVersion[i] = 0;
+        JPL_SlotReferenced[i] = 0;
+    }
+    JPL_CacheSlotsUsed = 0;
+    JPL_CacheClockHand = 0;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Data file <%s> successfully opened.", jpl_ephem_filename);
         ephem_log(temp_err_string);
     }
 
@@ -501,7 +796,7 @@ void jpl_readAsciiData() {
 
     // Make table indicating that we have loaded all of the ephemeris data
     JPL_EphemData_items_loaded = (unsigned char *) lt_malloc(JPL_EphemArrayRecords * sizeof(unsigned char));
-    memset(JPL_EphemData_items_loaded, 1, JPL_EphemArrayRecords);
+    memset(JPL_EphemData_items_loaded, JPL_RECORD_LOADED, JPL_EphemArrayRecords);
 
     // Free storage for local copy
     free(JPL_EphemData);
@@ -530,94 +825,406 @@ double chebyshev(double *coeffs, int Ncoeff, double x) {
     return x * d - dd + coeffs[0];
 }
 
-//! jpl_computeXYZ - Evaluate the 3D position of a solar system body at Julian date JD (in ICRF v2 as used by DE430)
-//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
-//! \param [in] jd - Julian day number; TT
-//! \param [out] x - Cartesian position of body (AU). This axis points away from RA=0.
-//! \param [out] y - Cartesian position of body (AU).
-//! \param [out] z - Cartesian position of body (AU). This axis points towards J2000.0 north celestial pole
+//! chebyshev_derivative - Evaluate the derivative of a Chebyshev polynomial, using d/dx T_k(x) = k U_{k-1}(x), where
+//! U are the Chebyshev polynomials of the second kind
+//! \param coeffs - The coefficients of the Chebyshev polynomial
+//! \param Ncoeff - The number of coefficients
+//! \param x - The point at which to evaluate the derivative
+//! \return The derivative of the Chebyshev polynomial with respect to x
+
+double chebyshev_derivative(double *coeffs, int Ncoeff, double x) {
+    double u_prev = 0, u = 1;  // U_{k-2} and U_{k-1}
+    double out = 0;
+    int k;
+
+    for (k = 1; k < Ncoeff; k++) {
+        out += k * coeffs[k] * u;
+        const double u_next = 2 * x * u - u_prev;
+        u_prev = u;
+        u = u_next;
+    }
+    return out;
+}
 
-void jpl_computeXYZ(int body_id, double jd, double *x, double *y, double *z) {
-    int record_index, i;
-    double dt, tc;
+//! jpl_setCacheSize - Set a limit on the memory used to cache records of DE430 which have been loaded from disk. This
+//! must be called before the ephemeris is first used.
+//! \param [in] max_bytes - The memory budget, in bytes. Zero means that the whole ephemeris may be cached.
 
-#pragma omp critical (jpl_init)
-    {
-        // If we haven't already loaded DE430 data, make sure we have done so now
-        if (JPL_EphemFile == NULL) jpl_readAsciiData();
+void jpl_setCacheSize(const long max_bytes) {
+    if (JPL_EphemData != NULL) {
+        ephem_warning("The DE430 cache size cannot be changed after the ephemeris has been opened.");
+        return;
     }
+    JPL_CacheBudget = max_bytes;
+}
 
-    // If this query falls outside the time span of DE430, then reject the query
-    if ((JPL_EphemFile == NULL) || (jd < JPL_EphemStart) || (jd > JPL_EphemEnd)) {
-        *x = *y = *z = GSL_NAN;
+//! jpl_setTolerance - Set the accuracy needed in the positions of bodies, allowing trailing terms of the Chebyshev
+//! series in DE430 to be skipped. This must be called before the ephemeris is first used.
+//! \param [in] tolerance - The largest acceptable error in positions, in km. Zero means full precision.
+
+void jpl_setTolerance(const double tolerance) {
+    if (JPL_EphemData != NULL) {
+        ephem_warning("The DE430 tolerance cannot be changed after the ephemeris has been opened.");
         return;
     }
+    JPL_Tolerance = tolerance;
+}
 
-    // Work out which block within DE430 this query falls within
-    record_index = floor((jd - JPL_EphemStart) / JPL_EphemStep);
+//! jpl_countTerms - Work out how many terms of the Chebyshev series for each body in a unit which has just been
+//! loaded are needed to stay within <JPL_Tolerance>, and store them in <JPL_TermCount>
+//! \param [in] unit - The number of the unit
+//! \param [in] data - The coefficients in the unit
+
+static void jpl_countTerms(const int unit, const double *data) {
+    const int unit_body = unit / JPL_EphemArrayRecords;
+    const int record_index = unit % JPL_EphemArrayRecords;
+    const int body_first = JPL_BodyMajor ? unit_body : 0;
+    const int body_last = JPL_BodyMajor ? unit_body : (JPL_BODY_COUNT - 1);
+
+    for (int body_id = body_first; body_id <= body_last; body_id++) {
+        const int n = JPL_ShapeData[body_id * 3 + 1];
+        const int g = JPL_ShapeData[body_id * 3 + 2];
+        const double *coefficients = data + (JPL_ShapeData[body_id * 3 + 0] - JPL_BodyFirstCoefficient[unit_body]);
+        int terms = (n > 0) ? 1 : 0;
+
+        // Find the largest number of terms needed by any coordinate, in any subinterval
+        for (int i = 0; i < 3 * g; i++) {
+            const double *c = coefficients + i * n;
+            double tail = 0;
+            int k = n;
+            while ((k > terms) && (tail + fabs(c[k - 1]) <= JPL_Tolerance)) tail += fabs(c[--k]);
+            terms = k;
+        }
+        JPL_TermCount[record_index * JPL_BODY_COUNT + body_id] = (unsigned char) terms;
+    }
+}
 
-    // Clip block number within allowed range
-    if (record_index < 0) record_index = 0;
-    if (record_index >= JPL_EphemArrayRecords) record_index = JPL_EphemArrayRecords - 1;
+//! jpl_slotData - Return a pointer to the data held in a slot in the cache
+//! \param [in] slot - The slot
+//! \return - Pointer to the first coefficient held in the slot
+
+static double *jpl_slotData(const int slot) {
+    // When the whole ephemeris is cached, each unit has its own slot, and each body's units are packed together
+    if (JPL_CacheSlots < JPL_UnitCount) return &JPL_EphemData[(long) slot * JPL_UnitLength];
+    const int body = slot / JPL_EphemArrayRecords;
+    const int record = slot % JPL_EphemArrayRecords;
+    return &JPL_EphemData[JPL_BodyDataOffset[body] + (long) record * JPL_BodyLength[body]];
+}
+
+//! jpl_cacheSlot - Choose a slot in the cache in which to store a unit, evicting the unit it holds if necessary.
+//! Must be called from within the critical section <jpl_fetch>.
+//! \param [in] unit - The unit we are going to store
+//! \param [in] protect_first - The first of a run of units which must not be evicted
+//! \param [in] protect_count - The number of units which must not be evicted
+//! \return - The slot to use
 
-    if (!JPL_EphemData_items_loaded[record_index]) {
-        // Create a pointer to the block that we need to query
-        long data_position_needed = JPL_EphemData_offset + record_index * JPL_EphemArrayLen * sizeof(double);
+static int jpl_cacheSlot(const int unit, const int protect_first, const int protect_count) {
+    // If the whole ephemeris can be cached, each unit has its own slot
+    if (JPL_CacheSlots >= JPL_UnitCount) return unit;
 
+    // Use empty slots first
+    if (JPL_CacheSlotsUsed < JPL_CacheSlots) return JPL_CacheSlotsUsed++;
+
+    // CLOCK algorithm: skip over slots which have been used since the clock hand last passed, clearing their bits
+    while (1) {
+        const int slot = JPL_CacheClockHand;
+        const int record = JPL_SlotRecord[slot];
+        JPL_CacheClockHand = (JPL_CacheClockHand + 1) % JPL_CacheSlots;
+        if ((record >= protect_first) && (record < protect_first + protect_count)) continue;
+        if (JPL_SlotReferenced[slot]) {
+            JPL_SlotReferenced[slot] = 0;
+            continue;
+        }
+        return slot;
+    }
+}
+
+//! jpl_loadRecord - Read a unit of DE430 from the current position in the file into a slot in the cache. Must be
+//! called from within the critical section <jpl_fetch>.
+//! \param [in] unit - The number of the unit to read
+//! \param [in] slot - The slot to read it into, from <jpl_cacheSlot>
+//! \param [in] status - The status to give the unit in <JPL_EphemData_items_loaded>
+
+static void jpl_loadRecord(const int unit, const int slot, const unsigned char status) {
+    const int evicted = JPL_SlotRecord[slot];
+    const int length = JPL_BodyLength[unit / JPL_EphemArrayRecords];
+
+    // Mark the slot as being overwritten
+    JPL_SlotVersion[slot]++;
+#pragma omp flush
+    if (evicted >= 0) {
+        JPL_RecordSlot[evicted] = -1;
+        JPL_EphemData_items_loaded[evicted] = JPL_RECORD_ABSENT;
+        JPL_Cache_evictions++;
+    }
+
+    dcf_fread((void *) jpl_slotData(slot), sizeof(double), length, JPL_EphemFile,
+              jpl_ephem_filename, __FILE__, __LINE__);
+    if (JPL_TermCount != NULL) jpl_countTerms(unit, jpl_slotData(slot));
+    JPL_BytesRead += length * (long) sizeof(double);
+    JPL_SlotRecord[slot] = unit;
+    JPL_SlotReferenced[slot] = 1;
+    JPL_RecordSlot[unit] = slot;
+    JPL_EphemData_items_loaded[unit] = status;
+
+    // Mark the slot as ready to use
+#pragma omp flush
+    JPL_SlotVersion[slot]++;
+#pragma omp flush
+}
+
+//! jpl_fetchRecord - Make sure that a unit of DE430 has been loaded from disk. If the unit has to be loaded, and
+//! it directly follows the last unit we loaded for the same body, the units after it are read at the same time, and
+//! the operating system is asked to start fetching the ones after those.
+//! \param [in] unit - The number of the unit which is needed
+
+static void jpl_fetchRecord(const int unit) {
 #pragma omp critical (jpl_fetch)
-        {
+    {
+        const unsigned char status = JPL_EphemData_items_loaded[unit];
+
+        if (status == JPL_RECORD_READAHEAD) {
+            // The unit has already been loaded by readahead
+            JPL_EphemData_items_loaded[unit] = JPL_RECORD_LOADED;
+            JPL_Readahead_hits++;
+        } else if (status == JPL_RECORD_ABSENT) {
+            const int body = unit / JPL_EphemArrayRecords;
+            const int record_index = unit % JPL_EphemArrayRecords;
+            const long unit_length = JPL_BodyLength[body] * (long) sizeof(double);
+            const long data_position_needed = JPL_BodyFileOffset[body] + record_index * unit_length;
+            int i, count = 1;
+
+            // If this is a sequential scan, read the following units too. These follow this one in the file.
+            if (record_index == JPL_LastLoaded[body] + 1) {
+                while ((count <= JPL_READAHEAD_RECORDS) && (record_index + count < JPL_EphemArrayRecords) &&
+                       (JPL_EphemData_items_loaded[unit + count] == JPL_RECORD_ABSENT)) {
+                    count++;
+                }
+            }
+
             fseek(JPL_EphemFile, data_position_needed, SEEK_SET);
-            dcf_fread((void *) &JPL_EphemData[record_index * JPL_EphemArrayLen],
-                      sizeof(double), JPL_EphemArrayLen, JPL_EphemFile,
-                      jpl_ephem_filename, __FILE__, __LINE__);
-            JPL_EphemData_items_loaded[record_index] = 1;
+            for (i = 0; i < count; i++) {
+                jpl_loadRecord(unit + i, jpl_cacheSlot(unit + i, unit, count),
+                               (i == 0) ? JPL_RECORD_LOADED : JPL_RECORD_READAHEAD);
+            }
+            JPL_LastLoaded[body] = record_index + count - 1;
+            JPL_Readahead_misses++;
+            JPL_Readahead_loaded += count - 1;
+
+#ifdef POSIX_FADV_WILLNEED
+            // Ask the operating system to start fetching the units we are likely to need next, without waiting
+            if (count > 1) {
+                posix_fadvise(fileno(JPL_EphemFile), data_position_needed + count * unit_length,
+                              JPL_READAHEAD_RECORDS * unit_length, POSIX_FADV_WILLNEED);
+            }
+#endif
         }
     }
-    double *data = &JPL_EphemData[record_index * JPL_EphemArrayLen];
+}
 
-    double t0 = data[0]; // First JD of time step
-    //double t1 = data[1]; // Last JD of time step
+//! jpl_cacheStatistics - Report how effective the caching and readahead of DE430 data has been. Data is loaded in
+//! units of one record, or of one body's coefficients within one record if the body-major copy of DE430 is in use.
+//! \param [out] hits - The number of units used which had been loaded by readahead
+//! \param [out] misses - The number of times a query had to wait for a unit to be loaded from disk
+//! \param [out] loaded - The number of units loaded by readahead, whether they were used or not
+//! \param [out] evictions - The number of units evicted from the cache to stay within its memory budget
+//! \param [out] bytes_read - The number of bytes of ephemeris data read from disk
+
+void jpl_cacheStatistics(long *hits, long *misses, long *loaded, long *evictions, long *bytes_read) {
+    *hits = JPL_Readahead_hits;
+    *misses = JPL_Readahead_misses;
+    *loaded = JPL_Readahead_loaded;
+    *evictions = JPL_Cache_evictions;
+    *bytes_read = JPL_BytesRead;
+}
 
-    // Read the shape array data about this body, which gives us 3 numbers...
+//! jpl_setCompactEphemeris - Use a compact ephemeris, written by <jpl_writeCompactEphemeris>, in place of DE430.
+//! This must be called before the ephemeris is first used. Queries about bodies or times which are not included in
+//! the compact ephemeris return NaN.
+//! \param [in] filename - The filename of the compact ephemeris
 
-    // Offset of start of Chebyshev coefficient list (FORTRAN numbering starts at 1!)
-    int c = JPL_ShapeData[body_id * 3 + 0];
+void jpl_setCompactEphemeris(const char *filename) {
+    if (JPL_EphemData != NULL) {
+        ephem_warning("The ephemeris file cannot be changed after the ephemeris has been opened.");
+        return;
+    }
+    snprintf(JPL_CompactFilename, FNAME_LENGTH, "%s", filename);
+}
 
-    // Number of Chebyshev coefficients
-    int n = JPL_ShapeData[body_id * 3 + 1];
+//! jpl_init - Make sure that the DE430 data has been loaded, or that we have opened the binary files containing it
 
-    // Number of sub-steps within time step
-    int g = JPL_ShapeData[body_id * 3 + 2];
+static void jpl_init() {
+#pragma omp critical (jpl_init)
+    {
+        // If we haven't already loaded DE430 data, make sure we have done so now
+        if (JPL_EphemFile == NULL) jpl_readAsciiData();
+    }
+}
 
+//! jpl_subinterval - Work out which subinterval of a record of DE430 a time falls within, and its position within it
+//! \param [in] jd - Julian day number; TT
+//! \param [in] t0 - The first JD of the record
+//! \param [in] g - The number of subintervals in the record
+//! \param [out] subinterval - The subinterval which <jd> falls within
+//! \param [out] dt - The length of each subinterval; days
+//! \param [out] tc - The position of <jd> within its subinterval, scaled to range -1 to 1
+
+static void jpl_subinterval(const double jd, const double t0, const int g, int *subinterval, double *dt, double *tc) {
     if (g == 1) {
         // If the time step is not subdivided, then life is very easy...
-        dt = JPL_EphemStep;  // size of whole time step
-        tc = 2 * (jd - t0) / dt - 1; // time position within this step, scaled to range -1 to 1.
+        *subinterval = 0;
+        *dt = JPL_EphemStep;  // size of whole time step
+        *tc = 2 * (jd - t0) / *dt - 1; // time position within this step, scaled to range -1 to 1.
     } else {
         // Work out which subdivision we fall within...
-        dt = JPL_EphemStep / g;  // size of each subdivision
+        *dt = JPL_EphemStep / g;  // size of each subdivision
 
         // Work out which subdivision we fall into, and clamp it within sensible range
-        i = (int) floor((jd - t0) / dt);
+        int i = (int) floor((jd - t0) / *dt);
         if (i >= g) i = g - 1;
         if (i < 0) i = 0;
-
-        // Update the offset of start of Chebyshev coefficient list for this subdivision
-        c += i * 3 * n;
+        *subinterval = i;
 
         // time position within this step, scaled to range -1 to 1.
-        tc = 2 * ((jd - t0) - i * dt) / dt - 1;
-        if (tc < -1) tc = -1;
-        if (tc > 1) tc = 1;
+        *tc = 2 * ((jd - t0) - i * *dt) / *dt - 1;
+        if (*tc < -1) *tc = -1;
+        if (*tc > 1) *tc = 1;
     }
+}
 
-    // Offset within block of coefficients uses FORTRAN numbering
-    double *data_scan = data + (c - 1);
+//! jpl_recordIndex - Work out which record of DE430 a time falls within
+//! \param [in] jd - Julian day number; TT
+//! \return - The number of the record
 
-    // Evaluate the Chebyshev polynomial
-    *x = chebyshev(data_scan, n, tc) / JPL_AU;
-    *y = chebyshev(data_scan + 1 * n, n, tc) / JPL_AU;
-    *z = chebyshev(data_scan + 2 * n, n, tc) / JPL_AU;
+static int jpl_recordIndex(const double jd) {
+    // Work out which block within DE430 this query falls within
+    int record_index = floor((jd - JPL_EphemStart) / JPL_EphemStep);
+
+    // Clip block number within allowed range
+    if (record_index < 0) record_index = 0;
+    if (record_index >= JPL_EphemArrayRecords) record_index = JPL_EphemArrayRecords - 1;
+    return record_index;
+}
+
+//! jpl_findCoefficients - Find the Chebyshev coefficients which describe the position of a body at a particular
+//! time, loading them from disk if necessary. The time must fall within the span of the ephemeris.
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] jd - Julian day number; TT
+//! \param [out] buffer - A buffer of 3 * JPL_MAX_COEFFICIENTS doubles. If records may be evicted from the cache, the
+//! coefficients are copied into this buffer.
+//! \param [out] record_index - The record containing the coefficients
+//! \param [out] subinterval - The subinterval of the record which <jd> falls within
+//! \param [out] t0 - The first JD of the record
+//! \param [out] dt - The length of each subinterval; days
+//! \param [out] tc - The position of <jd> within its subinterval, scaled to range -1 to 1
+//! \return - Pointer to the coefficients for the x coordinate, which are followed by those for y and z
+
+static const double *jpl_findCoefficients(const int body_id, const double jd, double *buffer, int *record_index,
+                                          int *subinterval, double *t0, double *dt, double *tc) {
+    *record_index = jpl_recordIndex(jd);
+
+    // Read the shape array data about this body, which gives us 3 numbers...
+
+    // Offset of start of Chebyshev coefficient list (FORTRAN numbering starts at 1!)
+    const int c0 = JPL_ShapeData[body_id * 3 + 0];
+
+    // Number of Chebyshev coefficients
+    const int n = JPL_ShapeData[body_id * 3 + 1];
+
+    // Number of sub-steps within time step
+    const int g = JPL_ShapeData[body_id * 3 + 2];
+
+    // If records may be evicted from the cache, we copy the coefficients we need into <buffer>
+    const int may_evict = (JPL_CacheSlots < JPL_UnitCount);
+    if (may_evict && (n > JPL_MAX_COEFFICIENTS)) {
+        ephem_fatal(__FILE__, __LINE__, "Too many Chebyshev coefficients in ephemeris.");
+        exit(1);
+    }
+
+    // The unit of data which contains the coefficients we need
+    const int unit_body = JPL_BodyMajor ? body_id : 0;
+    const int unit = unit_body * JPL_EphemArrayRecords + *record_index;
+
+    const double *data_scan;
+    while (1) {
+        if (JPL_EphemData_items_loaded[unit] != JPL_RECORD_LOADED) jpl_fetchRecord(unit);
+
+        // Find the slot holding the unit. If it has been evicted since we fetched it, try again.
+        const int slot = JPL_RecordSlot[unit];
+        if (slot < 0) continue;
+        const unsigned int version = JPL_SlotVersion[slot];
+#pragma omp flush
+        if (version & 1) continue;
+
+        double *data = jpl_slotData(slot);
+
+        // First JD of time step
+        *t0 = JPL_BodyMajor ? JPL_RecordStart[*record_index] : data[0];
+        //double t1 = data[1]; // Last JD of time step
+
+        // Update the offset of start of Chebyshev coefficient list for the subdivision we fall within
+        jpl_subinterval(jd, *t0, g, subinterval, dt, tc);
+        const int c = c0 + *subinterval * 3 * n;
+
+        // Offset within block of coefficients uses FORTRAN numbering
+        data_scan = data + (c - JPL_BodyFirstCoefficient[unit_body]);
+        if (!may_evict) break;
+        if (!JPL_SlotReferenced[slot]) JPL_SlotReferenced[slot] = 1;
+
+        // Copy the coefficients, and check that the slot was not overwritten while we did so
+        memcpy(buffer, data_scan, 3 * n * sizeof(double));
+        data_scan = buffer;
+#pragma omp flush
+        if ((JPL_SlotVersion[slot] == version) && (JPL_SlotRecord[slot] == unit)) break;
+    }
+    return data_scan;
+}
+
+//! jpl_computeState - Evaluate the 3D position, and optionally the velocity, of a solar system body at Julian date
+//! JD (in ICRF v2 as used by DE430)
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] jd - Julian day number; TT
+//! \param [out] x - Cartesian position of body (AU). This axis points away from RA=0.
+//! \param [out] y - Cartesian position of body (AU).
+//! \param [out] z - Cartesian position of body (AU). This axis points towards J2000.0 north celestial pole
+//! \param [out] velocity - If not NULL, the velocity of the body is returned here, from the derivatives of the
+//! Chebyshev polynomials (AU per day)
+
+static void jpl_computeState(int body_id, double jd, double *x, double *y, double *z, double *velocity) {
+    int record_index, subinterval;
+    double coefficients[3 * JPL_MAX_COEFFICIENTS];
+    double t0, dt, tc;
+
+    jpl_init();
+
+    // If this query falls outside the time span of DE430, or asks for a body which is not included in a compact
+    // ephemeris, then reject the query
+    if ((JPL_EphemFile == NULL) || (jd < JPL_EphemStart) || (jd > JPL_EphemEnd) ||
+        (JPL_ShapeData[body_id * 3 + 1] < 1)) {
+        *x = *y = *z = GSL_NAN;
+        if (velocity != NULL) velocity[0] = velocity[1] = velocity[2] = GSL_NAN;
+        return;
+    }
+
+    // Number of Chebyshev coefficients
+    const int n = JPL_ShapeData[body_id * 3 + 1];
+
+    const double *data_scan = jpl_findCoefficients(body_id, jd, coefficients, &record_index, &subinterval,
+                                                   &t0, &dt, &tc);
+
+    // Evaluate the Chebyshev polynomial, skipping any trailing terms which are not needed for the accuracy we need
+    const int terms = (JPL_TermCount != NULL) ? JPL_TermCount[record_index * JPL_BODY_COUNT + body_id] : n;
+    *x = chebyshev((double *) data_scan, terms, tc) / JPL_AU;
+    *y = chebyshev((double *) data_scan + 1 * n, terms, tc) / JPL_AU;
+    *z = chebyshev((double *) data_scan + 2 * n, terms, tc) / JPL_AU;
+
+    // Differentiate the Chebyshev polynomials, converting from rate of change per unit <tc> to per day
+    if (velocity != NULL) {
+        const double scale = 2 / dt / JPL_AU;
+        velocity[0] = chebyshev_derivative((double *) data_scan, n, tc) * scale;
+        velocity[1] = chebyshev_derivative((double *) data_scan + 1 * n, n, tc) * scale;
+        velocity[2] = chebyshev_derivative((double *) data_scan + 2 * n, n, tc) * scale;
+    }
 
     // For diagnostics, it may be useful to print internal state
     // if (DEBUG) {
@@ -628,57 +1235,253 @@ void jpl_computeXYZ(int body_id, double jd, double *x, double *y, double *z) {
     // }
 }
 
-//! jpl_computeEphemeris - Main entry point for estimating the position, brightness, etc of an object at a particular
-//! time, using data from the DE430 ephemeris.
-//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 2=Earth/Moon barycentre. 9=Pluto. 10=Sun, etc
-//! \param [in] jd - The Julian date to query; TT
-//! \param [out] x - x,y,z position of body, in ICRF v2, in AU, relative to solar system barycentre.
-//! \param [out] y - x points to RA=0. y points to RA=6h.
-//! \param [out] z - z points to celestial north pole (i.e. J2000.0).
-//! \param [out] ra - Right ascension of the object (J2000.0, radians, relative to geocentre)
-//! \param [out] dec - Declination of the object (J2000.0, radians, relative to geocentre)
-//! \param [out] mag - Estimated V-band magnitude of the object
-//! \param [out] phase - Phase of the object (0-1)
-//! \param [out] angSize - Angular size of the object (diameter; arcseconds)
-//! \param [out] phySize - Physical size of the object (diameter; metres)
-//! \param [out] albedo - Albedo of the object (0-1)
-//! \param [out] sunDist - Distance of the object from the Sun (AU)
-//! \param [out] earthDist - Distance of the object from the Earth (AU)
-//! \param [out] sunAngDist - Angular distance of the object from the Sun, as seen from the Earth (radians)
-//! \param [out] theta_ESO - Angular distance of the object from the Earth, as seen from the Sun (radians)
-//! \param [out] eclipticLongitude - The ecliptic longitude of the object (J2000.0 radians)
-//! \param [out] eclipticLatitude - The ecliptic latitude of the object (J2000.0 radians)
-//! \param [out] eclipticDistance - The separation of the object from the Sun, in ecliptic longitude (radians)
-//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates to output. Supply 2451545.0 for J2000.0.
-//! \param [in] do_topocentric_correction - Boolean indicating whether to apply topocentric correction to (ra, dec)
-//! \param [in] topocentric_latitude - Latitude (deg) of observer on Earth, if topocentric correction is applied.
-//! \param [in] topocentric_longitude - Longitude (deg) of observer on Earth, if topocentric correction is applied.
+//! jpl_computeXYZ - Evaluate the 3D position of a solar system body at Julian date JD (in ICRF v2 as used by DE430)
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] jd - Julian day number; TT
+//! \param [out] x - Cartesian position of body (AU). This axis points away from RA=0.
+//! \param [out] y - Cartesian position of body (AU).
+//! \param [out] z - Cartesian position of body (AU). This axis points towards J2000.0 north celestial pole
 
-void jpl_computeEphemeris(int bodyId, const double jd, double *x, double *y, double *z, double *ra, double *dec,
-                          double *mag, double *phase, double *angSize, double *phySize, double *albedo, double *sunDist,
-                          double *earthDist, double *sunAngDist, double *theta_ESO, double *eclipticLongitude,
-                          double *eclipticLatitude, double *eclipticDistance, const double ra_dec_epoch,
-                          const int do_topocentric_correction,
-                          const double topocentric_latitude, const double topocentric_longitude) {
-    // Position of the Sun relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
-    double sun_pos_x, sun_pos_y, sun_pos_z;
+void jpl_computeXYZ(int body_id, double jd, double *x, double *y, double *z) {
+    jpl_computeState(body_id, jd, x, y, z, NULL);
+}
 
-    // Position of the Earth-Moon barycentre, relative to the solar system barycentre, AU
-    double EMX, EMY, EMZ;
+//! jpl_computeXYZVelocity - Evaluate the 3D position and velocity of a solar system body at Julian date JD
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] jd - Julian day number; TT
+//! \param [out] x - Cartesian position of body (AU)
+//! \param [out] y - Cartesian position of body (AU)
+//! \param [out] z - Cartesian position of body (AU)
+//! \param [out] velocity - Velocity of body (AU per day)
 
-    // Moon's position relative to the Earth-Moon barycentre, AU
-    double moon_pos_x, moon_pos_y, moon_pos_z;
+void jpl_computeXYZVelocity(int body_id, double jd, double *x, double *y, double *z, double *velocity) {
+    jpl_computeState(body_id, jd, x, y, z, velocity);
+}
 
-    // Earth's position relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
-    double earth_pos_x, earth_pos_y, earth_pos_z;
+//! jpl_computeXYZGrid - Evaluate the 3D positions of a solar system body at many Julian dates. Runs of consecutive
+//! dates which fall within the same subinterval of DE430 are evaluated together, by building a matrix of the
+//! Chebyshev polynomials T_k evaluated at each date, and multiplying it by the coefficients of all three axes with a
+//! single BLAS call. This is much faster than <jpl_computeXYZ> for densely sampled time series, and agrees with it
+//! to within rounding errors.
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] count - The number of Julian dates
+//! \param [in] jd - The Julian day numbers; TT. These should be in time order for best performance.
+//! \param [out] x - Cartesian positions of body (AU)
+//! \param [out] y - Cartesian positions of body (AU)
+//! \param [out] z - Cartesian positions of body (AU)
+
+void jpl_computeXYZGrid(const int body_id, const int count, const double *jd, double *x, double *y, double *z) {
+    double coefficients[3 * JPL_MAX_COEFFICIENTS];
+    double basis[JPL_GRID_CHUNK * JPL_MAX_COEFFICIENTS];
+    double tc[JPL_GRID_CHUNK];
+    double out[JPL_GRID_CHUNK * 3];
+    int i = 0;
+
+    jpl_init();
+
+    while (i < count) {
+        int j, k, m, record_index, subinterval;
+        double t0, dt;
+
+        // Dates outside the ephemeris, and bodies which are unusual, are handed to the usual code path
+        const int n = (JPL_EphemFile != NULL) ? JPL_ShapeData[body_id * 3 + 1] : 0;
+        const int g = (JPL_EphemFile != NULL) ? JPL_ShapeData[body_id * 3 + 2] : 0;
+        if ((n < 1) || (n > JPL_MAX_COEFFICIENTS) || !(jd[i] >= JPL_EphemStart) || (jd[i] > JPL_EphemEnd)) {
+            jpl_computeXYZ(body_id, jd[i], &x[i], &y[i], &z[i]);
+            i++;
+            continue;
+        }
+
+        const double *data_scan = jpl_findCoefficients(body_id, jd[i], coefficients, &record_index, &subinterval,
+                                                       &t0, &dt, &tc[0]);
+
+        // Gather the following dates which fall within the same subinterval
+        for (m = 1; (m < JPL_GRID_CHUNK) && (i + m < count); m++) {
+            int subinterval_m;
+            double dt_m;
+            const double t = jd[i + m];
+            if (!(t >= JPL_EphemStart) || (t > JPL_EphemEnd) || (jpl_recordIndex(t) != record_index)) break;
+            jpl_subinterval(t, t0, g, &subinterval_m, &dt_m, &tc[m]);
+            if (subinterval_m != subinterval) break;
+        }
+
+        // Evaluate the Chebyshev polynomials at each date
+        const int terms = (JPL_TermCount != NULL) ? JPL_TermCount[record_index * JPL_BODY_COUNT + body_id] : n;
+        for (j = 0; j < m; j++) {
+            double *row = basis + j * terms;
+            row[0] = 1;
+            if (terms > 1) row[1] = tc[j];
+            for (k = 2; k < terms; k++) row[k] = 2 * tc[j] * row[k - 1] - row[k - 2];
+        }
+
+        // Multiply the (m x terms) basis matrix by the (terms x 3) matrix of coefficients for the x, y and z axes
+        cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, 3, terms,
+                    1.0, basis, terms, data_scan, n, 0.0, out, 3);
+
+        for (j = 0; j < m; j++) {
+            x[i + j] = out[j * 3 + 0] / JPL_AU;
+            y[i + j] = out[j * 3 + 1] / JPL_AU;
+            z[i + j] = out[j * 3 + 2] / JPL_AU;
+        }
+        i += m;
+    }
+}
+
+//! jpl_ephemerisShape - Return the time span of the ephemeris, and the layout of its Chebyshev coefficients
+//! \param [out] jd_start - The Julian day number of the start of the ephemeris; TT
+//! \param [out] jd_end - The Julian day number of the end of the ephemeris; TT
+//! \param [out] jd_step - The number of days covered by each record
+//! \param [out] record_count - The number of records in the ephemeris
+//! \param [out] shape - The 13x3 shape array. For each body, the second and third entries give the number of
+//! Chebyshev coefficients for each coordinate, and the number of subintervals each record is divided into.
+
+void jpl_ephemerisShape(double *jd_start, double *jd_end, double *jd_step, int *record_count, int *shape) {
+    jpl_init();
+    if (JPL_EphemFile == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Could not open ephemeris.");
+        exit(1);
+    }
+    *jd_start = JPL_EphemStart;
+    *jd_end = JPL_EphemEnd;
+    *jd_step = JPL_EphemStep;
+    *record_count = JPL_EphemArrayRecords;
+    memcpy(shape, JPL_ShapeData, 13 * 3 * sizeof(int));
+}
+
+//! jpl_readCoefficients - Read the Chebyshev coefficients for one body from one record of the ephemeris, straight
+//! from disk, bypassing the cache. The coefficients for each subinterval are stored in turn, with the coefficients
+//! for the x, y and z coordinates (km) following one another within each subinterval.
+//! \param [in] body_id - The body's index within DE430 (0 Sun - 12 Pluto)
+//! \param [in] record_index - The number of the record to read
+//! \param [out] t0 - The Julian day number of the start of the record; TT
+//! \param [out] coefficients - Buffer in which to return the coefficients. Its length must be 3 * n * g, where n and g
+//! are the number of coefficients and the number of subintervals given in the shape array.
+
+void jpl_readCoefficients(const int body_id, const int record_index, double *t0, double *coefficients) {
+    jpl_init();
+    const int c0 = JPL_ShapeData[body_id * 3 + 0];
+    const int length = 3 * JPL_ShapeData[body_id * 3 + 1] * JPL_ShapeData[body_id * 3 + 2];
+
+#pragma omp critical (jpl_fetch)
+    {
+        if (JPL_BodyMajor) {
+            fseek(JPL_EphemFile, JPL_BodyFileOffset[body_id] + record_index * (long) length * sizeof(double),
+                  SEEK_SET);
+            dcf_fread((void *) coefficients, sizeof(double), length, JPL_EphemFile, jpl_ephem_filename,
+                      __FILE__, __LINE__);
+            *t0 = JPL_RecordStart[record_index];
+        } else {
+            const long record_length = JPL_EphemArrayLen * (long) sizeof(double);
+            const long record_position = JPL_BodyFileOffset[0] + record_index * record_length;
+            fseek(JPL_EphemFile, record_position, SEEK_SET);
+            dcf_fread((void *) t0, sizeof(double), 1, JPL_EphemFile, jpl_ephem_filename, __FILE__, __LINE__);
+            fseek(JPL_EphemFile, record_position + (c0 - 1) * (long) sizeof(double), SEEK_SET);
+            dcf_fread((void *) coefficients, sizeof(double), length, JPL_EphemFile, jpl_ephem_filename,
+                      __FILE__, __LINE__);
+        }
+        JPL_BytesRead += length * (long) sizeof(double);
+    }
+}
+
+//! jpl_writeCompactEphemeris - Write an ephemeris in the layout of <data/dcfbinary_bodies.430>, which can be used in
+//! place of DE430 by calling <jpl_setCompactEphemeris>. It must cover a whole number of records of DE430, and its
+//! bodies may have different numbers of Chebyshev coefficients and subintervals to DE430.
+//! \param [in] filename - The filename to write the ephemeris to
+//! \param [in] jd_start - The Julian day number of the start of the ephemeris; TT. Must be the start of a record.
+//! \param [in] record_count - The number of records in the ephemeris
+//! \param [in] shape - The 13x3 shape array, giving the number of coefficients and subintervals for each body. The
+//! number of coefficients should be zero for bodies which are not included.
+//! \param [in] record_start - The Julian day number of the start of each record; TT
+//! \param [in] body_coefficients - For each body, the coefficients for each record in turn, in the order described
+//! in <jpl_readCoefficients>
+//! \return - Zero on success
+
+int jpl_writeCompactEphemeris(const char *filename, const double jd_start, const int record_count, const int *shape,
+                              const double *record_start, double *const *body_coefficients) {
+    long body_offset[JPL_BODY_COUNT];
+    int body_length[JPL_BODY_COUNT];
+    int i;
+
+    jpl_init();
+    FILE *output = fopen(filename, "wb");
+    if (output == NULL) return 1;
+
+    double jd_end = jd_start + record_count * JPL_EphemStep;
+    if (jd_end > JPL_EphemEnd) jd_end = JPL_EphemEnd;
+
+    jpl_writeBodyMajorHeader(output, jd_start, jd_end, record_count, shape, body_offset, body_length);
+    fwrite((void *) record_start, sizeof(double), record_count, output);
+    for (i = 0; i < JPL_BODY_COUNT; i++) {
+        if (body_length[i] > 0) {
+            fwrite((void *) body_coefficients[i], sizeof(double), (size_t) record_count * body_length[i], output);
+        }
+    }
+
+    const int failed = ferror(output);
+    fclose(output);
+    return failed;
+}
+
+//! jpl_correctAberration - Correct the position of an object for annual aberration, using equation (7.118) of the
+//! Explanatory Supplement, with the Earth's velocity vector estimated from its position a short time after the time
+//! of observation (see eqn 7.119 of the Explanatory Supplement).
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [in|out] x - x,y,z position of body, relative to solar system barycentre, AU
+//! \param [in|out] y - y position of body
+//! \param [in|out] z - z position of body
+
+void jpl_correctAberration(const orbitalElementsEpochState *state, double *x, double *y, double *z) {
+    const double earth_pos_x = state->earth_pos[0];
+    const double earth_pos_y = state->earth_pos[1];
+    const double earth_pos_z = state->earth_pos[2];
+
+    const double eb_dot_timestep_sec = ORBIT_EARTH_VELOCITY_TIMESTEP * 86400;
+    const double u1[3] = {
+            *x - earth_pos_x,
+            *y - earth_pos_y,
+            *z - earth_pos_z
+    };
+    const double u1_mag = gsl_hypot3(u1[0], u1[1], u1[2]);
+    const double u[3] = {u1[0] / u1_mag, u1[1] / u1_mag, u1[2] / u1_mag};
+    const double eb_dot[3] = {
+            state->earth_pos_future[0] - earth_pos_x,
+            state->earth_pos_future[1] - earth_pos_y,
+            state->earth_pos_future[2] - earth_pos_z
+    };
+
+    // Speed of light in AU per time step
+    const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * eb_dot_timestep_sec;
+    const double V[3] = {eb_dot[0] / c, eb_dot[1] / c, eb_dot[2] / c};
+    const double V_mag = gsl_hypot3(V[0], V[1], V[2]);
+    const double beta = sqrt(1 - gsl_pow_2(V_mag));
+    const double f1 = u[0] * V[0] + u[1] * V[1] + u[2] * V[2];
+    const double f2 = 1 + f1 / (1 + beta);
+
+    // Correct for aberration
+    *x = earth_pos_x + (beta * u1[0] + f2 * u1_mag * V[0]) / (1 + f1);
+    *y = earth_pos_y + (beta * u1[1] + f2 * u1_mag * V[1]) / (1 + f1);
+    *z = earth_pos_z + (beta * u1[2] + f2 * u1_mag * V[2]) / (1 + f1);
+}
+
+//! jpl_computePositionAtEpoch - Compute the apparent position of an object, corrected for light travel time and
+//! aberration, using data from the DE430 ephemeris, given the positions of the Earth and Sun which have already been
+//! computed for the time of observation. This is the first step of <jpl_computeEphemerisAtEpoch>, for callers which
+//! need only the position of the object, and not its brightness, RA or Dec.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 9=Moon. 10=Sun. 19=Earth, etc
+//! \param [in] state - The positions of the Earth and Sun at the time of observation, from
+//! orbitalElements_computeEpochState
+//! \param [out] x - x,y,z position of body, in ICRF v2, in AU, relative to solar system barycentre. NaN if the
+//! object is not known.
+//! \param [out] y - x points to RA=0. y points to RA=6h.
+//! \param [out] z - z points to celestial north pole (i.e. J2000.0).
+
+void jpl_computePositionAtEpoch(int bodyId, const orbitalElementsEpochState *state, double *x, double *y,
+                                double *z) {
+    const double jd = state->jd;
 
     // Boolean flags indicating whether this is the Earth, Sun or Moon (which need special treatment)
     int is_moon = 0, is_earth = 0, is_sun = 0;
 
-    double EMX_future, EMY_future, EMZ_future; // Position of the Earth-Moon centre of mass
-    double moon_pos_x_future, moon_pos_y_future, moon_pos_z_future;
-    double earth_pos_x_future, earth_pos_y_future, earth_pos_z_future;
-
     // Body 19 is the Earth.
     // DE430 gives us the Earth/Moon barycentre (body 2), from which we subtract a small fraction of the Moon's
     // offset (body 9) to get the Earth's centre of mass
@@ -700,51 +1503,20 @@ void jpl_computeEphemeris(int bodyId, const double jd, double *x, double *y, dou
 
     // We give asteroids body numbers which start at 1e7 + 1 (Ceres). These aren't in DE430, so use orbital elements.
     if (bodyId > 10000000) {
-        orbitalElements_computeEphemeris(bodyId, jd, x, y, z, ra, dec, mag, phase, angSize, phySize, albedo, sunDist,
-                                         earthDist, sunAngDist, theta_ESO, eclipticLongitude, eclipticLatitude,
-                                         eclipticDistance, ra_dec_epoch,
-                                         do_topocentric_correction, topocentric_latitude, topocentric_longitude);
+        orbitalElements_computePositionAtEpoch(bodyId, state, x, y, z);
         return;
     }
 
     // If we've got a query for a body which isn't in DE430, then we can't proceed
     if ((bodyId < 0) || (bodyId > 10)) {
-        *x = *y = *z = *ra = *dec = GSL_NAN;
+        *x = *y = *z = GSL_NAN;
         return;
     }
 
-    // DE430 gives us XYZ coordinates relative to the solar system's centre of mass
-    // We need to know the Earth's position, in order to convert this to RA and Dec
-    // Below are values of GM3 and GMM from DE405. See
-    // <https://web.archive.org/web/20120220062549/http://iau-comm4.jpl.nasa.gov/de405iom/de405iom.pdf>
-    const double earth_mass = 0.8887692390113509e-9;
-    const double moon_mass = 0.1093189565989898e-10;
-    const double moon_earth_mass_ratio = moon_mass / (moon_mass + earth_mass);
-
-    // Look up the Earth-Moon centre of mass position
-    jpl_computeXYZ(2, jd, &EMX, &EMY, &EMZ);
-
-    // Look up the Moon's position relative to the E-M centre of mass
-    jpl_computeXYZ(9, jd, &moon_pos_x, &moon_pos_y, &moon_pos_z);
-
-    // Calculate the position of the Earth's centre of mass
-    earth_pos_x = EMX - moon_earth_mass_ratio * moon_pos_x;
-    earth_pos_y = EMY - moon_earth_mass_ratio * moon_pos_y;
-    earth_pos_z = EMZ - moon_earth_mass_ratio * moon_pos_z;
-
-    // Look up the Sun's position, taking light travel time into account
-    {
-        jpl_computeXYZ(10, jd, &sun_pos_x, &sun_pos_y, &sun_pos_z);
-
-        // Calculate light travel time
-        const double distance = gsl_hypot3(sun_pos_x - earth_pos_x,
-                                           sun_pos_y - earth_pos_y,
-                                           sun_pos_z - earth_pos_z);  // AU
-        const double light_travel_time = distance * GSL_CONST_MKSA_ASTRONOMICAL_UNIT / GSL_CONST_MKSA_SPEED_OF_LIGHT;
-
-        // Look up position of requested object at the time the light left the object
-        jpl_computeXYZ(10, jd - light_travel_time / 86400, &sun_pos_x, &sun_pos_y, &sun_pos_z);
-    }
+    // Earth's position relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
+    const double earth_pos_x = state->earth_pos[0];
+    const double earth_pos_y = state->earth_pos[1];
+    const double earth_pos_z = state->earth_pos[2];
 
     // If the user's query was about the Earth, we already know its position
     if (is_earth) {
@@ -755,16 +1527,16 @@ void jpl_computeEphemeris(int bodyId, const double jd, double *x, double *y, dou
 
         // If the user's query was about the Sun, we already know that position too
     else if (is_sun) {
-        *x = sun_pos_x;
-        *y = sun_pos_y;
-        *z = sun_pos_z;
+        *x = state->sun_pos[0];
+        *y = state->sun_pos[1];
+        *z = state->sun_pos[2];
     }
 
         // If the user's query was about the Moon, we already know that position too
     else if (is_moon) {
-        *x = moon_pos_x + earth_pos_x;
-        *y = moon_pos_y + earth_pos_y;
-        *z = moon_pos_z + earth_pos_z;
+        *x = state->moon_pos[0] + earth_pos_x;
+        *y = state->moon_pos[1] + earth_pos_y;
+        *z = state->moon_pos[2] + earth_pos_z;
     }
 
         // Otherwise we need to query DE430 for the particular object the user was looking for,
@@ -781,50 +1553,360 @@ void jpl_computeEphemeris(int bodyId, const double jd, double *x, double *y, dou
         jpl_computeXYZ(bodyId, jd - light_travel_time / 86400, x, y, z);
     }
 
-    // Look up the Earth-Moon centre of mass position, a short time in the future
-    // We use this to calculate the Earth's velocity vector, which is needed to correct for aberration
-    // (see eqn 7.119 of the Explanatory Supplement)
-    const double eb_dot_timestep = 1e-6; // days
-    const double eb_dot_timestep_sec = eb_dot_timestep * 86400;
-    jpl_computeXYZ(2, jd + eb_dot_timestep, &EMX_future, &EMY_future, &EMZ_future);
-    jpl_computeXYZ(9, jd + eb_dot_timestep, &moon_pos_x_future, &moon_pos_y_future, &moon_pos_z_future);
-    earth_pos_x_future = EMX_future - moon_earth_mass_ratio * moon_pos_x_future;
-    earth_pos_y_future = EMY_future - moon_earth_mass_ratio * moon_pos_y_future;
-    earth_pos_z_future = EMZ_future - moon_earth_mass_ratio * moon_pos_z_future;
-
-    // Equation (7.118) of the Explanatory Supplement - correct for aberration
-    if (!is_earth) {
-        const double u1[3] = {
-                *x - earth_pos_x,
-                *y - earth_pos_y,
-                *z - earth_pos_z
-        };
-        const double u1_mag = gsl_hypot3(u1[0], u1[1], u1[2]);
-        const double u[3] = {u1[0] / u1_mag, u1[1] / u1_mag, u1[2] / u1_mag};
-        const double eb_dot[3] = {
-                earth_pos_x_future - earth_pos_x,
-                earth_pos_y_future - earth_pos_y,
-                earth_pos_z_future - earth_pos_z
-        };
-
-        // Speed of light in AU per time step
-        const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * eb_dot_timestep_sec;
-        const double V[3] = {eb_dot[0] / c, eb_dot[1] / c, eb_dot[2] / c};
-        const double V_mag = gsl_hypot3(V[0], V[1], V[2]);
-        const double beta = sqrt(1 - gsl_pow_2(V_mag));
-        const double f1 = u[0] * V[0] + u[1] * V[1] + u[2] * V[2];
-        const double f2 = 1 + f1 / (1 + beta);
-
-        // Correct for aberration
-        *x = earth_pos_x + (beta * u1[0] + f2 * u1_mag * V[0]) / (1 + f1);
-        *y = earth_pos_y + (beta * u1[1] + f2 * u1_mag * V[1]) / (1 + f1);
-        *z = earth_pos_z + (beta * u1[2] + f2 * u1_mag * V[2]) / (1 + f1);
+    // Correct for aberration, using the Earth's velocity vector
+    if (!is_earth) jpl_correctAberration(state, x, y, z);
+}
+
+//! jpl_computeEphemerisAtEpoch - Estimate the position, brightness, etc of an object, using data from the DE430
+//! ephemeris, given the positions of the Earth and Sun which have already been computed for the time of observation.
+//! When computing the positions of many objects at the same time, this avoids looking up the Earth and Sun each time.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 2=Earth/Moon barycentre. 9=Pluto. 10=Sun, etc
+//! \param [in] state - The positions of the Earth and Sun at the time of observation, from
+//! orbitalElements_computeEpochState
+//! \param [out] x - x,y,z position of body, in ICRF v2, in AU, relative to solar system barycentre.
+//! \param [out] y - x points to RA=0. y points to RA=6h.
+//! \param [out] z - z points to celestial north pole (i.e. J2000.0).
+//! \param [out] ra - Right ascension of the object (J2000.0, radians, relative to geocentre)
+//! \param [out] dec - Declination of the object (J2000.0, radians, relative to geocentre)
+//! \param [out] mag - Estimated V-band magnitude of the object
+//! \param [out] phase - Phase of the object (0-1)
+//! \param [out] angSize - Angular size of the object (diameter; arcseconds)
+//! \param [out] phySize - Physical size of the object (diameter; metres)
+//! \param [out] albedo - Albedo of the object (0-1)
+//! \param [out] sunDist - Distance of the object from the Sun (AU)
+//! \param [out] earthDist - Distance of the object from the Earth (AU)
+//! \param [out] sunAngDist - Angular distance of the object from the Sun, as seen from the Earth (radians)
+//! \param [out] theta_ESO - Angular distance of the object from the Earth, as seen from the Sun (radians)
+//! \param [out] eclipticLongitude - The ecliptic longitude of the object (J2000.0 radians)
+//! \param [out] eclipticLatitude - The ecliptic latitude of the object (J2000.0 radians)
+//! \param [out] eclipticDistance - The separation of the object from the Sun, in ecliptic longitude (radians)
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates to output. Supply 2451545.0 for J2000.0.
+//! \param [in] do_topocentric_correction - Boolean indicating whether to apply topocentric correction to (ra, dec)
+//! \param [in] topocentric_latitude - Latitude (deg) of observer on Earth, if topocentric correction is applied.
+//! \param [in] topocentric_longitude - Longitude (deg) of observer on Earth, if topocentric correction is applied.
+
+void jpl_computeEphemerisAtEpoch(int bodyId, const orbitalElementsEpochState *state, double *x, double *y,
+                                 double *z, double *ra, double *dec, double *mag, double *phase, double *angSize,
+                                 double *phySize, double *albedo, double *sunDist, double *earthDist,
+                                 double *sunAngDist, double *theta_ESO, double *eclipticLongitude,
+                                 double *eclipticLatitude, double *eclipticDistance, const double ra_dec_epoch,
+                                 const int do_topocentric_correction,
+                                 const double topocentric_latitude, const double topocentric_longitude) {
+    // We give asteroids body numbers which start at 1e7 + 1 (Ceres). These aren't in DE430, so use orbital elements.
+    if (bodyId > 10000000) {
+        orbitalElements_computeEphemerisAtEpoch(bodyId, state, x, y, z, ra, dec, mag, phase, angSize, phySize,
+                                                albedo, sunDist, earthDist, sunAngDist, theta_ESO, eclipticLongitude,
+                                                eclipticLatitude, eclipticDistance, ra_dec_epoch,
+                                                do_topocentric_correction, topocentric_latitude,
+                                                topocentric_longitude);
+        return;
+    }
+
+    // Compute the apparent position of the object
+    jpl_computePositionAtEpoch(bodyId, state, x, y, z);
+
+    // If we've got a query for a body which isn't in DE430, then we can't proceed
+    if ((bodyId < 0) || ((bodyId > 10) && (bodyId != 19))) {
+        *ra = *dec = GSL_NAN;
+        return;
     }
 
+    // The Earth's magnitude is computed for the Earth/Moon barycentre's ID number
+    if (bodyId == 19) bodyId = 2;
+
     // Populate other quantities, like the brightness, RA and Dec of the object, based on its XYZ position
-    magnitudeEstimate(bodyId, *x, *y, *z, earth_pos_x, earth_pos_y, earth_pos_z, sun_pos_x, sun_pos_y, sun_pos_z, ra,
+    magnitudeEstimate(bodyId, *x, *y, *z, state->earth_pos[0], state->earth_pos[1], state->earth_pos[2],
+                      state->sun_pos[0], state->sun_pos[1], state->sun_pos[2], ra,
                       dec, mag, phase, angSize, phySize,
                       albedo, sunDist, earthDist, sunAngDist, theta_ESO, eclipticLongitude, eclipticLatitude,
-                      eclipticDistance, ra_dec_epoch, jd,
+                      eclipticDistance, ra_dec_epoch, state->jd,
                       do_topocentric_correction, topocentric_latitude, topocentric_longitude);
 }
+
+//! jpl_computeEphemeris - Main entry point for estimating the position, brightness, etc of an object at a particular
+//! time, using data from the DE430 ephemeris.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 2=Earth/Moon barycentre. 9=Pluto. 10=Sun, etc
+//! \param [in] jd - The Julian date to query; TT
+//! \param [out] x - x,y,z position of body, in ICRF v2, in AU, relative to solar system barycentre.
+//! \param [out] y - x points to RA=0. y points to RA=6h.
+//! \param [out] z - z points to celestial north pole (i.e. J2000.0).
+//! \param [out] ra - Right ascension of the object (J2000.0, radians, relative to geocentre)
+//! \param [out] dec - Declination of the object (J2000.0, radians, relative to geocentre)
+//! \param [out] mag - Estimated V-band magnitude of the object
+//! \param [out] phase - Phase of the object (0-1)
+//! \param [out] angSize - Angular size of the object (diameter; arcseconds)
+//! \param [out] phySize - Physical size of the object (diameter; metres)
+//! \param [out] albedo - Albedo of the object (0-1)
+//! \param [out] sunDist - Distance of the object from the Sun (AU)
+//! \param [out] earthDist - Distance of the object from the Earth (AU)
+//! \param [out] sunAngDist - Angular distance of the object from the Sun, as seen from the Earth (radians)
+//! \param [out] theta_ESO - Angular distance of the object from the Earth, as seen from the Sun (radians)
+//! \param [out] eclipticLongitude - The ecliptic longitude of the object (J2000.0 radians)
+//! \param [out] eclipticLatitude - The ecliptic latitude of the object (J2000.0 radians)
+//! \param [out] eclipticDistance - The separation of the object from the Sun, in ecliptic longitude (radians)
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates to output. Supply 2451545.0 for J2000.0.
+//! \param [in] do_topocentric_correction - Boolean indicating whether to apply topocentric correction to (ra, dec)
+//! \param [in] topocentric_latitude - Latitude (deg) of observer on Earth, if topocentric correction is applied.
+//! \param [in] topocentric_longitude - Longitude (deg) of observer on Earth, if topocentric correction is applied.
+
+void jpl_computeEphemeris(int bodyId, const double jd, double *x, double *y, double *z, double *ra, double *dec,
+                          double *mag, double *phase, double *angSize, double *phySize, double *albedo, double *sunDist,
+                          double *earthDist, double *sunAngDist, double *theta_ESO, double *eclipticLongitude,
+                          double *eclipticLatitude, double *eclipticDistance, const double ra_dec_epoch,
+                          const int do_topocentric_correction,
+                          const double topocentric_latitude, const double topocentric_longitude) {
+    // Asteroids and comets are handled entirely by orbitalElements, which looks up the Earth and Sun itself
+    if (bodyId > 10000000) {
+        orbitalElements_computeEphemeris(bodyId, jd, x, y, z, ra, dec, mag, phase, angSize, phySize, albedo, sunDist,
+                                         earthDist, sunAngDist, theta_ESO, eclipticLongitude, eclipticLatitude,
+                                         eclipticDistance, ra_dec_epoch,
+                                         do_topocentric_correction, topocentric_latitude, topocentric_longitude);
+        return;
+    }
+
+    orbitalElementsEpochState state;
+    orbitalElements_computeEpochState(jd, &state);
+    jpl_computeEphemerisAtEpoch(bodyId, &state, x, y, z, ra, dec, mag, phase, angSize, phySize, albedo, sunDist,
+                                earthDist, sunAngDist, theta_ESO, eclipticLongitude, eclipticLatitude,
+                                eclipticDistance, ra_dec_epoch,
+                                do_topocentric_correction, topocentric_latitude, topocentric_longitude);
+}
+
+//! jpl_motionOfEarthAndSun - Compute the velocities of the Earth's centre of mass and of the Moon, and of the Sun at
+//! the time the light we see left it, which are needed to compute the rates of change of apparent positions
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [out] earth_vel - Velocity of the Earth's centre of mass, relative to the solar system barycentre; AU/day
+//! \param [out] moon_vel - Velocity of the Moon relative to the Earth; AU per day
+//! \param [out] sun_vel - Velocity of the Sun, relative to the solar system barycentre; AU per day
+
+static void jpl_motionOfEarthAndSun(const orbitalElementsEpochState *state, double *earth_vel, double *moon_vel,
+                                    double *sun_vel) {
+    const double moon_earth_mass_ratio = ORBIT_MOON_MASS / (ORBIT_MOON_MASS + ORBIT_EARTH_MASS);
+    const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * 86400;  // AU per day
+    double tmp[3], emb_vel[3];
+    int i;
+
+    // Velocity of the Earth's centre of mass
+    jpl_computeXYZVelocity(2, state->jd, &tmp[0], &tmp[1], &tmp[2], emb_vel);
+    jpl_computeXYZVelocity(9, state->jd, &tmp[0], &tmp[1], &tmp[2], moon_vel);
+    for (i = 0; i < 3; i++) earth_vel[i] = emb_vel[i] - moon_earth_mass_ratio * moon_vel[i];
+
+    // Velocity of the Sun, at the time the light we see left it
+    const double distance = gsl_hypot3(state->sun_pos[0] - state->earth_pos[0],
+                                       state->sun_pos[1] - state->earth_pos[1],
+                                       state->sun_pos[2] - state->earth_pos[2]);  // AU
+    jpl_computeXYZVelocity(10, state->jd - distance / c, &tmp[0], &tmp[1], &tmp[2], sun_vel);
+}
+
+//! jpl_motionOfObject - Compute the position and velocity of an object at the time the light we see left it, in the
+//! same way as <jpl_computeEphemerisAtEpoch> and <orbitalElements_computeEphemerisAtEpoch>
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 9=Moon. 10=Sun, etc. Not the Earth.
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [in] use_orbital_elements - Boolean indicating whether the positions of the planets are computed from
+//! orbital elements rather than DE430
+//! \param [in] earth_vel - The velocity of the Earth's centre of mass, from <jpl_motionOfEarthAndSun>
+//! \param [in] moon_vel - The velocity of the Moon relative to the Earth, from <jpl_motionOfEarthAndSun>
+//! \param [in] sun_vel - The velocity of the Sun, from <jpl_motionOfEarthAndSun>
+//! \param [out] pos - The position of the object, relative to the solar system barycentre; AU
+//! \param [out] vel - The velocity of the object, relative to the solar system barycentre; AU per day
+//! \return - Boolean indicating whether the object is known
+
+static int jpl_motionOfObject(const int bodyId, const orbitalElementsEpochState *state,
+                              const int use_orbital_elements, const double *earth_vel, const double *moon_vel,
+                              const double *sun_vel, double *pos, double *vel) {
+    const double jd = state->jd;
+    const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * 86400;  // AU per day
+    double tmp[3];
+    int i;
+
+    if (bodyId == 10) {
+        for (i = 0; i < 3; i++) {
+            pos[i] = state->sun_pos[i];
+            vel[i] = sun_vel[i];
+        }
+    } else if (bodyId == 9) {
+        for (i = 0; i < 3; i++) {
+            pos[i] = state->moon_pos[i] + state->earth_pos[i];
+            vel[i] = moon_vel[i] + earth_vel[i];
+        }
+    } else if ((bodyId > 10000000) || use_orbital_elements) {
+        double helio_vel[3];
+        orbitalElements_computeXYZ(bodyId, jd, &tmp[0], &tmp[1], &tmp[2]);
+        const double distance = gsl_hypot3(tmp[0] + state->sun_pos[0] - state->earth_pos[0],
+                                           tmp[1] + state->sun_pos[1] - state->earth_pos[1],
+                                           tmp[2] + state->sun_pos[2] - state->earth_pos[2]);  // AU
+        orbitalElements_computeXYZVelocity(bodyId, jd - distance / c, &tmp[0], &tmp[1], &tmp[2], helio_vel);
+        for (i = 0; i < 3; i++) {
+            pos[i] = tmp[i] + state->sun_pos[i];
+            vel[i] = helio_vel[i] + sun_vel[i];
+        }
+    } else if ((bodyId >= 0) && (bodyId < 10)) {
+        jpl_computeXYZ(bodyId, jd, &tmp[0], &tmp[1], &tmp[2]);
+        const double distance = gsl_hypot3(tmp[0] - state->earth_pos[0],
+                                           tmp[1] - state->earth_pos[1],
+                                           tmp[2] - state->earth_pos[2]);  // AU
+        jpl_computeXYZVelocity(bodyId, jd - distance / c, &pos[0], &pos[1], &pos[2], vel);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+//! jpl_computeVelocityAtEpoch - Compute the rate of change of the apparent position of an object, as returned by
+//! <jpl_computePositionAtEpoch>. This is the velocity of the object when the light we see left it, scaled by the rate
+//! at which the light travel time changes. The slow change in the correction for aberration is neglected.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 9=Moon. 10=Sun. 19=Earth, etc
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [in] use_orbital_elements - Boolean indicating whether the positions of the planets are computed from
+//! orbital elements rather than DE430
+//! \param [out] velocity - The rate of change of the apparent position; AU per day, ICRF. NaN if not known.
+
+void jpl_computeVelocityAtEpoch(int bodyId, const orbitalElementsEpochState *state, const int use_orbital_elements,
+                                double *velocity) {
+    const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * 86400;  // AU per day
+    double pos[3], vel[3], earth_vel[3], moon_vel[3], sun_vel[3];
+    int i;
+
+    jpl_motionOfEarthAndSun(state, earth_vel, moon_vel, sun_vel);
+
+    // The Earth is not corrected for light travel time
+    if (bodyId == 19) {
+        for (i = 0; i < 3; i++) velocity[i] = earth_vel[i];
+        return;
+    }
+
+    if (!jpl_motionOfObject(bodyId, state, use_orbital_elements, earth_vel, moon_vel, sun_vel, pos, vel)) {
+        velocity[0] = velocity[1] = velocity[2] = GSL_NAN;
+        return;
+    }
+
+    // We see the object's velocity scaled by (1 - d(distance)/dt / c), as in <jpl_computeRatesAtEpoch>
+    const double rel[3] = {pos[0] - state->earth_pos[0], pos[1] - state->earth_pos[1], pos[2] - state->earth_pos[2]};
+    const double distance = gsl_hypot3(rel[0], rel[1], rel[2]);
+    const double u_dot_vel = (rel[0] * vel[0] + rel[1] * vel[1] + rel[2] * vel[2]) / distance;
+    const double u_dot_earth_vel = (rel[0] * earth_vel[0] + rel[1] * earth_vel[1] + rel[2] * earth_vel[2]) / distance;
+    const double distance_rate = (u_dot_vel - u_dot_earth_vel) / (1 + u_dot_vel / c);
+    for (i = 0; i < 3; i++) velocity[i] = vel[i] * (1 - distance_rate / c);
+}
+
+//! jpl_computeRatesAtEpoch - Compute the rates of change of the RA, Dec and distance of an object as seen by an
+//! observer, and of its distance from the Sun. These are computed analytically from the velocities of the object and
+//! observer, rather than by differencing positions at two times.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 9=Moon. 10=Sun. 19=Earth, etc
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [in] use_orbital_elements - Boolean indicating whether the positions of the planets are computed from
+//! orbital elements (as by <orbitalElements_computeEphemeris>) rather than DE430
+//! \param [in] topocentric_offset - The position of the observer relative to the geocentre; AU, J2000.0
+//! \param [out] ra_rate - Rate of change of the object's right ascension (J2000.0; radians per day). This is the
+//! rate of change of the coordinate, not multiplied by cos(dec).
+//! \param [out] dec_rate - Rate of change of the object's declination (J2000.0; radians per day)
+//! \param [out] earth_dist_rate - Rate of change of the object's distance from the observer, positive when receding
+//! (AU per day)
+//! \param [out] sun_dist_rate - Rate of change of the object's distance from the Sun (AU per day)
+
+void jpl_computeRatesAtEpoch(int bodyId, const orbitalElementsEpochState *state, const int use_orbital_elements,
+                             const double *topocentric_offset, double *ra_rate, double *dec_rate,
+                             double *earth_dist_rate, double *sun_dist_rate) {
+    const double jd = state->jd;
+    const double c = GSL_CONST_MKSA_SPEED_OF_LIGHT / GSL_CONST_MKSA_ASTRONOMICAL_UNIT * 86400;  // AU per day
+    const double earth_rotation = 2 * M_PI * 1.00273781191135448;  // radians per day (sidereal)
+    double pos[3], vel[3], moon_vel[3], earth_vel[3], earth_acc[3], sun_vel[3];
+    double obs_pos[3], obs_vel[3];
+    int i;
+
+    *ra_rate = *dec_rate = *earth_dist_rate = *sun_dist_rate = GSL_NAN;
+
+    // The rates of the observer's own position are not defined
+    if (bodyId == 19) return;
+
+    // Velocities of the Earth's centre of mass, the Moon and the Sun
+    jpl_motionOfEarthAndSun(state, earth_vel, moon_vel, sun_vel);
+
+    // Acceleration of the Earth's centre of mass, due to the gravity of the Sun and Moon; AU per day squared
+    {
+        const double gm_sun = 0.2959122082855911e-3;  // AU^3 per day^2 (DE405)
+        const double sun_dist_3 = gsl_pow_3(gsl_hypot3(state->sun_pos[0] - state->earth_pos[0],
+                                                       state->sun_pos[1] - state->earth_pos[1],
+                                                       state->sun_pos[2] - state->earth_pos[2]));
+        const double moon_dist_3 = gsl_pow_3(gsl_hypot3(state->moon_pos[0], state->moon_pos[1], state->moon_pos[2]));
+        for (i = 0; i < 3; i++) {
+            earth_acc[i] = gm_sun * (state->sun_pos[i] - state->earth_pos[i]) / sun_dist_3 +
+                           ORBIT_MOON_MASS * state->moon_pos[i] / moon_dist_3;
+        }
+    }
+
+    // Position and velocity of the observer, including the Earth's rotation
+    for (i = 0; i < 3; i++) {
+        obs_pos[i] = state->earth_pos[i] + topocentric_offset[i];
+        obs_vel[i] = earth_vel[i];
+    }
+
+    // The observer rotates about the celestial pole of date, which we find as the normal to two points on the
+    // celestial equator of date, converted into J2000.0
+    {
+        double ra_0, dec_0, ra_1, dec_1;
+        ra_dec_to_j2000(0, 0, jd, &ra_0, &dec_0);
+        ra_dec_to_j2000(M_PI / 2, 0, jd, &ra_1, &dec_1);
+        const double e0[3] = {cos(dec_0) * cos(ra_0), cos(dec_0) * sin(ra_0), sin(dec_0)};
+        const double e1[3] = {cos(dec_1) * cos(ra_1), cos(dec_1) * sin(ra_1), sin(dec_1)};
+        double pole[3] = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+        const double pole_mag = gsl_hypot3(pole[0], pole[1], pole[2]);
+        for (i = 0; i < 3; i++) pole[i] *= earth_rotation / pole_mag;
+
+        obs_vel[0] += pole[1] * topocentric_offset[2] - pole[2] * topocentric_offset[1];
+        obs_vel[1] += pole[2] * topocentric_offset[0] - pole[0] * topocentric_offset[2];
+        obs_vel[2] += pole[0] * topocentric_offset[1] - pole[1] * topocentric_offset[0];
+    }
+
+    // Position and velocity of the object, allowing for light travel time
+    if (!jpl_motionOfObject(bodyId, state, use_orbital_elements, earth_vel, moon_vel, sun_vel, pos, vel)) return;
+
+    // Rate of change of distance from the observer. The light travel time changes as the object recedes, so we see
+    // its velocity scaled by (1 - d(distance)/dt / c).
+    const double rel[3] = {pos[0] - obs_pos[0], pos[1] - obs_pos[1], pos[2] - obs_pos[2]};
+    const double distance = gsl_hypot3(rel[0], rel[1], rel[2]);
+    const double u_dot_vel = (rel[0] * vel[0] + rel[1] * vel[1] + rel[2] * vel[2]) / distance;
+    const double u_dot_obs_vel = (rel[0] * obs_vel[0] + rel[1] * obs_vel[1] + rel[2] * obs_vel[2]) / distance;
+    *earth_dist_rate = (u_dot_vel - u_dot_obs_vel) / (1 + u_dot_vel / c);
+
+    // Rates of change of RA and Dec. The apparent direction of the object is displaced by aberration, using the
+    // velocity of the geocentre, as in <jpl_correctAberration>. To first order, the apparent direction is
+    // u' = u + V/c - (u.V/c) u, whose rate of change perpendicular to u is u_dot (1 - u.V/c) + (A - (u.A) u) / c,
+    // where A is the acceleration of the geocentre.
+    {
+        const double f = 1 - *earth_dist_rate / c;
+        const double u[3] = {rel[0] / distance, rel[1] / distance, rel[2] / distance};
+        const double u_dot_earth_vel = u[0] * earth_vel[0] + u[1] * earth_vel[1] + u[2] * earth_vel[2];
+        const double u_dot_earth_acc = u[0] * earth_acc[0] + u[1] * earth_acc[1] + u[2] * earth_acc[2];
+        double u_app[3], u_app_dot[3];
+
+        for (i = 0; i < 3; i++) {
+            const double rel_dot = vel[i] * f - obs_vel[i];
+            const double u_dot = (rel_dot - *earth_dist_rate * u[i]) / distance;
+            u_app[i] = u[i] + (earth_vel[i] - u_dot_earth_vel * u[i]) / c;
+            u_app_dot[i] = u_dot * (1 - u_dot_earth_vel / c) + (earth_acc[i] - u_dot_earth_acc * u[i]) / c;
+        }
+
+        // Normalise the apparent direction, and remove any component of its rate of change along itself
+        const double u_app_mag = gsl_hypot3(u_app[0], u_app[1], u_app[2]);
+        const double radial = (u_app[0] * u_app_dot[0] + u_app[1] * u_app_dot[1] + u_app[2] * u_app_dot[2]) /
+                              gsl_pow_2(u_app_mag);
+        for (i = 0; i < 3; i++) {
+            u_app_dot[i] = (u_app_dot[i] - radial * u_app[i]) / u_app_mag;
+            u_app[i] /= u_app_mag;
+        }
+
+        const double u_app_xy_2 = gsl_pow_2(u_app[0]) + gsl_pow_2(u_app[1]);
+        *ra_rate = (u_app[0] * u_app_dot[1] - u_app[1] * u_app_dot[0]) / u_app_xy_2;
+        *dec_rate = u_app_dot[2] / sqrt(u_app_xy_2);
+    }
+
+    // Rate of change of distance from the Sun
+    if (bodyId == 10) {
+        *sun_dist_rate = 0;
+    } else {
+        const double helio[3] = {pos[0] - state->sun_pos[0], pos[1] - state->sun_pos[1], pos[2] - state->sun_pos[2]};
+        *sun_dist_rate = (helio[0] * (vel[0] - sun_vel[0]) + helio[1] * (vel[1] - sun_vel[1]) +
+                          helio[2] * (vel[2] - sun_vel[2])) / gsl_hypot3(helio[0], helio[1], helio[2]);
+    }
+}
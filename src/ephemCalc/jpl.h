@@ -22,12 +22,55 @@
 #ifndef JPL_H
 #define JPL_H 1
 
+#include "orbitalElements.h"
+
+void jpl_setCacheSize(long max_bytes);
+
+void jpl_cacheStatistics(long *hits, long *misses, long *loaded, long *evictions, long *bytes_read);
+
+void jpl_setCompactEphemeris(const char *filename);
+
+void jpl_setTolerance(double tolerance);
+
+double chebyshev(double *coeffs, int Ncoeff, double x);
+
+void jpl_ephemerisShape(double *jd_start, double *jd_end, double *jd_step, int *record_count, int *shape);
+
+void jpl_readCoefficients(int body_id, int record_index, double *t0, double *coefficients);
+
+int jpl_writeCompactEphemeris(const char *filename, double jd_start, int record_count, const int *shape,
+                              const double *record_start, double *const *body_coefficients);
+
 void jpl_computeXYZ(int body_id, double jd, double *x, double *y, double *z);
 
+void jpl_computeXYZVelocity(int body_id, double jd, double *x, double *y, double *z, double *velocity);
+
+void jpl_computeXYZGrid(int body_id, int count, const double *jd, double *x, double *y, double *z);
+
+void jpl_correctAberration(const orbitalElementsEpochState *state, double *x, double *y, double *z);
+
+void jpl_computePositionAtEpoch(int bodyId, const orbitalElementsEpochState *state, double *x, double *y,
+                                double *z);
+
+void jpl_computeEphemerisAtEpoch(int bodyId, const orbitalElementsEpochState *state, double *x, double *y,
+                                 double *z, double *ra, double *dec, double *mag, double *phase, double *angSize,
+                                 double *phySize, double *albedo, double *sunDist, double *earthDist,
+                                 double *sunAngDist, double *theta_ESO, double *eclipticLongitude,
+                                 double *eclipticLatitude, double *eclipticDistance, double ra_dec_epoch,
+                                 int do_topocentric_correction, double topocentric_latitude,
+                                 double topocentric_longitude);
+
 void jpl_computeEphemeris(int bodyId, double jd, double *x, double *y, double *z, double *ra, double *dec,
                           double *mag, double *phase, double *angSize, double *phySize, double *albedo, double *sunDist,
                           double *earthDist, double *sunAngDist, double *theta_ESO, double *eclipticLongitude,
                           double *eclipticLatitude, double *eclipticDistance, double ra_dec_epoch,
                           int do_topocentric_correction, double topocentric_latitude, double topocentric_longitude);
 
+void jpl_computeVelocityAtEpoch(int bodyId, const orbitalElementsEpochState *state, int use_orbital_elements,
+                                double *velocity);
+
+void jpl_computeRatesAtEpoch(int bodyId, const orbitalElementsEpochState *state, int use_orbital_elements,
+                             const double *topocentric_offset, double *ra_rate, double *dec_rate,
+                             double *earth_dist_rate, double *sun_dist_rate);
+
 #endif
@@ -0,0 +1,289 @@
+// jplCompact.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+
+// This module writes compact ephemerides, covering a limited time span and a subset of the bodies in DE430, with
+// only as many Chebyshev coefficients as are needed to match DE430 to within a given tolerance. They are written in
+// the same layout as <data/dcfbinary_bodies.430>, so that <jpl.c> can use them in place of DE430.
+
+#define JPLCOMPACT_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "jpl.h"
+#include "jplCompact.h"
+
+// Each subinterval is refitted by sampling the DE430 series at this many Chebyshev nodes
+#define JPLCOMPACT_NODES JPLCOMPACT_MAX_COEFFICIENTS
+
+// Each refitted series is compared with DE430 at this many evenly spaced points in its subinterval
+#define JPLCOMPACT_TEST_POINTS (4 * JPLCOMPACT_NODES)
+
+// Returned by <jplCompact_fit> when a number of subintervals cannot meet the tolerance
+#define JPLCOMPACT_INFEASIBLE (JPLCOMPACT_MAX_COEFFICIENTS + 1)
+
+//! The cosines used in the discrete cosine transform, cos(pi * l * (m + 1/2) / N), indexed [l * N + m]
+static double jplCompact_cosines[JPLCOMPACT_NODES * JPLCOMPACT_NODES];
+
+//! jplCompact_evaluate - Evaluate one coordinate of a body from the Chebyshev coefficients for one record of DE430
+//! \param [in] coefficients - The coefficients for the record, from <jpl_readCoefficients>
+//! \param [in] n - The number of coefficients for each coordinate
+//! \param [in] g - The number of subintervals in the record
+//! \param [in] coordinate - The coordinate to evaluate (0-2)
+//! \param [in] u - The time at which to evaluate, as a fraction of the length of the record (0-1)
+//! \return - The coordinate; km
+
+static double jplCompact_evaluate(const double *coefficients, const int n, const int g, const int coordinate,
+                                  const double u) {
+    int i = (int) floor(u * g);
+    if (i >= g) i = g - 1;
+    if (i < 0) i = 0;
+    double tc = 2 * (u * g - i) - 1;
+    if (tc < -1) tc = -1;
+    if (tc > 1) tc = 1;
+    return chebyshev((double *) &coefficients[(i * 3 + coordinate) * n], n, tc);
+}
+
+//! jplCompact_fit - Refit one coordinate of a body over one subinterval of a record, when the record is divided into
+//! a different number of subintervals, and work out how many terms of the new series are needed to stay within a
+//! tolerance of DE430. The new series is interpolated through the DE430 series at Chebyshev nodes. The error of the
+//! full series is only sampled, at a set of test points, so when it is truncated after <terms> terms, the error
+//! quoted is the sum of the magnitudes of the discarded terms plus the largest error seen at the test points. Between
+//! the test points the error may be slightly larger.
+//! \param [in] coefficients - The DE430 coefficients for the record, from <jpl_readCoefficients>
+//! \param [in] n - The number of DE430 coefficients for each coordinate
+//! \param [in] g - The number of subintervals in DE430
+//! \param [in] coordinate - The coordinate to fit (0-2)
+//! \param [in] g_new - The number of subintervals to divide the record into
+//! \param [in] j - The subinterval to fit (0 to g_new-1)
+//! \param [in] tolerance - The largest acceptable error; km
+//! \param [out] fit - The JPLCOMPACT_NODES coefficients of the new series
+//! \param [out] error - The maximum sampled error of the new series, when truncated after the number of terms
+//! returned
+//! \return - The number of terms needed, or JPLCOMPACT_INFEASIBLE if the tolerance cannot be met
+
+static int jplCompact_fit(const double *coefficients, const int n, const int g, const int coordinate,
+                          const int g_new, const int j, const double tolerance, double *fit, double *error) {
+    const int N = JPLCOMPACT_NODES;
+    double samples[JPLCOMPACT_NODES];
+    int l, m;
+
+    // Sample DE430 at the Chebyshev nodes
+    for (m = 0; m < N; m++) {
+        const double x = cos(M_PI * (m + 0.5) / N);
+        samples[m] = jplCompact_evaluate(coefficients, n, g, coordinate, (j + (x + 1) / 2) / g_new);
+    }
+
+    // Discrete cosine transform
+    for (l = 0; l < N; l++) {
+        double sum = 0;
+        for (m = 0; m < N; m++) sum += samples[m] * jplCompact_cosines[l * N + m];
+        fit[l] = 2 * sum / N;
+    }
+    fit[0] /= 2;
+
+    // Compare the full series with DE430, including at the ends of the subinterval
+    double fit_error = 0;
+    for (m = 0; m <= JPLCOMPACT_TEST_POINTS; m++) {
+        const double x = -1 + 2. * m / JPLCOMPACT_TEST_POINTS;
+        const double exact = jplCompact_evaluate(coefficients, n, g, coordinate, (j + (x + 1) / 2) / g_new);
+        const double difference = fabs(chebyshev(fit, N, x) - exact);
+        if (difference > fit_error) fit_error = difference;
+    }
+    if (!(fit_error <= tolerance)) return JPLCOMPACT_INFEASIBLE;
+
+    // Discard as many of the highest-order terms as the tolerance allows
+    int terms = N;
+    double tail = 0;
+    while ((terms > 1) && (fit_error + tail + fabs(fit[terms - 1]) <= tolerance)) {
+        tail += fabs(fit[terms - 1]);
+        terms--;
+    }
+    *error = fit_error + tail;
+    return terms;
+}
+
+//! jplCompact_write - Write a compact ephemeris, covering part of the time span of DE430 and a subset of its bodies.
+//! For each body, each record is divided into the number of subintervals, and the series truncated to the number of
+//! terms, which needs the fewest coefficients while matching DE430 to within the tolerance at every test point in the
+//! time span.
+//! The subintervals considered are those of DE430, and the divisions formed by merging them in equal groups.
+//! \param [in] filename - The filename to write the compact ephemeris to
+//! \param [in] jd_min - The start of the time span to include; TT. This is rounded out to whole records of DE430.
+//! \param [in] jd_max - The end of the time span to include; TT
+//! \param [in] include_body - For each of the 13 bodies in DE430, a boolean flag indicating whether to include it
+//! \param [in] tolerance - The largest acceptable difference between the positions of bodies and DE430; km
+//! \param [out] summary - A description of the compact ephemeris which was written
+//! \return - Zero on success
+
+int jplCompact_write(const char *filename, const double jd_min, const double jd_max, const int *include_body,
+                     const double tolerance, jplCompactSummary *summary) {
+    int needed[13][JPLCOMPACT_MAX_SUBINTERVALS + 1];
+    int shape[13 * 3], shape_out[13 * 3];
+    double *body_coefficients[13];
+    double jd_start, jd_end, jd_step;
+    int record_count, i, j, k;
+
+    jpl_ephemerisShape(&jd_start, &jd_end, &jd_step, &record_count, shape);
+
+    for (i = 0; i < JPLCOMPACT_NODES; i++)
+        for (j = 0; j < JPLCOMPACT_NODES; j++)
+            jplCompact_cosines[i * JPLCOMPACT_NODES + j] = cos(M_PI * i * (j + 0.5) / JPLCOMPACT_NODES);
+
+    // Work out which records to include
+    int record_first = (int) floor((jd_min - jd_start) / jd_step);
+    int record_last = (int) ceil((jd_max - jd_start) / jd_step);
+    if (record_first < 0) record_first = 0;
+    if (record_first > record_count - 1) record_first = record_count - 1;
+    if (record_last > record_count) record_last = record_count;
+    if (record_last < record_first + 1) record_last = record_first + 1;
+    const int records_out = record_last - record_first;
+
+    double *record_start = (double *) lt_malloc(records_out * sizeof(double));
+    if (record_start == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    for (i = 0; i < records_out; i++) record_start[i] = jd_start + (record_first + i) * jd_step;
+
+    for (i = 0; i < 13; i++) {
+        const int n = shape[i * 3 + 1], g = shape[i * 3 + 2];
+        if ((n > JPLCOMPACT_MAX_COEFFICIENTS) || (g > JPLCOMPACT_MAX_SUBINTERVALS)) {
+            ephem_fatal(__FILE__, __LINE__, "Too many Chebyshev coefficients in ephemeris.");
+            exit(1);
+        }
+        for (j = 0; j <= JPLCOMPACT_MAX_SUBINTERVALS; j++) needed[i][j] = 0;
+    }
+
+    // First pass: for each body, and each number of subintervals, work out how many terms are needed
+#pragma omp parallel for shared(needed, record_start) private(i, j, k)
+    for (int r = 0; r < records_out; r++) {
+        double coefficients[3 * JPLCOMPACT_MAX_COEFFICIENTS * JPLCOMPACT_MAX_SUBINTERVALS];
+        double fit[JPLCOMPACT_NODES];
+        double t0, error;
+
+        for (i = 0; i < 13; i++) {
+            const int n = shape[i * 3 + 1], g = shape[i * 3 + 2];
+            if ((!include_body[i]) || (n < 1)) continue;
+            jpl_readCoefficients(i, record_first + r, &t0, coefficients);
+            record_start[r] = t0;
+
+            for (int g_new = 1; g_new <= g; g_new++) {
+                if ((g % g_new) != 0) continue;
+                int terms = 0;
+                for (j = 0; (j < g_new) && (terms < JPLCOMPACT_INFEASIBLE); j++)
+                    for (k = 0; k < 3; k++) {
+                        const int t = jplCompact_fit(coefficients, n, g, k, g_new, j, tolerance, fit, &error);
+                        if (t > terms) terms = t;
+                    }
+#pragma omp critical (jplCompact_needed)
+                {
+                    if (terms > needed[i][g_new]) needed[i][g_new] = terms;
+                }
+            }
+        }
+    }
+
+    // Choose the division of each record which needs the fewest coefficients
+    int c = 3;
+    for (i = 0; i < 13; i++) {
+        const int g = shape[i * 3 + 2];
+        int best = 0;
+        for (int g_new = 1; g_new <= g; g_new++) {
+            if (((g % g_new) != 0) || (needed[i][g_new] >= JPLCOMPACT_INFEASIBLE)) continue;
+            if ((best == 0) || (g_new * needed[i][g_new] < best * needed[i][best])) best = g_new;
+        }
+        if ((!include_body[i]) || (shape[i * 3 + 1] < 1)) best = 0;
+        if ((best == 0) && include_body[i] && (shape[i * 3 + 1] > 0)) {
+            snprintf(temp_err_string, FNAME_LENGTH,
+                     "Body %d cannot be represented to within the tolerance; it will be omitted.", i);
+            ephem_warning(temp_err_string);
+        }
+
+        shape_out[i * 3 + 0] = c;
+        shape_out[i * 3 + 1] = (best > 0) ? needed[i][best] : 0;
+        shape_out[i * 3 + 2] = (best > 0) ? best : 1;
+        c += 3 * shape_out[i * 3 + 1] * shape_out[i * 3 + 2];
+
+        summary->coefficients[i] = shape_out[i * 3 + 1];
+        summary->subintervals[i] = shape_out[i * 3 + 2];
+        summary->max_error[i] = 0;
+        body_coefficients[i] = NULL;
+        if (best > 0) {
+            body_coefficients[i] = (double *) lt_malloc(
+                    (size_t) records_out * 3 * shape_out[i * 3 + 1] * shape_out[i * 3 + 2] * sizeof(double));
+            if (body_coefficients[i] == NULL) {
+                ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+                exit(1);
+            }
+        }
+    }
+
+    // Second pass: compute the coefficients of the compact ephemeris
+#pragma omp parallel for shared(body_coefficients, summary) private(i, j, k)
+    for (int r = 0; r < records_out; r++) {
+        double coefficients[3 * JPLCOMPACT_MAX_COEFFICIENTS * JPLCOMPACT_MAX_SUBINTERVALS];
+        double fit[JPLCOMPACT_NODES];
+        double t0, error;
+
+        for (i = 0; i < 13; i++) {
+            const int n = shape[i * 3 + 1], g = shape[i * 3 + 2];
+            const int n_new = shape_out[i * 3 + 1], g_new = shape_out[i * 3 + 2];
+            if (body_coefficients[i] == NULL) continue;
+            jpl_readCoefficients(i, record_first + r, &t0, coefficients);
+
+            double *out = body_coefficients[i] + (size_t) r * 3 * n_new * g_new;
+            double record_error = 0;
+            for (j = 0; j < g_new; j++)
+                for (k = 0; k < 3; k++) {
+                    const int terms = jplCompact_fit(coefficients, n, g, k, g_new, j, tolerance, fit, &error);
+
+                    // The sampled error for the terms we keep, which may be more than this subinterval needed
+                    double tail = 0;
+                    for (int l = terms; l < n_new; l++) tail += fabs(fit[l]);
+                    if (error - tail > record_error) record_error = error - tail;
+                    memcpy(out + (j * 3 + k) * n_new, fit, n_new * sizeof(double));
+                }
+#pragma omp critical (jplCompact_needed)
+            {
+                if (record_error > summary->max_error[i]) summary->max_error[i] = record_error;
+            }
+        }
+    }
+
+    // Write the compact ephemeris
+    summary->jd_start = jd_start + record_first * jd_step;
+    summary->jd_end = summary->jd_start + records_out * jd_step;
+    if (summary->jd_end > jd_end) summary->jd_end = jd_end;
+    summary->record_count = records_out;
+    return jpl_writeCompactEphemeris(filename, summary->jd_start, records_out, shape_out, record_start,
+                                     body_coefficients);
+}
@@ -0,0 +1,42 @@
+// jplCompact.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+
+#ifndef JPLCOMPACT_H
+#define JPLCOMPACT_H 1
+
+// The largest number of Chebyshev coefficients, and of subintervals, for any body in a compact ephemeris
+#define JPLCOMPACT_MAX_COEFFICIENTS 32
+#define JPLCOMPACT_MAX_SUBINTERVALS 32
+
+// A description of a compact ephemeris which has been written by <jplCompact_write>
+typedef struct {
+    double jd_start, jd_end;  // The time span of the compact ephemeris; TT
+    int record_count;  // The number of records it contains
+    int coefficients[13];  // The number of Chebyshev coefficients for each coordinate of each body; zero if excluded
+    int subintervals[13];  // The number of subintervals each record is divided into for each body
+    double max_error[13];  // The maximum sampled difference between the positions of each body and DE430; km
+} jplCompactSummary;
+
+int jplCompact_write(const char *filename, double jd_min, double jd_max, const int *include_body, double tolerance,
+                     jplCompactSummary *summary);
+
+#endif
@@ -161,6 +161,32 @@ void magnitudeEstimate(const int body_id,
                                      1, pos_earth, julian_date, st);
     }
 
+    magnitudeEstimate_atObserver(body_id, xo, yo, zo, xe, ye, ze, xs, ys, zs, ra, dec, mag, phase, angSize, phySize,
+                                 albedoOut, sunDist, earthDist, sunAngDist, theta_eso, eclipticLongitude,
+                                 eclipticLatitude, eclipticDistance, ra_dec_epoch, topocentric_offset);
+}
+
+//! magnitudeEstimate_atObserver - As <magnitudeEstimate>, but for an observer at a fixed offset from the geocentre.
+//! This allows callers computing ephemerides for many observers at once to compute each observer's offset only once
+//! per time step, rather than once per object.
+//! \param [in] body_id - Id number of body to have ephemeris computed.
+//! \param [in] xo - x,y,z position of body, in AU relative to solar system barycentre.
+//! \param [in] xe - x,y,z position of the geocentre, in AU relative to solar system barycentre.
+//! \param [in] xs - x,y,z position of Sun, in AU relative to solar system barycentre.
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates to output. Supply 2451545.0 for J2000.0.
+//! \param [in] topocentric_offset - The position of the observer relative to the geocentre, in AU, J2000.0 equatorial
+//! coordinates. See <earthTopocentricPositionICRF>.
+//! All other parameters are as for <magnitudeEstimate>.
+
+void magnitudeEstimate_atObserver(const int body_id,
+                                  const double xo, const double yo, const double zo,
+                                  const double xe, const double ye, const double ze,
+                                  const double xs, const double ys, const double zs,
+                                  double *ra, double *dec, double *mag, double *phase, double *angSize,
+                                  double *phySize, double *albedoOut, double *sunDist, double *earthDist,
+                                  double *sunAngDist, double *theta_eso, double *eclipticLongitude,
+                                  double *eclipticLatitude, double *eclipticDistance, const double ra_dec_epoch,
+                                  const double *topocentric_offset) {
     const double xe_topocentric = xe + topocentric_offset[0];
     const double ye_topocentric = ye + topocentric_offset[1];
     const double ze_topocentric = ze + topocentric_offset[2];
@@ -247,7 +273,7 @@ void magnitudeEstimate(const int body_id,
             orbitalElements_asteroids_init();
 
             // Fetch asteroid's record
-            item = orbitalElements_asteroids_fetch(body_id - 10000000);
+            item = orbitalElements_asteroids_fetch(orbitalElements_asteroids_slot(body_id - 10000000));
             if (item == NULL) fail = 1;
         } else {
             // Comet
@@ -256,7 +282,7 @@ void magnitudeEstimate(const int body_id,
             orbitalElements_comets_init();
 
             // Fetch comet's record
-            item = orbitalElements_comets_fetch(body_id - 20000000);
+            item = orbitalElements_comets_fetch(orbitalElements_comets_slot(body_id - 20000000));
             if (item == NULL) fail = 1;
         }
 
@@ -314,17 +340,6 @@ void magnitudeEstimate(const int body_id,
         *mag = GSL_NAN;
     }
 
-    // Compute RA and Dec from J2000.0 coordinates
-    {
-        // Position of object relative to the geocentre, in J2000.0 coordinates
-        const double x2 = xo - xe_topocentric;
-        const double y2 = yo - ye_topocentric;
-        const double z2 = zo - ze_topocentric;
-        *ra = atan2(y2, x2);
-        *dec = asin(z2 / sqrt(gsl_pow_2(x2) + gsl_pow_2(y2) + gsl_pow_2(z2)));
-        // Clamp RA within range 0 to 2pi radians
-        if (*ra < 0) *ra += 2 * M_PI;
-    }
 
     // Compute ecliptic distance from J2000.0 coordinates
     {
@@ -362,6 +377,40 @@ void magnitudeEstimate(const int body_id,
         if (*eclipticDistance < 0) (*theta_eso) *= -1;
     }
 
+    // Compute RA and Dec
+    magnitudeEstimate_raDec(xo, yo, zo, xe, ye, ze, ra, dec, ra_dec_epoch, topocentric_offset);
+}
+
+//! magnitudeEstimate_raDec - Compute only the RA and Dec of an object, as seen by an observer at a fixed offset from
+//! the geocentre. This is the subset of <magnitudeEstimate_atObserver> needed by callers which do not want the
+//! object's brightness or its geometry relative to the Sun.
+//! \param [in] xo - x,y,z position of body, in AU relative to solar system barycentre.
+//! \param [in] xe - x,y,z position of the geocentre, in AU relative to solar system barycentre.
+//! \param [out] ra - Right ascension of the object (radians)
+//! \param [out] dec - Declination of the object (radians)
+//! \param [in] ra_dec_epoch - The epoch of the RA/Dec coordinates to output. Supply 2451545.0 for J2000.0.
+//! \param [in] topocentric_offset - The position of the observer relative to the geocentre, in AU, J2000.0 equatorial
+//! coordinates.
+
+void magnitudeEstimate_raDec(const double xo, const double yo, const double zo,
+                             const double xe, const double ye, const double ze,
+                             double *ra, double *dec, const double ra_dec_epoch, const double *topocentric_offset) {
+    const double xe_topocentric = xe + topocentric_offset[0];
+    const double ye_topocentric = ye + topocentric_offset[1];
+    const double ze_topocentric = ze + topocentric_offset[2];
+
+    // Compute RA and Dec from J2000.0 coordinates
+    {
+        // Position of object relative to the geocentre, in J2000.0 coordinates
+        const double x2 = xo - xe_topocentric;
+        const double y2 = yo - ye_topocentric;
+        const double z2 = zo - ze_topocentric;
+        *ra = atan2(y2, x2);
+        *dec = asin(z2 / sqrt(gsl_pow_2(x2) + gsl_pow_2(y2) + gsl_pow_2(z2)));
+        // Clamp RA within range 0 to 2pi radians
+        if (*ra < 0) *ra += 2 * M_PI;
+    }
+
     // Convert RA and Dec to requested epoch
     if (ra_dec_epoch != 2451545.0) {
         const double ra_j2000 = *ra;  // radians
@@ -385,19 +434,15 @@ void magnitudeEstimate(const int body_id,
 #define RADIUS_EARTH_POLE    6356752.314245 /* metres */
 
 /**
- * earthTopocentricPositionICRF - Return the 3D position of a point on the Earth's surface, in ICRF coordinates,
- * relative to the solar system barycentre (the origin and coordinate system used by DE430).
- * @param out [out] - A three-component Cartesian vector.
+ * earthTopocentricPositionOfDate - Return the 3D position of a point on the Earth's surface, relative to the centre
+ * of the Earth, in equatorial coordinates for the equator and equinox of date.
+ * @param out [out] - A three-component Cartesian vector; metres
  * @param lat [in] - Latitude, degrees
  * @param lng [in] - Longitude, degrees
- * @param radius_in_earth_radii [in] - The radial position, in Earth radii, of the location to query. Set to 1 for
- * Earth's surface.
- * @param pos_earth [in] - The 3D position of the centre of the Earth at the epoch, as quoted by DE430
- * @param epoch [in] - The Julian Day number when the calculation is to be performed
  * @param sidereal_time [in] - Sidereal time in degrees
  */
-void earthTopocentricPositionICRF(double *out, const double lat, const double lng, const double radius_in_earth_radii,
-                                  const double *pos_earth, const double epoch, const double sidereal_time) {
+static void earthTopocentricPositionOfDate(double *out, const double lat, const double lng,
+                                           const double sidereal_time) {
 
     // In radians, the geodetic coordinates of the requested point, rotated to place RA=0 at longitude 0
     const double lat_geodetic = lat * M_PI / 180;
@@ -409,15 +454,33 @@ void earthTopocentricPositionICRF(double *out, const double lat, const double ln
 
     const double n = gsl_pow_2(RADIUS_EARTH_EQUATOR) / sqrt(gsl_pow_2(RADIUS_EARTH_EQUATOR * cos(lat_geodetic)) +
                                                             gsl_pow_2(RADIUS_EARTH_POLE * sin(lat_geodetic)));
-    const double x = (n + altitude) * cos(lng_geodetic) * cos(lat_geodetic);
-    const double y = (n + altitude) * sin(lng_geodetic) * cos(lat_geodetic);
-    const double z = (gsl_pow_2(RADIUS_EARTH_POLE / RADIUS_EARTH_EQUATOR) * n + altitude) * sin(lat_geodetic);
+    out[0] = (n + altitude) * cos(lng_geodetic) * cos(lat_geodetic);
+    out[1] = (n + altitude) * sin(lng_geodetic) * cos(lat_geodetic);
+    out[2] = (gsl_pow_2(RADIUS_EARTH_POLE / RADIUS_EARTH_EQUATOR) * n + altitude) * sin(lat_geodetic);
+}
+
+/**
+ * earthTopocentricPositionICRF - Return the 3D position of a point on the Earth's surface, in ICRF coordinates,
+ * relative to the solar system barycentre (the origin and coordinate system used by DE430).
+ * @param out [out] - A three-component Cartesian vector.
+ * @param lat [in] - Latitude, degrees
+ * @param lng [in] - Longitude, degrees
+ * @param radius_in_earth_radii [in] - The radial position, in Earth radii, of the location to query. Set to 1 for
+ * Earth's surface.
+ * @param pos_earth [in] - The 3D position of the centre of the Earth at the epoch, as quoted by DE430
+ * @param epoch [in] - The Julian Day number when the calculation is to be performed
+ * @param sidereal_time [in] - Sidereal time in degrees
+ */
+void earthTopocentricPositionICRF(double *out, const double lat, const double lng, const double radius_in_earth_radii,
+                                  const double *pos_earth, const double epoch, const double sidereal_time) {
+    double pos[3];
+    earthTopocentricPositionOfDate(pos, lat, lng, sidereal_time);
 
     // Work out RA and Dec of star above this point, for ecliptic of epoch
-    const double radius_geoid = sqrt(gsl_pow_2(x) + gsl_pow_2(y) + gsl_pow_2(z));  // metres
+    const double radius_geoid = sqrt(gsl_pow_2(pos[0]) + gsl_pow_2(pos[1]) + gsl_pow_2(pos[2]));  // metres
 
-    const double lat_at_epoch = asin(z / radius_geoid);  // planetocentric coordinates; radians
-    const double lng_at_epoch = atan2(y, x);  // planetocentric coordinates; radians
+    const double lat_at_epoch = asin(pos[2] / radius_geoid);  // planetocentric coordinates; radians
+    const double lng_at_epoch = atan2(pos[1], pos[0]);  // planetocentric coordinates; radians
 
     // Transform into J2000.0
     double lat_j2000, lng_j2000; // radians
@@ -429,3 +492,33 @@ void earthTopocentricPositionICRF(double *out, const double lat, const double ln
     out[1] = cos(lat_j2000) * sin(lng_j2000) * radius_requested + pos_earth[1];
     out[2] = sin(lat_j2000) * radius_requested + pos_earth[2];
 }
+
+/**
+ * earthTopocentricPositionPrecessed - Return the 3D position of a point on the Earth's surface, in ICRF coordinates,
+ * relative to the solar system barycentre, given the precession matrix for the epoch. Used when the positions of
+ * many points are needed at the same epoch. The point is precessed with the IAU 1976 precession matrix, where
+ * <earthTopocentricPositionICRF> uses Green's approximate formulae.
+ * @param out [out] - A three-component Cartesian vector.
+ * @param lat [in] - Latitude, degrees
+ * @param lng [in] - Longitude, degrees
+ * @param radius_in_earth_radii [in] - The radial position, in Earth radii, of the location to query. Set to 1 for
+ * Earth's surface.
+ * @param pos_earth [in] - The 3D position of the centre of the Earth at the epoch, as quoted by DE430
+ * @param precession [in] - The precession matrix for the epoch, from <precession_matrix>
+ * @param sidereal_time [in] - Sidereal time in degrees
+ */
+void earthTopocentricPositionPrecessed(double *out, const double lat, const double lng,
+                                       const double radius_in_earth_radii, const double *pos_earth,
+                                       const double *precession, const double sidereal_time) {
+    double pos[3];
+    earthTopocentricPositionOfDate(pos, lat, lng, sidereal_time);
+    const double x = pos[0], y = pos[1], z = pos[2];  // metres
+
+    // Transform from the equator and equinox of epoch into J2000.0, using the transpose of the precession matrix,
+    // and output position relative to the solar system barycentre, in ICRF coordinates
+    const double *p = precession;
+    const double scale = radius_in_earth_radii / AU;
+    out[0] = (p[0] * x + p[3] * y + p[6] * z) * scale + pos_earth[0];
+    out[1] = (p[1] * x + p[4] * y + p[7] * z) * scale + pos_earth[1];
+    out[2] = (p[2] * x + p[5] * y + p[8] * z) * scale + pos_earth[2];
+}
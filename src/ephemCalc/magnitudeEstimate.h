@@ -36,7 +36,20 @@ void magnitudeEstimate(int body_id, double xo, double yo, double zo, double xe,
                        double *eclipticDistance, double ra_dec_epoch, double julian_date,
                        int do_topocentric_correction, double topocentric_latitude, double topocentric_longitude);
 
+void magnitudeEstimate_atObserver(int body_id, double xo, double yo, double zo, double xe, double ye, double ze,
+                                  double xs, double ys, double zs, double *ra, double *dec, double *mag,
+                                  double *phase, double *angSize, double *phySize, double *albedoOut, double *sunDist,
+                                  double *earthDist, double *sunAngDist, double *theta_eso, double *eclipticLongitude,
+                                  double *eclipticLatitude, double *eclipticDistance, double ra_dec_epoch,
+                                  const double *topocentric_offset);
+
+void magnitudeEstimate_raDec(double xo, double yo, double zo, double xe, double ye, double ze, double *ra, double *dec,
+                             double ra_dec_epoch, const double *topocentric_offset);
+
 void earthTopocentricPositionICRF(double *out, double lat, double lng, double radius_in_earth_radii,
                                   const double *pos_earth, double epoch, double sidereal_time);
 
+void earthTopocentricPositionPrecessed(double *out, double lat, double lng, double radius_in_earth_radii,
+                                       const double *pos_earth, const double *precession, double sidereal_time);
+
 #endif
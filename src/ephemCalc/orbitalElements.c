@@ -45,6 +45,10 @@ const static double ORBIT_CONST_SPEED_OF_LIGHT = 299792458.; // m/s
 const static double ORBIT_CONST_ASTRONOMICAL_UNIT = 149597870700.; // m
 const static double ORBIT_CONST_GM_SOLAR = 1.32712440041279419e20; // m^3 s^-2
 
+// Version number of the layout of binary files such as <data/dcfbinary.ast>. Files with any other version number are
+// regenerated from the original text files.
+const static int ORBIT_BINARY_FORMAT = 3;
+
 // Binary files containing the orbital elements of solar system objects
 FILE *planet_database_file = NULL;
 FILE *asteroid_database_file = NULL;
@@ -60,16 +64,31 @@ orbitalElements *planet_database = NULL;
 orbitalElements *asteroid_database = NULL;
 orbitalElements *comet_database = NULL;
 
+// Blocks of memory used to hold the names and flags of each object
+orbitalElementsMetadata *planet_metadata = NULL;
+orbitalElementsMetadata *asteroid_metadata = NULL;
+orbitalElementsMetadata *comet_metadata = NULL;
+
 // Record of which entries we have loaded from each database
 unsigned char *planet_database_items_loaded = NULL;
 unsigned char *asteroid_database_items_loaded = NULL;
 unsigned char *comet_database_items_loaded = NULL;
 
+// Record of which metadata entries we have loaded from each database
+unsigned char *planet_metadata_items_loaded = NULL;
+unsigned char *asteroid_metadata_items_loaded = NULL;
+unsigned char *comet_metadata_items_loaded = NULL;
+
 // Pointers to the positions in the files where the orbitalElement structures begin
 int planet_database_offset = -1;
 int asteroid_database_offset = -1;
 int comet_database_offset = -1;
 
+// Pointers to the positions in the files where the orbitalElementsMetadata structures begin
+long planet_metadata_offset = -1;
+long asteroid_metadata_offset = -1;
+long comet_metadata_offset = -1;
+
 // Number of objects in each list
 int planet_count = 0;
 int asteroid_count = 0;
@@ -80,26 +99,52 @@ int planet_secure_count = 0;
 int asteroid_secure_count = 0;
 int comet_secure_count = 0;
 
+// Tables mapping the number of each object to the slot it occupies
+int *planet_slot_from_number = NULL;
+int *asteroid_slot_from_number = NULL;
+int *comet_slot_from_number = NULL;
+
+// The length of each of the tables above
+int planet_number_count = 0;
+int asteroid_number_count = 0;
+int comet_number_count = 0;
+
 //! OrbitalElements_ReadBinaryData - restore orbital elements from a binary dump of the data in a file such as
 //! <data/dcfbinary.ast>. This saves time parsing original text file every time we are run. For further efficiency,
 //! we don't actually read the orbital elements from disk straight away, until they're actually needed. We merely
 //! malloc a buffer to hold them. This massively reduces the start-up time.
 //!
+//! The file contains a table of numeric <orbitalElements> structures, followed by a parallel table of
+//! <orbitalElementsMetadata> structures, so that each can be loaded without the other. These are followed by a table
+//! mapping object numbers to slots in the other two tables, which is small, and is read straight away.
+//!
 //! \param [in] filename - The filename of the binary data dump
 //! \param [out] file_pointer - Return a file handle for the binary data dump
 //! \param [out] elements_offset  - Return the offset of the start of the table of <orbitalElements> structures from the
 //! beginning of the file.
+//! \param [out] metadata_offset  - Return the offset of the start of the table of <orbitalElementsMetadata> structures
+//! from the beginning of the file.
 //! \param [out] data_buffer - Return a malloced buffer which is big enough to contain the table of <orbitalElements>
 //! structures.
+//! \param [out] metadata_buffer - Return a malloced buffer which is big enough to contain the table of
+//! <orbitalElementsMetadata> structures.
 //! \param [out] data_buffer_items_loaded - Return an array which we use to keep track of which orbital elements we have
 //! already loaded.
+//! \param [out] metadata_buffer_items_loaded - Return an array which we use to keep track of which metadata records we
+//! have already loaded.
+//! \param [out] slot_from_number - Return a malloced table mapping object numbers to slots.
 //! \param [out] item_count - Return the number of orbital elements in this binary file.
 //! \param [out] item_secure_count - Return the number of securely determined orbital elements in this binary file.
+//! \param [out] number_count - Return the length of the table <slot_from_number>.
 //! \return - Zero on success
 
 int OrbitalElements_ReadBinaryData(const char *filename, FILE **file_pointer, int *elements_offset,
-                                   orbitalElements **data_buffer, unsigned char **data_buffer_items_loaded,
-                                   int *item_count, int *item_secure_count) {
+                                   long *metadata_offset, orbitalElements **data_buffer,
+                                   orbitalElementsMetadata **metadata_buffer,
+                                   unsigned char **data_buffer_items_loaded,
+                                   unsigned char **metadata_buffer_items_loaded,
+                                   int **slot_from_number,
+                                   int *item_count, int *item_secure_count, int *number_count) {
     char filename_with_path[FNAME_LENGTH];
 
     // Work out the full path of the binary data file we are to read
@@ -113,6 +158,16 @@ int OrbitalElements_ReadBinaryData(const char *filename, FILE **file_pointer, in
     *file_pointer = fopen(filename_with_path, "rb");
     if (*file_pointer == NULL) return 1; // FAIL
 
+    // Check that this file was written in the layout we expect
+    int format;
+    dcf_fread((void *) &format, sizeof(int), 1, *file_pointer, filename_with_path, __FILE__, __LINE__);
+    if (format != ORBIT_BINARY_FORMAT) {
+        if (DEBUG) { ephem_log("Rejecting this as having an obsolete format"); }
+        fclose(*file_pointer);
+        *file_pointer = NULL;
+        return 1;
+    }
+
     // Read the number of objects with orbital elements in this file
     dcf_fread((void *) item_count, sizeof(int), 1, *file_pointer, filename_with_path, __FILE__, __LINE__);
     if (DEBUG) {
@@ -127,8 +182,11 @@ int OrbitalElements_ReadBinaryData(const char *filename, FILE **file_pointer, in
         ephem_log(temp_err_string);
     }
 
+    // Read the length of the table mapping object numbers to slots
+    dcf_fread((void *) number_count, sizeof(int), 1, *file_pointer, filename_with_path, __FILE__, __LINE__);
+
     // Check that numbers are sensible
-    if ((*item_count < 1) || (*item_count > 1e6)) {
+    if ((*item_count < 1) || (*item_count > 1e7) || (*number_count < 1) || (*number_count > 1e8)) {
         if (DEBUG) { ephem_log("Rejecting this as implausible"); }
         fclose(*file_pointer);
         *file_pointer = NULL;
@@ -138,12 +196,43 @@ int OrbitalElements_ReadBinaryData(const char *filename, FILE **file_pointer, in
     // We have now reached the orbital elements. Store their offset from the start of the file.
     *elements_offset = ftell(*file_pointer);
 
+    // The metadata table follows on immediately after the orbital elements
+    *metadata_offset = *elements_offset + (long) (*item_count) * (long) sizeof(orbitalElements);
+
+    // The table mapping object numbers to slots follows on after the metadata
+    const long map_offset = *metadata_offset + (long) (*item_count) * (long) sizeof(orbitalElementsMetadata);
+
+    // Check that the file is the right length
+    fseek(*file_pointer, 0L, SEEK_END);
+    const long file_length = ftell(*file_pointer);
+    if (file_length != map_offset + (long) (*number_count) * (long) sizeof(int)) {
+        if (DEBUG) { ephem_log("Rejecting this as having the wrong length"); }
+        fclose(*file_pointer);
+        *file_pointer = NULL;
+        return 1;
+    }
+
     // Allocate memory to store records as we load them
     *data_buffer = (orbitalElements *) lt_malloc((*item_count) * sizeof(orbitalElements));
+    *metadata_buffer = (orbitalElementsMetadata *) lt_malloc((*item_count) * sizeof(orbitalElementsMetadata));
     *data_buffer_items_loaded = (unsigned char *) lt_malloc((*item_count) * sizeof(unsigned char));
+    *metadata_buffer_items_loaded = (unsigned char *) lt_malloc((*item_count) * sizeof(unsigned char));
+    *slot_from_number = (int *) lt_malloc((*number_count) * sizeof(int));
+    if ((*data_buffer == NULL) || (*metadata_buffer == NULL) ||
+        (*data_buffer_items_loaded == NULL) || (*metadata_buffer_items_loaded == NULL) ||
+        (*slot_from_number == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Read the table mapping object numbers to slots
+    fseek(*file_pointer, map_offset, SEEK_SET);
+    dcf_fread((void *) *slot_from_number, sizeof(int), *number_count, *file_pointer, filename_with_path,
+              __FILE__, __LINE__);
 
-    // Zero array telling us which records we have read
+    // Zero arrays telling us which records we have read
     memset(*data_buffer_items_loaded, 0, *item_count);
+    memset(*metadata_buffer_items_loaded, 0, *item_count);
 
     if (DEBUG) {
         sprintf(temp_err_string, "Data file opened successfully.");
@@ -159,13 +248,20 @@ int OrbitalElements_ReadBinaryData(const char *filename, FILE **file_pointer, in
 //!
 //! \param [in] filename - The filename of the binary dump we are to produce
 //! \param [in] data - The table of orbitalElements structures to write
+//! \param [in] metadata - The table of orbitalElementsMetadata structures to write
 //! \param [out] elements_offset  - Return the offset of the start of the table of <orbitalElements> structures from the
 //! beginning of the file.
+//! \param [out] metadata_offset  - Return the offset of the start of the table of <orbitalElementsMetadata> structures
+//! from the beginning of the file.
+//! \param [in] slot_from_number - The table mapping object numbers to slots
 //! \param [in] item_count - The number of orbital elements structures to write
 //! \param [in] item_secure_count - The number of objects in this table which have secure orbits
+//! \param [in] number_count - The length of the table <slot_from_number>
 
-void OrbitalElements_DumpBinaryData(const char *filename, const orbitalElements *data, int *elements_offset,
-                                    const int item_count, const int item_secure_count) {
+void OrbitalElements_DumpBinaryData(const char *filename, const orbitalElements *data,
+                                    const orbitalElementsMetadata *metadata, int *elements_offset,
+                                    long *metadata_offset, const int *slot_from_number,
+                                    const int item_count, const int item_secure_count, const int number_count) {
     FILE *output;
     char filename_with_path[FNAME_LENGTH];
 
@@ -181,8 +277,10 @@ void OrbitalElements_DumpBinaryData(const char *filename, const orbitalElements
     if (output == NULL) return; // FAIL
 
     // Write the number of objects with orbital elements in this file
+    fwrite((void *) &ORBIT_BINARY_FORMAT, sizeof(int), 1, output);
     fwrite((void *) &item_count, sizeof(int), 1, output);
     fwrite((void *) &item_secure_count, sizeof(int), 1, output);
+    fwrite((void *) &number_count, sizeof(int), 1, output);
 
     // We have now reached the orbital elements. Store their offset from the start of the file.
     *elements_offset = ftell(output);
@@ -190,6 +288,13 @@ void OrbitalElements_DumpBinaryData(const char *filename, const orbitalElements
     // Write the orbital elements themselves
     fwrite((void *) data, sizeof(orbitalElements), item_count, output);
 
+    // Write the names and flags of the objects
+    *metadata_offset = ftell(output);
+    fwrite((void *) metadata, sizeof(orbitalElementsMetadata), item_count, output);
+
+    // Write the table mapping object numbers to slots
+    fwrite((void *) slot_from_number, sizeof(int), number_count, output);
+
     // Close output file
     fclose(output);
 
@@ -200,6 +305,37 @@ void OrbitalElements_DumpBinaryData(const char *filename, const orbitalElements
     }
 }
 
+//! OrbitalElements_BuildSlotMap - Make a table mapping the numbers of objects onto the slots they occupy in a
+//! densely packed table of orbital elements.
+//!
+//! \param [in] metadata - The table of orbitalElementsMetadata structures, indexed by slot
+//! \param [in] item_count - The number of objects in the table <metadata>
+//! \param [out] slot_from_number - Return a malloced table mapping object numbers to slots
+//! \param [out] number_count - Return the length of the table <slot_from_number>
+
+void OrbitalElements_BuildSlotMap(const orbitalElementsMetadata *metadata, const int item_count,
+                                  int **slot_from_number, int *number_count) {
+    int i;
+
+    // The table must be long enough to hold the highest numbered object
+    *number_count = 1;
+    for (i = 0; i < item_count; i++) {
+        if (*number_count <= metadata[i].number) *number_count = metadata[i].number + 1;
+    }
+
+    *slot_from_number = (int *) lt_malloc((*number_count) * sizeof(int));
+    if (*slot_from_number == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Gaps in the numbering map onto no slot at all
+    for (i = 0; i < *number_count; i++) (*slot_from_number)[i] = -1;
+    for (i = 0; i < item_count; i++) {
+        if (metadata[i].number >= 0) (*slot_from_number)[metadata[i].number] = i;
+    }
+}
+
 //! orbitalElements_planets_readAsciiData - Read the asteroid orbital elements contained in the file <data/planets.dat>
 
 void orbitalElements_planets_readAsciiData() {
@@ -209,8 +345,10 @@ void orbitalElements_planets_readAsciiData() {
 
     // Try and read data from binary dump. Only proceed with parsing the text files if binary dump doesn't exist.
     int status = OrbitalElements_ReadBinaryData("dcfbinary.plt", &planet_database_file, &planet_database_offset,
-                                                &planet_database, &planet_database_items_loaded,
-                                                &planet_count, &planet_secure_count);
+                                                &planet_metadata_offset, &planet_database, &planet_metadata,
+                                                &planet_database_items_loaded, &planet_metadata_items_loaded,
+                                                &planet_slot_from_number,
+                                                &planet_count, &planet_secure_count, &planet_number_count);
 
     // If successful, return
     if (status == 0) return;
@@ -219,7 +357,8 @@ void orbitalElements_planets_readAsciiData() {
     planet_count = 0;
     planet_secure_count = 0;
     planet_database = (orbitalElements *) lt_malloc(MAX_PLANETS * sizeof(orbitalElements));
-    if (planet_database == NULL) {
+    planet_metadata = (orbitalElementsMetadata *) lt_malloc(MAX_PLANETS * sizeof(orbitalElementsMetadata));
+    if ((planet_database == NULL) || (planet_metadata == NULL)) {
         ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
         exit(1);
     }
@@ -238,15 +377,17 @@ void orbitalElements_planets_readAsciiData() {
         planet_database[i].epochOsculation = GSL_NAN;
         planet_database[i].slopeParam_n = 2;
         planet_database[i].slopeParam_G = -999;
-        planet_database[i].number = -1;
-        planet_database[i].secureOrbit = 0;
         planet_database[i].argumentPerihelion_dot = 0;
         planet_database[i].longAscNode_dot = 0;
         planet_database[i].inclination_dot = 0;
         planet_database[i].eccentricity_dot = 0;
         planet_database[i].semiMajorAxis_dot = 0;
-        strcpy(planet_database[i].name, "Undefined");
-        strcpy(planet_database[i].name2, "Undefined");
+
+        memset(&planet_metadata[i], 0, sizeof(orbitalElementsMetadata));
+        planet_metadata[i].number = -1;
+        planet_metadata[i].secureOrbit = 0;
+        strcpy(planet_metadata[i].name, "Undefined");
+        strcpy(planet_metadata[i].name2, "Undefined");
     }
 
     if (DEBUG) {
@@ -277,45 +418,54 @@ void orbitalElements_planets_readAsciiData() {
         if (line[0] == '#') continue;
         if (strlen(line) < 168) continue;
 
+        // Check we've not overrun the table of planets
+        if (planet_count >= MAX_PLANETS) {
+            ephem_fatal(__FILE__, __LINE__, "Too many planets in planets.dat; increase MAX_PLANETS.");
+            exit(1);
+        }
+
+        // Planets are stored in the order they appear in planets.dat
+        const int slot = planet_count;
+        planet_count++;
+
         // Read body id
         body_id = (int) get_float(line, NULL);
-        if (planet_count <= body_id) planet_count = body_id + 1;
-        planet_database[body_id].number = body_id;
+        planet_metadata[slot].number = body_id;
         planet_secure_count++;
 
         // Read planet name
-        for (i = 166, j = 0; (line[i] > ' '); i++, j++) planet_database[body_id].name[j] = line[i];
-        planet_database[body_id].name[j] = '\0';
+        for (i = 166, j = 0; (line[i] > ' '); i++, j++) planet_metadata[slot].name[j] = line[i];
+        planet_metadata[slot].name[j] = '\0';
 
         // Fill out dummy information
-        planet_database[body_id].absoluteMag = 999;
-        planet_database[body_id].slopeParam_G = 2;
-        planet_database[body_id].secureOrbit = 1;
+        planet_database[slot].absoluteMag = 999;
+        planet_database[slot].slopeParam_G = 2;
+        planet_metadata[slot].secureOrbit = 1;
 
         // Now start reading orbital elements of object
         for (i = 18; line[i] == ' '; i++);
         // AU
-        planet_database[body_id].semiMajorAxis = get_float(line + i, NULL);
+        planet_database[slot].semiMajorAxis = get_float(line + i, NULL);
         for (i = 30; line[i] == ' '; i++);
         // convert <AU per century> to <AU per day>
-        planet_database[body_id].semiMajorAxis_dot = get_float(line + i, NULL) / 36525.;
+        planet_database[slot].semiMajorAxis_dot = get_float(line + i, NULL) / 36525.;
         for (i = 42; line[i] == ' '; i++);
-        planet_database[body_id].eccentricity = get_float(line + i, NULL);
+        planet_database[slot].eccentricity = get_float(line + i, NULL);
         for (i = 53; line[i] == ' '; i++);
         // convert <per century> into <per day>
-        planet_database[body_id].eccentricity_dot = get_float(line + i, NULL) / 36525.;
+        planet_database[slot].eccentricity_dot = get_float(line + i, NULL) / 36525.;
         for (i = 65; line[i] == ' '; i++);
         // convert <degrees> to <radians; J2000.0>
-        planet_database[body_id].longAscNode = get_float(line + i, NULL) * M_PI / 180;
+        planet_database[slot].longAscNode = get_float(line + i, NULL) * M_PI / 180;
         for (i = 79; line[i] == ' '; i++);
         // Convert <degrees/century> into <radians/day>
-        planet_database[body_id].longAscNode_dot = get_float(line + i, NULL) / 36525. * M_PI / 180;
+        planet_database[slot].longAscNode_dot = get_float(line + i, NULL) / 36525. * M_PI / 180;
         for (i = 91; line[i] == ' '; i++);
         // radians; J2000.0
-        planet_database[body_id].inclination = get_float(line + i, NULL) * M_PI / 180;
+        planet_database[slot].inclination = get_float(line + i, NULL) * M_PI / 180;
         for (i = 104; line[i] == ' '; i++);
         // Convert <degrees/century> into <radians/day>
-        planet_database[body_id].inclination_dot = get_float(line + i, NULL) / 36525. * M_PI / 180;
+        planet_database[slot].inclination_dot = get_float(line + i, NULL) / 36525. * M_PI / 180;
         for (i = 116; line[i] == ' '; i++);
         // convert <degrees> to <radians; J2000.0>
         const double longitude_perihelion = get_float(line + i, NULL) * M_PI / 180;
@@ -327,17 +477,17 @@ void orbitalElements_planets_readAsciiData() {
         const double mean_longitude = get_float(line + i, NULL) * M_PI / 180;
         for (i = 155; line[i] == ' '; i++);
         // convert <unix time> to <julian date>
-        planet_database[body_id].epochOsculation = jd_from_unix(get_float(line + i, NULL));
+        planet_database[slot].epochOsculation = jd_from_unix(get_float(line + i, NULL));
 
         // radians; J2000.0
-        planet_database[body_id].meanAnomaly = mean_longitude - longitude_perihelion;
+        planet_database[slot].meanAnomaly = mean_longitude - longitude_perihelion;
 
         // radians; J2000.0
-        planet_database[body_id].argumentPerihelion = longitude_perihelion - planet_database[body_id].longAscNode;
+        planet_database[slot].argumentPerihelion = longitude_perihelion - planet_database[slot].longAscNode;
 
         // radians per day
-        planet_database[body_id].argumentPerihelion_dot = (longitude_perihelion_dot -
-                                                           planet_database[body_id].longAscNode_dot);
+        planet_database[slot].argumentPerihelion_dot = (longitude_perihelion_dot -
+                                                        planet_database[slot].longAscNode_dot);
     }
     fclose(input);
 
@@ -351,12 +501,16 @@ void orbitalElements_planets_readAsciiData() {
     }
 
     // Now that we've parsed the text-based version of this data, dump a binary version to make loading faster next time
-    OrbitalElements_DumpBinaryData("dcfbinary.plt", planet_database, &planet_database_offset,
-                                   planet_count, planet_secure_count);
+    OrbitalElements_BuildSlotMap(planet_metadata, planet_count, &planet_slot_from_number, &planet_number_count);
+    OrbitalElements_DumpBinaryData("dcfbinary.plt", planet_database, planet_metadata, &planet_database_offset,
+                                   &planet_metadata_offset, planet_slot_from_number,
+                                   planet_count, planet_secure_count, planet_number_count);
 
     // Make table indicating that we have loaded all the orbital elements in this table
     planet_database_items_loaded = (unsigned char *) lt_malloc(planet_count * sizeof(unsigned char));
     memset(planet_database_items_loaded, 1, planet_count);
+    planet_metadata_items_loaded = (unsigned char *) lt_malloc(planet_count * sizeof(unsigned char));
+    memset(planet_metadata_items_loaded, 1, planet_count);
 
     // Open a file pointer to the file
     char filename_with_path[FNAME_LENGTH];
@@ -369,14 +523,16 @@ void orbitalElements_planets_readAsciiData() {
 //! file downloaded from Ted Bowell's website
 
 void orbitalElements_asteroids_readAsciiData() {
-    int i;
+    int i, max_number = 0;
     char fname[FNAME_LENGTH];
     FILE *input = NULL;
 
     // Try and read data from binary dump. Only proceed with parsing the text files if binary dump doesn't exist.
     int status = OrbitalElements_ReadBinaryData("dcfbinary.ast", &asteroid_database_file, &asteroid_database_offset,
-                                                &asteroid_database, &asteroid_database_items_loaded,
-                                                &asteroid_count, &asteroid_secure_count);
+                                                &asteroid_metadata_offset, &asteroid_database, &asteroid_metadata,
+                                                &asteroid_database_items_loaded, &asteroid_metadata_items_loaded,
+                                                &asteroid_slot_from_number,
+                                                &asteroid_count, &asteroid_secure_count, &asteroid_number_count);
 
     // If successful, return
     if (status == 0) return;
@@ -385,7 +541,8 @@ void orbitalElements_asteroids_readAsciiData() {
     asteroid_count = 0;
     asteroid_secure_count = 0;
     asteroid_database = (orbitalElements *) lt_malloc(MAX_ASTEROIDS * sizeof(orbitalElements));
-    if (asteroid_database == NULL) {
+    asteroid_metadata = (orbitalElementsMetadata *) lt_malloc(MAX_ASTEROIDS * sizeof(orbitalElementsMetadata));
+    if ((asteroid_database == NULL) || (asteroid_metadata == NULL)) {
         ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
         exit(1);
     }
@@ -404,15 +561,17 @@ void orbitalElements_asteroids_readAsciiData() {
         asteroid_database[i].epochOsculation = GSL_NAN;
         asteroid_database[i].slopeParam_n = 2;
         asteroid_database[i].slopeParam_G = -999;
-        asteroid_database[i].number = -1;
-        asteroid_database[i].secureOrbit = 0;
         asteroid_database[i].argumentPerihelion_dot = 0;
         asteroid_database[i].longAscNode_dot = 0;
         asteroid_database[i].inclination_dot = 0;
         asteroid_database[i].eccentricity_dot = 0;
         asteroid_database[i].semiMajorAxis_dot = 0;
-        strcpy(asteroid_database[i].name, "Undefined");
-        strcpy(asteroid_database[i].name2, "Undefined");
+
+        memset(&asteroid_metadata[i], 0, sizeof(orbitalElementsMetadata));
+        asteroid_metadata[i].number = -1;
+        asteroid_metadata[i].secureOrbit = 0;
+        strcpy(asteroid_metadata[i].name, "Undefined");
+        strcpy(asteroid_metadata[i].name2, "Undefined");
     }
 
     if (DEBUG) {
@@ -442,22 +601,27 @@ void orbitalElements_asteroids_readAsciiData() {
         if (line[0] == '#') continue;
         if (strlen(line) < 250) continue;
 
-        // Read asteroid number
-        for (i = 0; (line[i] > '\0') && (line[i] <= ' '); i++);
-
-        // Unnumbered asteroid; don't bother adding to catalogue
-        if (i >= 6) continue;
+        // Check we've not overrun the table of asteroids
+        if (asteroid_count >= MAX_ASTEROIDS) {
+            ephem_warning("Too many asteroids in astorb.dat; increase MAX_ASTEROIDS.");
+            break;
+        }
 
-        const int n = (int) get_float(line + i, NULL);
+        // Asteroids are packed densely into the table, in the order they appear in astorb.dat
+        const int n = asteroid_count;
+        asteroid_count++;
 
-        // asteroid_count should be the highest number asteroid we have encountered
-        if (asteroid_count <= n) asteroid_count = n + 1;
-        asteroid_database[n].number = n;
+        // Read asteroid number. Unnumbered asteroids, which have provisional designations, are given numbers later.
+        for (i = 0; (line[i] > '\0') && (line[i] <= ' '); i++);
+        if (i < 6) {
+            asteroid_metadata[n].number = (int) get_float(line + i, NULL);
+            if (max_number < asteroid_metadata[n].number) max_number = asteroid_metadata[n].number;
+        }
 
         // Read asteroid name
         for (i = 25; (i > 7) && (line[i] > '\0') && (line[i] <= ' '); i--);
-        strncpy(asteroid_database[n].name, line + 7, i - 6);
-        asteroid_database[n].name[i - 6] = '\0';
+        strncpy(asteroid_metadata[n].name, line + 7, i - 6);
+        asteroid_metadata[n].name[i - 6] = '\0';
 
         // Read absolute magnitude
         for (i = 42; (line[i] > '\0') && (line[i] <= ' '); i++);
@@ -482,10 +646,10 @@ void orbitalElements_asteroids_readAsciiData() {
         const int obs_count = (int) get_float(line + i, NULL);
 
         // Orbit deemed secure if more than 10 yrs data
-        asteroid_database[n].secureOrbit = (day_obs_span > 3650) && (obs_count > 500);
+        asteroid_metadata[n].secureOrbit = (day_obs_span > 3650) && (obs_count > 500);
 
         // Count how many objects we've seen with secure orbits
-        if (asteroid_database[n].secureOrbit) asteroid_secure_count++;
+        if (asteroid_metadata[n].secureOrbit) asteroid_secure_count++;
 
         // Now start reading orbital elements of object
         {
@@ -522,6 +686,11 @@ void orbitalElements_asteroids_readAsciiData() {
     }
     fclose(input);
 
+    // Number the unnumbered asteroids after the highest-numbered asteroid, so that each has a unique bodyId
+    for (i = 0; i < asteroid_count; i++) {
+        if (asteroid_metadata[i].number < 0) asteroid_metadata[i].number = ++max_number;
+    }
+
     if (DEBUG) {
         sprintf(temp_err_string, "Asteroid count               = %7d", asteroid_count);
         ephem_log(temp_err_string);
@@ -532,12 +701,17 @@ void orbitalElements_asteroids_readAsciiData() {
     }
 
     // Now that we've parsed the text-based version of this data, dump a binary version to make loading faster next time
-    OrbitalElements_DumpBinaryData("dcfbinary.ast", asteroid_database, &asteroid_database_offset,
-                                   asteroid_count, asteroid_secure_count);
+    OrbitalElements_BuildSlotMap(asteroid_metadata, asteroid_count, &asteroid_slot_from_number,
+                                 &asteroid_number_count);
+    OrbitalElements_DumpBinaryData("dcfbinary.ast", asteroid_database, asteroid_metadata, &asteroid_database_offset,
+                                   &asteroid_metadata_offset, asteroid_slot_from_number,
+                                   asteroid_count, asteroid_secure_count, asteroid_number_count);
 
     // Make table indicating that we have loaded all the orbital elements in this table
     asteroid_database_items_loaded = (unsigned char *) lt_malloc(asteroid_count * sizeof(unsigned char));
     memset(asteroid_database_items_loaded, 1, asteroid_count);
+    asteroid_metadata_items_loaded = (unsigned char *) lt_malloc(asteroid_count * sizeof(unsigned char));
+    memset(asteroid_metadata_items_loaded, 1, asteroid_count);
 
     // Open a file pointer to the file
     char filename_with_path[FNAME_LENGTH];
@@ -557,8 +731,10 @@ void orbitalElements_comets_readAsciiData() {
 
     // Try and read data from binary dump. Only proceed with parsing the text files if binary dump doesn't exist.
     int status = OrbitalElements_ReadBinaryData("dcfbinary.cmt", &comet_database_file, &comet_database_offset,
-                                                &comet_database, &comet_database_items_loaded,
-                                                &comet_count, &comet_secure_count);
+                                                &comet_metadata_offset, &comet_database, &comet_metadata,
+                                                &comet_database_items_loaded, &comet_metadata_items_loaded,
+                                                &comet_slot_from_number,
+                                                &comet_count, &comet_secure_count, &comet_number_count);
 
     // If successful, return
     if (status == 0) return;
@@ -567,7 +743,8 @@ void orbitalElements_comets_readAsciiData() {
     comet_count = 0;
     comet_secure_count = 0;
     comet_database = (orbitalElements *) lt_malloc(MAX_COMETS * sizeof(orbitalElements));
-    if (comet_database == NULL) {
+    comet_metadata = (orbitalElementsMetadata *) lt_malloc(MAX_COMETS * sizeof(orbitalElementsMetadata));
+    if ((comet_database == NULL) || (comet_metadata == NULL)) {
         ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
         exit(1);
     }
@@ -586,15 +763,17 @@ void orbitalElements_comets_readAsciiData() {
         comet_database[i].epochOsculation = GSL_NAN;
         comet_database[i].slopeParam_n = 2;
         comet_database[i].slopeParam_G = -999;
-        comet_database[i].number = -1;
-        comet_database[i].secureOrbit = 0;
         comet_database[i].argumentPerihelion_dot = 0;
         comet_database[i].longAscNode_dot = 0;
         comet_database[i].inclination_dot = 0;
         comet_database[i].eccentricity_dot = 0;
         comet_database[i].semiMajorAxis_dot = 0;
-        strcpy(comet_database[i].name, "Undefined");
-        strcpy(comet_database[i].name2, "Undefined");
+
+        memset(&comet_metadata[i], 0, sizeof(orbitalElementsMetadata));
+        comet_metadata[i].number = -1;
+        comet_metadata[i].secureOrbit = 0;
+        strcpy(comet_metadata[i].name, "Undefined");
+        strcpy(comet_metadata[i].name2, "Undefined");
     }
 
     // Now start reading the orbital elements of comets from Soft00Cmt.txt
@@ -630,15 +809,15 @@ void orbitalElements_comets_readAsciiData() {
 
         // Read comet name
         for (j = 102, k = 0; (line[j] != '(') && (line[j] != '\0') && (k < 23); j++, k++) {
-            comet_database[comet_count].name[k] = line[j];
+            comet_metadata[comet_count].name[k] = line[j];
         }
-        while ((k > 0) && (comet_database[comet_count].name[--k] == ' '));
-        comet_database[comet_count].name[k + 1] = '\0';
+        while ((k > 0) && (comet_metadata[comet_count].name[--k] == ' '));
+        comet_metadata[comet_count].name[k + 1] = '\0';
 
         // Read comet's MPC designation
         for (j = 0, k = 0; (line[j] > '\0') && (line[j] <= ' '); j++);
-        while ((line[j] > ' ') && (k < 23)) comet_database[comet_count].name2[k++] = line[j++];
-        comet_database[comet_count].name2[k] = '\0';
+        while ((line[j] > ' ') && (k < 23)) comet_metadata[comet_count].name2[k++] = line[j++];
+        comet_metadata[comet_count].name2[k] = '\0';
 
         // Read perihelion distance
         perihelion_dist = get_float(line + 31, NULL);
@@ -694,7 +873,8 @@ void orbitalElements_comets_readAsciiData() {
         else comet_database[comet_count].slopeParam_n = get_float(line + j, NULL);
 
         // Calculate derived quantities
-        comet_database[comet_count].secureOrbit = 1;
+        comet_metadata[comet_count].number = comet_count;
+        comet_metadata[comet_count].secureOrbit = 1;
         // AU
         comet_database[comet_count].semiMajorAxis = a = perihelion_dist / (1 - eccentricity);
         // radians; J2000.0
@@ -721,12 +901,16 @@ void orbitalElements_comets_readAsciiData() {
     }
 
     // Now that we've parsed the text-based version of this data, dump a binary version to make loading faster next time
-    OrbitalElements_DumpBinaryData("dcfbinary.cmt", comet_database, &comet_database_offset,
-                                   comet_count, comet_secure_count);
+    OrbitalElements_BuildSlotMap(comet_metadata, comet_count, &comet_slot_from_number, &comet_number_count);
+    OrbitalElements_DumpBinaryData("dcfbinary.cmt", comet_database, comet_metadata, &comet_database_offset,
+                                   &comet_metadata_offset, comet_slot_from_number,
+                                   comet_count, comet_secure_count, comet_number_count);
 
     // Make table indicating that we have loaded all the orbital elements in this table
     comet_database_items_loaded = (unsigned char *) lt_malloc(comet_count * sizeof(unsigned char));
     memset(comet_database_items_loaded, 1, comet_count);
+    comet_metadata_items_loaded = (unsigned char *) lt_malloc(comet_count * sizeof(unsigned char));
+    memset(comet_metadata_items_loaded, 1, comet_count);
 
     // Open a file pointer to the file
     char filename_with_path[FNAME_LENGTH];
@@ -744,13 +928,23 @@ void orbitalElements_planets_init() {
     }
 }
 
-//! orbitalElements_planets_fetch - Fetch the orbitalElements record for bodyId <index>. If needed, load them from disk.
-//! \param index - The bodyId of the object whose orbital elements are to be loaded
-//! \return - An orbitalElements structure for bodyId
+//! orbitalElements_planets_slot - Look up which slot in the table of orbital elements is occupied by the object
+//! with bodyId <number>.
+//! \param number - The number of the object
+//! \return - The slot occupied by the object, or -1 if there is no such object
+
+int orbitalElements_planets_slot(int number) {
+    if ((planet_slot_from_number == NULL) || (number < 0) || (number >= planet_number_count)) return -1;
+    return planet_slot_from_number[number];
+}
+
+//! orbitalElements_planets_fetch - Fetch the orbitalElements record in slot <index>. If needed, load them from disk.
+//! \param index - The slot occupied by the object whose orbital elements are to be loaded
+//! \return - An orbitalElements structure for the object
 
 orbitalElements *orbitalElements_planets_fetch(int index) {
     // Check that request is within allowed range
-    if ((index < 0) || (index > planet_count)) return NULL;
+    if ((index < 0) || (index >= planet_count)) return NULL;
 
     // If we have already loaded these orbital elements, we can return a pointer immediately
     if (planet_database_items_loaded[index]) return &planet_database[index];
@@ -768,6 +962,31 @@ orbitalElements *orbitalElements_planets_fetch(int index) {
     return &planet_database[index];
 }
 
+//! orbitalElements_planets_fetchMetadata - Fetch the name and flags of the object in slot <index>. If needed, load
+//! them from disk. These are stored separately from the orbital elements, and are not needed to compute positions.
+//! \param index - The slot occupied by the object whose metadata is to be loaded
+//! \return - An orbitalElementsMetadata structure for the object
+
+orbitalElementsMetadata *orbitalElements_planets_fetchMetadata(int index) {
+    // Check that request is within allowed range
+    if ((index < 0) || (index >= planet_count)) return NULL;
+
+    // If we have already loaded this metadata, we can return a pointer immediately
+    if (planet_metadata_items_loaded[index]) return &planet_metadata[index];
+
+#pragma omp critical (planets_fetch)
+    {
+        // If not, then read it from disk now
+        long data_position_needed = planet_metadata_offset + index * sizeof(orbitalElementsMetadata);
+        fseek(planet_database_file, data_position_needed, SEEK_SET);
+        dcf_fread((void *) &planet_metadata[index], sizeof(orbitalElementsMetadata), 1, planet_database_file,
+                  planet_database_filename, __FILE__, __LINE__);
+        planet_metadata_items_loaded[index] = 1;
+    }
+
+    return &planet_metadata[index];
+}
+
 //! orbitalElements_asteroids_init - Make sure that asteroid orbital elements are initialised, in thread-safe fashion
 
 void orbitalElements_asteroids_init() {
@@ -777,14 +996,23 @@ void orbitalElements_asteroids_init() {
     }
 }
 
-//! orbitalElements_asteroids_fetch - Fetch the orbitalElements record for bodyId (10000000 + index). If needed, load
-//! them from disk.
-//! \param index - The index of the object whose orbital elements are to be loaded (bodyId = 10000000 + index)
-//! \return - An orbitalElements structure for bodyId
+//! orbitalElements_asteroids_slot - Look up which slot in the table of orbital elements is occupied by the object
+//! with bodyId (10000000 + number).
+//! \param number - The number of the object
+//! \return - The slot occupied by the object, or -1 if there is no such object
+
+int orbitalElements_asteroids_slot(int number) {
+    if ((asteroid_slot_from_number == NULL) || (number < 0) || (number >= asteroid_number_count)) return -1;
+    return asteroid_slot_from_number[number];
+}
+
+//! orbitalElements_asteroids_fetch - Fetch the orbitalElements record in slot <index>. If needed, load them from disk.
+//! \param index - The slot occupied by the object whose orbital elements are to be loaded
+//! \return - An orbitalElements structure for the object
 
 orbitalElements *orbitalElements_asteroids_fetch(int index) {
     // Check that request is within allowed range
-    if ((index < 0) || (index > asteroid_count)) return NULL;
+    if ((index < 0) || (index >= asteroid_count)) return NULL;
 
     // If we have already loaded these orbital elements, we can return a pointer immediately
     if (asteroid_database_items_loaded[index]) return &asteroid_database[index];
@@ -802,6 +1030,61 @@ orbitalElements *orbitalElements_asteroids_fetch(int index) {
     return &asteroid_database[index];
 }
 
+//! orbitalElements_asteroids_fetchMetadata - Fetch the name and flags of the object in slot <index>. If needed, load
+//! them from disk. These are stored separately from the orbital elements, and are not needed to compute positions.
+//! \param index - The slot occupied by the object whose metadata is to be loaded
+//! \return - An orbitalElementsMetadata structure for the object
+
+orbitalElementsMetadata *orbitalElements_asteroids_fetchMetadata(int index) {
+    // Check that request is within allowed range
+    if ((index < 0) || (index >= asteroid_count)) return NULL;
+
+    // If we have already loaded this metadata, we can return a pointer immediately
+    if (asteroid_metadata_items_loaded[index]) return &asteroid_metadata[index];
+
+#pragma omp critical (asteroids_fetch)
+    {
+        // If not, then read it from disk now
+        long data_position_needed = asteroid_metadata_offset + index * sizeof(orbitalElementsMetadata);
+        fseek(asteroid_database_file, data_position_needed, SEEK_SET);
+        dcf_fread((void *) &asteroid_metadata[index], sizeof(orbitalElementsMetadata), 1, asteroid_database_file,
+                  asteroid_database_filename, __FILE__, __LINE__);
+        asteroid_metadata_items_loaded[index] = 1;
+    }
+
+    return &asteroid_metadata[index];
+}
+
+//! orbitalElements_asteroids_loadAll - Read the orbital elements of every asteroid into memory in a single pass.
+//! This is much faster than loading records one at a time when we are going to scan the whole catalogue.
+
+void orbitalElements_asteroids_loadAll() {
+    orbitalElements_asteroids_init();
+
+#pragma omp critical (asteroids_fetch)
+    {
+        fseek(asteroid_database_file, asteroid_database_offset, SEEK_SET);
+        dcf_fread((void *) asteroid_database, sizeof(orbitalElements), asteroid_count, asteroid_database_file,
+                  asteroid_database_filename, __FILE__, __LINE__);
+        memset(asteroid_database_items_loaded, 1, asteroid_count);
+    }
+}
+
+//! orbitalElements_asteroids_loadAllMetadata - Read the names and flags of every asteroid into memory in a single
+//! pass.
+
+void orbitalElements_asteroids_loadAllMetadata() {
+    orbitalElements_asteroids_init();
+
+#pragma omp critical (asteroids_fetch)
+    {
+        fseek(asteroid_database_file, asteroid_metadata_offset, SEEK_SET);
+        dcf_fread((void *) asteroid_metadata, sizeof(orbitalElementsMetadata), asteroid_count,
+                  asteroid_database_file, asteroid_database_filename, __FILE__, __LINE__);
+        memset(asteroid_metadata_items_loaded, 1, asteroid_count);
+    }
+}
+
 //! orbitalElements_comets_init - Make sure that comet orbital elements are initialised, in thread-safe fashion
 
 void orbitalElements_comets_init() {
@@ -811,14 +1094,23 @@ void orbitalElements_comets_init() {
     }
 }
 
-//! orbitalElements_comets_fetch - Fetch the orbitalElements record for bodyId (20000000 + index). If needed, load
-//! them from disk.
-//! \param index - The index of the object whose orbital elements are to be loaded (bodyId = 20000000 + index)
-//! \return - An orbitalElements structure for bodyId
+//! orbitalElements_comets_slot - Look up which slot in the table of orbital elements is occupied by the object
+//! with bodyId (20000000 + number).
+//! \param number - The number of the object
+//! \return - The slot occupied by the object, or -1 if there is no such object
+
+int orbitalElements_comets_slot(int number) {
+    if ((comet_slot_from_number == NULL) || (number < 0) || (number >= comet_number_count)) return -1;
+    return comet_slot_from_number[number];
+}
+
+//! orbitalElements_comets_fetch - Fetch the orbitalElements record in slot <index>. If needed, load them from disk.
+//! \param index - The slot occupied by the object whose orbital elements are to be loaded
+//! \return - An orbitalElements structure for the object
 
 orbitalElements *orbitalElements_comets_fetch(int index) {
     // Check that request is within allowed range
-    if ((index < 0) || (index > comet_count)) return NULL;
+    if ((index < 0) || (index >= comet_count)) return NULL;
 
     // If we have already loaded these orbital elements, we can return a pointer immediately
     if (comet_database_items_loaded[index]) return &comet_database[index];
@@ -836,70 +1128,125 @@ orbitalElements *orbitalElements_comets_fetch(int index) {
     return &comet_database[index];
 }
 
-//! orbitalElements_computeXYZ - Main orbital elements computer. Return 3D position in ICRF, in AU, relative to the
-//! Sun (not the solar system barycentre!!). z-axis points towards the J2000.0 north celestial pole.
-//! \param [in] body_id - The id number of the object whose position is being queried
-//! \param [in] jd - The Julian day number at which the object's position is wanted; TT
-//! \param [out] x - The x position of the object relative to the Sun (in AU; ICRF; points to RA=0)
-//! \param [out] y - The y position of the object relative to the Sun (in AU; ICRF; points to RA=6h)
-//! \param [out] z - The z position of the object relative to the Sun (in AU; ICRF; points to NCP)
+//! orbitalElements_comets_fetchMetadata - Fetch the name and flags of the object in slot <index>. If needed, load
+//! them from disk. These are stored separately from the orbital elements, and are not needed to compute positions.
+//! \param index - The slot occupied by the object whose metadata is to be loaded
+//! \return - An orbitalElementsMetadata structure for the object
 
-void orbitalElements_computeXYZ(int body_id, double jd, double *x, double *y, double *z) {
-    orbitalElements *orbital_elements;
+orbitalElementsMetadata *orbitalElements_comets_fetchMetadata(int index) {
+    // Check that request is within allowed range
+    if ((index < 0) || (index >= comet_count)) return NULL;
 
-    double v, r;
+    // If we have already loaded this metadata, we can return a pointer immediately
+    if (comet_metadata_items_loaded[index]) return &comet_metadata[index];
 
-    // const double epsilon = (23.4393 - 3.563E-7 * (jd - 2451544.5)) * M_PI / 180;
+#pragma omp critical (comets_fetch)
+    {
+        // If not, then read it from disk now
+        long data_position_needed = comet_metadata_offset + index * sizeof(orbitalElementsMetadata);
+        fseek(comet_database_file, data_position_needed, SEEK_SET);
+        dcf_fread((void *) &comet_metadata[index], sizeof(orbitalElementsMetadata), 1, comet_database_file,
+                  comet_database_filename, __FILE__, __LINE__);
+        comet_metadata_items_loaded[index] = 1;
+    }
+
+    return &comet_metadata[index];
+}
+
+//! orbitalElements_lookup - Fetch the orbital elements of the object with a particular bodyId, from whichever of
+//! the planet, asteroid and comet databases it belongs to.
+//! \param [in] body_id - The id number of the object
+//! \return - The orbital elements of the object, or NULL if it is not in the database
 
+static const orbitalElements *orbitalElements_lookup(const int body_id) {
     // Case 1: Object is a planet
     if (body_id < 10000000) {
-        // Planets occupy body numbers 1-19
-        const int index = body_id;
-
         orbitalElements_planets_init();
 
-        // Return NaN if object is not in database
-        if ((planet_database_file == NULL) || (index >= planet_count)) {
-            *x = *y = *z = GSL_NAN;
-            return;
-        }
-
-        // Fetch data from the binary database file
-        orbital_elements = orbitalElements_planets_fetch(index);
+        // Planets occupy body numbers 1-19
+        const int index = orbitalElements_planets_slot(body_id);
+        if ((planet_database_file == NULL) || (index < 0)) return NULL;
+        return orbitalElements_planets_fetch(index);
     }
 
         // Case 2: Object is an asteroid
     else if (body_id < 20000000) {
-        // Asteroids occupy body numbers 1e7 - 2e7
-        const int index = body_id - 10000000;
-
         orbitalElements_asteroids_init();
 
-        // Return NaN if object is not in database
-        if ((asteroid_database_file == NULL) || (index >= asteroid_count)) {
-            *x = *y = *z = GSL_NAN;
-            return;
-        }
-
-        // Fetch data from the binary database file
-        orbital_elements = orbitalElements_asteroids_fetch(index);
+        // Asteroids occupy body numbers 1e7 - 2e7
+        const int index = orbitalElements_asteroids_slot(body_id - 10000000);
+        if ((asteroid_database_file == NULL) || (index < 0)) return NULL;
+        return orbitalElements_asteroids_fetch(index);
     }
 
         // Case 3: Object is a comet
     else {
+        orbitalElements_comets_init();
+
         // Comets occupy body numbers 2e7 - 3e7
-        const int index = body_id - 20000000;
+        const int index = orbitalElements_comets_slot(body_id - 20000000);
+        if ((comet_database_file == NULL) || (index < 0)) return NULL;
+        return orbitalElements_comets_fetch(index);
+    }
+}
 
-        orbitalElements_comets_init();
+//! orbitalElements_maxSpeed - Return the speed of an object relative to the Sun at perihelion, which is the fastest
+//! it moves at any point in its orbit. This is true of elliptical, parabolic and hyperbolic orbits alike.
+//! \param [in] body_id - The id number of the object
+//! \param [in] jd - The Julian day number at which to evaluate the orbital elements; TT
+//! \return - The speed of the object at perihelion, in AU per day, or NaN if it is not known
 
-        // Return NaN if object is not in database
-        if ((comet_database_file == NULL) || (index >= comet_count)) {
-            *x = *y = *z = GSL_NAN;
-            return;
-        }
+double orbitalElements_maxSpeed(const int body_id, const double jd) {
+    const orbitalElements *orbital_elements = orbitalElements_lookup(body_id);
+    if (orbital_elements == NULL) return GSL_NAN;
 
-        // Fetch data from the binary database file
-        orbital_elements = orbitalElements_comets_fetch(index);
+    const double offset_from_epoch = jd - orbital_elements->epochOsculation;
+    const double a = orbital_elements->semiMajorAxis + orbital_elements->semiMajorAxis_dot * offset_from_epoch;
+    const double e = orbital_elements->eccentricity + orbital_elements->eccentricity_dot * offset_from_epoch;
+
+    // Vis-viva equation at the perihelion distance q = a(1-e)
+    const double q = a * (1 - e) * ORBIT_CONST_ASTRONOMICAL_UNIT;
+    if ((!gsl_finite(q)) || (q <= 0) || (e < 0)) return GSL_NAN;
+    return sqrt(ORBIT_CONST_GM_SOLAR * (1 + e) / q) * 86400 / ORBIT_CONST_ASTRONOMICAL_UNIT;
+}
+
+//! orbitalElements_checksum - Return a checksum of the orbital elements of an object, so that results derived from
+//! them, such as cached apparent places, can be recognised as stale when the catalogue is updated
+//! \param [in] body_id - The id number of the object
+//! \return - An FNV-1a hash of the object's orbital elements, or 0 if it has none
+
+unsigned long orbitalElements_checksum(const int body_id) {
+    const orbitalElements *orbital_elements = orbitalElements_lookup(body_id);
+    if (orbital_elements == NULL) return 0;
+
+    const unsigned char *bytes = (const unsigned char *) orbital_elements;
+    unsigned long hash = 2166136261UL;
+    size_t i;
+    for (i = 0; i < sizeof(orbitalElements); i++) hash = ((hash ^ bytes[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    return hash;
+}
+
+//! orbitalElements_computeState - Main orbital elements computer. Return 3D position in ICRF, in AU, relative to the
+//! Sun (not the solar system barycentre!!). z-axis points towards the J2000.0 north celestial pole.
+//! \param [in] body_id - The id number of the object whose position is being queried
+//! \param [in] jd - The Julian day number at which the object's position is wanted; TT
+//! \param [out] x - The x position of the object relative to the Sun (in AU; ICRF; points to RA=0)
+//! \param [out] y - The y position of the object relative to the Sun (in AU; ICRF; points to RA=6h)
+//! \param [out] z - The z position of the object relative to the Sun (in AU; ICRF; points to NCP)
+//! \param [out] velocity - If not NULL, the velocity of the object relative to the Sun is returned here (AU per
+//! day; ICRF). Slow drifts in the orbital elements are neglected.
+
+static void orbitalElements_computeState(int body_id, double jd, double *x, double *y, double *z,
+                                        double *velocity) {
+    double v, r;
+
+    // const double epsilon = (23.4393 - 3.563E-7 * (jd - 2451544.5)) * M_PI / 180;
+
+    // Fetch data from the binary database file, and return NaN if object is not in database
+    const orbitalElements *orbital_elements = orbitalElements_lookup(body_id);
+    if (orbital_elements == NULL) {
+        *x = *y = *z = GSL_NAN;
+        return;
     }
 
     // Extract orbital elements from structure
@@ -1016,6 +1363,28 @@ void orbitalElements_computeXYZ(int body_id, double jd, double *x, double *y, do
     *y = yh_j2000 * cos(epsilon) - zh_j2000 * sin(epsilon);
     *z = yh_j2000 * sin(epsilon) + zh_j2000 * cos(epsilon);
 
+    // Velocity of object relative to the Sun, from the rates of change of its distance and true anomaly
+    if (velocity != NULL) {
+        const double gm = ORBIT_CONST_GM_SOLAR / gsl_pow_3(ORBIT_CONST_ASTRONOMICAL_UNIT) * gsl_pow_2(86400.);  // AU^3/day^2
+        const double p = r * (1 + e * cos(v));  // semi-latus rectum; AU
+        const double h = sqrt(gm * p);  // specific angular momentum; AU^2/day
+        const double v_dot = h / gsl_pow_2(r);  // rate of change of true anomaly; radians per day
+        const double r_dot = gm / h * e * sin(v);  // AU per day
+
+        // Derivative of the ecliptic coordinates with respect to the argument of latitude (v + w)
+        const double dx_du = -cos(N) * sin(v + w) - sin(N) * cos(v + w) * cos(inc);
+        const double dy_du = -sin(N) * sin(v + w) + cos(N) * cos(v + w) * cos(inc);
+        const double dz_du = cos(v + w) * sin(inc);
+
+        const double xh_dot = r_dot * xh_j2000 / r + r * v_dot * dx_du;
+        const double yh_dot = r_dot * yh_j2000 / r + r * v_dot * dy_du;
+        const double zh_dot = r_dot * zh_j2000 / r + r * v_dot * dz_du;
+
+        velocity[0] = xh_dot;
+        velocity[1] = yh_dot * cos(epsilon) - zh_dot * sin(epsilon);
+        velocity[2] = yh_dot * sin(epsilon) + zh_dot * cos(epsilon);
+    }
+
     // When debugging, show intermediate calculation
     if (DEBUG) {
         sprintf(temp_err_string, "a = %.10e km", a * ORBIT_CONST_ASTRONOMICAL_UNIT / 1e3);
@@ -1039,6 +1408,139 @@ void orbitalElements_computeXYZ(int body_id, double jd, double *x, double *y, do
     }
 }
 
+//! orbitalElements_computeXYZ - Return 3D position in ICRF, in AU, relative to the Sun (not the solar system
+//! barycentre!!). z-axis points towards the J2000.0 north celestial pole.
+//! \param [in] body_id - The id number of the object whose position is being queried
+//! \param [in] jd - The Julian day number at which the object's position is wanted; TT
+//! \param [out] x - The x position of the object relative to the Sun (in AU; ICRF; points to RA=0)
+//! \param [out] y - The y position of the object relative to the Sun (in AU; ICRF; points to RA=6h)
+//! \param [out] z - The z position of the object relative to the Sun (in AU; ICRF; points to NCP)
+
+void orbitalElements_computeXYZ(int body_id, double jd, double *x, double *y, double *z) {
+    orbitalElements_computeState(body_id, jd, x, y, z, NULL);
+}
+
+//! orbitalElements_computeXYZVelocity - Return 3D position and velocity in ICRF, relative to the Sun.
+//! \param [in] body_id - The id number of the object whose position is being queried
+//! \param [in] jd - The Julian day number at which the object's position is wanted; TT
+//! \param [out] x - The x,y,z position of the object relative to the Sun (in AU; ICRF)
+//! \param [out] velocity - The velocity of the object relative to the Sun (AU per day; ICRF)
+
+void orbitalElements_computeXYZVelocity(int body_id, double jd, double *x, double *y, double *z, double *velocity) {
+    double v[3] = {GSL_NAN, GSL_NAN, GSL_NAN};
+    orbitalElements_computeState(body_id, jd, x, y, z, v);
+    velocity[0] = v[0];
+    velocity[1] = v[1];
+    velocity[2] = v[2];
+}
+
+//! orbitalElements_computeEpochState - Look up the positions of the Earth and Sun at a particular time. These are
+//! needed to compute the ephemeris of any object at that time, and so when computing the ephemerides of many objects
+//! at the same time, they only need to be computed once.
+//! \param [in] jd - The Julian date to query; TT
+//! \param [out] state - The positions of the Earth and Sun at <jd>
+
+void orbitalElements_computeEpochState(const double jd, orbitalElementsEpochState *state) {
+    // Position of the Earth-Moon barycentre, relative to the solar system barycentre, AU
+    double EMX, EMY, EMZ;
+
+    double EMX_future, EMY_future, EMZ_future; // Position of the Earth-Moon centre of mass
+
+    state->jd = jd;
+
+    // Look up position of the Earth at this JD, so that we can convert XYZ coordinates relative to Sun into
+    // RA and Dec as observed from the Earth.
+    const double moon_earth_mass_ratio = ORBIT_MOON_MASS / (ORBIT_MOON_MASS + ORBIT_EARTH_MASS);
+
+    // Look up the Earth-Moon centre of mass position
+    jpl_computeXYZ(2, jd, &EMX, &EMY, &EMZ);
+
+    // Look up the Moon's position relative to the E-M centre of mass
+    jpl_computeXYZ(9, jd, &state->moon_pos[0], &state->moon_pos[1], &state->moon_pos[2]);
+
+    // Calculate the position of the Earth's centre of mass
+    state->earth_pos[0] = EMX - moon_earth_mass_ratio * state->moon_pos[0];
+    state->earth_pos[1] = EMY - moon_earth_mass_ratio * state->moon_pos[1];
+    state->earth_pos[2] = EMZ - moon_earth_mass_ratio * state->moon_pos[2];
+
+    // Look up the Sun's position, taking light travel time into account
+    {
+        jpl_computeXYZ(10, jd, &state->sun_pos[0], &state->sun_pos[1], &state->sun_pos[2]);
+
+        // Calculate light travel time
+        const double distance = gsl_hypot3(state->sun_pos[0] - state->earth_pos[0],
+                                           state->sun_pos[1] - state->earth_pos[1],
+                                           state->sun_pos[2] - state->earth_pos[2]);  // AU
+        const double light_travel_time = distance * ORBIT_CONST_ASTRONOMICAL_UNIT / ORBIT_CONST_SPEED_OF_LIGHT;
+
+        // Look up position of requested object at the time the light left the object
+        jpl_computeXYZ(10, jd - light_travel_time / 86400,
+                       &state->sun_pos[0], &state->sun_pos[1], &state->sun_pos[2]);
+    }
+
+    // Look up the Earth-Moon centre of mass position, a short time in the future
+    // We use this to calculate the Earth's velocity vector, which is needed to correct for aberration
+    // (see eqn 7.119 of the Explanatory Supplement)
+    jpl_computeXYZ(2, jd + ORBIT_EARTH_VELOCITY_TIMESTEP, &EMX_future, &EMY_future, &EMZ_future);
+    jpl_computeXYZ(9, jd + ORBIT_EARTH_VELOCITY_TIMESTEP,
+                   &state->moon_pos_future[0], &state->moon_pos_future[1], &state->moon_pos_future[2]);
+    state->earth_pos_future[0] = EMX_future - moon_earth_mass_ratio * state->moon_pos_future[0];
+    state->earth_pos_future[1] = EMY_future - moon_earth_mass_ratio * state->moon_pos_future[1];
+    state->earth_pos_future[2] = EMZ_future - moon_earth_mass_ratio * state->moon_pos_future[2];
+}
+
+//! orbitalElements_computeEpochStateGrid - Look up the positions of the Earth and Sun at many times, as
+//! <orbitalElements_computeEpochState> does for a single time. The positions of the Earth-Moon barycentre and Moon
+//! are evaluated for all of the times together with <jpl_computeXYZGrid>, which is much faster when the times are
+//! closely spaced. The Sun's position depends on the light travel time to the Earth, and so is looked up separately
+//! for each time.
+//! \param [in] count - The number of times
+//! \param [in] jd - The Julian dates to query, in time order; TT
+//! \param [out] states - The positions of the Earth and Sun at each time
+
+void orbitalElements_computeEpochStateGrid(const int count, const double *jd, orbitalElementsEpochState *states) {
+    const double moon_earth_mass_ratio = ORBIT_MOON_MASS / (ORBIT_MOON_MASS + ORBIT_EARTH_MASS);
+
+    // Work through the times in blocks, so that the workspace fits on the stack
+    double jd_future[ORBIT_EPOCH_GRID_BLOCK];
+    double emb[2][3][ORBIT_EPOCH_GRID_BLOCK], moon[2][3][ORBIT_EPOCH_GRID_BLOCK];
+    int i, j, k;
+
+    for (i = 0; i < count; i += ORBIT_EPOCH_GRID_BLOCK) {
+        const int m = (count - i < ORBIT_EPOCH_GRID_BLOCK) ? (count - i) : ORBIT_EPOCH_GRID_BLOCK;
+
+        // Look up the Earth-Moon centre of mass, and the Moon's position relative to it, now and a short time later.
+        // We use the latter to calculate the Earth's velocity vector, which is needed to correct for aberration.
+        for (j = 0; j < m; j++) jd_future[j] = jd[i + j] + ORBIT_EARTH_VELOCITY_TIMESTEP;
+        jpl_computeXYZGrid(2, m, jd + i, emb[0][0], emb[0][1], emb[0][2]);
+        jpl_computeXYZGrid(9, m, jd + i, moon[0][0], moon[0][1], moon[0][2]);
+        jpl_computeXYZGrid(2, m, jd_future, emb[1][0], emb[1][1], emb[1][2]);
+        jpl_computeXYZGrid(9, m, jd_future, moon[1][0], moon[1][1], moon[1][2]);
+
+        for (j = 0; j < m; j++) {
+            orbitalElementsEpochState *state = &states[i + j];
+            state->jd = jd[i + j];
+
+            // Calculate the position of the Earth's centre of mass
+            for (k = 0; k < 3; k++) {
+                state->moon_pos[k] = moon[0][k][j];
+                state->earth_pos[k] = emb[0][k][j] - moon_earth_mass_ratio * state->moon_pos[k];
+                state->moon_pos_future[k] = moon[1][k][j];
+                state->earth_pos_future[k] = emb[1][k][j] - moon_earth_mass_ratio * state->moon_pos_future[k];
+            }
+
+            // Look up the Sun's position, taking light travel time into account
+            jpl_computeXYZ(10, state->jd, &state->sun_pos[0], &state->sun_pos[1], &state->sun_pos[2]);
+            const double distance = gsl_hypot3(state->sun_pos[0] - state->earth_pos[0],
+                                               state->sun_pos[1] - state->earth_pos[1],
+                                               state->sun_pos[2] - state->earth_pos[2]);  // AU
+            const double light_travel_time = distance * ORBIT_CONST_ASTRONOMICAL_UNIT / ORBIT_CONST_SPEED_OF_LIGHT;
+            jpl_computeXYZ(10, state->jd - light_travel_time / 86400,
+                           &state->sun_pos[0], &state->sun_pos[1], &state->sun_pos[2]);
+        }
+    }
+}
+
 //! orbitalElements_computeEphemeris - Main entry point for estimating the position, brightness, etc of an object at
 //! a particular time, using orbital elements.
 //! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 2=Earth/Moon barycentre. 9=Pluto. 10=Sun, etc
@@ -1072,25 +1574,41 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
                                       double *eclipticDistance, const double ra_dec_epoch,
                                       const int do_topocentric_correction,
                                       const double topocentric_latitude, const double topocentric_longitude) {
-    // Position of the Sun relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
-    double sun_pos_x, sun_pos_y, sun_pos_z;
+    orbitalElementsEpochState state;
+    orbitalElements_computeEpochState(jd, &state);
+    orbitalElements_computeEphemerisAtEpoch(bodyId, &state, x, y, z, ra, dec, mag, phase, angSize, phySize, albedo,
+                                            sunDist, earthDist, sunAngDist, theta_eso, eclipticLongitude,
+                                            eclipticLatitude, eclipticDistance, ra_dec_epoch,
+                                            do_topocentric_correction, topocentric_latitude, topocentric_longitude);
+}
 
-    // Position of the Earth-Moon barycentre, relative to the solar system barycentre, AU
-    double EMX, EMY, EMZ;
+//! orbitalElements_computePositionAtEpoch - Compute the apparent position of an object, corrected for light travel
+//! time and aberration, using positions of the Earth and Sun which have already been computed by
+//! <orbitalElements_computeEpochState>. This is the first step of <orbitalElements_computeEphemerisAtEpoch>, for
+//! callers which need only the position of the object, and not its brightness, RA or Dec.
+//! \param [in] bodyId - The object ID number we want to query. 0=Mercury. 9=Moon. 10=Sun. 19=Earth, etc
+//! \param [in] state - The positions of the Earth and Sun at the time of observation
+//! \param [out] x - x,y,z position of body, in ICRF v2, in AU, relative to solar system barycentre.
+//! \param [out] y - x points to RA=0. y points to RA=6h.
+//! \param [out] z - z points to celestial north pole (i.e. J2000.0).
+
+void orbitalElements_computePositionAtEpoch(int bodyId, const orbitalElementsEpochState *state,
+                                            double *x, double *y, double *z) {
+    const double jd = state->jd;
 
-    // Moon's position relative to the Earth-Moon barycentre, AU
-    double moon_pos_x, moon_pos_y, moon_pos_z;
+    // Position of the Sun relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
+    const double sun_pos_x = state->sun_pos[0];
+    const double sun_pos_y = state->sun_pos[1];
+    const double sun_pos_z = state->sun_pos[2];
 
     // Earth's position relative to the solar system barycentre, J2000.0 equatorial coordinates, AU
-    double earth_pos_x, earth_pos_y, earth_pos_z;
+    const double earth_pos_x = state->earth_pos[0];
+    const double earth_pos_y = state->earth_pos[1];
+    const double earth_pos_z = state->earth_pos[2];
 
     // Boolean flags indicating whether this is the Earth, Sun or Moon (which need special treatment)
     int is_moon = 0, is_earth = 0, is_sun = 0;
 
-    double EMX_future, EMY_future, EMZ_future; // Position of the Earth-Moon centre of mass
-    double moon_pos_x_future, moon_pos_y_future, moon_pos_z_future;
-    double earth_pos_x_future, earth_pos_y_future, earth_pos_z_future;
-
     // Earth: Need to convert from Earth/Moon barycentre to geocentre
     if (bodyId == 19) {
         bodyId = 2;
@@ -1107,39 +1625,6 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
         is_sun = 1;
     }
 
-    // Look up position of the Earth at this JD, so that we can convert XYZ coordinates relative to Sun into
-    // RA and Dec as observed from the Earth.
-    // Below are values of GM3 and GMM from DE405. See
-    // <https://web.archive.org/web/20120220062549/http://iau-comm4.jpl.nasa.gov/de405iom/de405iom.pdf>
-    const double earth_mass = 0.8887692390113509e-9;
-    const double moon_mass = 0.1093189565989898e-10;
-    const double moon_earth_mass_ratio = moon_mass / (moon_mass + earth_mass);
-
-    // Look up the Earth-Moon centre of mass position
-    jpl_computeXYZ(2, jd, &EMX, &EMY, &EMZ);
-
-    // Look up the Moon's position relative to the E-M centre of mass
-    jpl_computeXYZ(9, jd, &moon_pos_x, &moon_pos_y, &moon_pos_z);
-
-    // Calculate the position of the Earth's centre of mass
-    earth_pos_x = EMX - moon_earth_mass_ratio * moon_pos_x;
-    earth_pos_y = EMY - moon_earth_mass_ratio * moon_pos_y;
-    earth_pos_z = EMZ - moon_earth_mass_ratio * moon_pos_z;
-
-    // Look up the Sun's position, taking light travel time into account
-    {
-        jpl_computeXYZ(10, jd, &sun_pos_x, &sun_pos_y, &sun_pos_z);
-
-        // Calculate light travel time
-        const double distance = gsl_hypot3(sun_pos_x - earth_pos_x,
-                                           sun_pos_y - earth_pos_y,
-                                           sun_pos_z - earth_pos_z);  // AU
-        const double light_travel_time = distance * ORBIT_CONST_ASTRONOMICAL_UNIT / ORBIT_CONST_SPEED_OF_LIGHT;
-
-        // Look up position of requested object at the time the light left the object
-        jpl_computeXYZ(10, jd - light_travel_time / 86400, &sun_pos_x, &sun_pos_y, &sun_pos_z);
-    }
-
     // If the user's query was about the Earth, we already know its position
     if (is_earth) {
         *x = earth_pos_x;
@@ -1156,9 +1641,9 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
 
         // If the user's query was about the Moon, we already know that position too
     else if (is_moon) {
-        *x = moon_pos_x + earth_pos_x;
-        *y = moon_pos_y + earth_pos_y;
-        *z = moon_pos_z + earth_pos_z;
+        *x = state->moon_pos[0] + earth_pos_x;
+        *y = state->moon_pos[1] + earth_pos_y;
+        *z = state->moon_pos[2] + earth_pos_z;
     }
 
         // Otherwise we need to use the orbital elements for the particular object the user was looking for,
@@ -1193,19 +1678,9 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
         *z = z_barycentric_1;
     }
 
-    // Look up the Earth-Moon centre of mass position, a short time in the future
-    // We use this to calculate the Earth's velocity vector, which is needed to correct for aberration
-    // (see eqn 7.119 of the Explanatory Supplement)
-    const double eb_dot_timestep = 1e-6; // days
-    const double eb_dot_timestep_sec = eb_dot_timestep * 86400;
-    jpl_computeXYZ(2, jd + eb_dot_timestep, &EMX_future, &EMY_future, &EMZ_future);
-    jpl_computeXYZ(9, jd + eb_dot_timestep, &moon_pos_x_future, &moon_pos_y_future, &moon_pos_z_future);
-    earth_pos_x_future = EMX_future - moon_earth_mass_ratio * moon_pos_x_future;
-    earth_pos_y_future = EMY_future - moon_earth_mass_ratio * moon_pos_y_future;
-    earth_pos_z_future = EMZ_future - moon_earth_mass_ratio * moon_pos_z_future;
-
     // Equation (7.118) of the Explanatory Supplement - correct for aberration
     if (!is_earth) {
+        const double eb_dot_timestep_sec = ORBIT_EARTH_VELOCITY_TIMESTEP * 86400;
         const double u1[3] = {
                 *x - earth_pos_x,
                 *y - earth_pos_y,
@@ -1214,9 +1689,9 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
         const double u1_mag = gsl_hypot3(u1[0], u1[1], u1[2]);
         const double u[3] = {u1[0] / u1_mag, u1[1] / u1_mag, u1[2] / u1_mag};
         const double eb_dot[3] = {
-                earth_pos_x_future - earth_pos_x,
-                earth_pos_y_future - earth_pos_y,
-                earth_pos_z_future - earth_pos_z
+                state->earth_pos_future[0] - earth_pos_x,
+                state->earth_pos_future[1] - earth_pos_y,
+                state->earth_pos_future[2] - earth_pos_z
         };
 
         // Speed of light in AU per time step
@@ -1232,11 +1707,32 @@ void orbitalElements_computeEphemeris(int bodyId, const double jd, double *x, do
         *y = earth_pos_y + (beta * u1[1] + f2 * u1_mag * V[1]) / (1 + f1);
         *z = earth_pos_z + (beta * u1[2] + f2 * u1_mag * V[2]) / (1 + f1);
     }
+}
+
+//! orbitalElements_computeEphemerisAtEpoch - Estimate the position, brightness, etc of an object, using positions of
+//! the Earth and Sun which have already been computed by <orbitalElements_computeEpochState>. The parameters are as
+//! for <orbitalElements_computeEphemeris>, except that the Julian date is taken from <state>.
+
+void orbitalElements_computeEphemerisAtEpoch(int bodyId, const orbitalElementsEpochState *state,
+                                             double *x, double *y, double *z, double *ra,
+                                             double *dec, double *mag, double *phase, double *angSize,
+                                             double *phySize, double *albedo, double *sunDist, double *earthDist,
+                                             double *sunAngDist, double *theta_eso, double *eclipticLongitude,
+                                             double *eclipticLatitude, double *eclipticDistance,
+                                             const double ra_dec_epoch, const int do_topocentric_correction,
+                                             const double topocentric_latitude,
+                                             const double topocentric_longitude) {
+    // Compute the apparent position of the object
+    orbitalElements_computePositionAtEpoch(bodyId, state, x, y, z);
+
+    // Earth: magnitudes are computed for the Earth/Moon barycentre's ID number
+    if (bodyId == 19) bodyId = 2;
 
     // Populate other quantities, like the brightness, RA and Dec of the object, based on its XYZ position
-    magnitudeEstimate(bodyId, *x, *y, *z, earth_pos_x, earth_pos_y, earth_pos_z, sun_pos_x, sun_pos_y, sun_pos_z, ra,
+    magnitudeEstimate(bodyId, *x, *y, *z, state->earth_pos[0], state->earth_pos[1], state->earth_pos[2],
+                      state->sun_pos[0], state->sun_pos[1], state->sun_pos[2], ra,
                       dec, mag, phase, angSize, phySize,
                       albedo, sunDist, earthDist, sunAngDist, theta_eso, eclipticLongitude, eclipticLatitude,
-                      eclipticDistance, ra_dec_epoch, jd,
+                      eclipticDistance, ra_dec_epoch, state->jd,
                       do_topocentric_correction, topocentric_latitude, topocentric_longitude);
 }
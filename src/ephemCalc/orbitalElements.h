@@ -24,14 +24,14 @@
 
 #include "coreUtils/strConstants.h"
 
-#define MAX_ASTEROIDS 1500000
+#define MAX_ASTEROIDS 2000000
 #define MAX_COMETS     200000
 #define MAX_PLANETS        50
 
+// The numeric orbital elements of an object, which are needed every time its position is computed. Names and flags,
+// which are needed far less often, are held in a parallel <orbitalElementsMetadata> table, so that scans over the
+// whole catalogue only pull these 128 bytes per object through the cache.
 typedef struct {
-    char name[24], name2[24];
-    int number;  // bodyId for planets; bodyId-10000000 for asteroids; bodyId-20000000 for comets
-    int secureOrbit;  // boolean flag indicating whether orbit is deemed secure
     double epochOsculation;  // Julian date
     double epochPerihelion;  // Julian date
     double absoluteMag;  // Absolute magnitude H
@@ -49,6 +49,36 @@ typedef struct {
     double slopeParam_n, slopeParam_G;
 } orbitalElements;
 
+// The descriptive information about an object, stored with the same indexing as its <orbitalElements> record
+typedef struct {
+    char name[24], name2[24];
+    int number;  // bodyId for planets; bodyId-10000000 for asteroids; bodyId-20000000 for comets
+    // Unnumbered asteroids are given numbers above that of the highest-numbered asteroid in the catalogue
+    int secureOrbit;  // boolean flag indicating whether orbit is deemed secure
+} orbitalElementsMetadata;
+
+// Masses of the Earth and Moon (GM3 and GMM from DE405), used to find the Earth's centre of mass from the position of
+// the Earth-Moon barycentre. See
+// <https://web.archive.org/web/20120220062549/http://iau-comm4.jpl.nasa.gov/de405iom/de405iom.pdf>
+#define ORBIT_EARTH_MASS 0.8887692390113509e-9
+#define ORBIT_MOON_MASS  0.1093189565989898e-10
+
+// Time step used to estimate the Earth's velocity by finite differencing, when correcting for aberration; days
+#define ORBIT_EARTH_VELOCITY_TIMESTEP 1e-6
+
+// The number of times whose Earth positions are evaluated together by <orbitalElements_computeEpochStateGrid>
+#define ORBIT_EPOCH_GRID_BLOCK 256
+
+// The positions of the Earth and Sun at a particular time, which are shared by all objects observed at that time
+typedef struct {
+    double jd;  // Julian date; TT
+    double earth_pos[3];  // Position of the Earth relative to the solar system barycentre; AU
+    double earth_pos_future[3];  // Position of the Earth a short time later, used to compute its velocity; AU
+    double sun_pos[3];  // Position of the Sun, allowing for light travel time to the Earth; AU
+    double moon_pos[3];  // Position of the Moon relative to the Earth; AU
+    double moon_pos_future[3];  // Position of the Moon relative to the Earth a short time later; AU
+} orbitalElementsEpochState;
+
 #ifndef ORBITALELEMENTS_C
 // Binary files containing the orbital elements of solar system objects
 extern FILE *planet_database_file;
@@ -65,21 +95,48 @@ extern orbitalElements *planet_database;
 extern orbitalElements *asteroid_database;
 extern orbitalElements *comet_database;
 
+// Blocks of memory used to hold the names and flags of each object
+extern orbitalElementsMetadata *planet_metadata;
+extern orbitalElementsMetadata *asteroid_metadata;
+extern orbitalElementsMetadata *comet_metadata;
+
 // Record of which entries we have loaded from each database
 extern unsigned char *planet_database_items_loaded;
 extern unsigned char *asteroid_database_items_loaded;
 extern unsigned char *comet_database_items_loaded;
 
+// Record of which metadata entries we have loaded from each database
+extern unsigned char *planet_metadata_items_loaded;
+extern unsigned char *asteroid_metadata_items_loaded;
+extern unsigned char *comet_metadata_items_loaded;
+
 // Pointers to the positions in the files where the orbitalElement structures begin
 extern int planet_database_offset;
 extern int asteroid_database_offset;
 extern int comet_database_offset;
 
-// Number of objects in each list
+// Pointers to the positions in the files where the orbitalElementsMetadata structures begin
+extern long planet_metadata_offset;
+extern long asteroid_metadata_offset;
+extern long comet_metadata_offset;
+
+// Number of objects in each list. Objects are packed densely into slots 0 to (count-1), in the order in which they
+// appear in the catalogue.
 extern int planet_count;
 extern int asteroid_count;
 extern int comet_count;
 
+// Tables mapping the number of each object (see <orbitalElementsMetadata>) to the slot it occupies, or -1 if there is
+// no object with that number.
+extern int *planet_slot_from_number;
+extern int *asteroid_slot_from_number;
+extern int *comet_slot_from_number;
+
+// The length of each of the tables above; one more than the highest object number
+extern int planet_number_count;
+extern int asteroid_number_count;
+extern int comet_number_count;
+
 // Number of objects with securely determined orbits
 extern int planet_secure_count;
 extern int asteroid_secure_count;
@@ -88,18 +145,47 @@ extern int comet_secure_count;
 
 void orbitalElements_planets_init();
 
+int orbitalElements_planets_slot(int number);
+
 orbitalElements *orbitalElements_planets_fetch(int index);
 
+orbitalElementsMetadata *orbitalElements_planets_fetchMetadata(int index);
+
 void orbitalElements_asteroids_init();
 
+int orbitalElements_asteroids_slot(int number);
+
 orbitalElements *orbitalElements_asteroids_fetch(int index);
 
+orbitalElementsMetadata *orbitalElements_asteroids_fetchMetadata(int index);
+
+void orbitalElements_asteroids_loadAll();
+
+void orbitalElements_asteroids_loadAllMetadata();
+
 void orbitalElements_comets_init();
 
+int orbitalElements_comets_slot(int number);
+
 orbitalElements *orbitalElements_comets_fetch(int index);
 
+orbitalElementsMetadata *orbitalElements_comets_fetchMetadata(int index);
+
+double orbitalElements_maxSpeed(int body_id, double jd);
+
+unsigned long orbitalElements_checksum(int body_id);
+
 void orbitalElements_computeXYZ(int body_id, double jd, double *x, double *y, double *z);
 
+void orbitalElements_computeXYZVelocity(int body_id, double jd, double *x, double *y, double *z, double *velocity);
+
+void orbitalElements_computeEpochState(double jd, orbitalElementsEpochState *state);
+
+void orbitalElements_computeEpochStateGrid(int count, const double *jd, orbitalElementsEpochState *states);
+
+void orbitalElements_computePositionAtEpoch(int bodyId, const orbitalElementsEpochState *state,
+                                            double *x, double *y, double *z);
+
 void orbitalElements_computeEphemeris(int bodyId, double jd, double *x, double *y, double *z, double *ra,
                                       double *dec, double *mag, double *phase, double *angSize, double *phySize,
                                       double *albedo, double *sunDist, double *earthDist, double *sunAngDist,
@@ -108,4 +194,13 @@ void orbitalElements_computeEphemeris(int bodyId, double jd, double *x, double *
                                       int do_topocentric_correction,
                                       double topocentric_latitude, double topocentric_longitude);
 
+void orbitalElements_computeEphemerisAtEpoch(int bodyId, const orbitalElementsEpochState *state,
+                                             double *x, double *y, double *z, double *ra,
+                                             double *dec, double *mag, double *phase, double *angSize,
+                                             double *phySize, double *albedo, double *sunDist, double *earthDist,
+                                             double *sunAngDist, double *theta_eso, double *eclipticLongitude,
+                                             double *eclipticLatitude, double *eclipticDistance,
+                                             double ra_dec_epoch, int do_topocentric_correction,
+                                             double topocentric_latitude, double topocentric_longitude);
+
 #endif
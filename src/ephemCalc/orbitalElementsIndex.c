@@ -0,0 +1,297 @@
+// orbitalElementsIndex.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#define ORBITALELEMENTSINDEX_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "orbitalElements.h"
+#include "orbitalElementsIndex.h"
+
+// The orbital elements by which the asteroid catalogue is indexed
+#define INDEX_A    0
+#define INDEX_E    1
+#define INDEX_INC  2
+#define INDEX_Q    3
+#define INDEX_H    4
+#define N_INDEX_KEYS 5
+
+// An entry in a sorted index. Values are stored in single precision to halve the size of the index; every object
+// which the index selects is then checked against the double-precision orbital elements.
+typedef struct {
+    float value;
+    int slot;
+} indexEntry;
+
+// Lists of the slots occupied by asteroids, sorted by each of the orbital elements we index
+static indexEntry *asteroid_index[N_INDEX_KEYS];
+
+// The number of entries in each sorted list. Objects where the orbital element is NaN are left out.
+static int asteroid_index_length[N_INDEX_KEYS];
+
+// List of the slots occupied by asteroids with secure orbits, in ascending order
+static int *asteroid_secure_slots = NULL;
+static int asteroid_secure_slot_count = 0;
+
+// Flag indicating whether the indexes above have been built
+static int asteroid_index_built = 0;
+
+//! index_key_value - Return the value of one of the indexed orbital elements of an object
+//! \param elements - The orbital elements of the object
+//! \param key - The orbital element to return, e.g. INDEX_A
+//! \return - The value of the orbital element
+
+static double index_key_value(const orbitalElements *elements, const int key) {
+    switch (key) {
+        case INDEX_A:
+            return elements->semiMajorAxis;
+        case INDEX_E:
+            return elements->eccentricity;
+        case INDEX_INC:
+            return elements->inclination;
+        case INDEX_Q:
+            return elements->semiMajorAxis * (1 - elements->eccentricity);
+        case INDEX_H:
+            return elements->absoluteMag;
+        default:
+            return GSL_NAN;
+    }
+}
+
+//! index_compare_entries - Comparison function used to sort an index by value, and then by slot
+
+static int index_compare_entries(const void *a, const void *b) {
+    const indexEntry *ea = (const indexEntry *) a;
+    const indexEntry *eb = (const indexEntry *) b;
+    if (ea->value < eb->value) return -1;
+    if (ea->value > eb->value) return 1;
+    return ea->slot - eb->slot;
+}
+
+//! index_compare_slots - Comparison function used to sort a list of slots into ascending order
+
+static int index_compare_slots(const void *a, const void *b) {
+    return *((const int *) a) - *((const int *) b);
+}
+
+//! orbitalElementsIndex_asteroids_build - Load the whole asteroid catalogue and build sorted indexes of it. This is
+//! only done once, the first time that a query is made.
+
+static void orbitalElementsIndex_asteroids_build() {
+    int i, key;
+
+    orbitalElements_asteroids_loadAll();
+    orbitalElements_asteroids_loadAllMetadata();
+
+    for (key = 0; key < N_INDEX_KEYS; key++) {
+        asteroid_index[key] = (indexEntry *) lt_malloc(asteroid_count * sizeof(indexEntry));
+        if (asteroid_index[key] == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+
+        int length = 0;
+        for (i = 0; i < asteroid_count; i++) {
+            const double value = index_key_value(&asteroid_database[i], key);
+            if (!gsl_finite(value)) continue;
+            asteroid_index[key][length].value = (float) value;
+            asteroid_index[key][length].slot = i;
+            length++;
+        }
+        qsort(asteroid_index[key], length, sizeof(indexEntry), index_compare_entries);
+        asteroid_index_length[key] = length;
+    }
+
+    asteroid_secure_slots = (int *) lt_malloc(asteroid_count * sizeof(int));
+    if (asteroid_secure_slots == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    asteroid_secure_slot_count = 0;
+    for (i = 0; i < asteroid_count; i++) {
+        if (asteroid_metadata[i].secureOrbit) asteroid_secure_slots[asteroid_secure_slot_count++] = i;
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Built orbital element index of %d asteroids.", asteroid_count);
+        ephem_log(temp_err_string);
+    }
+}
+
+//! orbitalElementsIndex_asteroids_init - Make sure that the asteroid index has been built, in thread-safe fashion
+
+static void orbitalElementsIndex_asteroids_init() {
+    orbitalElements_asteroids_init();
+
+#pragma omp critical (asteroids_index)
+    {
+        if (!asteroid_index_built) {
+            orbitalElementsIndex_asteroids_build();
+            asteroid_index_built = 1;
+        }
+    }
+}
+
+//! index_range - Find the range of entries in a sorted index which may lie within [min, max]. Because the index is
+//! held in single precision, the range is widened slightly, and may include a few objects which lie just outside.
+//! \param [in] key - The orbital element to look up, e.g. INDEX_A
+//! \param [in] min - The minimum value to select
+//! \param [in] max - The maximum value to select
+//! \param [out] start - The first entry in the index to consider
+//! \param [out] end - One more than the last entry in the index to consider
+
+static void index_range(const int key, const double min, const double max, int *start, int *end) {
+    const indexEntry *list = asteroid_index[key];
+    const int length = asteroid_index_length[key];
+    int lower, upper;
+
+    // Find the first entry which is no smaller than <min>
+    if (!gsl_finite(min)) {
+        *start = 0;
+    } else {
+        const float threshold = nextafterf((float) min, -INFINITY);
+        lower = 0;
+        upper = length;
+        while (lower < upper) {
+            const int mid = (lower + upper) / 2;
+            if (list[mid].value < threshold) lower = mid + 1;
+            else upper = mid;
+        }
+        *start = lower;
+    }
+
+    // Find the first entry which is larger than <max>
+    if (!gsl_finite(max)) {
+        *end = length;
+    } else {
+        const float threshold = nextafterf((float) max, INFINITY);
+        lower = *start;
+        upper = length;
+        while (lower < upper) {
+            const int mid = (lower + upper) / 2;
+            if (list[mid].value <= threshold) lower = mid + 1;
+            else upper = mid;
+        }
+        *end = lower;
+    }
+}
+
+//! orbitalElementsIndex_defaultFilter - Populate an orbitalElementsFilter structure with values which select all
+//! asteroids with secure orbits.
+//! \param [out] filter - The filter structure to populate
+
+void orbitalElementsIndex_defaultFilter(orbitalElementsFilter *filter) {
+    filter->a_min = filter->e_min = filter->inc_min = filter->q_min = filter->H_min = GSL_NEGINF;
+    filter->a_max = filter->e_max = filter->inc_max = filter->q_max = filter->H_max = GSL_POSINF;
+    filter->secure_only = 1;
+}
+
+//! orbitalElementsIndex_asteroids_query - Make a list of all the asteroids whose orbital elements lie within the
+//! ranges specified in a filter. The work done is proportional to the number of objects within the most selective of
+//! the ranges, rather than to the size of the whole catalogue.
+//! \param [in] filter - The ranges of orbital elements to select
+//! \param [out] slots_out - Array to populate with the slots occupied by the selected asteroids, in ascending order,
+//! and terminated by -1. Must have room for (asteroid_count + 1) entries.
+//! \return - The number of asteroids selected
+
+int orbitalElementsIndex_asteroids_query(const orbitalElementsFilter *filter, int *slots_out) {
+    int i, key, count = 0;
+    double min[N_INDEX_KEYS], max[N_INDEX_KEYS];
+    int active[N_INDEX_KEYS];
+
+    orbitalElementsIndex_asteroids_init();
+
+    min[INDEX_A] = filter->a_min;
+    max[INDEX_A] = filter->a_max;
+    min[INDEX_E] = filter->e_min;
+    max[INDEX_E] = filter->e_max;
+    min[INDEX_INC] = filter->inc_min;
+    max[INDEX_INC] = filter->inc_max;
+    min[INDEX_Q] = filter->q_min;
+    max[INDEX_Q] = filter->q_max;
+    min[INDEX_H] = filter->H_min;
+    max[INDEX_H] = filter->H_max;
+
+    // Work out which list of candidates is shortest. Start by assuming we need to check the whole catalogue.
+    int best_key = -1, best_start = 0, best_end = asteroid_count;
+    int use_secure_list = 0;
+
+    if (filter->secure_only) {
+        use_secure_list = 1;
+        best_end = asteroid_secure_slot_count;
+    }
+
+    for (key = 0; key < N_INDEX_KEYS; key++) {
+        int start, end;
+        active[key] = gsl_finite(min[key]) || gsl_finite(max[key]);
+        if (!active[key]) continue;
+        index_range(key, min[key], max[key], &start, &end);
+        if (end - start < best_end - best_start) {
+            best_key = key;
+            best_start = start;
+            best_end = end;
+            use_secure_list = 0;
+        }
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Asteroid query has %d candidates.", best_end - best_start);
+        ephem_log(temp_err_string);
+    }
+
+    // Check each candidate against all of the ranges in turn
+    for (i = best_start; i < best_end; i++) {
+        int slot, pass = 1;
+        if (best_key >= 0) slot = asteroid_index[best_key][i].slot;
+        else if (use_secure_list) slot = asteroid_secure_slots[i];
+        else slot = i;
+
+        if (filter->secure_only && !asteroid_metadata[slot].secureOrbit) continue;
+
+        for (key = 0; (key < N_INDEX_KEYS) && pass; key++) {
+            if (!active[key]) continue;
+            const double value = index_key_value(&asteroid_database[slot], key);
+            pass = (value >= min[key]) && (value <= max[key]);
+        }
+
+        if (pass) slots_out[count++] = slot;
+    }
+
+    // Candidates taken from a sorted index are not in slot order; sort them so that the catalogue is accessed in order
+    if (best_key >= 0) qsort(slots_out, count, sizeof(int), index_compare_slots);
+    slots_out[count] = -1;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Asteroid query selected %d objects.", count);
+        ephem_log(temp_err_string);
+    }
+
+    return count;
+}
@@ -0,0 +1,40 @@
+// orbitalElementsIndex.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef ORBITALELEMENTSINDEX_H
+#define ORBITALELEMENTSINDEX_H 1
+
+// Ranges of orbital elements used to select a subset of the asteroid catalogue. Each range is inclusive, and a range
+// which extends from -infinity to +infinity is not applied at all.
+typedef struct {
+    double a_min, a_max;  // semi-major axis; AU
+    double e_min, e_max;  // eccentricity
+    double inc_min, inc_max;  // inclination; radians
+    double q_min, q_max;  // perihelion distance a(1-e); AU
+    double H_min, H_max;  // absolute magnitude
+    int secure_only;  // boolean flag indicating whether to select only objects with secure orbits
+} orbitalElementsFilter;
+
+void orbitalElementsIndex_defaultFilter(orbitalElementsFilter *filter);
+
+int orbitalElementsIndex_asteroids_query(const orbitalElementsFilter *filter, int *slots_out);
+
+#endif
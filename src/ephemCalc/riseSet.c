@@ -0,0 +1,224 @@
+// riseSet.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// Rise, set and transit times are computed in the manner of chapter 15 of Meeus' Astronomical Algorithms. The
+// apparent position of each object is computed at 0h, 12h and 24h on each day, and these positions are shared by all
+// sites. At each site, the time of each event is predicted from the object's hour angle, and then refined by a few
+// Newton-Raphson steps, using positions interpolated from the three samples. No further ephemeris lookups are made
+// per site, so the cost of each additional site is only a few dozen trigonometric functions per object.
+
+#define RISESET_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <gsl/gsl_const_mksa.h>
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+#include "jpl.h"
+#include "orbitalElements.h"
+#include "riseSet.h"
+
+// Equatorial radius of the Earth
+#define RISESET_EARTH_RADIUS 6378137.0  /* metres */
+
+// The rate at which the Earth rotates relative to the equinox; sidereal days per solar day
+#define RISESET_SIDEREAL_RATE 1.00273790935
+
+// Precision with which the times of events are determined; days
+#define RISESET_TIME_TOLERANCE 1e-6
+
+// Maximum number of Newton-Raphson steps used to refine the time of each event
+#define RISESET_MAX_ITERATIONS 10
+
+// Largest Newton-Raphson step allowed; days
+#define RISESET_MAX_STEP 0.1
+
+//! rise_set_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *rise_set_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! rise_set_wrap - Wrap an angle into the range -pi to pi
+
+static double rise_set_wrap(double angle) {
+    angle = fmod(angle, 2 * M_PI);
+    if (angle > M_PI) angle -= 2 * M_PI;
+    if (angle <= -M_PI) angle += 2 * M_PI;
+    return angle;
+}
+
+//! rise_set_interpolate - Interpolate between samples taken at 0h, 12h and 24h, using a quadratic polynomial
+//! \param [in] y - The three samples
+//! \param [in] m - The time, as a fraction of a day after 0h
+//! \return - The interpolated value
+
+static double rise_set_interpolate(const double *y, const double m) {
+    return 2 * (m - 0.5) * (m - 1) * y[0] - 4 * m * (m - 1) * y[1] + 2 * m * (m - 0.5) * y[2];
+}
+
+//! riseSet_init - Allocate storage for the positions of a list of objects through a day
+//! \param [in] body_id - The bodyIds of the objects
+//! \param [in] object_count - The number of objects
+//! \return - Storage for the positions of the objects, to be filled by <riseSet_prepareDay>
+
+riseSetDay *riseSet_init(const int *body_id, const int object_count) {
+    int i;
+    riseSetDay *day = (riseSetDay *) rise_set_malloc(sizeof(riseSetDay));
+    day->object_count = object_count;
+    day->jd0 = GSL_NAN;
+    day->body_id = (int *) rise_set_malloc((object_count + 1) * sizeof(int));
+    day->ra = (double (*)[RISESET_SAMPLES]) rise_set_malloc((object_count + 1) * RISESET_SAMPLES * sizeof(double));
+    day->dec = (double (*)[RISESET_SAMPLES]) rise_set_malloc((object_count + 1) * RISESET_SAMPLES * sizeof(double));
+    day->h0 = (double *) rise_set_malloc((object_count + 1) * sizeof(double));
+    for (i = 0; i < object_count; i++) day->body_id[i] = body_id[i];
+    return day;
+}
+
+//! riseSet_prepareDay - Compute the positions of a list of objects at 0h, 12h and 24h on a particular day. The
+//! positions of the Earth and Sun are computed once for each time, and shared between all objects. If the previous
+//! call was for the previous day, its position at 24h is reused.
+//! \param [in|out] day - The list of objects, as returned by <riseSet_init>
+//! \param [in] jd0 - The Julian date of 0h UT on the day
+
+void riseSet_prepareDay(riseSetDay *day, const double jd0) {
+    int i, sample, first_sample = 0;
+
+    if (day->jd0 == jd0 - 1) {
+        for (i = 0; i < day->object_count; i++) {
+            day->ra[i][0] = day->ra[i][RISESET_SAMPLES - 1];
+            day->dec[i][0] = day->dec[i][RISESET_SAMPLES - 1];
+        }
+        first_sample = 1;
+    }
+
+    day->jd0 = jd0;
+    day->sidereal0 = sidereal_time(unix_from_jd(jd0)) * M_PI / 12;
+
+    for (sample = first_sample; sample < RISESET_SAMPLES; sample++) {
+        orbitalElementsEpochState state;
+        const double jd = jd0 + sample / (RISESET_SAMPLES - 1.);
+        orbitalElements_computeEpochState(jd, &state);
+
+#pragma omp parallel for private(i)
+        for (i = 0; i < day->object_count; i++) {
+            double ra, dec, x, y, z, mag, phase, ang_size, phy_size, albedo, sun_dist, earth_dist, sun_ang_dist;
+            double theta_eso, ecliptic_longitude, ecliptic_latitude, ecliptic_distance;
+
+            jpl_computeEphemerisAtEpoch(day->body_id[i], &state, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size,
+                                        &phy_size, &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                        &ecliptic_longitude, &ecliptic_latitude, &ecliptic_distance, jd, 0, 0, 0);
+            day->ra[i][sample] = ra;
+            day->dec[i][sample] = dec;
+
+            // The standard altitude at which objects rise and set, allowing for refraction, and for the Sun's
+            // semi-diameter and the Moon's parallax. Meeus (15.1)
+            if (sample == 1) {
+                if (day->body_id[i] == 10) {
+                    day->h0[i] = -0.8333 * M_PI / 180;
+                } else if (day->body_id[i] == 9) {
+                    const double parallax = asin(RISESET_EARTH_RADIUS / (earth_dist * GSL_CONST_MKSA_ASTRONOMICAL_UNIT));
+                    day->h0[i] = 0.7275 * parallax - 0.5667 * M_PI / 180;
+                } else {
+                    day->h0[i] = -0.5667 * M_PI / 180;
+                }
+            }
+        }
+    }
+}
+
+//! riseSet_compute - Compute the times when an object rises, transits and sets at a particular site
+//! \param [in] day - The positions of the objects through the day, from <riseSet_prepareDay>
+//! \param [in] object - The index of the object within <day>
+//! \param [in] latitude - The latitude of the site; degrees
+//! \param [in] longitude - The longitude of the site, east of Greenwich; degrees
+//! \param [out] out - The times of the events
+
+void riseSet_compute(const riseSetDay *day, const int object, const double latitude, const double longitude,
+                     riseSetTimes *out) {
+    const double phi = latitude * M_PI / 180;
+    const double lambda = longitude * M_PI / 180;
+    const double *dec = day->dec[object];
+    const double h0 = day->h0[object];
+    double ra[RISESET_SAMPLES];
+    int i, event, iteration;
+
+    // Make the RA samples continuous, rather than wrapping them at 2pi
+    ra[0] = day->ra[object][0];
+    for (i = 1; i < RISESET_SAMPLES; i++) ra[i] = ra[i - 1] + rise_set_wrap(day->ra[object][i] - ra[i - 1]);
+
+    // Predict the time of transit from the object's hour angle at 0h, and then refine it. Meeus (15.2)
+    double m_transit = (ra[0] - lambda - day->sidereal0) / (2 * M_PI);
+    m_transit -= floor(m_transit);
+    for (iteration = 0; iteration < RISESET_MAX_ITERATIONS; iteration++) {
+        const double hour_angle = rise_set_wrap(day->sidereal0 + 2 * M_PI * RISESET_SIDEREAL_RATE * m_transit +
+                                                lambda - rise_set_interpolate(ra, m_transit));
+        const double step = -hour_angle / (2 * M_PI);
+        m_transit += step;
+        if (fabs(step) < RISESET_TIME_TOLERANCE) break;
+    }
+
+    const double dec_transit = rise_set_interpolate(dec, m_transit);
+    out->transit_altitude = asin(sin(phi) * sin(dec_transit) + cos(phi) * cos(dec_transit));
+    out->jd_transit = ((m_transit >= 0) && (m_transit < 1)) ? day->jd0 + m_transit : GSL_NAN;
+    out->jd_rise = out->jd_set = GSL_NAN;
+
+    // Objects which never rise or never set
+    const double cos_h0 = (sin(h0) - sin(phi) * sin(dec_transit)) / (cos(phi) * cos(dec_transit));
+    if (fabs(cos_h0) > 1) return;
+
+    // Predict the times of rising and setting from the hour angle at which the object crosses the altitude <h0>,
+    // and then refine them. Meeus (15.2)
+    for (event = -1; event <= 1; event += 2) {
+        double m = m_transit + event * acos(cos_h0) / (2 * M_PI);
+        m -= floor(m);
+
+        for (iteration = 0; iteration < RISESET_MAX_ITERATIONS; iteration++) {
+            const double hour_angle = rise_set_wrap(day->sidereal0 + 2 * M_PI * RISESET_SIDEREAL_RATE * m +
+                                                    lambda - rise_set_interpolate(ra, m));
+            const double dec_m = rise_set_interpolate(dec, m);
+            const double altitude = asin(sin(phi) * sin(dec_m) + cos(phi) * cos(dec_m) * cos(hour_angle));
+            double step = (altitude - h0) / (2 * M_PI * cos(dec_m) * cos(phi) * sin(hour_angle));
+            if (!gsl_finite(step)) break;
+            step = GSL_MAX(-RISESET_MAX_STEP, GSL_MIN(RISESET_MAX_STEP, step));
+            m += step;
+            if (fabs(step) < RISESET_TIME_TOLERANCE) break;
+        }
+
+        if ((m < 0) || (m >= 1)) continue;
+        if (event < 0) out->jd_rise = day->jd0 + m;
+        else out->jd_set = day->jd0 + m;
+    }
+}
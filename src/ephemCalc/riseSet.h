@@ -0,0 +1,50 @@
+// riseSet.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef RISESET_H
+#define RISESET_H 1
+
+// The number of times each day at which the position of each object is sampled: 0h, 12h and 24h
+#define RISESET_SAMPLES 3
+
+// The positions of a list of objects through one day, which are shared by all sites
+typedef struct {
+    int object_count;
+    int *body_id;
+    double jd0;  // The start of the day; 0h UT
+    double sidereal0;  // Greenwich sidereal time at <jd0>; radians
+    double (*ra)[RISESET_SAMPLES], (*dec)[RISESET_SAMPLES];  // Apparent geocentric position, equinox of date; radians
+    double *h0;  // Altitude of each object's centre when it rises and sets; radians
+} riseSetDay;
+
+// The times when an object rises, transits and sets at a particular site
+typedef struct {
+    double jd_rise, jd_transit, jd_set;  // NaN if the event does not happen during the day
+    double transit_altitude;  // Altitude of the object at transit; radians
+} riseSetTimes;
+
+riseSetDay *riseSet_init(const int *body_id, int object_count);
+
+void riseSet_prepareDay(riseSetDay *day, double jd0);
+
+void riseSet_compute(const riseSetDay *day, int object, double latitude, double longitude, riseSetTimes *out);
+
+#endif
@@ -0,0 +1,117 @@
+// siteList.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#define SITELIST_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "siteList.h"
+
+//! site_list_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *site_list_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! site_list_parse_line - Read the name and position of a site from a line of a site list
+//! \param [in] line - The line of text to parse
+//! \param [out] name - The name of the site
+//! \param [out] latitude - The latitude of the site; degrees
+//! \param [out] longitude - The longitude of the site, east of Greenwich; degrees
+//! \return - Zero if the line does not describe a site
+
+static int site_list_parse_line(const char *line, char *name, double *latitude, double *longitude) {
+    char name_format[32];
+
+    // Ignore blank lines and comment lines
+    if ((line[0] == '\0') || (line[0] == '#')) return 0;
+
+    snprintf(name_format, sizeof(name_format), "%%%ds %%lf %%lf", SITE_NAME_LENGTH - 1);
+    return sscanf(line, name_format, name, latitude, longitude) == 3;
+}
+
+//! siteList_load - Read a list of sites from a text file. Each line of the file should contain the name of a site
+//! (without spaces), its latitude, and its longitude east of Greenwich, in degrees. Lines starting with # are ignored.
+//! \param [in] filename - The filename of the site list
+//! \return - The list of sites
+
+siteList *siteList_load(const char *filename) {
+    char line[FNAME_LENGTH], name[SITE_NAME_LENGTH];
+    double latitude, longitude;
+    int i;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Opening file <%s>", filename);
+        ephem_log(temp_err_string);
+    }
+
+    FILE *input = fopen(filename, "rt");
+    if (input == NULL) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Could not open site list <%s>.", filename);
+        ephem_fatal(__FILE__, __LINE__, temp_err_string);
+        exit(1);
+    }
+
+    siteList *sites = (siteList *) site_list_malloc(sizeof(siteList));
+
+    // Count the sites in the file, so that we know how much storage to allocate
+    sites->site_count = 0;
+    while ((!feof(input)) && (!ferror(input))) {
+        file_readline(input, line);
+        if (site_list_parse_line(line, name, &latitude, &longitude)) sites->site_count++;
+    }
+
+    sites->name = (char (*)[SITE_NAME_LENGTH]) site_list_malloc((sites->site_count + 1) * SITE_NAME_LENGTH);
+    sites->latitude = (double *) site_list_malloc((sites->site_count + 1) * sizeof(double));
+    sites->longitude = (double *) site_list_malloc((sites->site_count + 1) * sizeof(double));
+
+    // Read the sites
+    rewind(input);
+    i = 0;
+    while ((!feof(input)) && (!ferror(input)) && (i < sites->site_count)) {
+        file_readline(input, line);
+        if (!site_list_parse_line(line, name, &latitude, &longitude)) continue;
+        strcpy(sites->name[i], name);
+        sites->latitude[i] = latitude;
+        sites->longitude[i] = longitude;
+        i++;
+    }
+    fclose(input);
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Read %d sites.", sites->site_count);
+        ephem_log(temp_err_string);
+    }
+    return sites;
+}
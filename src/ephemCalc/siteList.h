@@ -0,0 +1,37 @@
+// siteList.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef SITELIST_H
+#define SITELIST_H 1
+
+// The maximum length of the name of a site
+#define SITE_NAME_LENGTH 64
+
+// A list of places on the Earth's surface
+typedef struct {
+    int site_count;
+    char (*name)[SITE_NAME_LENGTH];
+    double *latitude, *longitude;  // Geodetic latitude, and longitude east of Greenwich; degrees
+} siteList;
+
+siteList *siteList_load(const char *filename);
+
+#endif
@@ -0,0 +1,481 @@
+// skyIndex.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#define SKYINDEX_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/sphericalAst.h"
+
+#include "orbitalElements.h"
+#include "skyIndex.h"
+
+// Upper limit on the speed of the geocentre relative to the Sun. The Earth-Moon barycentre moves at up to 0.01750
+// AU/day at perihelion, to which we add the Earth's motion around it and the Sun's motion around the barycentre.
+#define SKY_INDEX_EARTH_SPEED 0.0176
+
+// The speed of light; AU per day
+#define SKY_INDEX_SPEED_OF_LIGHT 173.1446
+
+// Margin added to every distance limit, to allow for positions being stored in single precision; radians
+#define SKY_INDEX_MARGIN 1e-5
+
+//! sky_index_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *sky_index_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! sky_index_cell - Work out which cell on the sky contains a particular position
+//! \param index - The sky index
+//! \param ra - The right ascension of the position; radians
+//! \param dec - The declination of the position; radians
+//! \return - The number of the cell, or -1 if the position is not finite
+
+static int sky_index_cell(const skyIndex *index, double ra, const double dec) {
+    if ((!gsl_finite(ra)) || (!gsl_finite(dec))) return -1;
+
+    int band = (int) floor((dec + M_PI / 2) / M_PI * index->band_count);
+    if (band < 0) band = 0;
+    if (band >= index->band_count) band = index->band_count - 1;
+
+    const int cells_in_band = index->band_start[band + 1] - index->band_start[band];
+    ra = fmod(ra, 2 * M_PI);
+    if (ra < 0) ra += 2 * M_PI;
+    int cell = (int) floor(ra / (2 * M_PI) * cells_in_band);
+    if (cell < 0) cell = 0;
+    if (cell >= cells_in_band) cell = cells_in_band - 1;
+
+    return index->band_start[band] + cell;
+}
+
+//! sky_index_motion_limit - Work out an upper limit on how far an object may move across the sky, as seen from the
+//! geocentre, during an interval of time after it is sampled. The object's displacement relative to the geocentre
+//! cannot exceed <speed> times the length of the interval, and a displacement D can turn the line of sight from a
+//! distance r by at most asin(D/r). Annual aberration shifts every apparent position by at most v_earth / c, which
+//! may change in either direction between the sample and the query.
+//! \param speed - Upper limit on the speed of the object relative to the geocentre; AU per day
+//! \param earth_dist - The object's distance from the geocentre when it was sampled; AU
+//! \param interval - The length of the interval; days
+//! \return - Upper limit on the object's angular displacement from its sampled position; radians
+
+static double sky_index_motion_limit(const double speed, const double earth_dist, const double interval) {
+    // Changes in light travel time may make the object's retarded position move slightly faster than it does
+    const double displacement = speed * (1 + speed / SKY_INDEX_SPEED_OF_LIGHT) * interval;
+    const double aberration = 2 * SKY_INDEX_EARTH_SPEED / SKY_INDEX_SPEED_OF_LIGHT;
+
+    if ((!gsl_finite(displacement)) || (!(displacement < earth_dist))) return M_PI;
+    return GSL_MIN(M_PI, asin(displacement / earth_dist) + aberration + SKY_INDEX_MARGIN);
+}
+
+//! sky_index_enclosing_radius - Work out the radius of a circle around the centre of a box of RA and Dec which
+//! encloses the whole box. Along the top and bottom edges of the box, points are most distant from the centre at the
+//! corners. But if the box is more than 180 degrees wide in RA, the most distant point on each side edge may lie
+//! part-way along it, at the point closest to the antipode of the centre.
+//! \param ra_centre - The right ascension of the centre of the box; radians
+//! \param half_width - Half the width of the box in right ascension; radians
+//! \param dec_min - The minimum declination of the box; radians
+//! \param dec_max - The maximum declination of the box; radians
+//! \return - The radius of the enclosing circle; radians
+
+static double sky_index_enclosing_radius(const double ra_centre, const double half_width, const double dec_min,
+                                         const double dec_max) {
+    const double dec_centre = (dec_min + dec_max) / 2;
+
+    // A box which spans all RAs, and contains the antipode of its centre, can only be enclosed by the whole sky
+    if ((half_width >= M_PI) && (-dec_centre >= dec_min) && (-dec_centre <= dec_max)) return M_PI;
+
+    double radius = angDist_RADec(ra_centre, dec_centre, ra_centre - half_width, dec_min);
+    radius = GSL_MAX(radius, angDist_RADec(ra_centre, dec_centre, ra_centre - half_width, dec_max));
+
+    // Along a side edge, the cosine of the distance from the centre is sin(dec_c)sin(dec) + cos(dec_c)cos(dec)cos(h),
+    // which is smallest at the declination below. The two side edges are mirror images of each other.
+    const double dec_far = atan2(-sin(dec_centre), -cos(dec_centre) * cos(half_width));
+    if ((dec_far > dec_min) && (dec_far < dec_max)) {
+        radius = GSL_MAX(radius, angDist_RADec(ra_centre, dec_centre, ra_centre - half_width, dec_far));
+    }
+    return radius;
+}
+
+//! sky_index_make_cells - Divide the sky into bands of declination, and divide each band into cells of right
+//! ascension which are roughly <cell_size> wide.
+//! \param index - The sky index whose cells are to be set up
+
+static void sky_index_make_cells(skyIndex *index) {
+    int b, c;
+
+    index->band_count = (int) ceil(M_PI / index->cell_size);
+    const double band_height = M_PI / index->band_count;
+    index->band_start = (int *) sky_index_malloc((index->band_count + 1) * sizeof(int));
+
+    // Work out how many cells of right ascension are needed in each band
+    index->band_start[0] = 0;
+    for (b = 0; b < index->band_count; b++) {
+        const double dec_0 = -M_PI / 2 + b * band_height;
+        const double dec_1 = dec_0 + band_height;
+        const double widest = ((dec_0 <= 0) && (dec_1 >= 0)) ? 1 : GSL_MAX(cos(dec_0), cos(dec_1));
+        int cells_in_band = (int) ceil(2 * M_PI * widest / index->cell_size);
+        if (cells_in_band < 1) cells_in_band = 1;
+        index->band_start[b + 1] = index->band_start[b] + cells_in_band;
+    }
+    index->cell_count = index->band_start[index->band_count];
+
+    // Work out the centre of each cell, and the radius of a circle around the centre which encloses the whole cell
+    index->cell_centre_ra = (float *) sky_index_malloc(index->cell_count * sizeof(float));
+    index->cell_centre_dec = (float *) sky_index_malloc(index->cell_count * sizeof(float));
+    index->cell_radius = (float *) sky_index_malloc(index->cell_count * sizeof(float));
+    for (b = 0; b < index->band_count; b++) {
+        const double dec_0 = -M_PI / 2 + b * band_height;
+        const double dec_1 = dec_0 + band_height;
+        const int cells_in_band = index->band_start[b + 1] - index->band_start[b];
+        const double cell_width = 2 * M_PI / cells_in_band;
+        for (c = 0; c < cells_in_band; c++) {
+            const int cell = index->band_start[b] + c;
+            const double ra_0 = c * cell_width;
+            const double ra_1 = ra_0 + cell_width;
+            const double ra_centre = (ra_0 + ra_1) / 2;
+            const double dec_centre = (dec_0 + dec_1) / 2;
+            const double radius = sky_index_enclosing_radius(ra_centre, cell_width / 2, dec_0, dec_1);
+            index->cell_centre_ra[cell] = (float) ra_centre;
+            index->cell_centre_dec[cell] = (float) dec_centre;
+            index->cell_radius[cell] = (float) (radius + SKY_INDEX_MARGIN);
+        }
+    }
+}
+
+//! skyIndex_build - Compute the positions of a list of objects on a grid of times, and build an index of which
+//! objects lie in each part of the sky at each time.
+//! \param [in] body_id - The bodyIds of the objects to index. This array is not copied, and must remain valid for as
+//! long as the index is in use.
+//! \param [in] object_count - The number of objects to index
+//! \param [in] jd_min - The earliest time at which the index may be queried; TT
+//! \param [in] jd_max - The latest time at which the index may be queried; TT
+//! \param [in] jd_step - The interval between the times at which positions are sampled; days
+//! \param [in] cell_size - The approximate size of the cells the sky is divided into; radians
+//! \return - The sky index
+
+skyIndex *skyIndex_build(const int *body_id, const int object_count, const double jd_min, const double jd_max,
+                         const double jd_step, const double cell_size) {
+    int i, k;
+    skyIndex *index = (skyIndex *) sky_index_malloc(sizeof(skyIndex));
+
+    index->jd_min = jd_min;
+    index->jd_step = jd_step;
+    index->node_count = (int) ceil((jd_max - jd_min) / jd_step) + 1;
+    if (index->node_count < 2) index->node_count = 2;
+    index->object_count = object_count;
+    index->body_id = body_id;
+    index->cell_size = cell_size;
+    sky_index_make_cells(index);
+
+    // Each interval between consecutive sample times has its own set of cells
+    const int interval_count = index->node_count - 1;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Building sky index of %d objects at %d times, with %d cells.",
+                 object_count, index->node_count, index->cell_count);
+        ephem_log(temp_err_string);
+    }
+
+    // Compute the position of every object at every sample time
+    index->ra = (float *) sky_index_malloc((size_t) index->node_count * object_count * sizeof(float));
+    index->dec = (float *) sky_index_malloc((size_t) index->node_count * object_count * sizeof(float));
+    float *distance = (float *) sky_index_malloc((size_t) index->node_count * object_count * sizeof(float));
+
+    for (k = 0; k < index->node_count; k++) {
+        const size_t o = (size_t) k * object_count;
+
+        // The positions of the Earth and Sun are the same for every object, so only look them up once
+        orbitalElementsEpochState epoch_state;
+        orbitalElements_computeEpochState(jd_min + k * jd_step, &epoch_state);
+
+#pragma omp parallel for shared(epoch_state, index) private(i)
+        for (i = 0; i < object_count; i++) {
+            double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+            double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+            double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+            double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+            orbitalElements_computeEphemerisAtEpoch(body_id[i], &epoch_state, &x, &y, &z, &ra, &dec, &mag,
+                                                    &phase, &ang_size, &phy_size,
+                                                    &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                                    &ecliptic_longitude, &ecliptic_latitude,
+                                                    &ecliptic_distance, 2451545.0,
+                                                    0, 0, 0);
+
+            index->ra[o + i] = (float) ra;
+            index->dec[o + i] = (float) dec;
+            distance[o + i] = (float) earth_dist;
+        }
+    }
+
+    // Work out how far each object may move during each interval, and bucket objects into cells
+    index->motion = (float *) sky_index_malloc((size_t) interval_count * object_count * sizeof(float));
+    index->cell_start = (int *) sky_index_malloc((size_t) interval_count * (index->cell_count + 1) * sizeof(int));
+    index->cell_members = (int *) sky_index_malloc((size_t) interval_count * object_count * sizeof(int));
+    index->cell_motion = (float *) sky_index_malloc((size_t) interval_count * index->cell_count * sizeof(float));
+    index->band_motion = (float *) sky_index_malloc((size_t) interval_count * index->band_count * sizeof(float));
+    int *object_cell = (int *) sky_index_malloc(object_count * sizeof(int));
+    int *fill = (int *) sky_index_malloc(index->cell_count * sizeof(int));
+
+    for (k = 0; k < interval_count; k++) {
+        const size_t o = (size_t) k * object_count;
+        const size_t o_next = (size_t) (k + 1) * object_count;
+        int *cell_start = index->cell_start + (size_t) k * (index->cell_count + 1);
+        int *cell_members = index->cell_members + o;
+        float *cell_motion = index->cell_motion + (size_t) k * index->cell_count;
+        float *band_motion = index->band_motion + (size_t) k * index->band_count;
+        const double jd_k = jd_min + k * jd_step;
+
+        for (i = 0; i <= index->cell_count; i++) cell_start[i] = 0;
+        for (i = 0; i < index->cell_count; i++) cell_motion[i] = 0;
+        for (i = 0; i < index->band_count; i++) band_motion[i] = 0;
+
+        for (i = 0; i < object_count; i++) {
+            // The object's speed relative to the geocentre cannot exceed its speed at perihelion plus the Earth's
+            const double speed = orbitalElements_maxSpeed(body_id[i], jd_k) + SKY_INDEX_EARTH_SPEED;
+            index->motion[o + i] = (float) sky_index_motion_limit(speed, distance[o + i], jd_step);
+
+            // Objects whose positions could not be computed are left out of every cell
+            const int finite = gsl_finite(index->ra[o + i]) && gsl_finite(index->dec[o + i]) &&
+                               gsl_finite(index->ra[o_next + i]) && gsl_finite(index->dec[o_next + i]);
+            object_cell[i] = finite ? sky_index_cell(index, index->ra[o + i], index->dec[o + i]) : -1;
+            if (object_cell[i] < 0) continue;
+
+            cell_start[object_cell[i] + 1]++;
+            if (cell_motion[object_cell[i]] < index->motion[o + i]) {
+                cell_motion[object_cell[i]] = index->motion[o + i];
+            }
+        }
+
+        // Work out the largest distance moved by any object in each band of declination
+        for (i = 0; i < index->band_count; i++) {
+            int c;
+            for (c = index->band_start[i]; c < index->band_start[i + 1]; c++) {
+                if (band_motion[i] < cell_motion[c]) band_motion[i] = cell_motion[c];
+            }
+        }
+
+        // Turn the number of objects in each cell into the position of each cell's first member
+        for (i = 0; i < index->cell_count; i++) cell_start[i + 1] += cell_start[i];
+
+        // Sort objects into cells
+        memcpy(fill, cell_start, index->cell_count * sizeof(int));
+        for (i = 0; i < object_count; i++) {
+            if (object_cell[i] < 0) continue;
+            cell_members[fill[object_cell[i]]++] = i;
+        }
+    }
+
+    return index;
+}
+
+//! sky_index_compare_matches - Comparison function used to sort matches into order of bodyId
+
+static int sky_index_compare_matches(const void *a, const void *b) {
+    return ((const skyIndexMatch *) a)->body_id - ((const skyIndexMatch *) b)->body_id;
+}
+
+//! sky_index_query - Search for all objects within <radius> of a point on the sky. Optionally, also require that
+//! objects lie within a box of right ascension and declination.
+//! \param [in] index - The sky index
+//! \param [in] jd - The time of the query; TT
+//! \param [in] ra - The right ascension of the centre of the search; radians
+//! \param [in] dec - The declination of the centre of the search; radians
+//! \param [in] radius - The radius of the search; radians
+//! \param [in] box - If not NULL, the limits {ra_min, ra_max, dec_min, dec_max} of a box which objects must lie in.
+//! If ra_min > ra_max, the box wraps around RA=0.
+//! \param [out] matches_out - Array to populate with the objects found. Must have room for <object_count> entries.
+//! \return - The number of objects found, or -1 if <jd> lies outside the range of the index
+
+static int sky_index_query(const skyIndex *index, const double jd, const double ra, const double dec,
+                           const double radius, const double *box, skyIndexMatch *matches_out) {
+    int b, count = 0, have_epoch_state = 0;
+    orbitalElementsEpochState epoch_state;
+
+    // Work out which interval between sample times this query falls within
+    const int interval_count = index->node_count - 1;
+    int k = (int) floor((jd - index->jd_min) / index->jd_step);
+    if ((k < 0) || (k > interval_count)) return -1;
+    if (k == interval_count) {
+        if (jd > index->jd_min + interval_count * index->jd_step) return -1;
+        k = interval_count - 1;
+    }
+
+    const size_t o = (size_t) k * index->object_count;
+    const int *cell_start = index->cell_start + (size_t) k * (index->cell_count + 1);
+    const int *cell_members = index->cell_members + o;
+    const float *cell_motion = index->cell_motion + (size_t) k * index->cell_count;
+    const float *band_motion = index->band_motion + (size_t) k * index->band_count;
+
+    // Only visit cells in bands of declination, and ranges of right ascension, which lie close enough to the search
+    // region that an object in them could have moved into it
+    const double band_height = M_PI / index->band_count;
+    for (b = 0; b < index->band_count; b++) {
+        int c_scan;
+        const double reach = radius + band_motion[b] + SKY_INDEX_MARGIN;
+        const double band_dec_min = -M_PI / 2 + b * band_height;
+        const double band_dec_max = band_dec_min + band_height;
+        if ((band_dec_min > dec + reach) || (band_dec_max < dec - reach)) continue;
+
+        // The region within <reach> of the search centre spans all RAs if it contains a pole. Otherwise, it extends
+        // asin(sin(reach) / cos(dec)) either side of the centre in RA.
+        const int cells_in_band = index->band_start[b + 1] - index->band_start[b];
+        int c_min = 0, c_max = cells_in_band - 1;
+        if (reach < M_PI / 2 - fabs(dec)) {
+            const double ra_half_width = asin(sin(reach) / cos(dec));
+            const double cell_width = 2 * M_PI / cells_in_band;
+            c_min = (int) floor((ra - ra_half_width) / cell_width);
+            c_max = (int) floor((ra + ra_half_width) / cell_width);
+            if (c_max - c_min >= cells_in_band) {
+                c_min = 0;
+                c_max = cells_in_band - 1;
+            }
+        }
+
+        for (c_scan = c_min; c_scan <= c_max; c_scan++) {
+            int m;
+            const int c = index->band_start[b] + ((c_scan % cells_in_band) + cells_in_band) % cells_in_band;
+            if (cell_start[c] == cell_start[c + 1]) continue;
+
+            // Reject cells where no object could possibly have moved into the search region
+            const double cell_dist = angDist_RADec(index->cell_centre_ra[c], index->cell_centre_dec[c], ra, dec);
+            if (cell_dist - index->cell_radius[c] > radius + cell_motion[c]) continue;
+
+            for (m = cell_start[c]; m < cell_start[c + 1]; m++) {
+                const int i = cell_members[m];
+
+                // Reject objects which could not have moved into the search region
+                const double object_dist = angDist_RADec(index->ra[o + i], index->dec[o + i], ra, dec);
+                if (object_dist > radius + index->motion[o + i]) continue;
+
+                // Compute the precise position of this candidate
+                double ra_i = 0, dec_i = 0, x = 0, y = 0, z = 0;
+                double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+                double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+                double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+                if (!have_epoch_state) {
+                    orbitalElements_computeEpochState(jd, &epoch_state);
+                    have_epoch_state = 1;
+                }
+
+                orbitalElements_computeEphemerisAtEpoch(index->body_id[i], &epoch_state, &x, &y, &z, &ra_i, &dec_i,
+                                                        &mag, &phase, &ang_size, &phy_size,
+                                                        &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                                        &ecliptic_longitude, &ecliptic_latitude,
+                                                        &ecliptic_distance, 2451545.0,
+                                                        0, 0, 0);
+
+                if (angDist_RADec(ra_i, dec_i, ra, dec) > radius) continue;
+
+                if (box != NULL) {
+                    double ra_norm = fmod(ra_i, 2 * M_PI);
+                    if (ra_norm < 0) ra_norm += 2 * M_PI;
+                    const int in_ra = (box[0] <= box[1]) ?
+                                      ((ra_norm >= box[0]) && (ra_norm <= box[1])) :
+                                      ((ra_norm >= box[0]) || (ra_norm <= box[1]));
+                    if ((!in_ra) || (dec_i < box[2]) || (dec_i > box[3])) continue;
+                }
+
+                matches_out[count].body_id = index->body_id[i];
+                matches_out[count].ra = ra_i;
+                matches_out[count].dec = dec_i;
+                matches_out[count].mag = mag;
+                matches_out[count].earth_dist = earth_dist;
+                count++;
+            }
+        }
+    }
+
+    qsort(matches_out, count, sizeof(skyIndexMatch), sky_index_compare_matches);
+    return count;
+}
+
+//! skyIndex_coneQuery - Search for all objects within a circle on the sky at a particular time. RA and Dec are in
+//! the J2000.0 coordinate system, as seen from the geocentre.
+//! \param [in] index - The sky index
+//! \param [in] jd - The time of the query; TT
+//! \param [in] ra - The right ascension of the centre of the circle; radians
+//! \param [in] dec - The declination of the centre of the circle; radians
+//! \param [in] radius - The radius of the circle; radians
+//! \param [out] matches_out - Array to populate with the objects found. Must have room for <object_count> entries.
+//! \return - The number of objects found, or -1 if <jd> lies outside the range of the index
+
+int skyIndex_coneQuery(const skyIndex *index, const double jd, const double ra, const double dec,
+                       const double radius, skyIndexMatch *matches_out) {
+    return sky_index_query(index, jd, ra, dec, radius, NULL, matches_out);
+}
+
+//! skyIndex_boxQuery - Search for all objects within a box of RA and Dec at a particular time. RA and Dec are in
+//! the J2000.0 coordinate system, as seen from the geocentre.
+//! \param [in] index - The sky index
+//! \param [in] jd - The time of the query; TT
+//! \param [in] ra_min - The minimum right ascension; radians. If ra_min > ra_max, the box wraps around RA=0.
+//! \param [in] ra_max - The maximum right ascension; radians
+//! \param [in] dec_min - The minimum declination; radians
+//! \param [in] dec_max - The maximum declination; radians
+//! \param [out] matches_out - Array to populate with the objects found. Must have room for <object_count> entries.
+//! \return - The number of objects found, or -1 if <jd> lies outside the range of the index
+
+int skyIndex_boxQuery(const skyIndex *index, const double jd, const double ra_min, const double ra_max,
+                      const double dec_min, const double dec_max, skyIndexMatch *matches_out) {
+    double box[4];
+
+    box[0] = fmod(ra_min, 2 * M_PI);
+    if (box[0] < 0) box[0] += 2 * M_PI;
+    box[1] = fmod(ra_max, 2 * M_PI);
+    if (box[1] < 0) box[1] += 2 * M_PI;
+    box[2] = dec_min;
+    box[3] = dec_max;
+
+    // Work out the width of the box in RA. A box which spans all RAs has its maximum RA one turn after its minimum.
+    double ra_span = ra_max - ra_min;
+    if (ra_span < 2 * M_PI) {
+        ra_span = box[1] - box[0];
+        if (ra_span < 0) ra_span += 2 * M_PI;
+    } else {
+        box[0] = 0;
+        box[1] = 2 * M_PI;
+    }
+
+    // Search a circle which encloses the box
+    const double ra_centre = box[0] + ra_span / 2;
+    const double dec_centre = (dec_min + dec_max) / 2;
+    const double radius = sky_index_enclosing_radius(ra_centre, ra_span / 2, dec_min, dec_max);
+
+    return sky_index_query(index, jd, ra_centre, dec_centre, radius + SKY_INDEX_MARGIN, box, matches_out);
+}
@@ -0,0 +1,65 @@
+// skyIndex.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef SKYINDEX_H
+#define SKYINDEX_H 1
+
+// An index of the sky positions of a list of objects, sampled on a coarse grid of times. At each time, objects are
+// bucketed into cells on the sky, together with an upper limit on how far each object moves before the next time.
+// This limit follows from the object's speed at perihelion, plus the Earth's speed, and its distance from the Earth.
+typedef struct {
+    double jd_min, jd_step;  // The times at which positions are sampled; TT
+    int node_count;  // The number of times at which positions are sampled
+    int object_count;  // The number of objects in the index
+    const int *body_id;  // The bodyIds of the objects in the index
+
+    double cell_size;  // The approximate size of the cells on the sky; radians
+    int band_count;  // The number of bands of declination into which the sky is divided
+    int *band_start;  // The index of the first cell in each band of declination; band_count + 1 entries
+    int cell_count;  // The total number of cells
+    float *cell_centre_ra, *cell_centre_dec, *cell_radius;  // The centre and angular radius of each cell; radians
+
+    float *ra, *dec;  // Position of each object at each time; [node][object]; radians
+    float *motion;  // Upper limit on how far each object moves between each time and the next; [node][object]
+    int *cell_start;  // The first entry in <cell_members> for each cell; [node][cell_count + 1]
+    int *cell_members;  // Objects sorted by the cell they occupy; [node][object]
+    float *cell_motion;  // Largest value of <motion> for any object in each cell; [node][cell]
+    float *band_motion;  // Largest value of <motion> for any object in each band of declination; [node][band]
+} skyIndex;
+
+// A solar system object found within a region of the sky
+typedef struct {
+    int body_id;
+    double ra, dec;  // radians; J2000.0
+    double mag;
+    double earth_dist;  // AU
+} skyIndexMatch;
+
+skyIndex *skyIndex_build(const int *body_id, int object_count, double jd_min, double jd_max, double jd_step,
+                         double cell_size);
+
+int skyIndex_coneQuery(const skyIndex *index, double jd, double ra, double dec, double radius,
+                       skyIndexMatch *matches_out);
+
+int skyIndex_boxQuery(const skyIndex *index, double jd, double ra_min, double ra_max, double dec_min,
+                      double dec_max, skyIndexMatch *matches_out);
+
+#endif
@@ -0,0 +1,264 @@
+// starIndex.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#define STARINDEX_C 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <gsl/gsl_math.h>
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/errorReport.h"
+#include "coreUtils/strConstants.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/sphericalAst.h"
+
+#include "starIndex.h"
+
+// Conversion factor from milliarcseconds per year into radians per day
+#define STAR_PM_UNITS (M_PI / 180 / 3600 / 1000 / 365.25)
+
+//! star_index_malloc - Allocate memory, and throw a fatal error if this fails
+
+static void *star_index_malloc(const size_t size) {
+    void *output = lt_malloc(size);
+    if (output == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    return output;
+}
+
+//! star_index_band - Work out which band of declination contains a particular declination
+
+static int star_index_band(const starIndex *index, const double dec) {
+    int band = (int) floor((dec + M_PI / 2) / M_PI * index->band_count);
+    if (band < 0) band = 0;
+    if (band >= index->band_count) band = index->band_count - 1;
+    return band;
+}
+
+//! star_index_cell_in_band - Work out which cell within a band of declination contains a particular RA. The result
+//! is not wrapped into the range of cells in the band.
+
+static int star_index_cell_in_band(const starIndex *index, const int band, const double ra) {
+    const int cells_in_band = index->band_start[band + 1] - index->band_start[band];
+    return (int) floor(ra / (2 * M_PI) * cells_in_band);
+}
+
+//! star_index_parse_line - Read the name, position and proper motion of a star from a line of a star list
+//! \param [in] line - The line of text to parse
+//! \param [out] name - The name of the star
+//! \param [out] ra - The RA of the star; degrees
+//! \param [out] dec - The declination of the star; degrees
+//! \param [out] pm_ra - The proper motion of the star in RA, including the factor cos(dec); mas/yr
+//! \param [out] pm_dec - The proper motion of the star in declination; mas/yr
+//! \return - Zero if the line does not describe a star
+
+static int star_index_parse_line(const char *line, char *name, double *ra, double *dec, double *pm_ra,
+                                 double *pm_dec) {
+    char name_format[32];
+    *pm_ra = *pm_dec = 0;
+
+    // Ignore blank lines and comment lines
+    if ((line[0] == '\0') || (line[0] == '#')) return 0;
+
+    snprintf(name_format, sizeof(name_format), "%%%ds %%lf %%lf %%lf %%lf", STAR_NAME_LENGTH - 1);
+    const int items = sscanf(line, name_format, name, ra, dec, pm_ra, pm_dec);
+    if (items < 3) return 0;
+    return 1;
+}
+
+//! starIndex_load - Read a list of stars from a text file, and sort them into cells on the sky. Each line of the file
+//! should contain the name of a star, its J2000.0 RA and Dec in degrees, and optionally its proper motion in RA
+//! (including the factor cos(dec)) and Dec, in milliarcseconds per year. Lines starting with # are ignored.
+//! \param [in] filename - The filename of the star list
+//! \param [in] jd_epoch - The epoch at which the stars' positions are given; TT
+//! \param [in] cell_size - The approximate size of the cells the sky is divided into; radians
+//! \return - The star index
+
+starIndex *starIndex_load(const char *filename, const double jd_epoch, const double cell_size) {
+    int i, b;
+    char line[FNAME_LENGTH], name[STAR_NAME_LENGTH];
+    double ra, dec, pm_ra, pm_dec;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Opening file <%s>", filename);
+        ephem_log(temp_err_string);
+    }
+
+    FILE *input = fopen(filename, "rt");
+    if (input == NULL) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Could not open star list <%s>.", filename);
+        ephem_fatal(__FILE__, __LINE__, temp_err_string);
+        exit(1);
+    }
+
+    starIndex *index = (starIndex *) star_index_malloc(sizeof(starIndex));
+    index->jd_epoch = jd_epoch;
+    index->cell_size = cell_size;
+    index->pm_max = 0;
+
+    // Count the stars in the file, so that we know how much storage to allocate
+    index->star_count = 0;
+    while ((!feof(input)) && (!ferror(input))) {
+        file_readline(input, line);
+        if (star_index_parse_line(line, name, &ra, &dec, &pm_ra, &pm_dec)) index->star_count++;
+    }
+
+    index->ra = (double *) star_index_malloc((index->star_count + 1) * sizeof(double));
+    index->dec = (double *) star_index_malloc((index->star_count + 1) * sizeof(double));
+    index->pm_ra = (double *) star_index_malloc((index->star_count + 1) * sizeof(double));
+    index->pm_dec = (double *) star_index_malloc((index->star_count + 1) * sizeof(double));
+    index->name = (char (*)[STAR_NAME_LENGTH]) star_index_malloc((index->star_count + 1) * STAR_NAME_LENGTH);
+
+    // Read the stars
+    rewind(input);
+    i = 0;
+    while ((!feof(input)) && (!ferror(input)) && (i < index->star_count)) {
+        file_readline(input, line);
+        if (!star_index_parse_line(line, name, &ra, &dec, &pm_ra, &pm_dec)) continue;
+
+        strcpy(index->name[i], name);
+        index->ra[i] = fmod(ra * M_PI / 180, 2 * M_PI);
+        if (index->ra[i] < 0) index->ra[i] += 2 * M_PI;
+        index->dec[i] = dec * M_PI / 180;
+        index->pm_ra[i] = pm_ra * STAR_PM_UNITS;
+        index->pm_dec[i] = pm_dec * STAR_PM_UNITS;
+        index->pm_max = GSL_MAX(index->pm_max, gsl_hypot(index->pm_ra[i], index->pm_dec[i]));
+        i++;
+    }
+    fclose(input);
+
+    // Divide the sky into bands of declination, and divide each band into cells of RA roughly <cell_size> wide
+    index->band_count = (int) ceil(M_PI / cell_size);
+    const double band_height = M_PI / index->band_count;
+    index->band_start = (int *) star_index_malloc((index->band_count + 1) * sizeof(int));
+    index->band_start[0] = 0;
+    for (b = 0; b < index->band_count; b++) {
+        const double dec_0 = -M_PI / 2 + b * band_height;
+        const double dec_1 = dec_0 + band_height;
+        const double widest = ((dec_0 <= 0) && (dec_1 >= 0)) ? 1 : GSL_MAX(cos(dec_0), cos(dec_1));
+        int cells_in_band = (int) ceil(2 * M_PI * widest / cell_size);
+        if (cells_in_band < 1) cells_in_band = 1;
+        index->band_start[b + 1] = index->band_start[b] + cells_in_band;
+    }
+    index->cell_count = index->band_start[index->band_count];
+
+    // Sort stars into cells
+    index->cell_start = (int *) star_index_malloc((index->cell_count + 1) * sizeof(int));
+    index->cell_members = (int *) star_index_malloc((index->star_count + 1) * sizeof(int));
+    int *star_cell = (int *) star_index_malloc((index->star_count + 1) * sizeof(int));
+    int *fill = (int *) star_index_malloc((index->cell_count + 1) * sizeof(int));
+
+    for (i = 0; i <= index->cell_count; i++) index->cell_start[i] = 0;
+    for (i = 0; i < index->star_count; i++) {
+        const int band = star_index_band(index, index->dec[i]);
+        const int cells_in_band = index->band_start[band + 1] - index->band_start[band];
+        int cell = star_index_cell_in_band(index, band, index->ra[i]);
+        if (cell >= cells_in_band) cell = cells_in_band - 1;
+        star_cell[i] = index->band_start[band] + cell;
+        index->cell_start[star_cell[i] + 1]++;
+    }
+    for (i = 0; i < index->cell_count; i++) index->cell_start[i + 1] += index->cell_start[i];
+    memcpy(fill, index->cell_start, index->cell_count * sizeof(int));
+    for (i = 0; i < index->star_count; i++) index->cell_members[fill[star_cell[i]]++] = i;
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Read %d stars into %d cells.", index->star_count, index->cell_count);
+        ephem_log(temp_err_string);
+    }
+
+    return index;
+}
+
+//! starIndex_position - Compute the position of a star at a particular time, allowing for its proper motion
+//! \param [in] index - The star index
+//! \param [in] star - The number of the star within the index
+//! \param [in] jd - The time at which to compute the star's position; TT
+//! \param [out] ra - The J2000.0 RA of the star; radians
+//! \param [out] dec - The J2000.0 declination of the star; radians
+
+void starIndex_position(const starIndex *index, const int star, const double jd, double *ra, double *dec) {
+    const double dt = jd - index->jd_epoch;
+    *dec = index->dec[star] + index->pm_dec[star] * dt;
+    *ra = index->ra[star] + index->pm_ra[star] * dt / cos(index->dec[star]);
+}
+
+//! starIndex_query - Find all the stars which may lie within <radius> of a point on the sky at any time between
+//! <jd_min> and <jd_max>. Only the cells which overlap the search circle are examined.
+//! \param [in] index - The star index
+//! \param [in] ra - The RA of the centre of the search; radians
+//! \param [in] dec - The declination of the centre of the search; radians
+//! \param [in] radius - The radius of the search; radians
+//! \param [in] jd_min - The start of the time span over which stars may be within the search circle; TT
+//! \param [in] jd_max - The end of the time span over which stars may be within the search circle; TT
+//! \param [out] stars_out - Array to populate with the numbers of the stars found
+//! \param [in] max_stars - The number of entries there is room for in <stars_out>
+//! \return - The number of stars found. If this exceeds <max_stars>, only the first <max_stars> are returned.
+
+int starIndex_query(const starIndex *index, const double ra, const double dec, double radius, const double jd_min,
+                    const double jd_max, int *stars_out, const int max_stars) {
+    int band, count = 0;
+
+    // Allow for stars moving into the search circle, by proper motion, between the epoch and the time span
+    const double dt_max = GSL_MAX(fabs(jd_min - index->jd_epoch), fabs(jd_max - index->jd_epoch));
+    radius += index->pm_max * dt_max;
+
+    // Work out the range of declinations, and the range of RAs either side of the centre, which the circle spans
+    const int band_min = star_index_band(index, dec - radius);
+    const int band_max = star_index_band(index, dec + radius);
+    const int includes_pole = (fabs(dec) + radius >= M_PI / 2);
+    const double ra_half_width = includes_pole ? M_PI : asin(GSL_MIN(1, sin(radius) / cos(dec)));
+
+    for (band = band_min; band <= band_max; band++) {
+        int c, cell_min = 0;
+        const int cells_in_band = index->band_start[band + 1] - index->band_start[band];
+        int cell_max = cells_in_band - 1;
+
+        if (ra_half_width < M_PI) {
+            cell_min = star_index_cell_in_band(index, band, ra - ra_half_width);
+            cell_max = star_index_cell_in_band(index, band, ra + ra_half_width);
+            if (cell_max - cell_min >= cells_in_band) {
+                cell_min = 0;
+                cell_max = cells_in_band - 1;
+            }
+        }
+
+        for (c = cell_min; c <= cell_max; c++) {
+            int m;
+            const int cell = index->band_start[band] + ((c % cells_in_band) + cells_in_band) % cells_in_band;
+            for (m = index->cell_start[cell]; m < index->cell_start[cell + 1]; m++) {
+                const int star = index->cell_members[m];
+                if (angDist_RADec(index->ra[star], index->dec[star], ra, dec) > radius) continue;
+                if (count < max_stars) stars_out[count] = star;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,52 @@
+// starIndex.h
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#ifndef STARINDEX_H
+#define STARINDEX_H 1
+
+// The maximum length of the name of a star
+#define STAR_NAME_LENGTH 32
+
+// A list of stars, sorted into cells on the sky so that the stars near any point can be found quickly
+typedef struct {
+    int star_count;
+    double jd_epoch;  // The epoch at which the stars' positions are given; TT
+    double *ra, *dec;  // J2000.0 position of each star at <jd_epoch>; radians
+    double *pm_ra, *pm_dec;  // Proper motion of each star; radians per day. <pm_ra> includes the factor cos(dec).
+    double pm_max;  // The largest proper motion of any star; radians per day
+    char (*name)[STAR_NAME_LENGTH];
+
+    double cell_size;  // The approximate size of the cells on the sky; radians
+    int band_count;  // The number of bands of declination into which the sky is divided
+    int *band_start;  // The index of the first cell in each band of declination; band_count + 1 entries
+    int cell_count;  // The total number of cells
+    int *cell_start;  // The first entry in <cell_members> for each cell; cell_count + 1 entries
+    int *cell_members;  // Stars sorted by the cell they occupy
+} starIndex;
+
+starIndex *starIndex_load(const char *filename, double jd_epoch, double cell_size);
+
+void starIndex_position(const starIndex *index, int star, double jd, double *ra, double *dec);
+
+int starIndex_query(const starIndex *index, double ra, double dec, double radius, double jd_min, double jd_max,
+                    int *stars_out, int max_stars);
+
+#endif
@@ -0,0 +1,282 @@
+// events.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for searching for events such as conjunctions, oppositions, greatest elongations, stationary points
+// and perihelia of solar system bodies, using the DE430 ephemeris. Each event is located directly by root finding,
+// rather than by tabulating an ephemeris at high time resolution.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_const_mksa.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/calendarEvents.h"
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/eventSearch.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+#include "settings/settings.h"
+
+static const char *const usage[] = {
+        "events.bin [options] [[--] args]",
+        "events.bin [options]",
+        NULL,
+};
+
+//! event_object_name - Look up the name of a body, as it was specified on the command line
+//! \param [in] s - The settings, containing the list of objects
+//! \param [in] body_id - The bodyId of the object
+//! \return - The name of the object
+
+static const char *event_object_name(const settings *s, const int body_id) {
+    int i;
+    for (i = 0; i < s->objects_count; i++) if (s->body_id[i] == body_id) return s->object_name[i];
+
+    // Calendar events concern the Sun and Moon, even if they are not in the list of objects
+    if (body_id == 9) return "moon";
+    if (body_id == 10) return "sun";
+    return "-";
+}
+
+//! event_report - Write an event to stdout
+//! \param [in] event - The event
+//! \param [in] context - The settings, used to look up the names of objects
+
+void event_report(const eventFound *event, void *context) {
+    const settings *s = (const settings *) context;
+    int year, month, day, hour, min, status;
+    double sec;
+
+    // Distances from the Sun are in AU, and distances of the Moon are in km. All other quantities are angles, which
+    // we output in degrees.
+    double value = event->value * 180 / M_PI;
+    if ((event->type == EVENT_PERIHELION) || (event->type == EVENT_APHELION)) value = event->value;
+    if ((event->type == EVENT_PERIGEE) || (event->type == EVENT_APOGEE)) {
+        value = event->value * GSL_CONST_MKSA_ASTRONOMICAL_UNIT / 1e3;
+    }
+
+    inv_julian_day(event->jd, &year, &month, &day, &hour, &min, &sec, &status, temp_err_string);
+    fprintf(stdout, "%14.6f %04d %02d %02d %02d %02d %02d   %-20s %-12s %-12s %+d %12.6f\n",
+            event->jd, year, month, day, hour, min, (int) sec, eventSearch_name(event->type),
+            event_object_name(s, event->body_a),
+            (event->body_b >= 0) ? event_object_name(s, event->body_b) : "-",
+            event->sense, value);
+}
+
+// Calendar events are all found before the other events are searched for, and are then merged into the stream of
+// other events in time order
+typedef struct {
+    const settings *s;
+    eventFound *calendar;  // Calendar events, in time order
+    int calendar_count, calendar_allocated;
+    int calendar_reported;  // The number of calendar events which have been written to stdout
+} event_merge;
+
+//! event_collect_calendar - Add a calendar event to the list of those waiting to be merged with other events
+//! \param [in] event - The event
+//! \param [in] context - The <event_merge> structure
+
+void event_collect_calendar(const eventFound *event, void *context) {
+    event_merge *m = (event_merge *) context;
+    if (m->calendar_count >= m->calendar_allocated) {
+        const int allocated = 2 * m->calendar_allocated + 64;
+        eventFound *calendar = (eventFound *) lt_malloc(allocated * sizeof(eventFound));
+        if (calendar == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+        if (m->calendar_count > 0) memcpy(calendar, m->calendar, m->calendar_count * sizeof(eventFound));
+        m->calendar = calendar;
+        m->calendar_allocated = allocated;
+    }
+    m->calendar[m->calendar_count++] = *event;
+}
+
+//! event_report_merged - Write an event to stdout, preceded by any calendar events which happen before it
+//! \param [in] event - The event, or NULL to write all remaining calendar events
+//! \param [in] context - The <event_merge> structure
+
+void event_report_merged(const eventFound *event, void *context) {
+    event_merge *m = (event_merge *) context;
+    while ((m->calendar_reported < m->calendar_count) &&
+           ((event == NULL) || (m->calendar[m->calendar_reported].jd < event->jd))) {
+        event_report(&m->calendar[m->calendar_reported++], (void *) m->s);
+    }
+    if (event != NULL) event_report(event, (void *) m->s);
+}
+
+//! event_run - Build a list of searches from the objects and event types requested, and perform them
+//! \param [in] s - The settings, containing the list of objects and the time span to search
+//! \param [in] event_list - Comma-separated list of the names of the types of events to search for
+
+void event_run(settings *s, const char *event_list) {
+    int i, j, search_count = 0;
+    int event_enabled[EVENT_TYPE_COUNT];
+
+    settings_process(s);
+
+    // Read the list of event types to search for
+    for (i = 0; i < EVENT_TYPE_COUNT; i++) event_enabled[i] = 0;
+    {
+        const char *scan = event_list;
+        while (*scan != '\0') {
+            char event_string[FNAME_LENGTH];
+            str_comma_separated_list_scan(&scan, event_string);
+            const int type = eventSearch_type(event_string);
+            if (type < 0) {
+                snprintf(temp_err_string, FNAME_LENGTH, "Unrecognised event type <%s>.", event_string);
+                ephem_fatal(__FILE__, __LINE__, temp_err_string);
+                exit(1);
+            }
+            event_enabled[type] = 1;
+        }
+    }
+
+    eventSearch *searches = (eventSearch *) lt_malloc(EVENT_MAX_SEARCHES * sizeof(eventSearch));
+    if (searches == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    for (i = 0; i < s->objects_count; i++) {
+        const int body_id = s->body_id[i];
+        int type;
+
+        // Conjunctions between every pair of objects
+        if (event_enabled[EVENT_CONJUNCTION]) {
+            for (j = i + 1; (j < s->objects_count) && (search_count < EVENT_MAX_SEARCHES); j++) {
+                searches[search_count].type = EVENT_CONJUNCTION;
+                searches[search_count].body_a = body_id;
+                searches[search_count].body_b = s->body_id[j];
+                search_count++;
+            }
+        }
+
+        // All other events only concern a single object. The positions of the Sun and Earth relative to the Sun
+        // are not meaningful, except that the Earth has a perihelion and aphelion.
+        for (type = 0; (type < EVENT_CALENDAR_FIRST) && (search_count < EVENT_MAX_SEARCHES); type++) {
+            const int is_apsis = (type == EVENT_PERIHELION) || (type == EVENT_APHELION);
+            if ((type == EVENT_CONJUNCTION) || !event_enabled[type]) continue;
+            if (body_id == 10) continue;
+            if ((body_id == 19) && !is_apsis) continue;
+            searches[search_count].type = type;
+            searches[search_count].body_a = body_id;
+            searches[search_count].body_b = -1;
+            search_count++;
+        }
+    }
+
+    if (search_count >= EVENT_MAX_SEARCHES) {
+        ephem_warning("Too many objects requested; some events will not be searched for.");
+    }
+
+    // Lunar phases, apsides and nodes, and equinoxes and solstices, are found first, and then merged in time order
+    // into the events found by <eventSearch_run>, which are reported as they are found
+    event_merge merge;
+    merge.s = s;
+    merge.calendar = NULL;
+    merge.calendar_count = merge.calendar_allocated = merge.calendar_reported = 0;
+    for (i = EVENT_CALENDAR_FIRST; i < EVENT_TYPE_COUNT; i++) {
+        if (event_enabled[i]) {
+            calendarEvents_run(event_enabled, s->jd_min, s->jd_max, event_collect_calendar, &merge);
+            break;
+        }
+    }
+
+    if (search_count > 0) {
+        eventSearch_run(searches, search_count, s->jd_min, s->jd_max, s->jd_step, event_report_merged, &merge);
+    }
+    event_report_merged(NULL, &merge);
+    settings_close(s);
+}
+
+int main(int argc, const char **argv) {
+    settings event_settings;
+    const char *event_list = "conjunction,opposition,greatest_elongation,stationary_longitude";
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising event search.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default event search parameters.");
+    settings_default(&event_settings);
+    event_settings.objects_input_list = "sun,mercury,venus,mars,jupiter,saturn";
+    event_settings.jd_max = event_settings.jd_min + 365.25;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &event_settings.jd_min,
+                      "The Julian day number at which to start searching; TT"),
+            OPT_FLOAT('b', "jd_max", &event_settings.jd_max,
+                      "The Julian day number at which to stop searching; TT"),
+            OPT_FLOAT('s', "jd_step", &event_settings.jd_step,
+                      "The time step used to bracket events, in days. This must be shorter than the shortest interval between events of the same kind."),
+            OPT_STRING('o', "objects", &event_settings.objects_input_list,
+                       "The list of objects to search for events. See README.md."),
+            OPT_STRING('e', "events", &event_list,
+                       "Comma-separated list of the types of events to search for. See README.md."),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nSearch for conjunctions, oppositions, elongations and other events",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    // Perform search
+    event_run(&event_settings, event_list);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
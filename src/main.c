@@ -35,19 +35,110 @@
 #include "coreUtils/strConstants.h"
 #include "coreUtils/errorReport.h"
 
+#include "ephemCalc/apparentCache.h"
 #include "ephemCalc/constellations.h"
+#include "ephemCalc/horizon.h"
 #include "ephemCalc/jpl.h"
 #include "ephemCalc/meeus.h"
 #include "ephemCalc/orbitalElements.h"
 #include "ephemCalc/magnitudeEstimate.h"
+#include "mathsTools/julianDate.h"
 #include "mathsTools/precess_equinoxes.h"
+#include "mathsTools/sphericalAst.h"
 
 #include "listTools/ltMemory.h"
 
 #include "settings/settings.h"
 
-#define N_PARAMETERS 17
-static double buffer[N_PARAMETERS * MAX_OBJECTS];
+// The quantities computed for each object at each time point are held with one contiguous array of <objects_count>
+// values for each of the N_PARAMETERS quantities. Quantity <q> of an object is at offset PARAM(q) from its first
+// value. The buffer is allocated once, and reused at every time point.
+#define N_PARAMETERS 27
+#define PARAM(q) ((q) * s->objects_count)
+static double *buffer = NULL;
+
+// Groups of quantities which may be computed for each object. Only those needed by the selected output columns are
+// computed; see <ephemeris_columns_needed>. The position of each object is always computed.
+#define COLUMNS_RA_DEC    1  // RA and Dec
+#define COLUMNS_PHYSICAL  2  // Magnitude, phase, sizes, distances and elongations, from <magnitudeEstimate>
+#define COLUMNS_ECLIPTIC  4  // Ecliptic longitude and latitude, precessed to the epoch of observation
+#define COLUMNS_HORIZON   8  // Hour angle, altitude and azimuth
+#define COLUMNS_RATES    16  // Rates of motion
+#define COLUMNS_VELOCITY 32  // Rates of change of x, y and z, which are only used for interpolation
+
+static int columns_needed = 0;
+
+// When a cache of apparent places is in use, the key under which each object is cached, and a flag for each object
+// indicating whether its RA and Dec at the current time point were found in the cache
+static int use_apparent_cache = 0;
+static apparentCacheKey *apparent_key = NULL;
+static unsigned char *apparent_cached = NULL;
+
+// When computing an ephemeris for a list of sites, the position of each site relative to the geocentre, and a buffer
+// laid out like <buffer> for each site, holding the quantities computed for each object as seen from that site
+static double *site_offset = NULL;
+static horizonFrame *site_horizon = NULL;
+static double *site_buffer = NULL;
+
+// When writing the separations of each pair of objects, the separations (and position angles) of each pair, and
+// workspace for <angDist_matrix>
+static double *separation_buffer = NULL;
+static double *separation_workspace = NULL;
+
+// In interpolated output mode, the ephemeris is computed in full only at a set of nodes, and intermediate rows are
+// filled by cubic Hermite interpolation. The longest interval between nodes; days.
+#define HERMITE_MAX_INTERVAL 0.125
+
+// The time step used to differentiate quantities which have no analytic rates of change; days
+#define HERMITE_DERIVATIVE_STEP 1e-5
+
+// The accuracy required of interpolated magnitudes
+#define HERMITE_MAG_TOLERANCE 1e-3
+
+// The accuracy required of interpolated rates of change, as a fraction of their values. Rates close to zero are
+// checked instead against the rate at which their quantity changes by the interpolation tolerance in a day.
+#define HERMITE_RATE_TOLERANCE 1e-4
+
+// How each quantity is interpolated, and how its accuracy is checked
+#define HERMITE_SKIP      0  // Not output, and not interpolated
+#define HERMITE_ANGLE     1  // Angle; radians
+#define HERMITE_ANGLE_POS 2  // Angle which wraps around, in the range 0 to 2pi; radians
+#define HERMITE_ANGLE_SYM 3  // Angle which wraps around, in the range -pi to pi; radians
+#define HERMITE_FRACTION  4  // Dimensionless quantity, such as phase or albedo
+#define HERMITE_LENGTH    5  // Distance or size; checked as a fraction of its value
+#define HERMITE_POSITION  6  // Cartesian coordinate; checked as a fraction of the distance from the origin
+#define HERMITE_MAG       7  // Magnitude
+#define HERMITE_RATE      8  // Rate of change; per day
+
+// The groups of quantities for which the maximum interpolation error observed at check points is reported
+#define HERMITE_GROUP_ANGLES    0  // Angles; radians
+#define HERMITE_GROUP_RELATIVE  1  // Distances, sizes and positions, as a fraction of their values; and fractions
+#define HERMITE_GROUP_MAGS      2  // Magnitudes
+#define HERMITE_GROUP_RATES     3  // Rates of change, as a fraction of their values
+#define HERMITE_GROUPS          4
+
+// The kind of each quantity; the quantity whose values give its analytic rate of change, or -1 if it must be
+// differentiated numerically; for rates of change of distances, the distance, or -1 for rates of change of angles;
+// and a flag indicating whether any quantity must be differentiated numerically
+static int hermite_kind[N_PARAMETERS];
+static int hermite_rate_of[N_PARAMETERS];
+static int hermite_rate_scale[N_PARAMETERS];
+static int hermite_numeric = 0;
+
+// The largest interpolation error observed at check points in each group of quantities, in intervals which met the
+// tolerance
+static double hermite_max_error[HERMITE_GROUPS];
+
+// The number of rows in the longest interval between nodes, and the number of nodes computed so far
+static int hermite_max_rows = 0;
+static int hermite_node_count = 0;
+
+// Buffers laid out like <buffer>, used as workspace: the values and derivatives at the node at the midpoint of an
+// interval being checked, at each of the <hermite_max_depth> depths of bisection; values interpolated at that node;
+// and values either side of a node, used to differentiate numerically
+static int hermite_max_depth = 0;
+static double **hermite_work_value = NULL, **hermite_work_deriv = NULL;
+static double *hermite_interp = NULL, *hermite_before = NULL, *hermite_after = NULL;
 
 static const char *const usage[] = {
         "ephem.bin [options] [[--] args]",
@@ -55,94 +146,200 @@ static const char *const usage[] = {
         NULL,
 };
 
-void compute_ephemeris_time_point(const settings *s, FILE *output, const double jd) {
-    // When producing a text-based ephemeris, the first column in Julian day number (TT)
-    // Binary ephemerides have no JD column to save space.
-    if (!s->output_binary) fprintf(output, "%.12f   ", jd);
+//! ephemeris_to_ecliptic - Rotate a vector from J2000.0 equatorial coordinates into the ecliptic coordinates used by
+//! negative output formats
+//! \param [in|out] x - The x component of the vector
+//! \param [in|out] y - The y component of the vector
+//! \param [in|out] z - The z component of the vector
 
-    // Compute ephemeris
-    int i;
-#pragma omp parallel for shared(output) private(i)
-    for (i = 0; i < s->objects_count; i++) {
-        const int o = i * N_PARAMETERS;
-        double ra = 0, dec = 0, x = 0, y = 0, z = 0;
-        double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0;
-        double sun_dist = 0, earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
-        double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+static void ephemeris_to_ecliptic(double *x, double *y, double *z) {
+    double x2, y2, z2;
+    double epsilon = (23. + 26. / 60. + 21.448 / 3600.) / 180. * M_PI; // Meeus (22.2)
 
-        // If the <use_orbital_elements> is 0, we use DE430
-        if (s->use_orbital_elements == 0)
-            jpl_computeEphemeris(s->body_id[i], jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size, &phy_size,
-                                 &albedo,
-                                 &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso, &ecliptic_longitude,
-                                 &ecliptic_latitude, &ecliptic_distance, s->ra_dec_epoch,
-                                 s->enable_topocentric_correction,
-                                 s->latitude, s->longitude);
-
-            // If the <use_orbital_elements> is 2, we use Jean Meeus's algorithms (NOT IMPLEMENTED!!!)
-        else if (s->use_orbital_elements == 2)
-            meeus_computeEphemeris(s->body_id[i], jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size, &phy_size,
-                                   &albedo,
-                                   &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso, &ecliptic_longitude,
-                                   &ecliptic_latitude, &ecliptic_distance, s->ra_dec_epoch,
-                                   s->enable_topocentric_correction,
-                                   s->latitude, s->longitude);
+    // negative x-axis points to the vernal equinox; (y,z) get tipped up by 23.5 degrees from (ra,dec)
+    // to equatorial coordinates
+    x2 = *x;
+    y2 = cos(epsilon) * *y + sin(epsilon) * *z;
+    z2 = -sin(epsilon) * *y + cos(epsilon) * *z;
+    *x = x2;
+    *y = y2;
+    *z = z2;
+}
 
-            // If the <use_orbital_elements> is 1, we use orbital elements
-        else if (s->use_orbital_elements == 1)
-            orbitalElements_computeEphemeris(s->body_id[i], jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size,
-                                             &phy_size,
-                                             &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
-                                             &ecliptic_longitude, &ecliptic_latitude,
-                                             &ecliptic_distance, s->ra_dec_epoch,
-                                             s->enable_topocentric_correction,
-                                             s->latitude, s->longitude);
-
-        // Negative output formats use ecliptic coordinates, not RA and Declination
-        if (s->output_format < 0) {
-            double x2, y2, z2;
-            double epsilon = (23. + 26. / 60. + 21.448 / 3600.) / 180. * M_PI; // Meeus (22.2)
-
-            // negative x-axis points to the vernal equinox; (y,z) get tipped up by 23.5 degrees from (ra,dec)
-            // to equatorial coordinates
-            x2 = x;
-            y2 = cos(epsilon) * y + sin(epsilon) * z;
-            z2 = -sin(epsilon) * y + cos(epsilon) * z;
-            x = x2;
-            y = y2;
-            z = z2;
-        }
+//! ephemeris_store - Store the quantities computed for one object at one time point in a buffer, converting them to
+//! ecliptic coordinates if required by the output format.
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [out] out - The first of the N_PARAMETERS values for this object in the buffer
+//! \param [in] jd - The Julian date of the time point; TT
+
+static void ephemeris_store(const settings *s, double *out, const double jd, double x, double y, double z,
+                            const double ra, const double dec, const double mag, const double phase,
+                            const double ang_size, const double phy_size, const double albedo, const double sun_dist,
+                            const double earth_dist, const double sun_ang_dist, const double theta_eso,
+                            const double ecliptic_longitude, const double ecliptic_latitude,
+                            const double ecliptic_distance) {
+    // Negative output formats use ecliptic coordinates, not RA and Declination
+    if (s->output_format < 0) ephemeris_to_ecliptic(&x, &y, &z);
 
-        // Convert ecliptic longitude we output to epoch of observation
-        double eclTo_lat, eclTo_lng;
+    // Convert ecliptic longitude we output to epoch of observation
+    double eclTo_lat = ecliptic_latitude, eclTo_lng = ecliptic_longitude;
+    if (columns_needed & COLUMNS_ECLIPTIC) {
         precess(2451545.0, jd, ecliptic_longitude, ecliptic_latitude, &eclTo_lng, &eclTo_lat);
+    }
+
+    out[PARAM(0)] = x;
+    out[PARAM(1)] = y;
+    out[PARAM(2)] = z;
+    out[PARAM(3)] = ra;
+    out[PARAM(4)] = dec;
+    out[PARAM(5)] = mag;
+    out[PARAM(6)] = phase;
+    out[PARAM(7)] = ang_size;
+    out[PARAM(8)] = phy_size;
+    out[PARAM(9)] = albedo;
+    out[PARAM(10)] = sun_dist;
+    out[PARAM(11)] = earth_dist;
+    out[PARAM(12)] = sun_ang_dist;
+    out[PARAM(13)] = theta_eso;
+    out[PARAM(14)] = eclTo_lng; // ecliptic longitude in epoch of jd, not J2000.0
+    out[PARAM(15)] = ecliptic_distance;
+    out[PARAM(16)] = eclTo_lat;
+
+    // fix ecliptic longitude for precession of the equinoxes
+    if (out[PARAM(14)] > M_PI) out[PARAM(14)] -= 2 * M_PI;
+    if (out[PARAM(14)] < -M_PI) out[PARAM(14)] += 2 * M_PI;
+}
+
+//! ephemeris_store_rates - Store the rates of motion of one object at one time point in a buffer
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [out] out - The first of the N_PARAMETERS values for this object in the buffer
+//! \param [in] body_id - The object ID number
+//! \param [in] state - The positions of the Earth and Sun at the time point
+//! \param [in] topocentric_offset - The position of the observer relative to the geocentre; AU, J2000.0
+
+static void ephemeris_store_rates(const settings *s, double *out, const int body_id,
+                                  const orbitalElementsEpochState *state, const double *topocentric_offset) {
+    // Jean Meeus's algorithms (NOT IMPLEMENTED!!!) provide no velocities
+    if (s->use_orbital_elements == 2) {
+        out[PARAM(20)] = out[PARAM(21)] = out[PARAM(22)] = out[PARAM(23)] = GSL_NAN;
+        return;
+    }
+    jpl_computeRatesAtEpoch(body_id, state, s->use_orbital_elements, topocentric_offset,
+                            &out[PARAM(20)], &out[PARAM(21)], &out[PARAM(23)], &out[PARAM(22)]);
+}
+
+//! ephemeris_store_velocity - Store the rate of change of the position of one object at one time point in a buffer,
+//! in the same coordinates as its position. These are used to interpolate positions, and are not output.
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [out] out - The first of the N_PARAMETERS values for this object in the buffer
+//! \param [in] body_id - The object ID number
+//! \param [in] state - The positions of the Earth and Sun at the time point
+
+static void ephemeris_store_velocity(const settings *s, double *out, const int body_id,
+                                     const orbitalElementsEpochState *state) {
+    double velocity[3];
+    jpl_computeVelocityAtEpoch(body_id, state, s->use_orbital_elements, velocity);
+    if (s->output_format < 0) ephemeris_to_ecliptic(&velocity[0], &velocity[1], &velocity[2]);
+    out[PARAM(24)] = velocity[0];
+    out[PARAM(25)] = velocity[1];
+    out[PARAM(26)] = velocity[2];
+}
+
+//! ephemeris_columns_needed - Work out which groups of quantities are needed to produce the output columns selected
+//! by the settings for an ephemeris
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \return - A bitmask of COLUMNS_* flags
+
+static int ephemeris_columns_needed(const settings *s) {
+    int columns = 0;
+
+    // RA and Dec are output in modes 1-5, and are needed to find constellations and separations
+    if ((s->output_format >= 1) || s->output_constellations || s->output_separations) columns |= COLUMNS_RA_DEC;
 
-        buffer[o + 0] = x;
-        buffer[o + 1] = y;
-        buffer[o + 2] = z;
-        buffer[o + 3] = ra;
-        buffer[o + 4] = dec;
-        buffer[o + 5] = mag;
-        buffer[o + 6] = phase;
-        buffer[o + 7] = ang_size;
-        buffer[o + 8] = phy_size;
-        buffer[o + 9] = albedo;
-        buffer[o + 10] = sun_dist;
-        buffer[o + 11] = earth_dist;
-        buffer[o + 12] = sun_ang_dist;
-        buffer[o + 13] = theta_eso;
-        buffer[o + 14] = eclTo_lng; // ecliptic longitude in epoch of jd, not J2000.0
-        buffer[o + 15] = ecliptic_distance;
-        buffer[o + 16] = eclTo_lat;
-
-        // fix ecliptic longitude for precession of the equinoxes
-        if (buffer[o + 14] > M_PI) buffer[o + 14] -= 2 * M_PI;
-        if (buffer[o + 14] < -M_PI) buffer[o + 14] += 2 * M_PI;
-    }
-
-    // Produce output to file -- loop over objects producing a set of columns for each
+    // Magnitudes etc are output in modes 2 and 3, and distances in mode 5
+    if ((s->output_format == 2) || (s->output_format == 3) || (s->output_format == 5)) columns |= COLUMNS_PHYSICAL;
+
+    // Ecliptic coordinates are output only in mode 3
+    if (s->output_format == 3) columns |= COLUMNS_ECLIPTIC;
+    if (s->output_format == 4) columns |= COLUMNS_HORIZON;
+    if (s->output_format == 5) columns |= COLUMNS_RATES;
+    return columns;
+}
+
+//! ephemeris_store_at_observer - Compute the quantities needed by the output columns for one object, seen by one
+//! observer, from its apparent position, and store them in a buffer
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [out] out - The first of the N_PARAMETERS values for this object in the buffer
+//! \param [in] body_id - The object ID number
+//! \param [in] state - The positions of the Earth and Sun at the time point
+//! \param [in] x - The apparent position of the object, from <jpl_computePositionAtEpoch>; AU
+//! \param [in] topocentric_offset - The position of the observer relative to the geocentre; AU, J2000.0
+//! \param [in] epoch_precession - The precession matrix for the epoch of the RA/Dec output, computed once for many
+//! observers, or NULL to precess RA and Dec individually
+
+static void ephemeris_store_at_observer(const settings *s, double *out, const int body_id,
+                                        const orbitalElementsEpochState *state,
+                                        const double x, const double y, const double z,
+                                        const double *topocentric_offset, const double *epoch_precession) {
+    const double ra_dec_epoch = (epoch_precession != NULL) ? 2451545.0 : s->ra_dec_epoch;
+    double ra = GSL_NAN, dec = GSL_NAN;
+    double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0;
+    double sun_dist = 0, earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+    double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+    // Compute everything which <magnitudeEstimate> provides. The Earth's magnitude is computed for the Earth/Moon
+    // barycentre's ID number.
+    if (columns_needed & COLUMNS_PHYSICAL) {
+        magnitudeEstimate_atObserver((body_id == 19) ? 2 : body_id, x, y, z,
+                                     state->earth_pos[0], state->earth_pos[1], state->earth_pos[2],
+                                     state->sun_pos[0], state->sun_pos[1], state->sun_pos[2],
+                                     &ra, &dec, &mag, &phase, &ang_size, &phy_size, &albedo,
+                                     &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso, &ecliptic_longitude,
+                                     &ecliptic_latitude, &ecliptic_distance, ra_dec_epoch, topocentric_offset);
+    }
+
+        // Compute only RA and Dec
+    else if (columns_needed & COLUMNS_RA_DEC) {
+        magnitudeEstimate_raDec(x, y, z, state->earth_pos[0], state->earth_pos[1], state->earth_pos[2],
+                                &ra, &dec, ra_dec_epoch, topocentric_offset);
+    }
+
+    // Precess RA and Dec from J2000.0, using the matrix supplied
+    if ((ra_dec_epoch != s->ra_dec_epoch) && (columns_needed & (COLUMNS_PHYSICAL | COLUMNS_RA_DEC))) {
+        ra_dec_precess(epoch_precession, 0, ra, dec, &ra, &dec);
+    }
+
+    ephemeris_store(s, out, state->jd, x, y, z, ra, dec, mag, phase, ang_size, phy_size, albedo, sun_dist,
+                    earth_dist, sun_ang_dist, theta_eso, ecliptic_longitude, ecliptic_latitude, ecliptic_distance);
+    if (columns_needed & COLUMNS_RATES) ephemeris_store_rates(s, out, body_id, state, topocentric_offset);
+    if (columns_needed & COLUMNS_VELOCITY) ephemeris_store_velocity(s, out, body_id, state);
+}
+
+//! ephemeris_fwrite - Write a run of consecutive quantities for one object to a binary output file
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] obj - The first of the N_PARAMETERS values for the object in the buffer
+//! \param [in] first - The index of the first quantity to write
+//! \param [in] count - The number of quantities to write
+
+static void ephemeris_fwrite(const settings *s, FILE *output, const double *obj, const int first, const int count) {
+    double values[N_PARAMETERS];
+    int q;
+    for (q = 0; q < count; q++) values[q] = obj[PARAM(first + q)];
+    fwrite((void *) values, sizeof(double), count, output);
+}
+
+//! ephemeris_write - Write the columns for every object at one time point to the output
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] buf - The buffer of N_PARAMETERS arrays of values, one value for each object
+
+static void ephemeris_write(const settings *s, FILE *output, const double *buf) {
+    int i;
+
+    // Loop over objects producing a set of columns for each
     for (i = 0; i < s->objects_count; i++) {
-        const int o = i * N_PARAMETERS;
+        const double *obj = buf + i;
 
         // Produce text-based output
         if (!s->output_binary) {
@@ -151,61 +348,792 @@ void compute_ephemeris_time_point(const settings *s, FILE *output, const double
             // 1 - ra dec  (radians)
             // 2 - x y z ra dec mag phase AngSize
             // 3 - x y z ra dec mag phase AngSize physical_size albedo
+            // 4 - ra dec hour_angle altitude azimuth  (radians)
+            // 5 - ra dec sun_dist earth_dist ra_rate dec_rate sun_dist_rate earth_dist_rate  (radians, AU, per day)
 
-            // Write XYZ coordinates (in all modes but 1)
-            if (s->output_format != 1) {
-                fprintf(output, "%12.9f %12.9f %12.9f   ", buffer[o + 0], buffer[o + 1], buffer[o + 2]);
+            // Write XYZ coordinates (in all modes but 1, 4 and 5)
+            if ((s->output_format != 1) && (s->output_format != 4) && (s->output_format != 5)) {
+                fprintf(output, "%12.9f %12.9f %12.9f   ", obj[PARAM(0)], obj[PARAM(1)], obj[PARAM(2)]);
             }
 
-            // Write RA and Dec in modes 1,2,3
+            // Write RA and Dec in modes 1,2,3,4,5
             if (s->output_format >= 1) {
-                fprintf(output, "%12.9f %12.9f   ", buffer[o + 3], buffer[o + 4]);
+                fprintf(output, "%12.9f %12.9f   ", obj[PARAM(3)], obj[PARAM(4)]);
             }
 
             // Write magnitude, phase and angular size in modes 2,3
-            if (s->output_format >= 2) {
-                fprintf(output, "%6.3f %7.4f %12.9f   ", buffer[o + 5], buffer[o + 6], buffer[o + 7]);
+            if ((s->output_format >= 2) && (s->output_format <= 3)) {
+                fprintf(output, "%6.3f %7.4f %12.9f   ", obj[PARAM(5)], obj[PARAM(6)], obj[PARAM(7)]);
             }
 
             // Write physical size, albedo, sun_dist, earth_dist, sun_ang_dist, theta_edo, eclLng, eclDist, eclLat
-            if (s->output_format >= 3) {
-                fprintf(output, "%12.6e %8.5f %12.9f %12.9f %12.9f %12.9f %12.9f %12.9f %12.9f  ", buffer[o + 8],
-                        buffer[o + 9], buffer[o + 10], buffer[o + 11], buffer[o + 12], buffer[o + 13],
-                        buffer[o + 14], buffer[o + 15], buffer[o + 16]);
+            if (s->output_format == 3) {
+                fprintf(output, "%12.6e %8.5f %12.9f %12.9f %12.9f %12.9f %12.9f %12.9f %12.9f  ", obj[PARAM(8)],
+                        obj[PARAM(9)], obj[PARAM(10)], obj[PARAM(11)], obj[PARAM(12)], obj[PARAM(13)],
+                        obj[PARAM(14)], obj[PARAM(15)], obj[PARAM(16)]);
+            }
+
+            // Write hour angle, altitude and azimuth in mode 4
+            if (s->output_format == 4) {
+                fprintf(output, "%12.9f %12.9f %12.9f   ", obj[PARAM(17)], obj[PARAM(18)], obj[PARAM(19)]);
+            }
+
+            // Write distances and their rates of change, and rates of change of RA and Dec, in mode 5
+            if (s->output_format == 5) {
+                fprintf(output, "%12.9f %12.9f %16.9e %16.9e %16.9e %16.9e   ", obj[PARAM(10)], obj[PARAM(11)],
+                        obj[PARAM(20)], obj[PARAM(21)], obj[PARAM(22)], obj[PARAM(23)]);
             }
 
             // Write the name of the constellation the object is in, in the final column
             if (s->output_constellations) {
-                fprintf(output, "%s ", constellations_fetch(buffer[o + 3], buffer[o + 4]));
+                fprintf(output, "%s ", constellations_fetch(obj[PARAM(3)], obj[PARAM(4)]));
             }
         }
 
             // Produce binary output
         else {
-            if (s->output_format != 1) fwrite((void *) (buffer + o + 0), sizeof(double), 3, output);
-            if (s->output_format >= 1) fwrite((void *) (buffer + o + 3), sizeof(double), 2, output);
-            if (s->output_format >= 2) fwrite((void *) (buffer + o + 5), sizeof(double), 3, output);
-            if (s->output_format >= 3) fwrite((void *) (buffer + o + 8), sizeof(double), 9, output);
+            if ((s->output_format != 1) && (s->output_format != 4) && (s->output_format != 5))
+                ephemeris_fwrite(s, output, obj, 0, 3);
+            if (s->output_format >= 1) ephemeris_fwrite(s, output, obj, 3, 2);
+            if ((s->output_format >= 2) && (s->output_format <= 3))
+                ephemeris_fwrite(s, output, obj, 5, 3);
+            if (s->output_format == 3) ephemeris_fwrite(s, output, obj, 8, 9);
+            if (s->output_format == 4) ephemeris_fwrite(s, output, obj, 17, 3);
+            if (s->output_format == 5) {
+                ephemeris_fwrite(s, output, obj, 10, 2);
+                ephemeris_fwrite(s, output, obj, 20, 4);
+            }
             if (s->output_constellations)
-                fprintf(output, "%s ", constellations_fetch(buffer[o + 3], buffer[o + 4]));
+                fprintf(output, "%s ", constellations_fetch(obj[PARAM(3)], obj[PARAM(4)]));
+        }
+    }
+}
+
+//! ephemeris_write_separations - Write the angular separation, and optionally the position angle, of each pair of
+//! objects at one time point to the output, computed from the RA and Dec of each object
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] buf - The buffer of N_PARAMETERS arrays of values, one value for each object
+
+static void ephemeris_write_separations(const settings *s, FILE *output, const double *buf) {
+    const int values_per_pair = (s->output_separations > 1) ? 2 : 1;
+    const int values = values_per_pair * s->objects_count * (s->objects_count - 1) / 2;
+    int i;
+
+    if (!s->output_separations) return;
+
+    angDist_matrix(s->objects_count, 1, buf + PARAM(3), buf + PARAM(4), separation_workspace, separation_buffer,
+                   (values_per_pair > 1) ? separation_buffer + 1 : NULL, values_per_pair);
+
+    if (!s->output_binary) {
+        for (i = 0; i < values; i++) fprintf(output, "%12.9f ", separation_buffer[i]);
+        fprintf(output, "  ");
+    } else {
+        fwrite((void *) separation_buffer, sizeof(double), values, output);
+    }
+}
+
+//! compute_ephemeris_values - Compute the quantities needed by the output columns for every object at a single time
+//! point, and store them in a buffer laid out like <buffer>
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [out] buf - The buffer of N_PARAMETERS arrays of values, one value for each object
+//! \param [in] jd - The Julian date of the time point; TT
+//! \param [in] epoch_state - The positions of the Earth and Sun at <jd>, if already computed, or NULL
+
+static void compute_ephemeris_values(const settings *s, double *buf, const double jd,
+                                     const orbitalElementsEpochState *epoch_state) {
+    int i;
+
+    // Look up apparent places from the cache, where possible
+    int cache_misses = s->objects_count;
+    if (use_apparent_cache) {
+        cache_misses = 0;
+#pragma omp parallel for private(i) reduction(+:cache_misses)
+        for (i = 0; i < s->objects_count; i++) {
+            double v[APPARENT_CACHE_QUANTITIES];
+            apparent_cached[i] = (unsigned char) apparentCache_fetch(&apparent_key[i], jd, v);
+            if (apparent_cached[i]) {
+                ephemeris_store(s, buf + i, jd, v[APPARENT_CACHE_X], v[APPARENT_CACHE_Y], v[APPARENT_CACHE_Z],
+                                v[APPARENT_CACHE_RA],
+                                v[APPARENT_CACHE_DEC], v[APPARENT_CACHE_MAG], v[APPARENT_CACHE_PHASE],
+                                v[APPARENT_CACHE_ANG_SIZE], v[APPARENT_CACHE_PHY_SIZE], v[APPARENT_CACHE_ALBEDO],
+                                v[APPARENT_CACHE_SUN_DIST], v[APPARENT_CACHE_EARTH_DIST],
+                                v[APPARENT_CACHE_SUN_ANG_DIST], v[APPARENT_CACHE_THETA_ESO],
+                                v[APPARENT_CACHE_ECL_LONGITUDE], v[APPARENT_CACHE_ECL_LATITUDE],
+                                v[APPARENT_CACHE_ECL_DISTANCE]);
+            } else {
+                cache_misses++;
+            }
+        }
+    }
+
+    // Look up the positions of the Earth and Sun, which are shared by all objects, and the position of the observer
+    orbitalElementsEpochState state;
+    double topocentric_offset[3] = {0, 0, 0};
+    if ((s->use_orbital_elements != 2) && (cache_misses > 0)) {
+        if (epoch_state != NULL) state = *epoch_state;
+        else orbitalElements_computeEpochState(jd, &state);
+        if (s->enable_topocentric_correction && (columns_needed != 0)) {
+            const double st = sidereal_time(unix_from_jd(jd)) * 180 / 12; // degrees
+            const double pos_earth[3] = {0, 0, 0};
+            earthTopocentricPositionICRF(topocentric_offset, s->latitude, s->longitude, 1, pos_earth, jd, st);
+        }
+    }
+
+    // Compute ephemeris
+#pragma omp parallel for private(i)
+    for (i = 0; i < s->objects_count; i++) {
+        double x = 0, y = 0, z = 0;
+        if (use_apparent_cache && apparent_cached[i]) continue;
+
+        // If the <use_orbital_elements> is 2, we use Jean Meeus's algorithms (NOT IMPLEMENTED!!!)
+        if (s->use_orbital_elements == 2) {
+            double ra = 0, dec = 0;
+            double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0;
+            double sun_dist = 0, earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+            double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+            meeus_computeEphemeris(s->body_id[i], jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size, &phy_size,
+                                   &albedo,
+                                   &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso, &ecliptic_longitude,
+                                   &ecliptic_latitude, &ecliptic_distance, s->ra_dec_epoch,
+                                   s->enable_topocentric_correction,
+                                   s->latitude, s->longitude);
+            ephemeris_store(s, buf + i, jd, x, y, z, ra, dec, mag, phase, ang_size, phy_size, albedo, sun_dist,
+                            earth_dist, sun_ang_dist, theta_eso, ecliptic_longitude, ecliptic_latitude,
+                            ecliptic_distance);
+            if (columns_needed & COLUMNS_RATES) ephemeris_store_rates(s, buf + i, s->body_id[i], NULL, NULL);
+            continue;
         }
+
+        // If the <use_orbital_elements> is 0, we use DE430; if it is 1, we use orbital elements
+        if (s->use_orbital_elements == 0) jpl_computePositionAtEpoch(s->body_id[i], &state, &x, &y, &z);
+        else orbitalElements_computePositionAtEpoch(s->body_id[i], &state, &x, &y, &z);
+
+        // Compute only those quantities which are needed by the output columns
+        ephemeris_store_at_observer(s, buf + i, s->body_id[i], &state, x, y, z, topocentric_offset, NULL);
+    }
+
+    // Convert RA/Dec into hour angles, altitudes and azimuths, using a horizon frame computed once for all objects
+    if (columns_needed & COLUMNS_HORIZON) {
+        horizonFrame frame;
+        horizon_frame(&frame, jd, sidereal_time(unix_from_jd(jd)) * 180 / 12, s->latitude, s->longitude,
+                      s->ra_dec_epoch);
+        horizon_convert(&frame, s->objects_count, 1, buf + PARAM(3), buf + PARAM(4),
+                        buf + PARAM(17), buf + PARAM(18), buf + PARAM(19));
     }
+
+}
+
+//! ephemeris_write_row - Write the columns for every object at one time point to the output, as one line of text
+//! output (or one record of binary output)
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] jd - The Julian date of the time point; TT
+//! \param [in] buf - The buffer of N_PARAMETERS arrays of values, one value for each object
+
+static void ephemeris_write_row(const settings *s, FILE *output, const double jd, const double *buf) {
+    // When producing a text-based ephemeris, the first column in Julian day number (TT)
+    // Binary ephemerides have no JD column to save space.
+    if (!s->output_binary) fprintf(output, "%.12f   ", jd);
+
+    // Produce output to file
+    ephemeris_write(s, output, buf);
+    ephemeris_write_separations(s, output, buf);
     if (!s->output_binary) fprintf(output, "\n");
 }
 
+//! compute_ephemeris_time_point - Compute an ephemeris at a single time point
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] jd - The Julian date of the time point; TT
+//! \param [in] epoch_state - The positions of the Earth and Sun at <jd>, if already computed, or NULL
+
+void compute_ephemeris_time_point(const settings *s, FILE *output, const double jd,
+                                  const orbitalElementsEpochState *epoch_state) {
+    compute_ephemeris_values(s, buffer, jd, epoch_state);
+    ephemeris_write_row(s, output, jd, buffer);
+}
+
+//! compute_ephemeris_time_point_sites - Compute an ephemeris at a single time point, as seen from each of a list of
+//! sites. Everything which does not depend on the observer -- the positions of the Earth, Sun and each object, and
+//! the sidereal time -- is computed only once, and only the offset of each site from the geocentre is repeated.
+//! Each site produces one line of text output (or one record of binary output), in the order of the list of sites.
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] jd - The Julian date of the time point; TT
+//! \param [in] epoch_state - The positions of the Earth and Sun at <jd>, if already computed, or NULL
+
+void compute_ephemeris_time_point_sites(const settings *s, FILE *output, const double jd,
+                                        const orbitalElementsEpochState *epoch_state) {
+    const siteList *sites = s->sites;
+    const size_t site_stride = (size_t) N_PARAMETERS * s->objects_count;
+    orbitalElementsEpochState state;
+    int i, k;
+
+    // Look up the positions of the Earth and Sun
+    if (s->use_orbital_elements != 2) {
+        if (epoch_state != NULL) state = *epoch_state;
+        else orbitalElements_computeEpochState(jd, &state);
+    }
+
+    // Compute the position of each site relative to the geocentre, J2000.0, and its local horizon. The positions of
+    // objects alone do not depend on the observer. The precession matrices are computed once for all sites.
+    double precession[9], horizon_precession[9], epoch_precession[9];
+    const int precess_ra_dec = (s->ra_dec_epoch != 2451545.0);
+    const int precess_horizon = (s->ra_dec_epoch != jd);
+    if (columns_needed != 0) {
+        const double st = sidereal_time(unix_from_jd(jd)) * 180 / 12; // degrees
+        const double pos_earth[3] = {0, 0, 0};
+        precession_matrix(jd, precession);
+        if (precess_horizon) horizon_rotation(horizon_precession, jd, s->ra_dec_epoch);
+        for (k = 0; k < sites->site_count; k++) {
+            earthTopocentricPositionPrecessed(site_offset + 3 * k, sites->latitude[k], sites->longitude[k],
+                                              1, pos_earth, precession, st);
+            if (columns_needed & COLUMNS_HORIZON) {
+                horizon_framePrecessed(&site_horizon[k], st, sites->latitude[k], sites->longitude[k],
+                                       precess_horizon ? horizon_precession : NULL);
+            }
+        }
+    }
+    if (precess_ra_dec) precession_matrix(s->ra_dec_epoch, epoch_precession);
+
+    // Compute ephemeris
+#pragma omp parallel for shared(output) private(i, k)
+    for (i = 0; i < s->objects_count; i++) {
+        double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+        double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0;
+        double sun_dist = 0, earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+        double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+        // Jean Meeus's algorithms (NOT IMPLEMENTED!!!) cannot share any work between sites
+        if (s->use_orbital_elements == 2) {
+            for (k = 0; k < sites->site_count; k++) {
+                meeus_computeEphemeris(s->body_id[i], jd, &x, &y, &z, &ra, &dec, &mag, &phase, &ang_size, &phy_size,
+                                       &albedo,
+                                       &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso, &ecliptic_longitude,
+                                       &ecliptic_latitude, &ecliptic_distance, s->ra_dec_epoch,
+                                       1, sites->latitude[k], sites->longitude[k]);
+                ephemeris_store(s, site_buffer + k * site_stride + i, jd, x, y, z, ra, dec, mag, phase, ang_size,
+                                phy_size, albedo, sun_dist, earth_dist, sun_ang_dist, theta_eso,
+                                ecliptic_longitude, ecliptic_latitude, ecliptic_distance);
+                if (columns_needed & COLUMNS_RATES) {
+                    ephemeris_store_rates(s, site_buffer + k * site_stride + i, s->body_id[i], NULL, NULL);
+                }
+            }
+            continue;
+        }
+
+        // The barycentric position of the object, corrected for light travel time and aberration, is the same from
+        // every site
+        if (s->use_orbital_elements == 0) jpl_computePositionAtEpoch(s->body_id[i], &state, &x, &y, &z);
+        else orbitalElements_computePositionAtEpoch(s->body_id[i], &state, &x, &y, &z);
+
+        // Only the quantities which depend on the observer's position are recomputed for each site
+        for (k = 0; k < sites->site_count; k++) {
+            ephemeris_store_at_observer(s, site_buffer + k * site_stride + i, s->body_id[i], &state, x, y, z,
+                                        site_offset + 3 * k, precess_ra_dec ? epoch_precession : NULL);
+        }
+    }
+
+    // Produce output to file -- one line for each site. The name of the site is the second column of text output.
+    for (k = 0; k < sites->site_count; k++) {
+        double *site_objects = site_buffer + k * site_stride;
+        if (columns_needed & COLUMNS_HORIZON) {
+            horizon_convert(&site_horizon[k], s->objects_count, 1, site_objects + PARAM(3),
+                            site_objects + PARAM(4), site_objects + PARAM(17), site_objects + PARAM(18),
+                            site_objects + PARAM(19));
+        }
+        if (!s->output_binary) fprintf(output, "%.12f %-20s ", jd, sites->name[k]);
+        ephemeris_write(s, output, site_objects);
+        ephemeris_write_separations(s, output, site_objects);
+        if (!s->output_binary) fprintf(output, "\n");
+    }
+}
+
+//! hermite_setup - Work out which quantities are to be interpolated in interpolated output mode, and which of them
+//! can be differentiated analytically, and allocate workspace
+//! \param [in] s - The settings for the ephemeris we are computing
+
+static void hermite_setup(const settings *s) {
+    const int f = s->output_format;
+    const size_t buffer_size = (size_t) N_PARAMETERS * s->objects_count * sizeof(double);
+    int q;
+
+    for (q = 0; q < N_PARAMETERS; q++) {
+        hermite_kind[q] = HERMITE_SKIP;
+        hermite_rate_of[q] = -1;
+        hermite_rate_scale[q] = -1;
+    }
+    for (q = 0; q < HERMITE_GROUPS; q++) hermite_max_error[q] = 0;
+
+    // Quantities which are output, or used to compute constellations and separations; see <ephemeris_write>
+    if ((f != 1) && (f != 4) && (f != 5)) hermite_kind[0] = hermite_kind[1] = hermite_kind[2] = HERMITE_POSITION;
+    if (columns_needed & COLUMNS_RA_DEC) {
+        hermite_kind[3] = HERMITE_ANGLE_POS;
+        hermite_kind[4] = HERMITE_ANGLE;
+    }
+    if ((f == 2) || (f == 3)) {
+        hermite_kind[5] = HERMITE_MAG;
+        hermite_kind[6] = HERMITE_FRACTION;
+        hermite_kind[7] = HERMITE_LENGTH;
+    }
+    if (f == 3) {
+        hermite_kind[8] = HERMITE_LENGTH;
+        hermite_kind[9] = HERMITE_FRACTION;
+        hermite_kind[10] = hermite_kind[11] = HERMITE_LENGTH;
+        hermite_kind[12] = hermite_kind[13] = hermite_kind[16] = HERMITE_ANGLE;
+        hermite_kind[14] = hermite_kind[15] = HERMITE_ANGLE_SYM;
+    }
+    if (f == 4) {
+        hermite_kind[17] = HERMITE_ANGLE_SYM;
+        hermite_kind[18] = HERMITE_ANGLE;
+        hermite_kind[19] = HERMITE_ANGLE_POS;
+    }
+    if (f == 5) {
+        hermite_kind[10] = hermite_kind[11] = HERMITE_LENGTH;
+        hermite_kind[20] = hermite_kind[21] = hermite_kind[22] = hermite_kind[23] = HERMITE_RATE;
+        hermite_rate_scale[22] = 10;
+        hermite_rate_scale[23] = 11;
+    }
+
+    // The analytic rates of change of RA, Dec and distances are computed in the J2000.0 frame, and are not available
+    // from Jean Meeus's algorithms. They are only computed if some of these quantities are interpolated.
+    if ((s->use_orbital_elements != 2) && (s->ra_dec_epoch == 2451545.0)) {
+        if (hermite_kind[3] != HERMITE_SKIP) {
+            hermite_rate_of[3] = 20;
+            hermite_rate_of[4] = 21;
+            columns_needed |= COLUMNS_RATES;
+        }
+        if (hermite_kind[10] != HERMITE_SKIP) {
+            hermite_rate_of[10] = 22;
+            hermite_rate_of[11] = 23;
+            columns_needed |= COLUMNS_RATES;
+        }
+    }
+
+    // The analytic rates of change of positions are computed from the velocities of the objects
+    if ((s->use_orbital_elements != 2) && (hermite_kind[0] == HERMITE_POSITION)) {
+        hermite_rate_of[0] = 24;
+        hermite_rate_of[1] = 25;
+        hermite_rate_of[2] = 26;
+        columns_needed |= COLUMNS_VELOCITY;
+    }
+
+    hermite_numeric = 0;
+    for (q = 0; q < N_PARAMETERS; q++) {
+        if ((hermite_kind[q] != HERMITE_SKIP) && (hermite_rate_of[q] < 0)) hermite_numeric = 1;
+    }
+
+    // Intervals between nodes are bisected until they contain no rows between their ends, so an interval of
+    // <hermite_max_rows> rows needs workspace at ceil(log2(hermite_max_rows)) + 1 depths of bisection
+    hermite_max_rows = (int) floor(HERMITE_MAX_INTERVAL / s->jd_step);
+    hermite_node_count = 0;
+    hermite_max_depth = 1;
+    while ((1 << (hermite_max_depth - 1)) < hermite_max_rows) hermite_max_depth++;
+
+    // Allocate workspace
+    hermite_work_value = (double **) lt_malloc(hermite_max_depth * sizeof(double *));
+    hermite_work_deriv = (double **) lt_malloc(hermite_max_depth * sizeof(double *));
+    if ((hermite_work_value == NULL) || (hermite_work_deriv == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+    for (q = 0; q < hermite_max_depth; q++) {
+        hermite_work_value[q] = (double *) lt_malloc(buffer_size);
+        hermite_work_deriv[q] = (double *) lt_malloc(buffer_size);
+        if ((hermite_work_value[q] == NULL) || (hermite_work_deriv[q] == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+    }
+    hermite_interp = (double *) lt_malloc(buffer_size);
+    hermite_before = (double *) lt_malloc(buffer_size);
+    hermite_after = (double *) lt_malloc(buffer_size);
+    if ((hermite_interp == NULL) || (hermite_before == NULL) || (hermite_after == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+}
+
+//! hermite_node - Compute the ephemeris in full at a node, and the rate of change of each quantity which is to be
+//! interpolated
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] jd - The Julian date of the node; TT
+//! \param [out] value - Buffer laid out like <buffer>, in which to store the values of each quantity
+//! \param [out] deriv - Buffer laid out like <buffer>, in which to store the rates of change of each quantity; per day
+
+static void hermite_node(const settings *s, const double jd, double *value, double *deriv) {
+    int q, i;
+
+    compute_ephemeris_values(s, value, jd, NULL);
+    hermite_node_count++;
+    if (hermite_numeric) {
+        compute_ephemeris_values(s, hermite_before, jd - HERMITE_DERIVATIVE_STEP, NULL);
+        compute_ephemeris_values(s, hermite_after, jd + HERMITE_DERIVATIVE_STEP, NULL);
+    }
+
+    for (q = 0; q < N_PARAMETERS; q++) {
+        const int kind = hermite_kind[q];
+        if (kind == HERMITE_SKIP) continue;
+        for (i = 0; i < s->objects_count; i++) {
+            if (hermite_rate_of[q] >= 0) {
+                deriv[PARAM(q) + i] = value[PARAM(hermite_rate_of[q]) + i];
+            } else {
+                double diff = hermite_after[PARAM(q) + i] - hermite_before[PARAM(q) + i];
+                if ((kind == HERMITE_ANGLE_POS) || (kind == HERMITE_ANGLE_SYM)) diff = remainder(diff, 2 * M_PI);
+                deriv[PARAM(q) + i] = diff / (2 * HERMITE_DERIVATIVE_STEP);
+            }
+        }
+    }
+}
+
+//! hermite_interpolate - Interpolate the value of each quantity between two nodes by cubic Hermite interpolation
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] value_0 - The values of each quantity at the first node
+//! \param [in] deriv_0 - The rates of change of each quantity at the first node; per day
+//! \param [in] value_1 - The values of each quantity at the second node
+//! \param [in] deriv_1 - The rates of change of each quantity at the second node; per day
+//! \param [in] interval - The time interval between the nodes; days
+//! \param [in] t - The time at which to interpolate, as a fraction of the interval between the nodes (0-1)
+//! \param [out] out - Buffer laid out like <buffer>, in which to store the interpolated values
+
+static void hermite_interpolate(const settings *s, const double *value_0, const double *deriv_0,
+                                const double *value_1, const double *deriv_1, const double interval,
+                                const double t, double *out) {
+    const double h00 = (1 + 2 * t) * (1 - t) * (1 - t);
+    const double h10 = t * (1 - t) * (1 - t) * interval;
+    const double h01 = t * t * (3 - 2 * t);
+    const double h11 = t * t * (t - 1) * interval;
+    int q, i;
+
+    for (q = 0; q < N_PARAMETERS; q++) {
+        const int kind = hermite_kind[q];
+        for (i = 0; i < s->objects_count; i++) {
+            const int k = PARAM(q) + i;
+            const double p0 = value_0[k];
+            double p1 = value_1[k];
+
+            // Quantities which are not interpolated are taken from the first node
+            if (kind == HERMITE_SKIP) {
+                out[k] = p0;
+                continue;
+            }
+
+            // Angles which wrap around are interpolated without wrapping, and then wrapped back into their range
+            if ((kind == HERMITE_ANGLE_POS) || (kind == HERMITE_ANGLE_SYM)) p1 = p0 + remainder(p1 - p0, 2 * M_PI);
+            double v = h00 * p0 + h10 * deriv_0[k] + h01 * p1 + h11 * deriv_1[k];
+            if (kind == HERMITE_ANGLE_POS) {
+                v = fmod(v, 2 * M_PI);
+                if (v < 0) v += 2 * M_PI;
+            } else if (kind == HERMITE_ANGLE_SYM) {
+                v = remainder(v, 2 * M_PI);
+            }
+            out[k] = v;
+        }
+    }
+}
+
+//! hermite_check - Compare interpolated values of each quantity with values computed in full
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] interp - The interpolated values of each quantity
+//! \param [in] exact - The values of each quantity computed in full
+//! \param [out] error - The largest error in each group of quantities
+//! \return - Boolean indicating whether every quantity meets the tolerance
+
+static int hermite_check(const settings *s, const double *interp, const double *exact, double *error) {
+    const double tolerance = s->interpolate_tolerance / 3600 * M_PI / 180;  // radians
+    int q, i, ok = 1;
+
+    for (q = 0; q < HERMITE_GROUPS; q++) error[q] = 0;
+
+    for (q = 0; q < N_PARAMETERS; q++) {
+        const int kind = hermite_kind[q];
+        if (kind == HERMITE_SKIP) continue;
+        for (i = 0; i < s->objects_count; i++) {
+            const double e = exact[PARAM(q) + i];
+            const double v = interp[PARAM(q) + i];
+            double diff = fabs(v - e), limit = tolerance;
+            int group = HERMITE_GROUP_ANGLES;
+
+            // Quantities which are undefined, such as the magnitudes of objects with no brightness model, must be
+            // undefined at both nodes and in between
+            if (gsl_isnan(e) && gsl_isnan(v)) continue;
+            if (gsl_isnan(e) || gsl_isnan(v)) return 0;
+
+            if ((kind == HERMITE_ANGLE_POS) || (kind == HERMITE_ANGLE_SYM)) {
+                diff = fabs(remainder(v - e, 2 * M_PI));
+            } else if (kind == HERMITE_FRACTION) {
+                group = HERMITE_GROUP_RELATIVE;
+            } else if (kind == HERMITE_LENGTH) {
+                group = HERMITE_GROUP_RELATIVE;
+                if (e != 0) diff /= fabs(e);
+            } else if (kind == HERMITE_POSITION) {
+                const double r = gsl_hypot3(exact[PARAM(0) + i], exact[PARAM(1) + i], exact[PARAM(2) + i]);
+                group = HERMITE_GROUP_RELATIVE;
+                if (r != 0) diff /= r;
+            } else if (kind == HERMITE_MAG) {
+                group = HERMITE_GROUP_MAGS;
+                limit = HERMITE_MAG_TOLERANCE;
+            } else if (kind == HERMITE_RATE) {
+                // Rates which pass through zero, such as at stationary points, need an absolute floor
+                const int d = hermite_rate_scale[q];
+                const double floor = tolerance * ((d >= 0) ? fabs(exact[PARAM(d) + i]) : 1);  // per day
+                group = HERMITE_GROUP_RATES;
+                limit = HERMITE_RATE_TOLERANCE;
+                diff /= GSL_MAX(fabs(e), floor / HERMITE_RATE_TOLERANCE);
+            }
+
+            if (diff > error[group]) error[group] = diff;
+            if (!(diff <= limit)) ok = 0;
+        }
+    }
+    return ok;
+}
+
+//! hermite_write_rows - Interpolate the rows strictly between two nodes, and write them to the output
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] row_0 - The row number of the first node
+//! \param [in] value_0 - The values of each quantity at the first node
+//! \param [in] deriv_0 - The rates of change of each quantity at the first node
+//! \param [in] row_1 - The row number of the second node
+//! \param [in] value_1 - The values of each quantity at the second node
+//! \param [in] deriv_1 - The rates of change of each quantity at the second node
+
+static void hermite_write_rows(const settings *s, FILE *output, const int row_0, const double *value_0,
+                               const double *deriv_0, const int row_1, const double *value_1, const double *deriv_1) {
+    int row;
+    for (row = row_0 + 1; row < row_1; row++) {
+        const double jd = s->jd_min + row * s->jd_step;  // TT
+        hermite_interpolate(s, value_0, deriv_0, value_1, deriv_1, (row_1 - row_0) * s->jd_step,
+                            (double) (row - row_0) / (row_1 - row_0), buffer);
+        ephemeris_write_row(s, output, jd, buffer);
+    }
+}
+
+//! hermite_refine - Write the rows strictly between two nodes, checking whether they can be interpolated to within
+//! the tolerance. The ephemeris is computed in full at the midpoint, which becomes a new node, and compared with the
+//! value interpolated from the ends of the interval. For quantities which vary smoothly, the error of cubic Hermite
+//! interpolation is largest near the midpoint of the interval, so this check point is a good guide to the error of
+//! the rows in between, but not a strict bound on it. If the check fails, each half of the interval is refined in
+//! turn.
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] row_0 - The row number of the first node
+//! \param [in] value_0 - The values of each quantity at the first node
+//! \param [in] deriv_0 - The rates of change of each quantity at the first node
+//! \param [in] row_1 - The row number of the second node
+//! \param [in] value_1 - The values of each quantity at the second node
+//! \param [in] deriv_1 - The rates of change of each quantity at the second node
+//! \param [in] depth - The number of times the interval has been bisected
+
+static void hermite_refine(const settings *s, FILE *output, const int row_0, const double *value_0,
+                           const double *deriv_0, const int row_1, const double *value_1, const double *deriv_1,
+                           const int depth) {
+    double error[HERMITE_GROUPS];
+    int q;
+
+    if (row_1 - row_0 < 2) return;
+
+    // Workspace is sized for intervals of at most <hermite_max_rows> rows, which never run out of depths
+    if (depth >= hermite_max_depth) {
+        hermite_write_rows(s, output, row_0, value_0, deriv_0, row_1, value_1, deriv_1);
+        return;
+    }
+
+    const int row_mid = (row_0 + row_1) / 2;
+    const double jd_mid = s->jd_min + row_mid * s->jd_step;  // TT
+    double *value_mid = hermite_work_value[depth], *deriv_mid = hermite_work_deriv[depth];
+    hermite_node(s, jd_mid, value_mid, deriv_mid);
+
+    hermite_interpolate(s, value_0, deriv_0, value_1, deriv_1, (row_1 - row_0) * s->jd_step,
+                        (double) (row_mid - row_0) / (row_1 - row_0), hermite_interp);
+    if (hermite_check(s, hermite_interp, value_mid, error)) {
+        for (q = 0; q < HERMITE_GROUPS; q++) {
+            if (error[q] > hermite_max_error[q]) hermite_max_error[q] = error[q];
+        }
+        hermite_write_rows(s, output, row_0, value_0, deriv_0, row_mid, value_mid, deriv_mid);
+        ephemeris_write_row(s, output, jd_mid, value_mid);
+        hermite_write_rows(s, output, row_mid, value_mid, deriv_mid, row_1, value_1, deriv_1);
+        return;
+    }
+
+    hermite_refine(s, output, row_0, value_0, deriv_0, row_mid, value_mid, deriv_mid, depth + 1);
+    ephemeris_write_row(s, output, jd_mid, value_mid);
+    hermite_refine(s, output, row_mid, value_mid, deriv_mid, row_1, value_1, deriv_1, depth + 1);
+}
+
+//! compute_ephemeris_interpolated - Compute an ephemeris at evenly spaced time points, computing it in full only at
+//! adaptively chosen nodes, and filling the rows in between by cubic Hermite interpolation. Nodes are placed no more
+//! than HERMITE_MAX_INTERVAL apart, and each interval is bisected until the interpolation error at its midpoint meets
+//! the tolerance. Rows are written as each interval is finished, and the maximum error observed at the check points
+//! is reported at the end of the output.
+//! \param [in] s - The settings for the ephemeris we are computing
+//! \param [in] output - The file to write the ephemeris to
+//! \param [in] steps_total - The number of rows in the ephemeris
+
+static void compute_ephemeris_interpolated(const settings *s, FILE *output, const int steps_total) {
+    const size_t buffer_size = (size_t) N_PARAMETERS * s->objects_count * sizeof(double);
+
+    // The values and derivatives at the nodes at either end of the interval being worked on
+    double *value_0 = (double *) lt_malloc(buffer_size);
+    double *deriv_0 = (double *) lt_malloc(buffer_size);
+    double *value_1 = (double *) lt_malloc(buffer_size);
+    double *deriv_1 = (double *) lt_malloc(buffer_size);
+    if ((value_0 == NULL) || (deriv_0 == NULL) || (value_1 == NULL) || (deriv_1 == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    int row_0 = 0;
+    hermite_node(s, s->jd_min, value_0, deriv_0);
+    ephemeris_write_row(s, output, s->jd_min, value_0);
+    while (row_0 < steps_total - 1) {
+        const int row_1 = (steps_total - 1 - row_0 < hermite_max_rows) ? (steps_total - 1) : (row_0 + hermite_max_rows);
+        const double jd_1 = s->jd_min + row_1 * s->jd_step;  // TT
+        hermite_node(s, jd_1, value_1, deriv_1);
+        hermite_refine(s, output, row_0, value_0, deriv_0, row_1, value_1, deriv_1, 0);
+        ephemeris_write_row(s, output, jd_1, value_1);
+
+        double *swap = value_0;
+        value_0 = value_1;
+        value_1 = swap;
+        swap = deriv_0;
+        deriv_0 = deriv_1;
+        deriv_1 = swap;
+        row_0 = row_1;
+    }
+
+    // Report the maximum interpolation error observed at the check points. Binary ephemerides have no header, so it is
+    // reported on stderr.
+    {
+        FILE *header = s->output_binary ? stderr : output;
+        fprintf(header, "# Interpolated ephemeris: %d of %d rows computed in full; the rest by cubic Hermite "
+                        "interpolation, with a tolerance of %g arcsec.\n", hermite_node_count, steps_total,
+                s->interpolate_tolerance);
+        fprintf(header, "# Maximum error observed at check points: %.3e arcsec in angles; %.3e in distances and sizes "
+                        "(as a fraction of their values), phases and albedos; %.3e mag in magnitudes; %.3e in rates "
+                        "(as a fraction of their values).\n",
+                hermite_max_error[HERMITE_GROUP_ANGLES] * 180 / M_PI * 3600,
+                hermite_max_error[HERMITE_GROUP_RELATIVE], hermite_max_error[HERMITE_GROUP_MAGS],
+                hermite_max_error[HERMITE_GROUP_RATES]);
+    }
+}
+
 // Main entry point to compute an ephemeris, with parameters described by a settings structure
 void compute_ephemeris(settings *s) {
     FILE *output = stdout;
 
     // Initial processing of settings for this ephemeris
     settings_process(s);
+    columns_needed = ephemeris_columns_needed(s);
+
+    // Allocate a buffer for the quantities computed for each object
+    buffer = (double *) lt_malloc((size_t) N_PARAMETERS * s->objects_count * sizeof(double));
+    if (buffer == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Allocate buffers for the separation of each pair of objects
+    if (s->output_separations) {
+        separation_buffer = (double *) lt_malloc(((size_t) s->objects_count * s->objects_count + 1) * sizeof(double));
+        separation_workspace = (double *) lt_malloc(9 * s->objects_count * sizeof(double));
+        if ((separation_buffer == NULL) || (separation_workspace == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+    }
+
+    // Allocate buffers for the position of each observing site, and the ephemeris of each object seen from each site
+    if (s->sites != NULL) {
+        site_offset = (double *) lt_malloc(3 * s->sites->site_count * sizeof(double));
+        site_horizon = (horizonFrame *) lt_malloc(s->sites->site_count * sizeof(horizonFrame));
+        site_buffer = (double *) lt_malloc((size_t) N_PARAMETERS * s->objects_count * s->sites->site_count *
+                                           sizeof(double));
+        if ((site_offset == NULL) || (site_horizon == NULL) || (site_buffer == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+    }
 
-    if (s->jd_list == NULL) {
+    // Interpolated output is only possible for evenly spaced time points, without a list of sites, and only saves time
+    // if at least two steps fit between nodes
+    const int interpolate = (s->interpolate_tolerance > 0) && (s->jd_list == NULL) && (s->sites == NULL) &&
+                            (floor(HERMITE_MAX_INTERVAL / s->jd_step) >= 2);
+    if ((s->interpolate_tolerance > 0) && !interpolate) {
+        ephem_warning("Interpolated output needs evenly spaced times no more than 0.0625 days apart, without a list "
+                      "of sites; computing every row in full.");
+    }
+    if (interpolate) hermite_setup(s);
+
+    // A cache of apparent places can only be used when the quantities output for each object are positions and those
+    // computed by <magnitudeEstimate_atObserver>, without horizon coordinates or rates of change. It provides no rates
+    // of change, which are needed for interpolation. Cache entries cannot record which compact ephemeris they were
+    // computed from, since its contents may change under the same filename.
+    use_apparent_cache = (s->apparent_cache != NULL) && (s->apparent_cache_tolerance > 0) && (s->sites == NULL) &&
+                         (s->output_format >= 1) && (s->output_format <= 3) && (s->use_orbital_elements != 2) &&
+                         !interpolate && (s->ephemeris_file == NULL);
+    if (use_apparent_cache) {
+        apparent_key = (apparentCacheKey *) lt_malloc(s->objects_count * sizeof(apparentCacheKey));
+        apparent_cached = (unsigned char *) lt_malloc(s->objects_count);
+        if ((apparent_key == NULL) || (apparent_cached == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+
+        // The key for each object includes everything its apparent place depends upon
+        for (int i = 0; i < s->objects_count; i++) {
+            const apparentCacheKey key = {s->body_id[i], s->use_orbital_elements, s->enable_topocentric_correction,
+                                          s->ra_dec_epoch, s->latitude, s->longitude, s->ephemeris_tolerance,
+                                          orbitalElements_checksum(s->body_id[i]),
+                                          (columns_needed & COLUMNS_PHYSICAL) != 0};
+            apparent_key[i] = key;
+        }
+        apparentCache_open(s->apparent_cache, s->apparent_cache_tolerance);
+    } else if (s->apparent_cache != NULL) {
+        ephem_warning("The apparent place cache can only be used for output formats 1, 2 and 3, without a list of "
+                      "sites, interpolation or a compact ephemeris file; ignoring it.");
+    }
+
+    if ((s->jd_list == NULL) && interpolate) {
+        // Compute the ephemeris in full at a subset of the time points, and interpolate in between
+        const int steps_total = (int) ceil((s->jd_max - s->jd_min) / s->jd_step);
+        if (steps_total > 0) compute_ephemeris_interpolated(s, output, steps_total);
+    } else if (s->jd_list == NULL) {
         // Loop over all the time points in the ephemeris
         const int steps_total = (int) ceil((s->jd_max - s->jd_min) / s->jd_step);
+
+        // If requested, look up the positions of the Earth and Sun for blocks of time points at once
+        const int dense_grid = s->dense_grid && (s->use_orbital_elements != 2);
+        double *grid_jd = NULL;
+        orbitalElementsEpochState *grid_state = NULL;
+        if (dense_grid) {
+            grid_jd = (double *) lt_malloc(ORBIT_EPOCH_GRID_BLOCK * sizeof(double));
+            grid_state = (orbitalElementsEpochState *) lt_malloc(ORBIT_EPOCH_GRID_BLOCK *
+                                                                 sizeof(orbitalElementsEpochState));
+            if ((grid_jd == NULL) || (grid_state == NULL)) {
+                ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+                exit(1);
+            }
+        }
+
         for (int step_count = 0; step_count < steps_total; step_count++) {
             const double jd = s->jd_min + step_count * s->jd_step;  // TT
-            compute_ephemeris_time_point(s, output, jd);
+            const orbitalElementsEpochState *epoch_state = NULL;
+            if (dense_grid) {
+                const int grid_index = step_count % ORBIT_EPOCH_GRID_BLOCK;
+                if (grid_index == 0) {
+                    const int steps_left = steps_total - step_count;
+                    const int block_steps = (steps_left < ORBIT_EPOCH_GRID_BLOCK) ? steps_left : ORBIT_EPOCH_GRID_BLOCK;
+                    for (int j = 0; j < block_steps; j++) grid_jd[j] = s->jd_min + (step_count + j) * s->jd_step;
+                    orbitalElements_computeEpochStateGrid(block_steps, grid_jd, grid_state);
+                }
+                epoch_state = &grid_state[grid_index];
+            }
+            if (s->sites != NULL) compute_ephemeris_time_point_sites(s, output, jd, epoch_state);
+            else compute_ephemeris_time_point(s, output, jd, epoch_state);
         }
     } else {
         // Loop over explicit list of time points in the ephemeris
@@ -214,15 +1142,31 @@ void compute_ephemeris(settings *s) {
             char jd_string[FNAME_LENGTH];
             str_comma_separated_list_scan(&scan, jd_string);
             const double jd = get_float(jd_string, NULL);
-            compute_ephemeris_time_point(s, output, jd);
+            if (s->sites != NULL) compute_ephemeris_time_point_sites(s, output, jd, NULL);
+            else compute_ephemeris_time_point(s, output, jd, NULL);
         }
     }
 
     if (DEBUG) {
         char line[FNAME_LENGTH];
+        long hits, misses, loaded, evictions, bytes_read;
         strcpy(line, "Finished computing ephemeris.");
         ephem_log(line);
+        jpl_cacheStatistics(&hits, &misses, &loaded, &evictions, &bytes_read);
+        snprintf(line, FNAME_LENGTH, "DE430 data: %ld units loaded on demand; %ld loaded by readahead, of which %ld "
+                                     "used; %ld evicted; %ld bytes read.", misses, loaded, hits, evictions,
+                 bytes_read);
+        ephem_log(line);
+        if (use_apparent_cache) {
+            long cache_fits, cache_failures, cache_evictions;
+            apparentCache_statistics(&hits, &cache_fits, &cache_failures, &cache_evictions);
+            snprintf(line, FNAME_LENGTH, "Apparent place cache: %ld places evaluated from cached windows; %ld "
+                                         "windows fitted; %ld could not be fitted; %ld evicted.",
+                     hits, cache_fits, cache_failures, cache_evictions);
+            ephem_log(line);
+        }
     }
+    if (use_apparent_cache) apparentCache_close();
     fclose(output);
     settings_close(s);
 }
@@ -258,6 +1202,9 @@ int main(int argc, const char **argv) {
                       "The latitude of the observation site (deg); only used if topocentric correction enabled"),
             OPT_FLOAT('m', "longitude", &ephemeris_settings.longitude,
                       "The longitude of the observation site (deg); only used if topocentric correction enabled"),
+            OPT_STRING('L', "sites", &ephemeris_settings.site_list,
+                       "Text file listing observing sites -- name, latitude and longitude (deg) -- for which to "
+                       "produce topocentric ephemerides. Overrides <latitude> and <longitude>. See README.md."),
             OPT_INTEGER('t', "enable_topocentric_correction", &ephemeris_settings.enable_topocentric_correction,
                         "Set to either 0 (return geocentric coordinates) or 1 (return topocentric coordinates)"),
             OPT_FLOAT('e', "epoch", &ephemeris_settings.ra_dec_epoch,
@@ -270,6 +1217,28 @@ int main(int argc, const char **argv) {
                         "Set to either 0 (text output) or 1 (binary output)"),
             OPT_INTEGER('c', "output_constellations", &ephemeris_settings.output_constellations,
                         "Set to either 0 (no column for constellation names) or 1"),
+            OPT_INTEGER('p', "output_separations", &ephemeris_settings.output_separations,
+                        "Set to 1 to append the angular separation of each pair of objects, or 2 to also append "
+                        "their position angles"),
+            OPT_INTEGER('M', "cache_size", &ephemeris_settings.cache_size,
+                        "The maximum memory to use to cache DE430 data, in MB; 0 for no limit"),
+            OPT_STRING('E', "ephemeris_file", &ephemeris_settings.ephemeris_file,
+                       "A compact ephemeris, written by compactEphemeris.bin, to use in place of DE430"),
+            OPT_FLOAT('T', "ephemeris_tolerance", &ephemeris_settings.ephemeris_tolerance,
+                      "The accuracy needed in the positions of bodies from DE430, in km. Trailing terms of the "
+                      "Chebyshev series which are smaller than this are skipped. 0 for full precision."),
+            OPT_STRING('A', "apparent_cache", &ephemeris_settings.apparent_cache,
+                       "A file in which to cache Chebyshev fits to the RA and Dec of each object, which are reused "
+                       "by later runs. Only used with output_format 1. See README.md."),
+            OPT_FLOAT('P', "apparent_cache_tolerance", &ephemeris_settings.apparent_cache_tolerance,
+                      "The accuracy needed in RA, Dec and other angles taken from the apparent place cache, in "
+                      "arcsec. See README.md."),
+            OPT_FLOAT('I', "interpolate", &ephemeris_settings.interpolate_tolerance,
+                      "If non-zero, compute the ephemeris in full only at adaptively chosen nodes, and fill the "
+                      "rows in between by Hermite interpolation to this accuracy, in arcsec. See README.md."),
+            OPT_INTEGER('G', "dense_grid", &ephemeris_settings.dense_grid,
+                        "Set to 1 to look up the position of the Earth at blocks of evenly spaced time points "
+                        "with matrix products, which is faster for ephemerides with short time steps"),
             OPT_STRING('o', "objects", &ephemeris_settings.objects_input_list,
                        "The list of objects to produce ephemerides for. See README.md."),
             OPT_END(),
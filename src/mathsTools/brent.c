@@ -0,0 +1,120 @@
+// brent.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "brent.h"
+
+// The golden ratio, used to choose golden-section steps
+#define BRENT_GOLDEN 0.3819660112501051
+
+// Maximum number of iterations before giving up
+#define BRENT_MAX_ITERATIONS 200
+
+//! brent_minimise - Find the minimum of a function within a bracket [a, c], using Brent's method, which combines
+//! parabolic interpolation with golden-section search. See Brent (1973), Algorithms for Minimization without
+//! Derivatives, chapter 5.
+//! \param [in] f - The function to minimise
+//! \param [in] params - Parameters to pass to the function
+//! \param [in] a - The lower end of the bracket
+//! \param [in] b - A point within the bracket where the function is no larger than at either end
+//! \param [in] c - The upper end of the bracket
+//! \param [in] tolerance - The precision with which to locate the minimum, in units of x
+//! \param [out] x_min - The position of the minimum
+//! \return - The value of the function at the minimum
+
+double brent_minimise(double (*f)(double, void *), void *params, const double a, const double b, const double c,
+                      const double tolerance, double *x_min) {
+    int iteration;
+    double lower = (a < c) ? a : c;
+    double upper = (a < c) ? c : a;
+    double x = b, w = b, v = b;
+    double fx = f(x, params), fw = fx, fv = fx;
+    double d = 0, e = 0;
+
+    for (iteration = 0; iteration < BRENT_MAX_ITERATIONS; iteration++) {
+        const double midpoint = (lower + upper) / 2;
+        const double tol1 = tolerance + 1e-12 * fabs(x);
+        const double tol2 = 2 * tol1;
+
+        // Stop when the bracket is small enough
+        if (fabs(x - midpoint) <= tol2 - (upper - lower) / 2) break;
+
+        int golden_step = 1;
+        if (fabs(e) > tol1) {
+            // Try fitting a parabola through x, v and w
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2 * (q - r);
+            if (q > 0) p = -p;
+            else q = -q;
+            const double e_previous = e;
+            e = d;
+
+            // Accept the parabolic step only if it falls within the bracket, and is smaller than half the step
+            // before last
+            if ((fabs(p) < fabs(q * e_previous / 2)) && (p > q * (lower - x)) && (p < q * (upper - x))) {
+                d = p / q;
+                const double u = x + d;
+                if ((u - lower < tol2) || (upper - u < tol2)) d = (x < midpoint) ? tol1 : -tol1;
+                golden_step = 0;
+            }
+        }
+
+        if (golden_step) {
+            e = (x < midpoint) ? (upper - x) : (lower - x);
+            d = BRENT_GOLDEN * e;
+        }
+
+        // Never evaluate the function closer than <tol1> to x
+        const double u = (fabs(d) >= tol1) ? (x + d) : (x + ((d > 0) ? tol1 : -tol1));
+        const double fu = f(u, params);
+
+        if (fu <= fx) {
+            if (u < x) upper = x;
+            else lower = x;
+            v = w;
+            fv = fw;
+            w = x;
+            fw = fx;
+            x = u;
+            fx = fu;
+        } else {
+            if (u < x) lower = u;
+            else upper = u;
+            if ((fu <= fw) || (w == x)) {
+                v = w;
+                fv = fw;
+                w = u;
+                fw = fu;
+            } else if ((fu <= fv) || (v == x) || (v == w)) {
+                v = u;
+                fv = fu;
+            }
+        }
+    }
+
+    *x_min = x;
+    return fx;
+}
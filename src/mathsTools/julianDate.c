@@ -274,6 +274,62 @@ double jd_from_unix(double utc) {
     return (utc / 86400.0) + 2440587.5;
 }
 
+//! precession_matrix - Compute the rotation matrix which transforms vectors from the J2000.0 equatorial frame into
+//! the mean equator and equinox of another epoch, using the IAU 1976 precession angles. See Meeus's Astronomical
+//! Algorithms, chapter 21. The transpose of the matrix transforms vectors back into J2000.0. This is an exact rotation,
+//! used where many positions are precessed at once; it differs from Green's formulae in <ra_dec_from_j2000> by a few
+//! hundredths of an arcsecond near J2000.0, and by more at distant epochs.
+//! \param [in] jd - Julian date of the epoch
+//! \param [out] matrix - The 3x3 rotation matrix, in row-major order
+
+void precession_matrix(double jd, double *matrix) {
+    const double t = (jd - 2451545.0) / 36525.0; // Julian centuries since 2000.0
+
+    const double arcsec = M_PI / 180 / 3600;
+    const double zeta = (2306.2181 * t + 0.30188 * t * t + 0.017998 * t * t * t) * arcsec;
+    const double z = (2306.2181 * t + 1.09468 * t * t + 0.018203 * t * t * t) * arcsec;
+    const double theta = (2004.3109 * t - 0.42665 * t * t - 0.041833 * t * t * t) * arcsec;
+
+    const double c_zeta = cos(zeta), s_zeta = sin(zeta);
+    const double c_z = cos(z), s_z = sin(z);
+    const double c_theta = cos(theta), s_theta = sin(theta);
+
+    matrix[0] = c_zeta * c_theta * c_z - s_zeta * s_z;
+    matrix[1] = -s_zeta * c_theta * c_z - c_zeta * s_z;
+    matrix[2] = -s_theta * c_z;
+    matrix[3] = c_zeta * c_theta * s_z + s_zeta * c_z;
+    matrix[4] = -s_zeta * c_theta * s_z + c_zeta * c_z;
+    matrix[5] = -s_theta * s_z;
+    matrix[6] = c_zeta * s_theta;
+    matrix[7] = -s_zeta * s_theta;
+    matrix[8] = c_theta;
+}
+
+//! ra_dec_precess - Rotate celestial coordinates by a matrix computed by <precession_matrix>, so that the same
+//! rotation can be applied to many positions
+//! \param [in] matrix - The rotation matrix, from <precession_matrix>
+//! \param [in] transpose - If true, rotate by the transpose of <matrix>, converting from its epoch into J2000.0
+//! \param [in] ra_in - Input right ascension, in radians
+//! \param [in] dec_in - Input declination, in radians
+//! \param [out] ra_out - Output right ascension, in radians, in the range 0 to 2pi
+//! \param [out] dec_out - Output declination, in radians
+
+void ra_dec_precess(const double *matrix, int transpose, double ra_in, double dec_in,
+                    double *ra_out, double *dec_out) {
+    const double v[3] = {cos(dec_in) * cos(ra_in), cos(dec_in) * sin(ra_in), sin(dec_in)};
+    const int row = transpose ? 1 : 3, col = transpose ? 3 : 1;
+    double w[3];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        w[i] = matrix[i * row] * v[0] + matrix[i * row + col] * v[1] + matrix[i * row + 2 * col] * v[2];
+    }
+
+    *ra_out = atan2(w[1], w[0]);
+    if (*ra_out < 0) *ra_out += 2 * M_PI;
+    *dec_out = atan2(w[2], hypot(w[0], w[1]));
+}
+
 //! ra_dec_from_j2000 - Convert celestial coordinates from J2000 into a new epoch. See Green's Spherical Astronomy, pp 222-225
 //! \param [in] ra_j2000_in - Input right ascension, in radians, J2000
 //! \param [in] dec_j2000_in - Input declination, in radians, J2000
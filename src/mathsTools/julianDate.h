@@ -41,6 +41,11 @@ double unix_from_jd(double jd);
 
 double jd_from_unix(double utc);
 
+void precession_matrix(double jd, double *matrix);
+
+void ra_dec_precess(const double *matrix, int transpose, double ra_in, double dec_in,
+                    double *ra_out, double *dec_out);
+
 void ra_dec_from_j2000(double ra_j2000_in, double dec_j2000_in, double jd_new,
                        double *ra_epoch_out, double *dec_epoch_out);
 
@@ -49,27 +49,19 @@ double horner(double x, const double *c, int length) {
     return y;
 }
 
-//! precess - Convert a celestial position, expressed into equatorial coordinates at one epoch, into equatorial
-//! coordinates at a different epoch.
-//! \param [in] epochFrom - The epoch of the input equatorial coordinates, expressed as a Julian day number.
-//! \param [in] epochTo- The epoch of the output equatorial coordinates, expressed as a Julian day number.
-//! \param [in] eclFrom_lng - Input equatorial longitude (radians)
-//! \param [in] eclFrom_lat - Input equatorial latitude (radians)
-//! \param [out] eclTo_lng - Output equatorial longitude (radians)
-//! \param [out] eclTo_lat - Output equatorial latitude (radians)
-
-void precess(double epochFrom, double epochTo, double eclFrom_lng, double eclFrom_lat,
-             double *eclTo_lng, double *eclTo_lat) {
-
+//! precess_angles - Compute the angles which describe the precession of the ecliptic from one epoch to another.
+//! See Meeus, Astronomical Algorithms, (21.5) p. 136.
+//! \param [in] epochFrom - The epoch of the input ecliptic, expressed as a Julian day number.
+//! \param [in] epochTo - The epoch of the output ecliptic, expressed as a Julian day number.
+//! \param [out] eta - The angle between the two ecliptics (radians)
+//! \param [out] pi - The longitude of the node of the output ecliptic on the input ecliptic (radians)
+//! \param [out] p - The general precession in longitude (radians)
+
+static void precess_angles(double epochFrom, double epochTo, double *eta, double *pi, double *p) {
     // Convert epochs from JDs into Julian years
     epochFrom = (epochFrom - 2451544.5) / 365.2425 + 2000;
     epochTo = (epochTo - 2451544.5) / 365.2425 + 2000;
 
-    double smallAngle = 10 * M_PI / 180 / 60; // about .003 radians
-    // cosine of SmallAngle
-    double cosSmallAngle = cos(smallAngle); // about .999996
-
-
     // coefficients from (21.5) p. 136
     const double d = M_PI / 180;
     const double s = d / 3600;
@@ -96,9 +88,29 @@ void precess(double epochFrom, double epochTo, double eclFrom_lng, double eclFro
     p_coeff[2] = -0.000006 * s;
 
     double t = (epochTo - epochFrom) * 0.01;
-    double pi = horner(t, pi_coeff, 3);
-    double p = horner(t, p_coeff, 3) * t;
-    double eta = horner(t, eta_coeff, 3) * t;
+    *pi = horner(t, pi_coeff, 3);
+    *p = horner(t, p_coeff, 3) * t;
+    *eta = horner(t, eta_coeff, 3) * t;
+}
+
+//! precess - Convert a celestial position, expressed into equatorial coordinates at one epoch, into equatorial
+//! coordinates at a different epoch.
+//! \param [in] epochFrom - The epoch of the input equatorial coordinates, expressed as a Julian day number.
+//! \param [in] epochTo- The epoch of the output equatorial coordinates, expressed as a Julian day number.
+//! \param [in] eclFrom_lng - Input equatorial longitude (radians)
+//! \param [in] eclFrom_lat - Input equatorial latitude (radians)
+//! \param [out] eclTo_lng - Output equatorial longitude (radians)
+//! \param [out] eclTo_lat - Output equatorial latitude (radians)
+
+void precess(double epochFrom, double epochTo, double eclFrom_lng, double eclFrom_lat,
+             double *eclTo_lng, double *eclTo_lat) {
+    double eta, pi, p;
+
+    double smallAngle = 10 * M_PI / 180 / 60; // about .003 radians
+    // cosine of SmallAngle
+    double cosSmallAngle = cos(smallAngle); // about .999996
+
+    precess_angles(epochFrom, epochTo, &eta, &pi, &p);
     double s_eta = sin(eta);
     double c_eta = cos(eta);
 
@@ -121,6 +133,48 @@ void precess(double epochFrom, double epochTo, double eclFrom_lng, double eclFro
     }
 }
 
+//! precess_matrix - Compute the matrix which rotates position vectors in ecliptic coordinates at one epoch into
+//! ecliptic coordinates at a different epoch. This is the same transformation as <precess>, and is useful when
+//! velocities must also be transformed, or when many positions are transformed at once.
+//! \param [in] epochFrom - The epoch of the input ecliptic, expressed as a Julian day number.
+//! \param [in] epochTo - The epoch of the output ecliptic, expressed as a Julian day number.
+//! \param [out] matrix - The 3x3 rotation matrix, stored row by row
+
+void precess_matrix(double epochFrom, double epochTo, double *matrix) {
+    double eta, pi, p;
+    precess_angles(epochFrom, epochTo, &eta, &pi, &p);
+
+    // Rotate x to the node of the output ecliptic, tilt by eta about that node, and then measure longitudes from the
+    // equinox of the output epoch
+    const double cpi = cos(pi), spi = sin(pi);
+    const double ceta = cos(eta), seta = sin(eta);
+    const double cp = cos(pi + p), sp = sin(pi + p);
+
+    matrix[0] = cp * cpi + sp * ceta * spi;
+    matrix[1] = cp * spi - sp * ceta * cpi;
+    matrix[2] = -sp * seta;
+    matrix[3] = sp * cpi - cp * ceta * spi;
+    matrix[4] = sp * spi + cp * ceta * cpi;
+    matrix[5] = cp * seta;
+    matrix[6] = seta * spi;
+    matrix[7] = -seta * cpi;
+    matrix[8] = ceta;
+}
+
+//! nutation_longitude - Compute the nutation in longitude, to an accuracy of 0.5 arcseconds. See Meeus,
+//! Astronomical Algorithms, chapter 22.
+//! \param [in] jd - The Julian date; TT
+//! \return - The nutation in longitude (radians)
+
+double nutation_longitude(double jd) {
+    const double arcsec = M_PI / 180 / 3600;
+    const double t = (jd - 2451545.0) / 36525;
+    const double omega = (125.04452 - 1934.136261 * t) * M_PI / 180;
+    const double l_sun = (280.4665 + 36000.7698 * t) * M_PI / 180;
+    const double l_moon = (218.3165 + 481267.8813 * t) * M_PI / 180;
+    return (-17.20 * sin(omega) - 1.32 * sin(2 * l_sun) - 0.23 * sin(2 * l_moon) + 0.21 * sin(2 * omega)) * arcsec;
+}
+
 // Simple test case for diagnostics
 
 //void main() {
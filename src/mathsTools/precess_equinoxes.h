@@ -25,5 +25,9 @@
 void precess(double epochFrom, double epochTo, double eclFrom_lng, double eclFrom_lat,
              double *eclTo_lng, double *eclTo_lat);
 
+void precess_matrix(double epochFrom, double epochTo, double *matrix);
+
+double nutation_longitude(double jd);
+
 #endif
 
@@ -71,3 +71,56 @@ double angDist_RADec(double ra0, double dec0, double ra1, double dec1) {
     double sep = sqrt(sep2);
     return 2 * asin(sep / 2);
 }
+
+//! angDist_matrix - Calculate the angular distances, and optionally the position angles, between every pair of a
+//! list of points. Unit vectors pointing towards each point, and towards north and east at each point, are computed
+//! once, after which each pair costs only a few vector operations.
+//! \param count - The number of points
+//! \param stride - The separation of the values for consecutive points in the arrays <ra> and <dec>
+//! \param ra - The right ascension of each point (radians)
+//! \param dec - The declination of each point (radians)
+//! \param workspace - Storage for 9 * <count> doubles
+//! \param separation - Output array of angular distances (radians). The pairs (i, j) with i < j are listed in the
+//! order (0,1), (0,2) ... (0,count-1), (1,2) ...
+//! \param position_angle - Output array of the position angle of point j relative to point i, measured eastwards
+//! from north, in the range 0 to 2pi (radians). May be NULL.
+//! \param out_stride - The separation of the values for consecutive pairs in <separation> and <position_angle>
+
+void angDist_matrix(const int count, const int stride, const double *ra, const double *dec, double *workspace,
+                    double *separation, double *position_angle, const int out_stride) {
+    double *u = workspace, *east = workspace + 3 * count, *north = workspace + 6 * count;
+    int i, j, k = 0;
+
+    for (i = 0; i < count; i++) {
+        const double sin_ra = sin(ra[i * stride]), cos_ra = cos(ra[i * stride]);
+        const double sin_dec = sin(dec[i * stride]), cos_dec = cos(dec[i * stride]);
+        u[3 * i + 0] = cos_dec * cos_ra;
+        u[3 * i + 1] = cos_dec * sin_ra;
+        u[3 * i + 2] = sin_dec;
+        east[3 * i + 0] = -sin_ra;
+        east[3 * i + 1] = cos_ra;
+        east[3 * i + 2] = 0;
+        north[3 * i + 0] = -sin_dec * cos_ra;
+        north[3 * i + 1] = -sin_dec * sin_ra;
+        north[3 * i + 2] = cos_dec;
+    }
+
+    for (i = 0; i < count; i++) {
+        const double *ui = u + 3 * i;
+        for (j = i + 1; j < count; j++, k++) {
+            const double *uj = u + 3 * j;
+
+            // Use the chord length, which is accurate for small separations, as in <angDist_RADec>
+            const double chord = sqrt(gsl_pow_2(ui[0] - uj[0]) + gsl_pow_2(ui[1] - uj[1]) + gsl_pow_2(ui[2] - uj[2]));
+            separation[k * out_stride] = 2 * asin(GSL_MIN(chord / 2, 1));
+
+            if (position_angle != NULL) {
+                const double *ei = east + 3 * i, *ni = north + 3 * i;
+                double pa = atan2(uj[0] * ei[0] + uj[1] * ei[1] + uj[2] * ei[2],
+                                  uj[0] * ni[0] + uj[1] * ni[1] + uj[2] * ni[2]);
+                if (pa < 0) pa += 2 * M_PI;
+                position_angle[k * out_stride] = pa;
+            }
+        }
+    }
+}
@@ -26,5 +26,8 @@ double angDist_ABC(double xa, double ya, double za, double xb, double yb, double
 
 double angDist_RADec(double ra0, double dec0, double ra1, double dec1);
 
+void angDist_matrix(int count, int stride, const double *ra, const double *dec, double *workspace,
+                    double *separation, double *position_angle, int out_stride);
+
 #endif
 
@@ -0,0 +1,169 @@
+// riseSet.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for computing the times when objects rise, transit and set, at any number of places, using the
+// DE430 ephemeris.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/riseSet.h"
+#include "ephemCalc/siteList.h"
+
+#include "listTools/ltMemory.h"
+
+#include "mathsTools/julianDate.h"
+
+#include "settings/settings.h"
+
+static const char *const usage[] = {
+        "riseSet.bin [options] [[--] args]",
+        "riseSet.bin [options]",
+        NULL,
+};
+
+//! rise_set_write_time - Write a Julian date to stdout, or a dash if the event does not happen
+
+static void rise_set_write_time(const double jd) {
+    if (gsl_isnan(jd)) fprintf(stdout, " %14s", "-");
+    else fprintf(stdout, " %14.6f", jd);
+}
+
+//! rise_set_run - Compute the times when each object rises, transits and sets, on each day, at each site
+//! \param [in] s - The settings, containing the list of objects and the range of days
+//! \param [in] sites - The list of sites
+
+void rise_set_run(settings *s, const siteList *sites) {
+    double jd0;
+
+    settings_process(s);
+    riseSetDay *day = riseSet_init(s->body_id, s->objects_count);
+
+    // Each day starts at 0h UT
+    for (jd0 = floor(s->jd_min - 0.5) + 0.5; jd0 < s->jd_max; jd0++) {
+        int year, month, date, hour, min, status, i, j;
+        double sec;
+
+        riseSet_prepareDay(day, jd0);
+        inv_julian_day(jd0, &year, &month, &date, &hour, &min, &sec, &status, temp_err_string);
+
+        for (i = 0; i < sites->site_count; i++) {
+            for (j = 0; j < s->objects_count; j++) {
+                riseSetTimes times;
+                riseSet_compute(day, j, sites->latitude[i], sites->longitude[i], &times);
+                fprintf(stdout, "%14.6f %04d %02d %02d   %-20s %-12s", jd0, year, month, date, sites->name[i],
+                        s->object_name[j]);
+                rise_set_write_time(times.jd_rise);
+                rise_set_write_time(times.jd_transit);
+                rise_set_write_time(times.jd_set);
+                fprintf(stdout, " %+8.3f\n", times.transit_altitude * 180 / M_PI);
+            }
+        }
+    }
+    settings_close(s);
+}
+
+int main(int argc, const char **argv) {
+    settings rise_set_settings;
+    const char *site_list = NULL;
+    siteList *sites;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising rise and set calculation.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default rise and set parameters.");
+    settings_default(&rise_set_settings);
+    rise_set_settings.objects_input_list = "sun,moon";
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &rise_set_settings.jd_min,
+                      "The Julian day number of the first day; TT"),
+            OPT_FLOAT('b', "jd_max", &rise_set_settings.jd_max,
+                      "The Julian day number at which to stop; TT"),
+            OPT_STRING('o', "objects", &rise_set_settings.objects_input_list,
+                       "The list of objects to compute rise and set times for. See README.md."),
+            OPT_STRING('l', "sites", &site_list,
+                       "Text file listing sites: name, latitude and longitude (east of Greenwich; degrees)"),
+            OPT_FLOAT(0, "latitude", &rise_set_settings.latitude,
+                      "Latitude of the site, if no list of sites is supplied; degrees"),
+            OPT_FLOAT(0, "longitude", &rise_set_settings.longitude,
+                      "Longitude of the site (east of Greenwich), if no list of sites is supplied; degrees"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nCompute the times when objects rise, transit and set",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    // If no list of sites is supplied, use the single site given by --latitude and --longitude
+    if (site_list != NULL) {
+        sites = siteList_load(site_list);
+    } else {
+        static char site_name[1][SITE_NAME_LENGTH] = {"site"};
+        static siteList single_site;
+        single_site.site_count = 1;
+        single_site.name = site_name;
+        single_site.latitude = &rise_set_settings.latitude;
+        single_site.longitude = &rise_set_settings.longitude;
+        sites = &single_site;
+    }
+
+    // Compute rise and set times
+    rise_set_run(&rise_set_settings, sites);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
@@ -27,7 +27,9 @@
 #include <coreUtils/errorReport.h>
 
 #include "coreUtils/asciiDouble.h"
+#include "ephemCalc/jpl.h"
 #include "ephemCalc/orbitalElements.h"
+#include "listTools/ltMemory.h"
 
 #include "settings.h"
 
@@ -39,12 +41,24 @@ void settings_default(settings *i) {
     i->latitude = 0;
     i->longitude = 0;
     i->enable_topocentric_correction = 0;
+    i->site_list = NULL;
+    i->sites = NULL;
     i->ra_dec_epoch = 2451545.0;  // By default, use J2000 coordinates
     i->output_format = 0;
     i->use_orbital_elements = 0;
     i->output_constellations = 0;
+    i->output_separations = 0;
+    i->cache_size = 0;
+    i->ephemeris_file = NULL;
+    i->ephemeris_tolerance = 0;
+    i->apparent_cache = NULL;
+    i->apparent_cache_tolerance = 1e-3;
+    i->interpolate_tolerance = 0;
+    i->dense_grid = 0;
     i->output_binary = 0;
     i->objects_count = 0;
+    i->body_id = NULL;
+    i->object_name = NULL;
     i->objects_input_list = "jupiter";
     i->jd_list = NULL;
 }
@@ -54,13 +68,33 @@ void settings_process(settings *i) {
     int k, l;
     char name[FNAME_LENGTH];
 
+    // Limit the memory used to cache DE430 data, if requested
+    if (i->cache_size > 0) jpl_setCacheSize((long) i->cache_size * 1024 * 1024);
+    if (i->ephemeris_file != NULL) jpl_setCompactEphemeris(i->ephemeris_file);
+    if (i->ephemeris_tolerance > 0) jpl_setTolerance(i->ephemeris_tolerance);
+
+    // Count the commas in <i->objects_input_list>, to find an upper limit on the number of objects in it
+    int objects_max = 1;
+    for (k = 0; i->objects_input_list[k] > '\0'; k++) if (i->objects_input_list[k] == ',') objects_max++;
+
+    // Allocate storage for the names and IDs of the objects, and a copy of the list which we split into names
+    char *names = (char *) lt_malloc(strlen(i->objects_input_list) + 1);
+    i->object_name = (char **) lt_malloc(objects_max * sizeof(char *));
+    i->body_id = (int *) lt_malloc(objects_max * sizeof(int));
+    if ((names == NULL) || (i->object_name == NULL) || (i->body_id == NULL)) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
     // Transfer the names of objects we are to compute ephemerides for from <i->objects_input_list> to <i->object_name>
+    i->objects_count = 0;
     k = l = 0;
     while (i->objects_input_list[k] > '\0') {
         // Commas are used to separate object names on the command line
         if (i->objects_input_list[k] == ',') {
             if (l > 0) {
-                i->object_name[i->objects_count][l] = '\0';
+                names[l++] = '\0';
+                names += l;
                 i->objects_count++;
                 l = 0;
             }
@@ -69,12 +103,13 @@ void settings_process(settings *i) {
         }
 
         // All characters other than commas are part of object names
-        i->object_name[i->objects_count][l++] = i->objects_input_list[k++];
+        if (l == 0) i->object_name[i->objects_count] = names;
+        names[l++] = i->objects_input_list[k++];
     }
 
     // Make sure that last object is added to list
     if (l > 0) {
-        i->object_name[i->objects_count][l] = '\0';
+        names[l] = '\0';
         i->objects_count++;
     }
 
@@ -124,14 +159,27 @@ void settings_process(settings *i) {
             // Loop over comets seeing if names match
             int index;
             for (index = 0; index < comet_count; index++) {
-                // Fetch comet information
-                orbitalElements *item = orbitalElements_comets_fetch(index);
+                // Fetch comet's name; we don't need its orbital elements here
+                const orbitalElementsMetadata *item = orbitalElements_comets_fetchMetadata(index);
 
                 if ((str_cmp_no_case(name, item->name) == 0) || (str_cmp_no_case(name, item->name2) == 0)) {
-                    i->body_id[k] = 20000000 + index;
+                    i->body_id[k] = 20000000 + item->number;
                     break;
                 }
             }
+
+            // Search for asteroids with matching names. This includes unnumbered asteroids, which can be referred to
+            // by their provisional designations.
+            if (i->body_id[k] < 0) {
+                orbitalElements_asteroids_loadAllMetadata();
+
+                for (index = 0; index < asteroid_count; index++) {
+                    if (str_cmp_no_case(name, asteroid_metadata[index].name) == 0) {
+                        i->body_id[k] = 10000000 + asteroid_metadata[index].number;
+                        break;
+                    }
+                }
+            }
         }
 
         if (i->body_id[k] < 0) {
@@ -140,6 +188,9 @@ void settings_process(settings *i) {
             exit(1);
         }
     }
+
+    // Read the list of observing sites, if one was supplied
+    if (i->site_list != NULL) i->sites = siteList_load(i->site_list);
 }
 
 // Delete any memory allocated within a settings structure
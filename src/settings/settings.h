@@ -23,18 +23,30 @@
 #define SETTINGS_H 1
 
 #include "coreUtils/strConstants.h"
-
-#define MAX_OBJECTS 48
+#include "ephemCalc/siteList.h"
 
 typedef struct settings {
     double jd_min, jd_max, jd_step, ra_dec_epoch;  // All specified in TT
     double latitude, longitude;  // Used for topocentric correction
     int enable_topocentric_correction;  // Boolean
+    const char *site_list;  // Filename of a list of observing sites; if set, overrides <latitude> and <longitude>
+    siteList *sites;  // The list of observing sites, or NULL if none was supplied
     int use_orbital_elements, output_binary, output_format, output_constellations;
-    int body_id[MAX_OBJECTS];
-    char object_name[MAX_OBJECTS][FNAME_LENGTH];
+    int output_separations;  // 0 (none), 1 (separations of each pair of objects), 2 (also position angles)
+    int cache_size;  // Memory budget for caching DE430 data, in MB; 0 for no limit
+    const char *ephemeris_file;  // Filename of a compact ephemeris to use in place of DE430, or NULL
+    double ephemeris_tolerance;  // Accuracy needed in positions from DE430, in km; 0 for full precision
+    const char *apparent_cache;  // Filename of a cache of fitted apparent places, or NULL
+    double apparent_cache_tolerance;  // Accuracy needed in apparent places from the cache; arcsec
+    double interpolate_tolerance;  // Accuracy of interpolated rows; arcsec. 0 to compute every row in full.
+    int dense_grid;  // Boolean; look up the Earth's position at blocks of evenly spaced times with matrix products
     const char *objects_input_list, *jd_list;
+
+    // The objects we are to compute ephemerides for, allocated by <settings_process> to the length of
+    // <objects_input_list>
     int objects_count;
+    int *body_id;
+    char **object_name;
 } settings;
 
 void settings_default(settings *i);
@@ -0,0 +1,251 @@
+// skyQuery.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for finding all the asteroids and comets which lie within regions of the sky at particular times.
+// An index of the positions of every object is built once, on a coarse grid of times, after which each query only
+// needs to compute the precise positions of a handful of candidate objects.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/orbitalElements.h"
+#include "ephemCalc/orbitalElementsIndex.h"
+#include "ephemCalc/skyIndex.h"
+
+#include "listTools/ltMemory.h"
+
+static const char *const usage[] = {
+        "skyQuery.bin [options] [[--] args]",
+        "skyQuery.bin [options]",
+        NULL,
+};
+
+//! sky_query_settings - The settings which describe the index of the sky we are to build
+typedef struct {
+    double jd_min, jd_max, jd_step;  // TT; days
+    double cell_size;  // degrees
+    const char *catalogue;
+    orbitalElementsFilter filter;
+} sky_query_settings;
+
+//! sky_query_objects - Make a list of the objects to include in the sky index
+//! \param [in] s - The settings for the sky index
+//! \param [out] body_id - The bodyIds of the objects to include
+//! \return - The number of objects to include
+
+int sky_query_objects(sky_query_settings *s, int **body_id) {
+    int i, object_count = 0;
+    const int include_asteroids = (strcmp(s->catalogue, "asteroids") == 0) || (strcmp(s->catalogue, "all") == 0);
+    const int include_comets = (strcmp(s->catalogue, "comets") == 0) || (strcmp(s->catalogue, "all") == 0);
+
+    if ((!include_asteroids) && (!include_comets)) {
+        snprintf(temp_err_string, FNAME_LENGTH,
+                 "Unrecognised catalogue <%s>. Should be 'asteroids', 'comets' or 'all'.", s->catalogue);
+        ephem_fatal(__FILE__, __LINE__, temp_err_string);
+        exit(1);
+    }
+
+    orbitalElements_asteroids_init();
+    orbitalElements_comets_init();
+
+    *body_id = (int *) lt_malloc((asteroid_count + comet_count + 1) * sizeof(int));
+    if (*body_id == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    if (include_asteroids) {
+        int *slots = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+        if (slots == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+
+        // Inclinations are specified in degrees on the command line
+        s->filter.inc_min *= M_PI / 180;
+        s->filter.inc_max *= M_PI / 180;
+
+        const int count = orbitalElementsIndex_asteroids_query(&s->filter, slots);
+        for (i = 0; i < count; i++) {
+            (*body_id)[object_count++] = 10000000 + orbitalElements_asteroids_fetchMetadata(slots[i])->number;
+        }
+    }
+
+    if (include_comets) {
+        // Comets are not indexed by their orbital elements, so we include all of them
+        for (i = 0; i < comet_count; i++) {
+            (*body_id)[object_count++] = 20000000 + orbitalElements_comets_fetchMetadata(i)->number;
+        }
+    }
+
+    return object_count;
+}
+
+//! sky_query_run - Build an index of the sky, and then answer queries read from stdin, one per line. Each query is
+//! either "cone <jd> <ra> <dec> <radius>" or "box <jd> <ra_min> <ra_max> <dec_min> <dec_max>", with all angles in
+//! radians. For each object found, a line is written to stdout giving the number of the query, the bodyId of the
+//! object, its RA and Dec, its magnitude, and its distance from the Earth.
+//! \param [in] s - The settings for the sky index
+
+void sky_query_run(sky_query_settings *s) {
+    int *body_id;
+    const int object_count = sky_query_objects(s, &body_id);
+
+    skyIndex *index = skyIndex_build(body_id, object_count, s->jd_min, s->jd_max, s->jd_step,
+                                     s->cell_size * M_PI / 180);
+
+    skyIndexMatch *matches = (skyIndexMatch *) lt_malloc((object_count + 1) * sizeof(skyIndexMatch));
+    if (matches == NULL) {
+        ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+        exit(1);
+    }
+
+    // Answer queries one at a time
+    int query_index = 0;
+    while ((!feof(stdin)) && (!ferror(stdin))) {
+        int i, match_count;
+        char line[LSTR_LENGTH], query_type[64];
+        double jd, a, b, c, d;
+
+        file_readline(stdin, line);
+        const int items = sscanf(line, "%63s %lf %lf %lf %lf %lf", query_type, &jd, &a, &b, &c, &d);
+        if (items < 1) continue;
+
+        if ((strcmp(query_type, "cone") == 0) && (items == 5)) {
+            match_count = skyIndex_coneQuery(index, jd, a, b, c, matches);
+        } else if ((strcmp(query_type, "box") == 0) && (items == 6)) {
+            match_count = skyIndex_boxQuery(index, jd, a, b, c, d, matches);
+        } else {
+            snprintf(temp_err_string, FNAME_LENGTH, "Could not parse query <%s>.", line);
+            ephem_warning(temp_err_string);
+            query_index++;
+            continue;
+        }
+
+        if (match_count < 0) {
+            snprintf(temp_err_string, FNAME_LENGTH,
+                     "Query %d is at JD %.6f, which lies outside the range of the index.", query_index, jd);
+            ephem_warning(temp_err_string);
+        }
+
+        for (i = 0; i < match_count; i++) {
+            printf("%6d %9d %12.9f %12.9f %6.3f %12.9f\n", query_index, matches[i].body_id,
+                   matches[i].ra, matches[i].dec, matches[i].mag, matches[i].earth_dist);
+        }
+        fflush(stdout);
+        query_index++;
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Answered %d queries.", query_index);
+        ephem_log(temp_err_string);
+    }
+}
+
+int main(int argc, const char **argv) {
+    sky_query_settings s;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising sky query tool.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default sky query parameters.");
+    s.jd_min = 2451545.0;
+    s.jd_max = 2451545.0 + 30;
+    s.jd_step = 1;
+    s.cell_size = 2;
+    s.catalogue = "all";
+    orbitalElementsIndex_defaultFilter(&s.filter);
+    s.filter.secure_only = 0;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('a', "jd_min", &s.jd_min, "The earliest Julian day number at which queries may be made; TT"),
+            OPT_FLOAT('b', "jd_max", &s.jd_max, "The latest Julian day number at which queries may be made; TT"),
+            OPT_FLOAT('s', "jd_step", &s.jd_step,
+                      "The interval between the times at which the index samples positions; days"),
+            OPT_FLOAT('g', "cell_size", &s.cell_size, "The size of the cells the sky is divided into; degrees"),
+            OPT_STRING('c', "catalogue", &s.catalogue,
+                       "The catalogue of objects to include; either 'asteroids', 'comets' or 'all'"),
+            OPT_GROUP("Selection of asteroids"),
+            OPT_FLOAT(0, "a_min", &s.filter.a_min, "Minimum semi-major axis (AU)"),
+            OPT_FLOAT(0, "a_max", &s.filter.a_max, "Maximum semi-major axis (AU)"),
+            OPT_FLOAT(0, "e_min", &s.filter.e_min, "Minimum eccentricity"),
+            OPT_FLOAT(0, "e_max", &s.filter.e_max, "Maximum eccentricity"),
+            OPT_FLOAT(0, "i_min", &s.filter.inc_min, "Minimum inclination (deg)"),
+            OPT_FLOAT(0, "i_max", &s.filter.inc_max, "Maximum inclination (deg)"),
+            OPT_FLOAT(0, "q_min", &s.filter.q_min, "Minimum perihelion distance (AU)"),
+            OPT_FLOAT(0, "q_max", &s.filter.q_max, "Maximum perihelion distance (AU)"),
+            OPT_FLOAT(0, "H_min", &s.filter.H_min, "Minimum absolute magnitude"),
+            OPT_FLOAT(0, "H_max", &s.filter.H_max, "Maximum absolute magnitude"),
+            OPT_INTEGER(0, "secure_only", &s.filter.secure_only,
+                        "Set to 1 to include only asteroids with secure orbits"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nFind all the asteroids and comets within regions of the sky, read from stdin",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    if ((s.jd_step <= 0) || (s.cell_size <= 0) || (s.jd_max < s.jd_min)) {
+        ephem_fatal(__FILE__, __LINE__, "The time step and cell size must be positive, and jd_max >= jd_min.");
+        exit(1);
+    }
+
+    // Answer queries
+    sky_query_run(&s);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}
@@ -0,0 +1,284 @@
+// snapshot.c
+//
+// -------------------------------------------------
+// Copyright 2015-2025 Dominic Ford
+//
+// This file is part of EphemerisCompute.
+//
+// EphemerisCompute is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// EphemerisCompute is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with EphemerisCompute.  If not, see <http://www.gnu.org/licenses/>.
+// -------------------------------------------------
+
+// This is a tool for computing the positions of every object in the asteroid or comet catalogue at one instant, or
+// at a short list of instants. The output is written as columns of binary data, one column per quantity.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+
+#include "argparse/argparse.h"
+
+#include "coreUtils/asciiDouble.h"
+#include "coreUtils/strConstants.h"
+#include "coreUtils/errorReport.h"
+
+#include "ephemCalc/constellations.h"
+#include "ephemCalc/orbitalElements.h"
+#include "ephemCalc/orbitalElementsIndex.h"
+
+#include "listTools/ltMemory.h"
+
+// The quantities we output for each object, in addition to its number
+#define N_COLUMNS 6
+
+static const char *const usage[] = {
+        "snapshot.bin [options] [[--] args]",
+        "snapshot.bin [options]",
+        NULL,
+};
+
+//! snapshot_settings - The settings which describe the snapshot we are to produce
+typedef struct {
+    double jd;  // TT
+    const char *jd_list;
+    const char *catalogue;
+    double ra_dec_epoch;
+    int output_binary;
+    orbitalElementsFilter filter;
+} snapshot_settings;
+
+//! snapshot_time_point - Compute the positions of all the selected objects at a single instant, and write them to
+//! <output>.
+//! \param [in] s - The settings for the snapshot
+//! \param [in] output - The file to write the snapshot to
+//! \param [in] jd - The Julian date of the snapshot; TT
+//! \param [in] object_count - The number of objects in the snapshot
+//! \param [in] body_id - The bodyIds of the objects in the snapshot
+//! \param [in] number - The numbers of the objects in the snapshot, as written to the output
+//! \param [out] columns - Buffers of length <object_count>, for each of the N_COLUMNS quantities we output
+
+void snapshot_time_point(const snapshot_settings *s, FILE *output, const double jd, const int object_count,
+                         const int *body_id, const int *number, double **columns) {
+    int i, j;
+
+    // The positions of the Earth and Sun are the same for every object, so only look them up once
+    orbitalElementsEpochState epoch_state;
+    orbitalElements_computeEpochState(jd, &epoch_state);
+
+#pragma omp parallel for shared(epoch_state, columns) private(i)
+    for (i = 0; i < object_count; i++) {
+        double ra = 0, dec = 0, x = 0, y = 0, z = 0;
+        double mag = 0, phase = 0, ang_size = 0, phy_size = 0, albedo = 0, sun_dist = 0;
+        double earth_dist = 0, sun_ang_dist = 0, theta_eso = 0;
+        double ecliptic_longitude = 0, ecliptic_latitude = 0, ecliptic_distance = 0;
+
+        orbitalElements_computeEphemerisAtEpoch(body_id[i], &epoch_state, &x, &y, &z, &ra, &dec, &mag,
+                                                &phase, &ang_size, &phy_size,
+                                                &albedo, &sun_dist, &earth_dist, &sun_ang_dist, &theta_eso,
+                                                &ecliptic_longitude, &ecliptic_latitude,
+                                                &ecliptic_distance, s->ra_dec_epoch,
+                                                0, 0, 0);
+
+        columns[0][i] = ra;
+        columns[1][i] = dec;
+        columns[2][i] = mag;
+        columns[3][i] = earth_dist;
+        columns[4][i] = sun_dist;
+        columns[5][i] = sun_ang_dist;
+    }
+
+    // Produce binary output: a header giving the time and the number of objects, followed by one column at a time
+    if (s->output_binary) {
+        fwrite((void *) &jd, sizeof(double), 1, output);
+        fwrite((void *) &object_count, sizeof(int), 1, output);
+        fwrite((void *) number, sizeof(int), object_count, output);
+        for (j = 0; j < N_COLUMNS; j++) fwrite((void *) columns[j], sizeof(double), object_count, output);
+    }
+
+        // Produce text-based output, with one line per object
+    else {
+        for (i = 0; i < object_count; i++) {
+            fprintf(output, "%.12f %8d %12.9f %12.9f %6.3f %12.9f %12.9f %12.9f\n", jd, number[i],
+                    columns[0][i], columns[1][i], columns[2][i], columns[3][i], columns[4][i], columns[5][i]);
+        }
+    }
+}
+
+//! snapshot_compute - Main entry point to compute a snapshot, with parameters described by a snapshot_settings
+//! structure.
+//! \param [in] s - The settings for the snapshot
+
+void snapshot_compute(snapshot_settings *s) {
+    FILE *output = stdout;
+    int i, object_count = 0;
+    int *body_id, *number;
+    double *columns[N_COLUMNS];
+
+    // Make a list of the objects to include in the snapshot
+    if (strcmp(s->catalogue, "asteroids") == 0) {
+        orbitalElements_asteroids_init();
+
+        int *slots = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+        body_id = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+        number = (int *) lt_malloc((asteroid_count + 1) * sizeof(int));
+        if ((slots == NULL) || (body_id == NULL) || (number == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+
+        // Inclinations are specified in degrees on the command line
+        s->filter.inc_min *= M_PI / 180;
+        s->filter.inc_max *= M_PI / 180;
+
+        object_count = orbitalElementsIndex_asteroids_query(&s->filter, slots);
+        for (i = 0; i < object_count; i++) {
+            number[i] = orbitalElements_asteroids_fetchMetadata(slots[i])->number;
+            body_id[i] = 10000000 + number[i];
+        }
+    } else if (strcmp(s->catalogue, "comets") == 0) {
+        // Comets are not indexed by their orbital elements, so we include all of them
+        orbitalElements_comets_init();
+
+        body_id = (int *) lt_malloc((comet_count + 1) * sizeof(int));
+        number = (int *) lt_malloc((comet_count + 1) * sizeof(int));
+        if ((body_id == NULL) || (number == NULL)) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+
+        for (i = 0; i < comet_count; i++) {
+            number[i] = orbitalElements_comets_fetchMetadata(i)->number;
+            body_id[i] = 20000000 + number[i];
+        }
+        object_count = comet_count;
+    } else {
+        snprintf(temp_err_string, FNAME_LENGTH, "Unrecognised catalogue <%s>. Should be 'asteroids' or 'comets'.",
+                 s->catalogue);
+        ephem_fatal(__FILE__, __LINE__, temp_err_string);
+        exit(1);
+    }
+
+    if (DEBUG) {
+        snprintf(temp_err_string, FNAME_LENGTH, "Computing snapshot of %d objects.", object_count);
+        ephem_log(temp_err_string);
+    }
+
+    // Allocate buffers to hold each column of output
+    for (i = 0; i < N_COLUMNS; i++) {
+        columns[i] = (double *) lt_malloc((object_count + 1) * sizeof(double));
+        if (columns[i] == NULL) {
+            ephem_fatal(__FILE__, __LINE__, "Malloc fail.");
+            exit(1);
+        }
+    }
+
+    if (s->jd_list == NULL) {
+        snapshot_time_point(s, output, s->jd, object_count, body_id, number, columns);
+    } else {
+        // Loop over explicit list of time points
+        const char *scan = s->jd_list;
+        while (*scan != '\0') {
+            char jd_string[FNAME_LENGTH];
+            str_comma_separated_list_scan(&scan, jd_string);
+            const double jd = get_float(jd_string, NULL);
+            snapshot_time_point(s, output, jd, object_count, body_id, number, columns);
+        }
+    }
+
+    if (DEBUG) {
+        char line[FNAME_LENGTH];
+        strcpy(line, "Finished computing snapshot.");
+        ephem_log(line);
+    }
+    fclose(output);
+}
+
+int main(int argc, const char **argv) {
+    snapshot_settings s;
+
+    // Initialise sub-modules
+    if (DEBUG) ephem_log("Initialising snapshot computer.");
+    lt_memoryInit(&ephem_error, &ephem_log);
+    constellations_init();
+
+    // Turn off GSL's automatic error handler
+    gsl_set_error_handler_off();
+
+    // Set up default settings
+    if (DEBUG) ephem_log("Setting up default snapshot parameters.");
+    s.jd = 2451545.0;
+    s.jd_list = NULL;
+    s.catalogue = "asteroids";
+    s.ra_dec_epoch = 2451545.0;  // By default, use J2000 coordinates
+    s.output_binary = 1;
+    orbitalElementsIndex_defaultFilter(&s.filter);
+    s.filter.secure_only = 0;
+
+    // Scan commandline options for any switches
+    struct argparse_option options[] = {
+            OPT_HELP(),
+            OPT_GROUP("Basic options"),
+            OPT_FLOAT('j', "jd", &s.jd,
+                      "The Julian day number at which to compute the positions of objects; TT"),
+            OPT_STRING('l', "jd_list", &s.jd_list,
+                       "The list of Julian day numbers to calculate (optional). If specified, this overrides <jd>."),
+            OPT_STRING('c', "catalogue", &s.catalogue,
+                       "The catalogue of objects to include; either 'asteroids' or 'comets'"),
+            OPT_FLOAT('e', "epoch", &s.ra_dec_epoch,
+                      "The epoch of the RA/Dec coordinate system, e.g. 2451545.0 for J2000"),
+            OPT_INTEGER('z', "output_binary", &s.output_binary,
+                        "Set to either 0 (text output) or 1 (binary output)"),
+            OPT_GROUP("Selection of asteroids"),
+            OPT_FLOAT(0, "a_min", &s.filter.a_min, "Minimum semi-major axis (AU)"),
+            OPT_FLOAT(0, "a_max", &s.filter.a_max, "Maximum semi-major axis (AU)"),
+            OPT_FLOAT(0, "e_min", &s.filter.e_min, "Minimum eccentricity"),
+            OPT_FLOAT(0, "e_max", &s.filter.e_max, "Maximum eccentricity"),
+            OPT_FLOAT(0, "i_min", &s.filter.inc_min, "Minimum inclination (deg)"),
+            OPT_FLOAT(0, "i_max", &s.filter.inc_max, "Maximum inclination (deg)"),
+            OPT_FLOAT(0, "q_min", &s.filter.q_min, "Minimum perihelion distance (AU)"),
+            OPT_FLOAT(0, "q_max", &s.filter.q_max, "Maximum perihelion distance (AU)"),
+            OPT_FLOAT(0, "H_min", &s.filter.H_min, "Minimum absolute magnitude"),
+            OPT_FLOAT(0, "H_max", &s.filter.H_max, "Maximum absolute magnitude"),
+            OPT_INTEGER(0, "secure_only", &s.filter.secure_only,
+                        "Set to 1 to include only asteroids with secure orbits"),
+            OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usage, 0);
+    argparse_describe(&argparse,
+                      "\nCompute the positions of every object in a catalogue at one instant",
+                      "\n");
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc != 0) {
+        int i;
+        for (i = 0; i < argc; i++) {
+            printf("Error: unparsed argument <%s>\n", *(argv + i));
+        }
+        ephem_fatal(__FILE__, __LINE__, "Unparsed arguments");
+    }
+
+    // Compute snapshot
+    snapshot_compute(&s);
+
+    lt_freeAll(0);
+    lt_memoryStop();
+    if (DEBUG) ephem_log("Terminating normally.");
+    return 0;
+}